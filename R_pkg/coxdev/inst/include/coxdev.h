@@ -2,6 +2,40 @@
 #include <iostream>
 #endif
 
+// Debug builds (-DCOXDEV_COUNT_ALLOCATIONS) count heap allocations made while
+// one of the numerical kernels runs, so tests can check that evaluation at a
+// fixed design stays allocation-free. operator new is replaced in coxdev.cpp;
+// Eigen allocates with malloc instead, so EIGEN_NO_MALLOC is turned on and
+// its failed check is counted rather than asserted on. Must precede Eigen.
+#ifdef COXDEV_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cassert>
+#include <cstring>
+namespace coxdev_alloc {
+  extern std::atomic<long> count; // allocations made inside kernels
+  extern thread_local int depth;  // > 0 while a kernel runs on this thread
+  inline void note() { if (depth > 0) ++count; }
+  inline void eigen_check(bool ok, const char *what) {
+    if (!ok) {
+      if (std::strstr(what, "heap allocation") != nullptr) {
+	note();
+      } else {
+	assert(false && "Eigen assertion failed");
+      }
+    }
+  }
+  struct Scope {
+    Scope() { ++depth; }
+    ~Scope() { --depth; }
+  };
+}
+#define EIGEN_NO_MALLOC
+#define eigen_assert(x) coxdev_alloc::eigen_check(static_cast<bool>(x), #x)
+#define COXDEV_KERNEL_SCOPE coxdev_alloc::Scope coxdev_alloc_scope;
+#else
+#define COXDEV_KERNEL_SCOPE
+#endif
+
 #define MAKE_MAP_Xd(y) Eigen::Map<Eigen::VectorXd>((y).data(), (y).size())
 #define MAKE_MAP_Xi(y) Eigen::Map<Eigen::VectorXi>((y).data(), (y).size())
 
@@ -12,37 +46,122 @@
 #include <pybind11/eigen.h>
 #include <Eigen/Dense>
 
-// Map python buffers list element into an Eigen double vector
-// SRC_LIST = python list, OFFSET = index offset (e.g. 0 or 1),
-// DEST will be the ref downstream, TMP should be **unique** throwaway name with each invocation
-#define MAP_BUFFER_LIST(SRC_LIST, OFFSET, DEST, TMP)				\
-  py::array_t<double> TMP = SRC_LIST[OFFSET].cast<py::array_t<double>>();       \
-  Eigen::Map<Eigen::VectorXd> DEST(TMP.mutable_data(), TMP.size());
-
 namespace py = pybind11;
 #define EIGEN_REF Eigen::Ref
 #define ERROR_MSG(x) throw std::runtime_error(x)
 #define BUFFER_LIST py::list & // List of vectors for scratch space
 #define HESSIAN_MATVEC_TYPE void
-#define PREPROCESS_TYPE std::tuple<py::dict, Eigen::VectorXi, Eigen::VectorXi> 
+#define PREPROCESS_TYPE py::tuple // (preproc, event_order, start_order); int32 or int64 indices
+#define STATS_TYPE py::dict // phase name -> dict(seconds, calls, bytes)
 #endif
 
 #ifdef R_INTERFACE
 
 #include <RcppEigen.h>
 
-// Map buffer list element into an Eigen double vector
-// SRC_LIST = R list, OFFSET = index offset (e.g. 0 or 1),
-// DEST will be the ref downstream, TMP should be **unique** throwaway name with each invocation
-#define MAP_BUFFER_LIST(SRC_LIST, OFFSET, DEST, TMP)				\
-  Rcpp::NumericVector TMP = Rcpp::as<Rcpp::NumericVector>(SRC_LIST[OFFSET]); \
-  Eigen::Map<Eigen::VectorXd> Rcpp::as<Eigen::Map<Eigen::VectorXd>>(TMP);
-
 using namespace Rcpp;
 #define EIGEN_REF Eigen::Map
 #define ERROR_MSG(x) Rcpp::stop(x)
 #define BUFFER_LIST Rcpp::List // List of vectors for scratch space.
 #define HESSIAN_MATVEC_TYPE SEXP
 #define PREPROCESS_TYPE Rcpp::List
+#define STATS_TYPE Rcpp::List // phase name -> list(seconds, calls, bytes)
+
+// R numeric vectors are always contiguous doubles.
+template <typename Scalar>
+using InputVector = Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> >;
+
+// R has no 64 bit integer vector, so indices too large for an int are
+// stored as doubles (exact up to 2^53). Exported functions take index
+// vectors as SEXP and dispatch on the storage type: integer vectors are
+// mapped without a copy, doubles are mapped through the int64 copy made
+// when they were built (see RIndexCache) or else converted for the call.
+#define R_INDEX_DISPATCH(X, ...)		\
+  if (TYPEOF(X) == INTSXP) {			\
+    typedef int IndexType;			\
+    __VA_ARGS__;				\
+  } else {					\
+    typedef int64_t IndexType;			\
+    __VA_ARGS__;				\
+  }
+// The temporary owns any converted storage until the end of the call.
+#define R_INDEX_MAP(X) RIndexVector<IndexType>(X).map
+#endif
+
+// The kernels themselves, free of python and R
+#include "coxdev_core.h"
+#include "coxdev_concordance.h"
+#include "coxdev_survival.h"
+#include "coxdev_residuals.h"
+#include "coxdev_robust.h"
+#include "coxdev_bootstrap.h"
+#include "coxdev_information.h"
+#include "coxdev_stream.h"
+#include "coxdev_screen.h"
+#include "coxdev_multi.h"
+#include "coxdev_horizon.h"
+#include "coxdev_landmark.h"
+#include "coxdev_finegray.h"
+#include "coxdev_exact.h"
+#include "coxdev_sampled.h"
+
+using coxdev::IndexVector;
+using coxdev::VectorXi64;
+using coxdev::use_int32_index;
+
+#ifdef PY_INTERFACE
+// Read-only caller data (linear predictor, weights, matvec argument).
+// The inner stride lets pybind11 map strided numpy views (e.g. a column of
+// a Fortran ordered matrix) without a copy; Scalar is double or float.
+using coxdev::InputVector;
+#endif
+
+#ifdef R_INTERFACE
+template <typename IndexType> struct RIndexVector;
+
+template <> struct RIndexVector<int> {
+  Eigen::Map<Eigen::VectorXi> map;
+  explicit RIndexVector(SEXP x) : map(Rcpp::as<Eigen::Map<Eigen::VectorXi> >(x)) {}
+};
+
+// The int64 copy of a double index vector, attached to it as an external
+// pointer by r_index_wrap when the design is built. It is only used while
+// the vector still holds the data it was made from: vectors R derives from
+// it (event_order + 1, say) carry the attribute along but not the data.
+struct RIndexCache {
+  const double *source;
+  VectorXi64 indices;
+};
+
+inline SEXP r_index_cache_symbol() {
+  static SEXP symbol = Rf_install("coxdev_int64");
+  return symbol;
+}
+
+inline const VectorXi64 *r_index_cache(SEXP x) {
+  SEXP ptr = Rf_getAttrib(x, r_index_cache_symbol());
+  if (TYPEOF(ptr) != EXTPTRSXP) {
+    return nullptr;
+  }
+  // null after the vector was serialized and read back
+  const RIndexCache *cache = static_cast<const RIndexCache *>(R_ExternalPtrAddr(ptr));
+  if (cache == nullptr || cache->source != REAL(x) || cache->indices.size() != XLENGTH(x)) {
+    return nullptr;
+  }
+  return &cache->indices;
+}
+
+template <> struct RIndexVector<int64_t> {
+  VectorXi64 storage;
+  Eigen::Map<VectorXi64> map;
+  explicit RIndexVector(SEXP x) : map(nullptr, 0) {
+    if (const VectorXi64 *cached = r_index_cache(x)) {
+      new (&map) Eigen::Map<VectorXi64>(const_cast<int64_t *>(cached->data()), cached->size());
+    } else {
+      storage = Rcpp::as<Eigen::Map<Eigen::VectorXd> >(x).cast<int64_t>();
+      new (&map) Eigen::Map<VectorXi64>(storage.data(), storage.size());
+    }
+  }
+};
 #endif
 
@@ -0,0 +1,163 @@
+#ifndef COXDEV_BOOTSTRAP_H
+#define COXDEV_BOOTSTRAP_H
+
+// Bootstrap replicates of the deviance over one preprocessed design, with
+// the replicate weights drawn row by row as they are needed rather than
+// stored as an n x B matrix.
+//
+// The weight of row i in replicate b is a function of (seed, b, i) alone,
+// a counter based generator: a splitmix64 hash of the three, turned into a
+// Poisson(1) count (the usual resampling bootstrap, up to the total count)
+// or an Exp(1) draw (Rubin's Bayesian bootstrap, Dirichlet weights scaled
+// by n). So any subset of replicates may be evaluated, by any number of
+// threads in any order, and each replicate's deviance is bit for bit the
+// same as evaluating it alone.
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// The splitmix64 output function of x + the golden ratio increment.
+inline std::uint64_t splitmix64(std::uint64_t x)
+{
+  std::uint64_t z = x + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Uniform on (0, 1), from the 53 high bits of the hash of (seed, replicate, row).
+inline double bootstrap_uniform(std::uint64_t seed,
+				std::uint64_t replicate,
+				std::uint64_t row)
+{
+  const std::uint64_t h = splitmix64(splitmix64(splitmix64(seed) ^ replicate) ^ row);
+  return (static_cast<double>(h >> 11) + 0.5) * 0x1.0p-53;
+}
+
+// Weight of row in replicate: Poisson(1) by inversion, or Exp(1) when bayesian.
+inline double bootstrap_weight(bool bayesian,
+			       std::uint64_t seed,
+			       std::uint64_t replicate,
+			       std::uint64_t row)
+{
+  const double u = bootstrap_uniform(seed, replicate, row);
+  if (bayesian) {
+    return -std::log(u);
+  }
+  // P(N = 0) = exp(-1); the tail beyond 20 has probability below 1e-19
+  double p = 0.36787944117144233;
+  double F = p;
+  int k = 0;
+  while (u > F && k < 20) {
+    ++k;
+    p /= k;
+    F += p;
+  }
+  return k;
+}
+
+// The replicate weights of replicate, in native order.
+inline void bootstrap_weights(bool bayesian,
+			      std::uint64_t seed,
+			      std::uint64_t replicate,
+			      VectorRef weight)
+{
+  for (Eigen::Index i = 0; i < weight.size(); ++i) {
+    weight(i) = bootstrap_weight(bayesian, seed, replicate, i);
+  }
+}
+
+// Deviances of the replicates begin, ..., end - 1 into deviance (length
+// end - begin) and, unless X_gradient is 0 x 0, X' times their gradients
+// into the columns of the p x (end - begin) matrix X_gradient. Replicate b
+// has weights sample_weight times those of bootstrap_weights(bayesian, seed,
+// b). eta is centered as for cox_dev. Disjoint replicate ranges may be
+// filled by different threads, each with its own workspace. ws is left at
+// the last replicate.
+template <typename IndexType, typename ValueType>
+void bootstrap_deviances(const CoxDesign<IndexType> & design,
+			 CoxWorkspace & ws,
+			 const InputVector<ValueType> & eta,
+			 const InputVector<ValueType> & sample_weight,
+			 const InputMatrix<ValueType> & X,
+			 bool bayesian,
+			 std::uint64_t seed,
+			 Eigen::Index begin,
+			 Eigen::Index end,
+			 VectorRef deviance,
+			 MatrixRef X_gradient)
+{
+  const Eigen::Index n = design.status.size();
+  const bool do_gradient = X_gradient.size() > 0;
+  if (eta.size() != n || sample_weight.size() != n) {
+    throw std::runtime_error("bootstrap_deviances: eta and sample_weight must have an entry per observation.");
+  }
+  if (begin < 0 || begin > end || deviance.size() != end - begin) {
+    throw std::runtime_error("bootstrap_deviances: deviance must have an entry per replicate.");
+  }
+  if (do_gradient && (X.rows() != n || X_gradient.rows() != X.cols() || X_gradient.cols() != end - begin)) {
+    throw std::runtime_error("bootstrap_deviances: X_gradient must have a row per column of X and a column per replicate.");
+  }
+
+  // exp(eta) once, as the bindings clip it; exp_w = weight * exp(eta) per replicate
+  const Eigen::VectorXd exp_eta = eta.template cast<double>().array().min(30.0).exp();
+  Eigen::Matrix<ValueType, Eigen::Dynamic, 1> weight(n);
+
+  for (Eigen::Index b = begin; b < end; ++b) {
+    for (Eigen::Index i = 0; i < n; ++i) {
+      weight(i) = static_cast<ValueType>(sample_weight(i) * bootstrap_weight(bayesian, seed, b, i));
+    }
+    const double loglik_sat = compute_sat_loglik<IndexType, ValueType>(design.first, design.last, weight,
+								       design.event_order, design.status,
+								       ws.forward_cumsum[0]);
+    ws.exp_w = weight.template cast<double>().array() * exp_eta.array();
+    deviance(b - begin) = cox_dev<IndexType, ValueType>(design, ws, eta, weight, loglik_sat);
+    if (do_gradient) {
+      for (Eigen::Index j = 0; j < X.cols(); ++j) {
+	X_gradient(j, b - begin) = X.col(j).template cast<double>().dot(ws.grad);
+      }
+    }
+  }
+}
+
+// Deviances (length n_replicates) and, when X is not null, X' gradient
+// (p x n_replicates, column major) of the bootstrap replicates
+// first_replicate, ..., first_replicate + n_replicates - 1 at linear
+// predictor eta with base weights weight (null for unit weights), eta
+// centered as by deviance. work is left at the last replicate.
+template <typename IndexType>
+void bootstrap_deviances(const CoxDesignData<IndexType> & data,
+			 CoxWorkspaceData & work,
+			 const double *eta,
+			 const double *weight,
+			 bool bayesian,
+			 std::uint64_t seed,
+			 Eigen::Index first_replicate,
+			 Eigen::Index n_replicates,
+			 const double *X,
+			 Eigen::Index p,
+			 double *deviance,
+			 double *X_gradient)
+{
+  const Eigen::Index n = data.size();
+  Eigen::Map<const Eigen::VectorXd> eta_in(eta, n);
+  Eigen::Map<const Eigen::VectorXd> w(data.weights(weight), n);
+  work.center = eta_in.mean();
+  work.eta = eta_in.array() - work.center;
+  const bool do_gradient = X != nullptr && X_gradient != nullptr;
+  bootstrap_deviances<IndexType, double>(data.design(), work.ws, work.eta, w,
+					 Eigen::Map<const Eigen::MatrixXd>(X, do_gradient ? n : 0, do_gradient ? p : 0),
+					 bayesian, seed, first_replicate, first_replicate + n_replicates,
+					 Eigen::Map<Eigen::VectorXd>(deviance, n_replicates),
+					 Eigen::Map<Eigen::MatrixXd>(X_gradient, do_gradient ? p : 0,
+								     do_gradient ? n_replicates : 0));
+}
+
+} // namespace coxdev
+
+#endif
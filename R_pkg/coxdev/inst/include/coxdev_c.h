@@ -0,0 +1,366 @@
+#ifndef COXDEV_C_H
+#define COXDEV_C_H
+
+/*
+ * C interface to the coxdev kernels, for embedding without python or R.
+ *
+ * A design holds the preprocessed cohort and is only read by evaluations, so
+ * it may be shared between threads; a workspace holds the scratch space of
+ * one evaluation at a time and must be used by one thread at a time.
+ * coxdev_information_matvec reads what the last coxdev_deviance call left in
+ * its workspace.
+ *
+ * All arrays are contiguous, of length n and in the caller's (native) order.
+ * Functions returning int return COXDEV_OK on success, otherwise
+ * COXDEV_ERROR with a message available from coxdev_last_error.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COXDEV_OK 0
+#define COXDEV_ERROR 1
+
+#define COXDEV_BRESLOW 0
+#define COXDEV_EFRON 1
+
+#define COXDEV_HARRELL 0
+#define COXDEV_UNO 1
+
+#define COXDEV_POISSON 0
+#define COXDEV_BAYESIAN 1
+
+typedef struct coxdev_design coxdev_design;
+typedef struct coxdev_workspace coxdev_workspace;
+typedef struct coxdev_outcomes coxdev_outcomes;
+
+/* Preprocess event / stop times, binary status and optional start times
+   (start may be NULL) for tie breaking COXDEV_EFRON or COXDEV_BRESLOW. */
+int coxdev_design_create(int64_t n,
+			 const double *start,
+			 const double *event,
+			 const int *status,
+			 int tie_breaking,
+			 coxdev_design **design);
+
+void coxdev_design_free(coxdev_design *design);
+
+/* Number of observations. */
+int64_t coxdev_design_size(const coxdev_design *design);
+
+/* Append m observations to the design, as observations n, ..., n + m - 1,
+   merging them into its sorted orders rather than preprocessing all n + m
+   again; start is NULL exactly when the design was created without start
+   times. Room grows geometrically. Workspaces are sized for a design's
+   number of observations, so those created before must be created again. */
+int coxdev_design_append(coxdev_design *design,
+			 int64_t m,
+			 const double *start,
+			 const double *event,
+			 const int *status);
+
+int coxdev_workspace_create(const coxdev_design *design,
+			    coxdev_workspace **workspace);
+
+/* A workspace whose arrays share storage where no function needs them at
+   the same time, 16 rather than 24 doubles per observation, with the same
+   results. */
+int coxdev_workspace_create_low_memory(const coxdev_design *design,
+				       coxdev_workspace **workspace);
+
+void coxdev_workspace_free(coxdev_workspace *workspace);
+
+/* Bytes of scratch space held by the workspace. */
+int64_t coxdev_workspace_nbytes(const coxdev_workspace *workspace);
+
+/* Deviance at linear predictor eta with sample weights weight (NULL for unit
+   weights). gradient and diag_hessian, when not NULL, receive the gradient
+   and the diagonal of the Hessian of the deviance with respect to eta. */
+int coxdev_deviance(const coxdev_design *design,
+		    coxdev_workspace *workspace,
+		    const double *eta,
+		    const double *weight,
+		    double *deviance,
+		    double *gradient,
+		    double *diag_hessian);
+
+/* Product of arg with the information matrix at the point of the last
+   coxdev_deviance call with this workspace, written to out. */
+int coxdev_information_matvec(const coxdev_design *design,
+			      coxdev_workspace *workspace,
+			      const double *arg,
+			      double *out);
+
+/* The n_rows x n_columns block of the n x n information matrix at the point
+   of the last coxdev_deviance call with this workspace, written column major
+   to out: rows and columns hold indices in 0, ..., n - 1, or are NULL for all
+   n (n_rows or n_columns is then ignored). Built entry by entry from the
+   structure of the matrix rather than from information products. Uses the
+   workspace's scratch space, as coxdev_score_residuals. */
+int coxdev_information_matrix(const coxdev_design *design,
+			      coxdev_workspace *workspace,
+			      const int64_t *rows,
+			      int64_t n_rows,
+			      const int64_t *columns,
+			      int64_t n_columns,
+			      double *out);
+
+/* Concordance of eta with the survival data, weighting pairs by weight
+   (NULL for unit weights): Harrell's C for COXDEV_HARRELL, Uno's inverse
+   probability of censoring weighted C for COXDEV_UNO, counting only events
+   before tau (INFINITY for all). counts, when not NULL, receives the weighted
+   numbers of concordant, discordant and tied in eta pairs. */
+int coxdev_concordance(const coxdev_design *design,
+		       const double *eta,
+		       const double *weight,
+		       int method,
+		       double tau,
+		       double *concordance,
+		       double *counts);
+
+/* Baseline cumulative hazard (Breslow, or Efron for a COXDEV_EFRON design)
+   at the point of the last coxdev_deviance call with this workspace, for a
+   linear predictor of 0: time and cumhaz (room for n entries) receive the
+   unique event times, increasing, and the cumulative hazard at each, and
+   n_times their number. */
+int coxdev_baseline_hazard(const coxdev_design *design,
+			   const coxdev_workspace *workspace,
+			   double *time,
+			   double *cumhaz,
+			   int64_t *n_times);
+
+/* Survival curves exp(-H(t) exp(eta[i])) of the baseline (time, cumhaz) of
+   length n_times from coxdev_baseline_hazard, at n_query query times, written
+   row by row to the n x n_query matrix survival. */
+int coxdev_survival(const double *time,
+		    const double *cumhaz,
+		    int64_t n_times,
+		    const double *eta,
+		    int64_t n,
+		    const double *query,
+		    int64_t n_query,
+		    double *survival);
+
+/* Martingale residuals, and deviance residuals unless deviance is NULL, at
+   the point of the last coxdev_deviance call with this workspace; unweighted,
+   as in R's survival package. */
+int coxdev_residuals(const coxdev_design *design,
+		     const coxdev_workspace *workspace,
+		     double *martingale,
+		     double *deviance);
+
+/* Score and Schoenfeld residuals (0 for censored rows) of the p covariates
+   in the column major n x p matrix X at the point of the last
+   coxdev_deviance call, written column major to the n x p matrices score
+   and schoenfeld; either may be NULL. Uses the workspace's scratch space, so
+   information products must be taken before or after, not during. */
+int coxdev_score_residuals(const coxdev_design *design,
+			   coxdev_workspace *workspace,
+			   const double *X,
+			   int64_t p,
+			   double *score,
+			   double *schoenfeld);
+
+/* Cluster-robust variance of the coefficients of the p covariates in the
+   column major n x p matrix X at the point of the last coxdev_deviance call:
+   the p x p matrices meat, sum over clusters of the outer products of the
+   summed weighted score residuals, and covariance, the sandwich
+   I^{-1} meat I^{-1} with I the information X' H X. cluster holds a code in
+   0, ..., n_clusters - 1 for each observation. Uses the workspace's scratch
+   space, as coxdev_score_residuals. */
+int coxdev_robust_variance(const coxdev_design *design,
+			   coxdev_workspace *workspace,
+			   const double *X,
+			   int64_t p,
+			   const int64_t *cluster,
+			   int64_t n_clusters,
+			   double *meat,
+			   double *covariance);
+
+/* Deviances of the bootstrap replicates first_replicate, ...,
+   first_replicate + n_replicates - 1 at linear predictor eta, written to
+   deviance (length n_replicates). Replicate b has weights weight (NULL for
+   unit weights) times those of coxdev_bootstrap_weights for b, drawn as
+   needed and never stored. Unless X is NULL, X_gradient receives X' times
+   each replicate's gradient, column major p x n_replicates, for the column
+   major n x p matrix X. A replicate's results depend only on seed and its
+   number, so ranges may be split between threads, each with its own
+   workspace. The workspace is left at the last replicate. */
+int coxdev_bootstrap(const coxdev_design *design,
+		     coxdev_workspace *workspace,
+		     const double *eta,
+		     const double *weight,
+		     int scheme,
+		     uint64_t seed,
+		     int64_t first_replicate,
+		     int64_t n_replicates,
+		     const double *X,
+		     int64_t p,
+		     double *deviance,
+		     double *X_gradient);
+
+/* The n weights of bootstrap replicate replicate for seed: Poisson(1) counts
+   for COXDEV_POISSON, Exp(1) draws for COXDEV_BAYESIAN. */
+int coxdev_bootstrap_weights(int scheme,
+			     uint64_t seed,
+			     int64_t replicate,
+			     int64_t n,
+			     double *weight);
+
+/* Score tests of the p candidate columns of the column major n x p matrix X
+   against the null model of the last coxdev_deviance call, with null model
+   covariates the column major n x q matrix Z (NULL when q = 0): each
+   column's score x' g in score and its variance, adjusted for Z, in
+   variance (length p); score / sqrt(variance) is the test statistic. Each
+   column takes O(n + n q) work, with no information products. Uses the
+   workspace's scratch space, as coxdev_score_residuals. */
+int coxdev_score_screen(const coxdev_design *design,
+			coxdev_workspace *workspace,
+			const double *Z,
+			int64_t q,
+			const double *X,
+			int64_t p,
+			double *score,
+			double *variance);
+
+/* Saturated log likelihoods and deviances (length m) under administrative
+   censoring at each of the m non-decreasing horizons, at the point of the
+   last coxdev_deviance call, and when gradient is not NULL their gradients
+   (column major n x m). The deviances take one sweep of the event times
+   from the state that call left, with no preprocessing per horizon. */
+int coxdev_horizon_sweep(const coxdev_design *design,
+			 coxdev_workspace *workspace,
+			 const double *horizon,
+			 int64_t m,
+			 double *loglik_sat,
+			 double *deviance,
+			 double *gradient);
+
+/* The landmark supermodel: the L copies of the cohort still followed at
+   landmark[l], with follow-up truncated at horizon[l] (INFINITY for none),
+   each a stratum with its own linear predictor, column l of eta (column
+   major n x L). Saturated log likelihoods and deviances (length L) and,
+   when gradient is not NULL, gradients (column major n x L, zero off each
+   copy) are computed from the shared sorted order, without forming the
+   stacked data. weight may be NULL for unit weights. */
+int coxdev_landmark_deviances(const coxdev_design *design,
+			      const double *eta,
+			      const double *weight,
+			      const double *landmark,
+			      const double *horizon,
+			      int64_t L,
+			      double *loglik_sat,
+			      double *deviance,
+			      double *gradient);
+
+/* Deviance of the exact (discrete, conditional logistic) partial
+   likelihood for tied event times at eta with sample weights weight (NULL
+   for unit weights), whatever the design's tie breaking, with gradient and
+   diag_hessian as for coxdev_deviance. Each tie block of d events among m
+   at risk takes O(d m). */
+int coxdev_exact_deviance(const coxdev_design *design,
+			  const double *eta,
+			  const double *weight,
+			  double *deviance,
+			  double *gradient,
+			  double *diag_hessian);
+
+/* Approximate deviance at eta from risk sets subsampled as in a nested
+   case-control design: each tie block's events plus n_controls controls
+   drawn, with replacement, from the rows after it in event order, scaled
+   to an unbiased risk sum estimate. variance (if not NULL) receives the
+   estimated sampling variance of the deviance, gradient and diag_hessian
+   (if not NULL) those of the approximation, nonzero at the events and
+   drawn controls only. The draws depend only on seed and the blocks;
+   blocks with no more than n_controls rows after them are exact, so
+   n_controls >= n gives coxdev_deviance's deviance. */
+int coxdev_sampled_deviance(const coxdev_design *design,
+			    const double *eta,
+			    const double *weight,
+			    int64_t n_controls,
+			    uint64_t seed,
+			    double *deviance,
+			    double *variance,
+			    double *gradient,
+			    double *diag_hessian);
+
+/* A Fine-Gray design: event times and status codes 0 (censored), 1 (the
+   cause of interest) or 2 (a competing event), without start times. Its
+   coxdev_finegray_* evaluations take the subdistribution hazard deviance,
+   keeping subjects with a competing event at risk with weights from the
+   Kaplan-Meier estimate of the censoring distribution, applied within the
+   risk set sums rather than by expanding the data; other evaluations see
+   the cause specific Cox model, competing events censored. Fine-Gray
+   designs cannot be appended to. */
+int coxdev_finegray_create(int64_t n,
+			   const double *event,
+			   const int *status,
+			   int tie_breaking,
+			   coxdev_design **design);
+
+/* Fine-Gray deviance at eta with sample weights weight (NULL for unit
+   weights), which also weight the censoring Kaplan-Meier estimate, with
+   gradient and diag_hessian as for coxdev_deviance. */
+int coxdev_finegray_deviance(const coxdev_design *design,
+			     coxdev_workspace *workspace,
+			     const double *eta,
+			     const double *weight,
+			     double *deviance,
+			     double *gradient,
+			     double *diag_hessian);
+
+/* Product of arg with the Fine-Gray information matrix at the point of the
+   last coxdev_finegray_deviance call with this workspace, written to out. */
+int coxdev_finegray_information_matvec(const coxdev_design *design,
+				       coxdev_workspace *workspace,
+				       const double *arg,
+				       double *out);
+
+/* Preprocess K outcomes of the same n subjects: event / stop times and
+   binary status as column major n x K matrices, and optional start times
+   (start may be NULL) of length n shared by all outcomes. Like a design,
+   the result is only read by evaluations and may be shared between
+   threads. */
+int coxdev_outcomes_create(int64_t n,
+			   int64_t K,
+			   const double *start,
+			   const double *event,
+			   const int *status,
+			   int tie_breaking,
+			   coxdev_outcomes **outcomes);
+
+void coxdev_outcomes_free(coxdev_outcomes *outcomes);
+
+/* A workspace for evaluations of outcomes, one whatever their number. */
+int coxdev_outcomes_workspace_create(const coxdev_outcomes *outcomes,
+				     coxdev_workspace **workspace);
+
+/* Deviances of the count outcomes first_outcome, ... at linear predictor
+   eta with sample weights weight (NULL for unit weights) into deviance
+   (length count) and, when not NULL, their gradients with respect to eta
+   into gradient (column major n x count). exp(eta) is formed once for all
+   of them; threads may evaluate disjoint ranges, each with its own
+   workspace. */
+int coxdev_outcomes_deviance(const coxdev_outcomes *outcomes,
+			     coxdev_workspace *workspace,
+			     const double *eta,
+			     const double *weight,
+			     int64_t first_outcome,
+			     int64_t count,
+			     double *deviance,
+			     double *gradient);
+
+/* Message describing the last failure on the calling thread. */
+const char *coxdev_last_error(void);
+
+/* Turn the per-phase timing counters on or off, returning the previous setting. */
+int coxdev_set_stats_enabled(int enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef COXDEV_CONCORDANCE_H
+#define COXDEV_CONCORDANCE_H
+
+// Concordance (Harrell's C, and Uno's inverse probability of censoring
+// weighted C) from the preprocessed orderings, in O(n log n).
+//
+// A pair (i, j) is comparable when i has an event at t_i and j is at risk
+// past it: j's stop time is later than t_i, or equal to it with j censored,
+// and (with start times) j started before t_i. These are exactly the rows
+// after last(i) in event order whose start comes before i's event in start
+// order, i.e. the risk set of cox_dev without i's tied events. The pair is
+// concordant when eta_i > eta_j, discordant when eta_i < eta_j and tied in
+// risk otherwise; it has weight omega_i * w_j with omega_i = w_i for
+// Harrell's C and w_i / G(t_i-)^2 for Uno's, G the Kaplan-Meier estimate of
+// the censoring distribution. Only events with t_i < tau count.
+//
+// Events are swept in decreasing time, with a Fenwick tree over the ranks of
+// eta holding the weight of the comparable rows: a row is added once the
+// sweep passes its stop time and taken out again when it passes its start.
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// Weighted pair counts; index() is the concordance, ties in eta counting 1/2.
+struct Concordance {
+  double concordant;
+  double discordant;
+  double tied_risk;
+
+  Concordance() : concordant(0), discordant(0), tied_risk(0) {}
+
+  double comparable() const { return concordant + discordant + tied_risk; }
+
+  double index() const {
+    const double total = comparable();
+    return total > 0 ? (concordant + 0.5 * tied_risk) / total : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  Concordance & operator+=(const Concordance & other) {
+    concordant += other.concordant;
+    discordant += other.discordant;
+    tied_risk += other.tied_risk;
+    return *this;
+  }
+};
+
+// Sums of weights over ranks 0, ..., size - 1.
+class FenwickTree {
+public:
+  explicit FenwickTree(Eigen::Index size) : tree(size + 1, 0.0), total_(0.0) {}
+
+  void add(Eigen::Index rank, double value) {
+    total_ += value;
+    for (Eigen::Index k = rank + 1; k < (Eigen::Index) tree.size(); k += k & (-k)) {
+      tree[k] += value;
+    }
+  }
+
+  // sum over ranks < rank
+  double below(Eigen::Index rank) const {
+    double sum = 0.0;
+    for (Eigen::Index k = rank; k > 0; k -= k & (-k)) {
+      sum += tree[k];
+    }
+    return sum;
+  }
+
+  double total() const { return total_; }
+
+private:
+  std::vector<double> tree;
+  double total_;
+};
+
+// Dense ranks of eta, equal values sharing a rank; returns the number of ranks.
+template <typename IndexType, typename ValueType>
+Eigen::Index eta_ranks(const InputVector<ValueType> & eta,
+		       std::vector<IndexType> & rank)
+{
+  const Eigen::Index n = eta.size();
+  std::vector<IndexType> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+	    [&](IndexType i, IndexType j) { return eta(i) < eta(j); });
+  rank.resize(n);
+  Eigen::Index current = -1;
+  for (Eigen::Index k = 0; k < n; ++k) {
+    if (k == 0 || eta(order[k]) != eta(order[k - 1])) {
+      ++current;
+    }
+    rank[order[k]] = current;
+  }
+  return current + 1;
+}
+
+// Kaplan-Meier estimate of the censoring survival just before each row's
+// time, in event order: censored rows are the events here, and rows failing
+// at a time are still at risk of censoring at it. event_time is in event order.
+template <typename IndexType, typename ValueType>
+void censoring_survival(const CoxDesign<IndexType> & design,
+			const ConstVectorRef & event_time,
+			const InputVector<ValueType> & weight,
+			Eigen::VectorXd & G)
+{
+  const Eigen::Index n = design.status.size();
+  // weight at risk: stop rows from position k on, less those starting later
+  Eigen::VectorXd event_suffix(n + 1), start_suffix(n + 1);
+  event_suffix(n) = start_suffix(n) = 0.0;
+  for (Eigen::Index k = n - 1; k >= 0; --k) {
+    event_suffix(k) = event_suffix(k + 1) + static_cast<double>(weight(design.event_order(k)));
+    start_suffix(k) = start_suffix(k + 1) + static_cast<double>(weight(design.start_order(k)));
+  }
+
+  G.resize(n);
+  double surv = 1.0;
+  Eigen::Index block = 0;
+  while (block < n) {
+    Eigen::Index end = block;
+    double censored = 0.0;
+    while (end < n && event_time(end) == event_time(block)) {
+      if (design.status(end) == 0) {
+	censored += static_cast<double>(weight(design.event_order(end)));
+      }
+      ++end;
+    }
+    double at_risk = event_suffix(block);
+    if (design.have_start_times) {
+      at_risk -= start_suffix(design.event_map(block));
+    }
+    for (Eigen::Index k = block; k < end; ++k) {
+      G(k) = surv;
+    }
+    if (censored > 0 && at_risk > 0) {
+      surv *= std::max(0.0, 1.0 - censored / at_risk);
+    }
+    block = end;
+  }
+}
+
+// Weighted concordance of eta with the survival data of design; eta and
+// weight are in native order, event_time in event order. With ipcw, events
+// are weighted by the inverse squared censoring survival (Uno's C).
+template <typename IndexType, typename ValueType>
+Concordance concordance(const CoxDesign<IndexType> & design,
+			const ConstVectorRef & event_time,
+			const InputVector<ValueType> & eta,
+			const InputVector<ValueType> & weight,
+			bool ipcw = false,
+			double tau = std::numeric_limits<double>::infinity())
+{
+  const Eigen::Index n = design.status.size();
+  if (eta.size() != n || weight.size() != n || event_time.size() != n) {
+    throw std::runtime_error("concordance: eta, weight and event times must have one entry per observation.");
+  }
+
+  std::vector<IndexType> rank;
+  FenwickTree tree(eta_ranks<IndexType, ValueType>(eta, rank));
+
+  Eigen::VectorXd G;
+  if (ipcw) {
+    censoring_survival<IndexType, ValueType>(design, event_time, weight, G);
+  }
+
+  Concordance result;
+  Eigen::Index removed = n; // start order positions from here on are out of the tree
+  Eigen::Index k = n - 1;
+  while (k >= 0) {
+    const IndexType i = design.event_order(k);
+    if (design.status(k) == 0) {
+      tree.add(rank[i], static_cast<double>(weight(i)));
+      --k;
+      continue;
+    }
+    // the tied events first(k), ..., k share their comparable rows
+    const Eigen::Index first = design.first(k);
+    if (design.have_start_times) {
+      while (removed > design.event_map(k)) {
+	--removed;
+	const IndexType j = design.start_order(removed);
+	tree.add(rank[j], -static_cast<double>(weight(j)));
+      }
+    }
+    if (event_time(k) < tau && (!ipcw || G(k) > 0)) {
+      const double total = tree.total();
+      for (Eigen::Index m = first; m <= k; ++m) {
+	const IndexType e = design.event_order(m);
+	double omega = static_cast<double>(weight(e));
+	if (ipcw) {
+	  omega /= G(m) * G(m);
+	}
+	const double below = tree.below(rank[e]);
+	const double tied = tree.below(rank[e] + 1) - below;
+	result.concordant += omega * below;
+	result.tied_risk += omega * tied;
+	result.discordant += omega * (total - below - tied);
+      }
+    }
+    for (Eigen::Index m = first; m <= k; ++m) {
+      const IndexType e = design.event_order(m);
+      tree.add(rank[e], static_cast<double>(weight(e)));
+    }
+    k = first - 1;
+  }
+  return result;
+}
+
+// Concordance of eta (native order, length n) with the cohort of data, for
+// weights (null for unit weights); see concordance above.
+template <typename IndexType>
+Concordance concordance(const CoxDesignData<IndexType> & data,
+			const double *eta,
+			const double *weight,
+			bool ipcw,
+			double tau)
+{
+  const Eigen::Index n = data.size();
+  Eigen::VectorXd unit;
+  if (weight == nullptr) {
+    unit = Eigen::VectorXd::Ones(n);
+    weight = unit.data();
+  }
+  return concordance<IndexType, double>(data.design(), data.preproc.event.head(n),
+					Eigen::Map<const Eigen::VectorXd>(eta, n),
+					Eigen::Map<const Eigen::VectorXd>(weight, n),
+					ipcw, tau);
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,1102 @@
+#ifndef COXDEV_CORE_H
+#define COXDEV_CORE_H
+
+// The numerical core of coxdev: preprocessing, the deviance, its gradient and
+// diagonal Hessian and Hessian matvecs. Header only, depends on Eigen and the
+// standard library alone; the python and R bindings (coxdev.h / coxdev.cpp)
+// and the C interface (coxdev_c.h) are thin layers over it.
+//
+// Index vectors are templated on their integer type: int32 for the usual sizes,
+// int64 once n no longer fits. Loops run over Eigen::Index. Status stays an
+// int32 vector as it is really only 0, 1. Errors are reported by throwing
+// std::runtime_error.
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+// Marks a kernel for the allocation counter of debug builds, see coxdev.h
+#ifndef COXDEV_KERNEL_SCOPE
+#define COXDEV_KERNEL_SCOPE
+#endif
+
+namespace coxdev {
+
+// Index vectors (event_order, start_order, first, last, event_map, start_map)
+// are templated on their integer type: int32 keeps the memory footprint small
+// and is used whenever the data allow it, int64 otherwise.
+template <typename IndexType>
+using IndexVector = Eigen::Matrix<IndexType, Eigen::Dynamic, 1>;
+typedef IndexVector<int64_t> VectorXi64;
+
+// preprocess stacks the 2n start and event times for the joint sort, so
+// 32 bit indices are only safe while 2n still fits in an int32.
+inline bool use_int32_index(int64_t n) {
+  return 2 * n < (int64_t) INT32_MAX;
+}
+
+// Read-only caller data (linear predictor, weights, matvec argument): float or
+// double, possibly strided (e.g. a column of a Fortran ordered matrix).
+template <typename Scalar>
+using InputVector = Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>, 0, Eigen::InnerStride<> >;
+
+// Read-only caller matrices (covariates): float or double, of either storage
+// order or any strided view.
+template <typename Scalar>
+using InputMatrix = Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>, 0,
+				Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> >;
+
+// Contiguous arrays the kernels read (the preprocessed design) or write (scratch).
+template <typename IndexType>
+using IndexRef = Eigen::Ref<const IndexVector<IndexType> >;
+typedef Eigen::Ref<const Eigen::VectorXi> StatusRef;
+typedef Eigen::Ref<const Eigen::VectorXd> ConstVectorRef;
+typedef Eigen::Ref<Eigen::VectorXd> VectorRef;
+typedef Eigen::Ref<Eigen::MatrixXd> MatrixRef;
+
+// Opt-in instrumentation. Each phase accumulates wall clock time, calls and
+// an estimate of the bytes it reads and writes; times are inclusive of any
+// phase called within. The counters are process wide and only touched while
+// enabled, so a disabled phase costs one relaxed atomic load.
+enum CoxPhase {
+  PHASE_PREPROCESS,
+  PHASE_SAT_LOGLIK,
+  PHASE_COX_DEV,
+  PHASE_HESSIAN_MATVEC,
+  PHASE_RISK_SET,
+  PHASE_EVENT_SUMS,
+  PHASE_FORWARD_CUMSUMS,
+  PHASE_REORDER,
+  PHASE_APPEND,
+  PHASE_SCREEN,
+  PHASE_HORIZON,
+  PHASE_LANDMARK,
+  PHASE_FINEGRAY,
+  PHASE_EXACT,
+  PHASE_SAMPLED,
+  NUM_PHASES
+};
+
+inline const char * phase_name(int phase)
+{
+  static const char * const names[NUM_PHASES] = {
+    "preprocess",
+    "compute_sat_loglik",
+    "cox_dev",
+    "hessian_matvec",
+    "sum_over_risk_set",
+    "sum_over_events",
+    "forward_cumsums",
+    "reorder",
+    "append",
+    "score_screen",
+    "horizon_sweep",
+    "landmark",
+    "finegray",
+    "exact_ties",
+    "sampled_risk_sets"
+  };
+  return names[phase];
+}
+
+struct PhaseCounters {
+  std::atomic<bool> enabled;
+  std::atomic<long long> nanoseconds[NUM_PHASES];
+  std::atomic<long long> calls[NUM_PHASES];
+  std::atomic<long long> bytes[NUM_PHASES];
+  std::atomic<long long> buffer_remaps; // buffer list elements mapped by the bindings
+};
+
+// The process wide counters (zero initialized as a static).
+inline PhaseCounters & phase_counters()
+{
+  static PhaseCounters counters;
+  return counters;
+}
+
+inline bool stats_enabled()
+{
+  return phase_counters().enabled.load(std::memory_order_relaxed);
+}
+
+// Turn instrumentation on or off, returning the previous setting.
+inline bool set_stats_enabled(bool enabled)
+{
+  return phase_counters().enabled.exchange(enabled);
+}
+
+inline void reset_stats()
+{
+  PhaseCounters & counters = phase_counters();
+  for (int i = 0; i < NUM_PHASES; ++i) {
+    counters.nanoseconds[i] = 0;
+    counters.calls[i] = 0;
+    counters.bytes[i] = 0;
+  }
+  counters.buffer_remaps = 0;
+}
+
+// Times one call of a phase, from construction to stop() or the end of scope.
+class PhaseTimer {
+public:
+  PhaseTimer(CoxPhase which, double nbytes) :
+    phase(which), bytes(nbytes), on(stats_enabled()) {
+    if (on) start = std::chrono::steady_clock::now();
+  }
+  ~PhaseTimer() { stop(); }
+  void stop() {
+    if (on) {
+      PhaseCounters & counters = phase_counters();
+      std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+      counters.nanoseconds[phase].fetch_add(elapsed.count(), std::memory_order_relaxed);
+      counters.calls[phase].fetch_add(1, std::memory_order_relaxed);
+      counters.bytes[phase].fetch_add((long long) bytes, std::memory_order_relaxed);
+      on = false;
+    }
+  }
+private:
+  CoxPhase phase;
+  double bytes;
+  bool on;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Compute cumsum with a padding of 0 at the beginning
+// @param sequence input sequence [ro]
+// @param output output sequence  [w]
+inline void forward_cumsum(const ConstVectorRef & sequence,
+			   VectorRef output)
+{
+  if (sequence.size() + 1 != output.size()) {
+    throw std::runtime_error("forward_cumsum: output size must be one longer than input's.");
+  }
+
+  double sum = 0.0;
+  output(0) = sum;
+  for (Eigen::Index i = 1; i < output.size(); ++i) {
+    sum = sum + sequence(i - 1);
+    output(i) = sum;
+  }
+}
+
+// Compute reversed cumsums of a sequence
+// in start and / or event order with a 0 padded at the end.
+// pad by 1 at the end length=n+1 for when last=n-1
+// @param sequence input sequence [ro]
+// @param event_buffer [w]
+// @param start_buffer [w]
+// @param event_order [ro]
+// @param start_order [ro]
+// @param do_event a flag
+// @param do_start a flag
+template <typename IndexType>
+void reverse_cumsums(const ConstVectorRef & sequence,
+                     VectorRef event_buffer,
+                     VectorRef start_buffer,
+                     const IndexRef<IndexType> & event_order,
+                     const IndexRef<IndexType> & start_order,
+		     bool do_event = false,
+		     bool do_start = false)
+{
+  double sum = 0.0;
+
+  Eigen::Index n = sequence.size();
+  if (do_event) {
+    if (sequence.size() + 1 != event_buffer.size()) {
+      throw std::runtime_error("reverse_cumsums: event_buffer size must be one more than input's.");
+    }
+    event_buffer(n) = sum;
+    for (Eigen::Index i = n - 1; i >= 0;  --i) {
+      sum = sum + sequence(event_order(i));
+      event_buffer(i) = sum;
+    }
+  }
+
+  if (do_start) {
+    if (sequence.size() + 1 != start_buffer.size()) {
+      throw std::runtime_error("reverse_cumsums: event_buffer size must be one more than input's.");
+    }
+    sum = 0.0;
+    start_buffer(n) = sum;
+    for (Eigen::Index i = n - 1; i >= 0;  --i) {
+      sum = sum + sequence(start_order(i));
+      start_buffer(i) = sum;
+    }
+  }
+}
+
+// reorder an event-ordered vector into native order,
+// uses forward_scratch_buffer to make a temporary copy
+// @param arg
+// @param event_order
+// @param reorder_buffer
+template <typename IndexType>
+void to_native_from_event(VectorRef arg,
+			  const IndexRef<IndexType> & event_order,
+			  VectorRef reorder_buffer)
+{
+  reorder_buffer = arg;
+  for (Eigen::Index i = 0; i < event_order.size(); ++i) {
+    arg(event_order(i)) = reorder_buffer(i);
+  }
+}
+
+// reorder a native-ordered vector into event order,
+// arg may be float or double, possibly strided
+template <typename IndexType, typename ValueType>
+void to_event_from_native(const InputVector<ValueType> & arg,
+                          const IndexRef<IndexType> & event_order,
+                          VectorRef reorder_buffer)
+{
+  for (Eigen::Index i = 0; i < event_order.size(); ++i) {
+    reorder_buffer(i) = static_cast<double>(arg(event_order(i)));
+  }
+}
+
+// We need some sort of cumsums of scaling**i / risk_sums**j weighted by w_avg (within status==1)
+// this function fills in appropriate buffer
+// The arg = None is checked by a vector having size 0!
+inline void forward_prework(const StatusRef & status,
+			    const ConstVectorRef & w_avg,
+			    const ConstVectorRef & scaling,
+			    const ConstVectorRef & risk_sums,
+			    int i,
+			    int j,
+			    VectorRef moment_buffer,
+			    const ConstVectorRef & arg,
+			    bool use_w_avg = true)
+{
+  // No checks on size compatibility yet.
+  if (use_w_avg) {
+    // an event whose risk set carries no weight (only possible with zero
+    // weights) has w_avg 0 and contributes nothing, rather than 0 / 0
+    moment_buffer = (risk_sums.array() > 0).select(status.cast<double>().array() * w_avg.array() *
+						   scaling.array().pow(i) / risk_sums.array().pow(j), 0.0);
+  } else {
+    moment_buffer = status.cast<double>().array() * scaling.array().pow(i) / risk_sums.array().pow(j);
+  }
+  if (arg.size() > 0) {
+    moment_buffer = moment_buffer.array() * arg.array();
+  }
+}
+
+// Saturated log likelihood. Leaves the forward cumsum of weight * status
+// in event order in W_status, where cox_dev picks it up.
+template <typename IndexType, typename ValueType>
+double compute_sat_loglik(const IndexRef<IndexType> & first,
+			  const IndexRef<IndexType> & last,
+			  const InputVector<ValueType> & weight, // in natural order!!!
+			  const IndexRef<IndexType> & event_order,
+			  const StatusRef & status,
+			  VectorRef W_status)
+{
+  COXDEV_KERNEL_SCOPE
+  PhaseTimer timer(PHASE_SAT_LOGLIK,
+		   event_order.size() * (sizeof(ValueType) + 3.0 * sizeof(IndexType) + sizeof(int) + 3.0 * sizeof(double)));
+  if (event_order.size() + 1 != W_status.size()) {
+    throw std::runtime_error("compute_sat_loglik: W_status size must be one more than weight's.");
+  }
+
+  // forward cumsum of weight * status in event order, built in place
+  double sum = 0.0;
+  W_status(0) = sum;
+  for (Eigen::Index i = 0; i < event_order.size(); ++i) {
+    sum = sum + static_cast<double>(weight(event_order(i))) * status(i);
+    W_status(i + 1) = sum;
+  }
+
+  double loglik_sat = 0.0;
+  IndexType prev_first = -1;
+
+  for (Eigen::Index i = 0; i < first.size(); ++i) {
+    IndexType f = first(i); double s = W_status(last(i) + 1) - W_status(first(i));
+    if (s > 0 && f != prev_first) {
+      loglik_sat -= s * std::log(s);
+    }
+    prev_first = f;
+  }
+  return(loglik_sat);
+}
+
+// The preprocessed cohort: everything preprocess returns, in event order
+// where applicable. Evaluations only ever read it, so a single CoxDesign
+// can be shared by any number of threads, each with its own CoxWorkspace.
+template <typename IndexType>
+struct CoxDesign {
+  IndexRef<IndexType> event_order;
+  IndexRef<IndexType> start_order;
+  IndexRef<IndexType> first;
+  IndexRef<IndexType> last;
+  IndexRef<IndexType> event_map; // size 0 without start times
+  IndexRef<IndexType> start_map; // size 0 without start times
+  StatusRef status;
+  ConstVectorRef scaling;
+  bool have_start_times;
+  bool efron;
+};
+
+// Scratch space for one evaluation at a time. cox_dev fills it and
+// hessian_matvec reads back the risk sums, cumsums, w_avg and diag_part it left,
+// so the two must share a workspace. The arrays mirror the buffer lists of the
+// python / R interfaces element for element.
+struct CoxWorkspace {
+  Eigen::Map<Eigen::VectorXd> exp_w;
+  Eigen::Map<Eigen::VectorXd> T_1_term;
+  Eigen::Map<Eigen::VectorXd> T_2_term;
+  Eigen::Map<Eigen::VectorXd> grad;
+  Eigen::Map<Eigen::VectorXd> diag_hessian;
+  Eigen::Map<Eigen::VectorXd> diag_part;
+  Eigen::Map<Eigen::VectorXd> w_avg;
+  Eigen::Map<Eigen::VectorXd> forward_scratch;
+  Eigen::Map<Eigen::VectorXd> hess_matvec;
+  Eigen::Map<Eigen::VectorXd> event_reorder[3];  // eta, w, exp_w in event order
+  Eigen::Map<Eigen::VectorXd> risk_sums[2];      // [0] cox_dev, [1] hessian_matvec
+  Eigen::Map<Eigen::VectorXd> forward_cumsum[5]; // length n+1
+  Eigen::Map<Eigen::VectorXd> reverse_cumsum[4]; // length n+1, [0:2] cox_dev, [2:4] hessian_matvec
+};
+
+// Without start times the kernels expect event_map and start_map to be of size 0
+// (None in python), whatever was passed in.
+template <typename IndexType>
+Eigen::Map<const IndexVector<IndexType> > start_times_map(const IndexRef<IndexType> & x,
+							  bool have_start_times)
+{
+  return Eigen::Map<const IndexVector<IndexType> >(x.data(), have_start_times ? x.size() : 0);
+}
+
+// compute sum_i (d_i Z_i ((1_{t_k>=t_i} - 1_{s_k>=t_i}) - sigma_i (1_{i <= last(k)} - 1_{i <= first(k)-1})
+// Note how MatrixXd storage mode can affect efficiency in Python versus R for example.
+// C_arg and C_arg_scale are forward cumsum buffers of length n+1.
+template <typename IndexType>
+void sum_over_events(const IndexRef<IndexType> & event_order,
+                     const IndexRef<IndexType> & start_order,
+                     const IndexRef<IndexType> & first,
+                     const IndexRef<IndexType> & last,
+                     const IndexRef<IndexType> & start_map,
+                     const ConstVectorRef & scaling,
+                     const StatusRef & status,
+                     bool efron,
+		     VectorRef C_arg,
+		     VectorRef C_arg_scale,
+		     VectorRef forward_scratch_buffer,
+                     VectorRef value_buffer)
+{
+  PhaseTimer timer(PHASE_EVENT_SUMS,
+		   (efron ? 2.0 : 1.0) * last.size() * (2.0 * sizeof(IndexType) + 4.0 * sizeof(double)));
+
+  bool have_start_times = start_map.size() >  0;
+
+  forward_cumsum(forward_scratch_buffer, C_arg); //length=n+1
+
+  if (have_start_times) {
+    for (Eigen::Index i = 0; i < last.size(); ++i) {
+      value_buffer(i) = C_arg(last(i) + 1) - C_arg(start_map(i));
+    }
+  } else {
+    for (Eigen::Index i = 0; i < last.size(); ++i) {
+      value_buffer(i) = C_arg(last(i) + 1);
+    }
+  }
+  if (efron) {
+    forward_scratch_buffer = forward_scratch_buffer.array() * scaling.array();
+    forward_cumsum(forward_scratch_buffer, C_arg_scale); // length=n+1
+    for (Eigen::Index i = 0; i < last.size(); ++i) {
+      value_buffer(i) -= (C_arg_scale(last(i) + 1) - C_arg_scale(first(i)));
+    }
+  }
+}
+
+// arg is in native order
+// returns a sum in event order in risk_sum_buffer, using event_cumsum and
+// start_cumsum (length n+1) for the reversed cumsums
+template <typename IndexType>
+void sum_over_risk_set(const ConstVectorRef & arg,
+                       const IndexRef<IndexType> & event_order,
+                       const IndexRef<IndexType> & start_order,
+                       const IndexRef<IndexType> & first,
+                       const IndexRef<IndexType> & last,
+                       const IndexRef<IndexType> & event_map,
+                       const ConstVectorRef & scaling,
+                       bool efron,
+		       VectorRef risk_sum_buffer,
+		       VectorRef event_cumsum,
+		       VectorRef start_cumsum)
+{
+  bool have_start_times = event_map.size() > 0;
+  // one or two reversed cumsums, then the gather over first (and last for efron)
+  PhaseTimer timer(PHASE_RISK_SET,
+		   arg.size() * ((have_start_times ? 2.0 : 1.0) * (sizeof(IndexType) + 2.0 * sizeof(double)) +
+				 (efron ? 3.0 : 2.0) * (sizeof(IndexType) + sizeof(double))));
+
+  reverse_cumsums<IndexType>(arg,
+		  event_cumsum,
+		  start_cumsum,
+		  event_order,
+		  start_order,
+		  true, // do_event
+		  have_start_times); // do_start
+
+  if (have_start_times) {
+    for (Eigen::Index i = 0; i < first.size(); ++i) {
+      risk_sum_buffer(i) = event_cumsum(first(i)) - start_cumsum(event_map(i));
+    }
+  } else {
+    for (Eigen::Index i = 0; i < first.size(); ++i) {
+      risk_sum_buffer(i) = event_cumsum(first(i));
+    }
+  }
+
+  // compute the Efron correction, adjusting risk_sum if necessary
+
+  if (efron) {
+    // for K events,
+    // this results in risk sums event_cumsum[first] to
+    // event_cumsum[first] -
+    // (K-1)/K [event_cumsum[last+1] - event_cumsum[first]
+    // or event_cumsum[last+1] + 1/K [event_cumsum[first] - event_cumsum[last+1]]
+    // to event[cumsum_first]
+    for (Eigen::Index i = 0; i < first.size(); ++i) {
+      risk_sum_buffer(i) = risk_sum_buffer(i) - ( event_cumsum(first(i)) - event_cumsum(last(i) + 1) ) * scaling(i);
+    }
+  }
+}
+
+// eta and sample_weight are read in place whatever their floating type or stride,
+// exp_w = sample_weight * exp(eta) is expected in ws.exp_w and the forward cumsum
+// of sample_weight * status left by compute_sat_loglik in ws.forward_cumsum[0].
+// Fills in ws, leaving grad, diag_hessian and diag_part in native order.
+template <typename IndexType, typename ValueType>
+double cox_dev(const CoxDesign<IndexType> & design,
+	       CoxWorkspace & ws,
+	       const InputVector<ValueType> & eta, //eta is in native order  -- assumes centered (or otherwise normalized for numeric stability)
+	       const InputVector<ValueType> & sample_weight, //sample_weight is in native order
+	       double loglik_sat)
+{
+  COXDEV_KERNEL_SCOPE
+  const double n = (double) eta.size();
+  // eta, sample_weight and exp_w in; grad, diag_hessian, diag_part out
+  PhaseTimer timer(PHASE_COX_DEV, n * (2.0 * sizeof(ValueType) + 4.0 * sizeof(double)));
+
+  // shorthand
+  const IndexRef<IndexType> & event_order = design.event_order;
+  const IndexRef<IndexType> & first = design.first;
+  const IndexRef<IndexType> & last = design.last;
+  const IndexRef<IndexType> & start_map = design.start_map;
+  const StatusRef & status = design.status;
+  const ConstVectorRef & scaling = design.scaling;
+  const bool efron = design.efron;
+
+  Eigen::Map<Eigen::VectorXd> & eta_event = ws.event_reorder[0];
+  Eigen::Map<Eigen::VectorXd> & w_event = ws.event_reorder[1];
+  Eigen::Map<Eigen::VectorXd> & exp_eta_w_event = ws.event_reorder[2];
+  // We name it risk_sums as that is what it is called in the ensuing code
+  Eigen::Map<Eigen::VectorXd> & risk_sums = ws.risk_sums[0];
+  Eigen::Map<Eigen::VectorXd> & forward_scratch_buffer = ws.forward_scratch;
+
+  PhaseTimer to_event_timer(PHASE_REORDER,
+			    n * (3.0 * sizeof(IndexType) + 2.0 * sizeof(ValueType) + 4.0 * sizeof(double)));
+  to_event_from_native<IndexType, ValueType>(eta, event_order, eta_event);
+  to_event_from_native<IndexType, ValueType>(sample_weight, event_order, w_event);
+  to_event_from_native<IndexType, double>(ws.exp_w, event_order, exp_eta_w_event);
+  to_event_timer.stop();
+
+  // event_map is of size 0 without start times
+  sum_over_risk_set<IndexType>(ws.exp_w, // native order
+			       event_order,
+			       design.start_order,
+			       first,
+			       last,
+			       design.event_map,
+			       scaling,
+			       efron,
+			       risk_sums,
+			       ws.reverse_cumsum[0],  // only the first two reverse cumsums are used here
+			       ws.reverse_cumsum[1]);
+
+  // some ordered terms to complete likelihood
+  // calculation
+
+  // w_cumsum is only used here, can write over forward_cumsum_buffers
+  // after computing w_avg
+
+  // For us w_cumsum is forward_cumsum_buffers[0]
+  Eigen::Map<Eigen::VectorXd> & w_cumsum = ws.forward_cumsum[0];
+  for (Eigen::Index i = 0; i < ws.w_avg.size(); ++i) {
+    ws.w_avg(i) = (w_cumsum(last(i) + 1) - w_cumsum(first(i))) / ((double) (last(i) + 1 - first(i)));
+  }
+  // w_avg = w_avg_buffer # shorthand
+  double loglik = ( w_event.array() * eta_event.array() * status.cast<double>().array() ).sum() -
+		   (risk_sums.array() > 0).select(risk_sums.array().log() * ws.w_avg.array() *
+						  status.cast<double>().array(), 0.0).sum();
+
+  // forward cumsums for gradient and Hessian
+
+  //# length of cumsums is n+1
+  //# 0 is prepended for first(k)-1, start(k)-1 lookups
+  //# a 1 is added to all indices
+
+  Eigen::Map<Eigen::VectorXd> dummy_map(nullptr, 0); // dummy argument for use where None is used
+
+  // prework reads status, w_avg, scaling, risk_sums and writes the scratch,
+  // the cumsum reads it back and writes C; then the T terms are gathered
+  PhaseTimer cumsum_timer(PHASE_FORWARD_CUMSUMS,
+			  n * ((efron ? 5.0 : 2.0) * (sizeof(int) + 6.0 * sizeof(double)) +
+			       2.0 * (sizeof(IndexType) + 3.0 * sizeof(double))));
+  forward_prework(status, ws.w_avg, scaling, risk_sums, 0, 1, forward_scratch_buffer, dummy_map, true);
+  Eigen::Map<Eigen::VectorXd> & C_01 = ws.forward_cumsum[0];
+  forward_cumsum(forward_scratch_buffer, C_01); // length=n+1
+
+  forward_prework(status, ws.w_avg, scaling, risk_sums, 0, 2, forward_scratch_buffer, dummy_map, true);
+  Eigen::Map<Eigen::VectorXd> & C_02 = ws.forward_cumsum[1];
+  forward_cumsum(forward_scratch_buffer, C_02); // # length=n+1
+
+  if (!efron) {
+    if (design.have_start_times) {
+      // # +1 for start_map? depends on how
+      // # a tie between a start time and an event time
+      // # if that means the start individual is excluded
+      // # we should add +1, otherwise there should be
+      // # no +1 in the [start_map+1] above
+      for (Eigen::Index i = 0; i < last.size(); ++i) {
+	ws.T_1_term(i) = C_01(last(i) + 1) - C_01(start_map(i));
+	ws.T_2_term(i) = C_02(last(i) + 1) - C_02(start_map(i));
+      }
+    } else {
+      for (Eigen::Index i = 0; i < last.size(); ++i) {
+	ws.T_1_term(i) = C_01(last(i) + 1);
+	ws.T_2_term(i) = C_02(last(i) + 1);
+      }
+    }
+  } else {
+    // # compute the other necessary cumsums
+    forward_prework(status, ws.w_avg, scaling, risk_sums, 1, 1, forward_scratch_buffer, dummy_map, true);
+    Eigen::Map<Eigen::VectorXd> & C_11 = ws.forward_cumsum[2];
+    forward_cumsum(forward_scratch_buffer, C_11); // # length=n+1
+
+    forward_prework(status, ws.w_avg, scaling, risk_sums, 2, 1, forward_scratch_buffer, dummy_map, true);
+    Eigen::Map<Eigen::VectorXd> & C_21 = ws.forward_cumsum[3];
+    forward_cumsum(forward_scratch_buffer, C_21); // # length=n+1
+
+    forward_prework(status, ws.w_avg, scaling, risk_sums, 2, 2, forward_scratch_buffer, dummy_map, true);
+    Eigen::Map<Eigen::VectorXd> & C_22 = ws.forward_cumsum[4];
+    forward_cumsum(forward_scratch_buffer, C_22); // # length=n+1
+
+    for (Eigen::Index i = 0; i < last.size(); ++i) {
+      ws.T_1_term(i) = (C_01(last(i) + 1) -
+			(C_11(last(i) + 1) - C_11(first(i))));
+      ws.T_2_term(i) = ((C_22(last(i) + 1) - C_22(first(i)))
+			- 2 * (C_21(last(i) + 1) - C_21(first(i))) +
+			C_02(last(i) + 1));
+    }
+    if (design.have_start_times) {
+      for (Eigen::Index i = 0; i < start_map.size(); ++i) {
+	ws.T_1_term(i) -= C_01(start_map(i));
+      }
+      for (Eigen::Index i = 0; i < first.size(); ++i) {
+	ws.T_2_term(i) -= C_02(first(i));
+      }
+    }
+  }
+  cumsum_timer.stop();
+
+  // # could do multiply by exp_w after reorder...
+  // # save a reorder of w * exp(eta)
+
+  // grad last: with low_memory it is written over exp_eta_w_event
+
+  ws.diag_part = exp_eta_w_event.array() * ws.T_1_term.array();
+
+  // # now the diagonal of the Hessian
+
+  ws.diag_hessian = exp_eta_w_event.array().pow(2) * ws.T_2_term.array() - ws.diag_part.array();
+  ws.diag_hessian.array() *= -2.0;
+
+  ws.grad = w_event.array() * status.cast<double>().array() - ws.diag_part.array();
+  ws.grad.array() *= -2.0;
+
+  PhaseTimer to_native_timer(PHASE_REORDER, 3.0 * n * (sizeof(IndexType) + 4.0 * sizeof(double)));
+  to_native_from_event<IndexType>(ws.grad, event_order, forward_scratch_buffer);
+  to_native_from_event<IndexType>(ws.diag_hessian, event_order, forward_scratch_buffer);
+  to_native_from_event<IndexType>(ws.diag_part, event_order, forward_scratch_buffer);
+  to_native_timer.stop();
+
+  double deviance = 2.0 * (loglik_sat - loglik);
+  return(deviance);
+}
+
+// Product of arg with (half) the Hessian of the deviance at the point cox_dev last
+// evaluated with this workspace; the result is left in ws.hess_matvec (native order).
+// arg is read in place whatever its floating type or stride.
+template <typename IndexType, typename ValueType>
+void hessian_matvec(const CoxDesign<IndexType> & design,
+		    CoxWorkspace & ws,
+		    const InputVector<ValueType> & arg) // # arg is in native order
+{
+  COXDEV_KERNEL_SCOPE
+  // arg in (read twice), exp_w, diag_part in, the product out
+  PhaseTimer timer(PHASE_HESSIAN_MATVEC, arg.size() * (2.0 * sizeof(ValueType) + 3.0 * sizeof(double)));
+
+  // forward_scratch is free until the risk sums below are formed
+  ws.forward_scratch = ws.exp_w.array() * arg.array().template cast<double>();
+
+  // # now in event_order
+  sum_over_risk_set<IndexType>(ws.forward_scratch, // # exp_w * arg in native order
+			       design.event_order,
+			       design.start_order,
+			       design.first,
+			       design.last,
+			       design.event_map,
+			       design.scaling,
+			       design.efron,
+			       ws.risk_sums[1],
+			       ws.reverse_cumsum[2], // offset from index 2 of reverse_cumsum_buffers
+			       ws.reverse_cumsum[3]);
+  Eigen::Map<Eigen::VectorXd> & risk_sums_arg = ws.risk_sums[1];
+
+  // # E_arg = risk_sums_arg / risk_sums -- expecations under the probabilistic interpretation
+  // # forward_scratch_buffer[:] = status * w_avg * E_arg / risk_sums
+
+  // # one less step to compute from above representation
+  ws.forward_scratch = (ws.risk_sums[0].array() > 0).select(( design.status.template cast<double>().array() * ws.w_avg.array() * risk_sums_arg.array() ) /
+							   ws.risk_sums[0].array().pow(2), 0.0);
+
+  sum_over_events<IndexType>(design.event_order,
+			     design.start_order,
+			     design.first,
+			     design.last,
+			     design.start_map,
+			     design.scaling,
+			     design.status,
+			     design.efron,
+			     ws.forward_cumsum[0],
+			     ws.forward_cumsum[1],
+			     ws.forward_scratch,
+			     ws.hess_matvec);
+
+  PhaseTimer to_native_timer(PHASE_REORDER, arg.size() * (sizeof(IndexType) + 4.0 * sizeof(double)));
+  to_native_from_event<IndexType>(ws.hess_matvec, design.event_order, ws.forward_scratch);
+  to_native_timer.stop();
+  ws.hess_matvec = ws.hess_matvec.array() * ws.exp_w.array() - (ws.diag_part.array() * arg.array().template cast<double>());
+}
+
+/* Start of C implementation of preprocess */
+
+/**
+ * Equivalent of numpy.lexsort of the stacked (start, event) rows for our case where
+ * the keys are is_start, status_c and time. The stacked arrays are never formed:
+ * row j < n is the start of subject j, row n + j its event / stop time.
+ */
+template <typename IndexType>
+std::vector<IndexType> lexsort(const InputVector<double> & start,
+			       const InputVector<double> & event,
+			       const StatusRef & status) {
+  const Eigen::Index n = status.size();
+  std::vector<IndexType> idx(2 * n);
+  std::iota(idx.begin(), idx.end(), 0); // Fill idx with 0, 1, ..., 2n - 1
+
+  auto comparator = [&](IndexType i, IndexType j) {
+    const bool i_start = i < n, j_start = j < n;
+    const double c_i = i_start ? start(i) : event(i - n);
+    const double c_j = j_start ? start(j) : event(j - n);
+    if (c_i != c_j) return c_i < c_j;
+    const int b_i = i_start ? 1 : 1 - status(i - n); // complement of status
+    const int b_j = j_start ? 1 : 1 - status(j - n);
+    if (b_i != b_j) return b_i < b_j;
+    return (int) i_start < (int) j_start;
+  };
+
+  std::sort(idx.begin(), idx.end(), comparator);
+
+  return idx;
+}
+
+// What preprocess computes; start (the start times) is in start order, all
+// else but the two orders in event order.
+template <typename IndexType>
+struct Preprocessed {
+  IndexVector<IndexType> event_order;
+  IndexVector<IndexType> start_order;
+  Eigen::VectorXd start;
+  Eigen::VectorXd event;
+  IndexVector<IndexType> first;
+  IndexVector<IndexType> last;
+  Eigen::VectorXd scaling;
+  IndexVector<IndexType> start_map;
+  IndexVector<IndexType> event_map;
+  Eigen::VectorXi status;
+};
+
+/**
+ * Compute various functions of the start / event / status to be used to help in computing cumsums
+ * This is best done in C++ also to avoid dealing with 1-based indexing in R  and 0-based indexing
+ * elsewhere.
+ */
+template <typename IndexType>
+Preprocessed<IndexType> preprocess(const InputVector<double> & start,
+				   const InputVector<double> & event,
+				   const StatusRef & status)
+{
+  const Eigen::Index nevent = status.size();
+  // start, event, status in; the preproc arrays and two orders out
+  PhaseTimer timer(PHASE_PREPROCESS,
+		   nevent * (5.0 * sizeof(double) + 2.0 * sizeof(int) + 6.0 * sizeof(IndexType)));
+
+  // do the joint sort
+  std::vector<IndexType> sort_order = lexsort<IndexType>(start, event, status);
+
+  IndexType event_count = 0, start_count = 0;
+  std::vector<IndexType> event_order_vec, start_order_vec, start_map_vec, event_map_vec, first_vec;
+  event_order_vec.reserve(nevent); start_order_vec.reserve(nevent);
+  start_map_vec.reserve(nevent); event_map_vec.reserve(nevent); first_vec.reserve(nevent);
+  // int which_event = -1
+  IndexType first_event = -1, num_successive_event = 1;
+  double last_row_time;
+  bool last_row_time_set = false;
+
+  for (Eigen::Index i = 0; i < 2 * nevent; ++i) {
+    const Eigen::Index j = sort_order[i];
+    const bool _is_start = j < nevent;
+    const Eigen::Index _index = _is_start ? j : j - nevent;
+    const double _time = _is_start ? start(_index) : event(_index);
+    const int _status = _is_start ? 0 : status(_index);
+    if (_is_start) { //a start time
+      start_order_vec.push_back(_index);
+      start_map_vec.push_back(event_count);
+      start_count++;
+    } else { // an event / stop time
+      if (_status == 1) {
+	// if it's an event and the time is same as last row
+	// it is the same event
+	// else it's the next "which_event"
+	// CHANGED THE ORIGINAL COMPARISON time != last_row_time below to
+	// _time > last_row_time since time is sorted!
+	if (last_row_time_set  && _time > last_row_time) {// # index of next `status==1`
+	  first_event += num_successive_event;
+	  num_successive_event = 1;
+	  // which_event++;
+	} else {
+	  num_successive_event++;
+	}
+	first_vec.push_back(first_event);
+      } else {
+	first_event += num_successive_event;
+	num_successive_event = 1;
+	first_vec.push_back(first_event); // # this event time was not an failure time
+      }
+      event_map_vec.push_back(start_count);
+      event_order_vec.push_back(_index);
+      event_count++;
+    }
+    last_row_time = _time;
+    last_row_time_set = true;
+  }
+  // the sort order is no longer needed, release it before allocating the outputs
+  std::vector<IndexType>().swap(sort_order);
+
+  Preprocessed<IndexType> result;
+  IndexVector<IndexType> & _first = result.first;
+  IndexVector<IndexType> & start_order = result.start_order;
+  IndexVector<IndexType> & event_order = result.event_order;
+
+  _first = Eigen::Map<IndexVector<IndexType> >(first_vec.data(), first_vec.size());
+  start_order = Eigen::Map<IndexVector<IndexType> >(start_order_vec.data(), start_order_vec.size());
+  event_order = Eigen::Map<IndexVector<IndexType> >(event_order_vec.data(), event_order_vec.size());
+  result.event_map = Eigen::Map<IndexVector<IndexType> >(event_map_vec.data(), event_map_vec.size());
+
+  // reset start_map to original order
+  IndexVector<IndexType> start_map(start_map_vec.size());
+  for (Eigen::Index i = 0; i < start_map.size(); ++i) {
+    start_map(start_order(i)) = start_map_vec[i];
+  }
+
+  // set to event order
+  Eigen::VectorXi & _status = result.status;
+  _status.resize(status.size());
+  for (Eigen::Index i = 0; i < status.size(); ++i) {
+    _status(i) = status(event_order(i));
+  }
+
+  IndexVector<IndexType> & _start_map = result.start_map;
+  _start_map.resize(start_map.size());
+  for (Eigen::Index i = 0; i < start_map.size(); ++i) {
+    _start_map(i) = start_map(event_order(i));
+  }
+
+  Eigen::VectorXd & _event = result.event;
+  _event.resize(event.size());
+  for (Eigen::Index i = 0; i < event.size(); ++i) {
+    _event(i) = event(event_order(i));
+  }
+
+  Eigen::VectorXd & _start = result.start;
+  _start.resize(event.size());
+  for (Eigen::Index i = 0; i < event.size(); ++i) {
+    _start(i) = start(start_order(i));
+  }
+
+  // last is filled in from the end: immediately following a last event,
+  // `first` will agree with np.arange
+  const Eigen::Index first_size = _first.size();
+  IndexVector<IndexType> & _last = result.last;
+  _last.resize(first_size);
+  IndexType last_event = nevent - 1;
+  for (Eigen::Index i = 0; i < first_size; ++i) {
+    IndexType f = _first(first_size - i - 1);
+    _last(first_size - i - 1) = last_event;
+    if (f - (nevent - 1 - i) == 0) {
+      last_event = f - 1;
+    }
+  }
+
+  Eigen::VectorXd & _scaling = result.scaling;
+  _scaling.resize(nevent);
+  for (Eigen::Index i = 0; i < nevent; ++i) {
+    double fi = (double) _first(i);
+    _scaling(i) = ((double) i - fi) / ((double) _last(i) + 1.0 - fi);
+  }
+
+  // This is just a check
+  bool check_ok = true;
+  for (Eigen::Index i = 0; (i < _first.size()) && (check_ok); ++i) {
+    check_ok = (_first[_start_map[i]] == _start_map[i]);
+  }
+  if (!check_ok) {
+    throw std::runtime_error("first_start disagrees with start_map");
+  }
+
+  return result;
+}
+
+// Owning versions of CoxDesign and CoxWorkspace, for callers holding plain
+// arrays rather than interpreter objects (see coxdev_c.h).
+
+// A preprocessed cohort. start may be null when there are no start times.
+// Rows may be appended (see append in coxdev_stream.h): the arrays of
+// preproc then have room for capacity() rows, of which the first size()
+// are in use.
+template <typename IndexType>
+struct CoxDesignData {
+  Preprocessed<IndexType> preproc;
+  IndexVector<IndexType> event_position; // of each row in event order, kept once rows are appended
+  Eigen::VectorXd start_event;           // start times in event order, empty without them
+  Eigen::VectorXd unit_weight;           // the weights when none are given, shared by all workspaces
+  Eigen::Index n;
+  bool have_start_times;
+  bool efron_ties;                       // Efron's correction asked for
+  bool efron;
+
+  CoxDesignData(Eigen::Index n,
+		const double *start,
+		const double *event,
+		const int *status,
+		bool efron_ties) :
+    preproc(preprocess_arrays(n, start, event, status)),
+    n(n),
+    have_start_times(start != nullptr),
+    efron_ties(efron_ties),
+    // as in the bindings, Efron's correction is only applied when there are ties
+    efron(efron_ties && preproc.scaling.norm() > 0) {
+    set_start_event();
+    unit_weight.setOnes(n);
+  }
+
+  // The same cohort with indices of another width, e.g. widened before
+  // appending rows makes it too large for int32.
+  template <typename OtherIndex>
+  explicit CoxDesignData(const CoxDesignData<OtherIndex> & other) :
+    n(other.n),
+    have_start_times(other.have_start_times),
+    efron_ties(other.efron_ties),
+    efron(other.efron) {
+    preproc.event_order = other.preproc.event_order.template cast<IndexType>();
+    preproc.start_order = other.preproc.start_order.template cast<IndexType>();
+    preproc.start = other.preproc.start;
+    preproc.event = other.preproc.event;
+    preproc.first = other.preproc.first.template cast<IndexType>();
+    preproc.last = other.preproc.last.template cast<IndexType>();
+    preproc.scaling = other.preproc.scaling;
+    preproc.start_map = other.preproc.start_map.template cast<IndexType>();
+    preproc.event_map = other.preproc.event_map.template cast<IndexType>();
+    preproc.status = other.preproc.status;
+    event_position = other.event_position.template cast<IndexType>();
+    start_event = other.start_event;
+    unit_weight = other.unit_weight;
+  }
+
+  Eigen::Index size() const { return n; }
+
+  Eigen::Index capacity() const { return preproc.status.size(); }
+
+  // weight, or unit weights when it is null
+  const double * weights(const double *weight) const {
+    return weight != nullptr ? weight : unit_weight.data();
+  }
+
+  CoxDesign<IndexType> design() const {
+    return CoxDesign<IndexType>{preproc.event_order.head(n), preproc.start_order.head(n),
+	preproc.first.head(n), preproc.last.head(n),
+	start_times_map<IndexType>(preproc.event_map.head(n), have_start_times),
+	start_times_map<IndexType>(preproc.start_map.head(n), have_start_times),
+	preproc.status.head(n), preproc.scaling.head(n), have_start_times, efron};
+  }
+
+  // Gather the start times into event order, for the kernels walking the
+  // tie blocks (coxdev_exact.h, coxdev_sampled.h); once per design, and
+  // again when rows are appended.
+  void set_start_event() {
+    start_event.resize(have_start_times ? n : 0);
+    if (have_start_times) {
+      Eigen::VectorXd start_native(n);
+      for (Eigen::Index j = 0; j < n; ++j) {
+	start_native(preproc.start_order(j)) = preproc.start(j);
+      }
+      for (Eigen::Index k = 0; k < n; ++k) {
+	start_event(k) = start_native(preproc.event_order(k));
+      }
+    }
+  }
+
+private:
+  // no start times is the same as all starting at -inf
+  static Preprocessed<IndexType> preprocess_arrays(Eigen::Index n,
+						   const double *start,
+						   const double *event,
+						   const int *status) {
+    Eigen::VectorXd no_start;
+    if (start == nullptr) {
+      no_start = Eigen::VectorXd::Constant(n, -std::numeric_limits<double>::infinity());
+      start = no_start.data();
+    }
+    return preprocess<IndexType>(Eigen::Map<const Eigen::VectorXd>(start, n),
+				 Eigen::Map<const Eigen::VectorXd>(event, n),
+				 Eigen::Map<const Eigen::VectorXi>(status, n));
+  }
+};
+
+// Scratch space for a cohort of size n, in one allocation, plus the centered
+// linear predictor the pointer level functions below need (their unit
+// weights are the design's). Holds maps into its own storage, so it is
+// neither copied nor moved.
+//
+// Each array is a row of n + 1 doubles (the cumsums use all of it), 24 rows
+// in all. With low_memory, arrays no kernel ever needs at the same time
+// share rows, 16 in all:
+//
+//  - the reverse cumsums are only live within sum_over_risk_set (or its
+//    Fine-Gray version), when forward cumsums 1 and 2 are not: every kernel
+//    writes those afterwards, and forward cumsum 0, which holds the weight
+//    cumsum of compute_sat_loglik until cox_dev reads it, keeps its own row;
+//  - forward cumsums 3 and 4 (Efron's C_21 and C_22, and Fine-Gray and
+//    information_matrix scratch) are read before cox_dev writes diag_hessian
+//    and diag_part, whose rows they take; grad and diag_hessian are copied
+//    out before anything else runs;
+//  - exp_w in event order is read by cox_dev (or finegray_dev) before it
+//    writes grad, last, over it; horizon_sweep gathers it again from exp_w;
+//  - the centered eta is only read by cox_dev (or finegray_dev, or the
+//    bootstrap's loop of cox_dev calls), none of which write hess_matvec.
+//
+// What later calls read back (exp_w, T_1_term, T_2_term, diag_part, w_avg,
+// eta and w in event order and the risk sums) keeps its own rows. w in
+// event order would need the weights themselves, which no workspace keeps.
+class CoxWorkspaceData {
+public:
+  explicit CoxWorkspaceData(Eigen::Index n, bool low_memory = false) :
+    rows(low_memory ? 16 : 24),
+    storage(rows * (n + 1), 0.0),
+    ws{slot(0, n), slot(1, n), slot(2, n), slot(3, n), slot(4, n), slot(5, n),
+       slot(6, n), slot(7, n), slot(8, n),
+       {slot(9, n), slot(10, n), slot(11, n)},
+       {slot(12, n), slot(13, n)},
+       {slot(14, n, 1), slot(15, n, 1), slot(16, n, 1), slot(17, n, 1), slot(18, n, 1)},
+       {slot(19, n, 1), slot(20, n, 1), slot(21, n, 1), slot(22, n, 1)}},
+    eta(slot(23, n)),
+    center(0.0) {}
+  CoxWorkspaceData(const CoxWorkspaceData &) = delete;
+  CoxWorkspaceData & operator=(const CoxWorkspaceData &) = delete;
+
+  // bytes of scratch space held
+  std::size_t nbytes() const { return storage.size() * sizeof(double); }
+
+private:
+  Eigen::Index rows;
+  std::vector<double> storage;
+
+  // the k-th array in the order of CoxWorkspace, then eta: the 9 cumsums
+  // (14 to 22) have length n + 1, the rest n
+  Eigen::Map<Eigen::VectorXd> slot(Eigen::Index k, Eigen::Index n, Eigen::Index pad = 0) {
+    static const int low_memory_row[24] = {0, 1, 2, 3, 4, 5, 6, 7, 8,
+					   9, 10, 3, 11, 12,
+					   13, 14, 15, 4, 5,
+					   14, 15, 14, 15,
+					   8};
+    const Eigen::Index row = rows == 24 ? k : low_memory_row[k];
+    return Eigen::Map<Eigen::VectorXd>(storage.data() + row * (n + 1), n + pad);
+  }
+
+public:
+  CoxWorkspace ws;
+  Eigen::Map<Eigen::VectorXd> eta;         // centered linear predictor
+  double center;                           // mean of the last eta, subtracted from it
+};
+
+// Deviance at linear predictor eta (native order, length n) with weights
+// (null for unit weights), as computed by the bindings: eta is centered and
+// clipped at 30 before exponentiating. gradient and diag_hessian, when not
+// null, receive the gradient and diagonal Hessian of the deviance. Leaves ws
+// ready for information_matvec at this point.
+template <typename IndexType>
+double deviance(const CoxDesignData<IndexType> & data,
+		CoxWorkspaceData & work,
+		const double *eta,
+		const double *weight,
+		double *gradient,
+		double *diag_hessian)
+{
+  const Eigen::Index n = data.size();
+  const CoxDesign<IndexType> design = data.design();
+  CoxWorkspace & ws = work.ws;
+  Eigen::Map<const Eigen::VectorXd> eta_in(eta, n);
+  Eigen::Map<const Eigen::VectorXd> w(data.weights(weight), n);
+
+  const double loglik_sat = compute_sat_loglik<IndexType, double>(design.first, design.last, w,
+								  design.event_order, design.status,
+								  ws.forward_cumsum[0]);
+  work.center = eta_in.mean();
+  work.eta = eta_in.array() - work.center;
+  ws.exp_w = w.array() * work.eta.array().min(30.0).exp();
+
+  const double dev = cox_dev<IndexType, double>(design, ws, work.eta, w, loglik_sat);
+  if (gradient != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(gradient, n) = ws.grad;
+  }
+  if (diag_hessian != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(diag_hessian, n) = ws.diag_hessian;
+  }
+  return dev;
+}
+
+// Product of arg (native order) with the information matrix at the point
+// deviance last evaluated with work, written to out; the bindings' information
+// operator.
+template <typename IndexType>
+void information_matvec(const CoxDesignData<IndexType> & data,
+			CoxWorkspaceData & work,
+			const double *arg,
+			double *out)
+{
+  const Eigen::Index n = data.size();
+  hessian_matvec<IndexType, double>(data.design(), work.ws, Eigen::Map<const Eigen::VectorXd>(arg, n));
+  Eigen::Map<Eigen::VectorXd>(out, n) = -work.ws.hess_matvec;
+}
+
+} // namespace coxdev
+
+#endif
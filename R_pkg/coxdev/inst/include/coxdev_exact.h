@@ -0,0 +1,242 @@
+#ifndef COXDEV_EXACT_H
+#define COXDEV_EXACT_H
+
+// The exact (discrete, conditional logistic) partial likelihood for tied
+// event times, survival's ties = "exact". The d events of a tie block with
+// risk set R contribute
+//
+//   sum_{i in D} w_i eta_i - w_avg log e_d(x_R),   x_j = w_j exp(eta_j),
+//
+// e_d the elementary symmetric polynomial of degree d: the d tied events
+// are the chosen ones of all the d-subsets of the risk set. With unit
+// weights this is the conditional likelihood itself, and with a single
+// event per block it is Breslow's.
+//
+// e_d(x_R) is the degree d coefficient of prod_{j in R} (1 + x_j z), built
+// by the recursion e_k <- e_k + x_j e_{k-1} over the m members of R in
+// O(d m), with the coefficients kept as logarithms as they overflow any
+// scaling for large risk sets. The derivative of log e_d in eta_j is the
+// probability pi_j that j is among the chosen, x_j e_{d-1}(x_{R \ j}) /
+// e_d(x_R), and as e_d is linear in x_j the second derivative is pi_j (1 -
+// pi_j). e_{d-1}(x_{R \ j}) pairs the coefficients of the product over the
+// members before j with those of the product over the members after it,
+// so the latter, swept backwards, and a forward sweep give all the pi_j in
+// O(d m) too. Rather than a table of all m + 1 rows of the backward sweep,
+// O(d m) memory per block, every s-th row is kept, s about sqrt(m), and
+// the rows of each stretch of s recomputed from the next kept one as the
+// forward sweep reaches it: a second backward sweep for O(d sqrt(m))
+// memory. Blocks are independent, so ranges of blocks may be evaluated by
+// different threads. The risk set of a block is among the rows from its
+// first event on in event order, so the pi_j of the blocks starting at or
+// after position b are kept in event order from b: a range's output is the
+// tail of the cohort it can reach, not a copy of the whole.
+//
+// Zero weights drop an observation: it is neither an event nor at risk.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// log(exp(a) + exp(b))
+inline double log_add_exp(double a, double b)
+{
+  if (a < b) {
+    std::swap(a, b);
+  }
+  if (b == -std::numeric_limits<double>::infinity()) {
+    return a;
+  }
+  return a + std::log1p(std::exp(b - a));
+}
+
+// Multiply the polynomial with log coefficients coef(0), ..., coef(degree)
+// by 1 + x z, dropping the terms above degree, in place.
+inline void log_poly_step(double *coef, Eigen::Index degree, double log_x)
+{
+  for (Eigen::Index k = degree; k >= 1; --k) {
+    coef[k] = log_add_exp(coef[k], log_x + coef[k - 1]);
+  }
+}
+
+// The tie blocks whose first event is in begin, ..., end - 1 (event order):
+// their saturated log likelihoods (taken at equal weights within a block)
+// and log likelihoods are added to loglik(0) and loglik(1), and w_avg pi_j
+// and w_avg pi_j^2 summed over the blocks to pi_sum and pi2_sum, entry
+// k - begin for the row at event order position k. eta is centered as for
+// cox_dev; event and start_event hold the event and start times in event
+// order (start_event is unread without start times).
+template <typename IndexType, typename ValueType>
+void exact_partial_likelihood(const CoxDesign<IndexType> & design,
+			      const ConstVectorRef & event,
+			      const ConstVectorRef & start_event,
+			      const InputVector<ValueType> & eta,
+			      const InputVector<ValueType> & sample_weight,
+			      Eigen::Index begin,
+			      Eigen::Index end,
+			      VectorRef loglik,
+			      VectorRef pi_sum,
+			      VectorRef pi2_sum)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  const double minus_inf = -std::numeric_limits<double>::infinity();
+  if (event.size() != n || (design.have_start_times && start_event.size() != n) ||
+      eta.size() != n || sample_weight.size() != n) {
+    throw std::runtime_error("exact_partial_likelihood: event, start_event, eta and sample_weight must have an entry per observation.");
+  }
+  if (begin < 0 || begin > end || end > n) {
+    throw std::runtime_error("exact_partial_likelihood: invalid range.");
+  }
+  if (loglik.size() != 2 || pi_sum.size() != n - begin || pi2_sum.size() != n - begin) {
+    throw std::runtime_error("exact_partial_likelihood: loglik must have 2 entries and pi_sum and pi2_sum one per observation from begin on.");
+  }
+  PhaseTimer timer(PHASE_EXACT, (end - begin) * (2.0 * sizeof(ValueType) + 2.0 * sizeof(IndexType) + sizeof(int)));
+
+  // per block: the log x of the members of the risk set and their entries
+  // in pi_sum; the log
+  // coefficients of the products over the members from r on (row r) for
+  // every step-th r, and for the stretch of rows the forward sweep is in
+  std::vector<double> log_x;
+  std::vector<Eigen::Index> member;
+  std::vector<double> checkpoint;
+  std::vector<double> stretch;
+  std::vector<double> prefix;
+
+  for (Eigen::Index f = begin; f < end; ++f) {
+    if (design.status(f) != 1 || design.first(f) != f) {
+      continue;
+    }
+    const Eigen::Index l = design.last(f);
+    const double t = event(f);
+    double W = 0.0, sat = 0.0, numerator = 0.0;
+    Eigen::Index d = 0;
+    for (Eigen::Index k = f; k <= l; ++k) {
+      const IndexType i = design.event_order(k);
+      const double w = static_cast<double>(sample_weight(i));
+      if (w > 0) {
+	W += w;
+	sat += std::log(w);
+	numerator += w * static_cast<double>(eta(i));
+	++d;
+      }
+    }
+    if (d == 0) {
+      continue;
+    }
+    const double w_avg = W / d;
+
+    log_x.clear();
+    member.clear();
+    for (Eigen::Index k = f; k < n; ++k) {
+      const IndexType i = design.event_order(k);
+      const double w = static_cast<double>(sample_weight(i));
+      if (w > 0 && (!design.have_start_times || start_event(k) < t)) {
+	log_x.push_back(std::log(w) + std::min(static_cast<double>(eta(i)), 30.0));
+	member.push_back(k - begin);
+      }
+    }
+    const Eigen::Index m = static_cast<Eigen::Index>(member.size());
+    const Eigen::Index width = d + 1;
+
+    const Eigen::Index step = std::max<Eigen::Index>(1, static_cast<Eigen::Index>(std::ceil(std::sqrt(static_cast<double>(m)))));
+
+    // row m is the empty product; keep rows 0, step, 2 step, ...
+    checkpoint.assign((m / step + 1) * width, minus_inf);
+    stretch.assign(step * width, minus_inf);
+    double * row = &stretch[0];
+    row[0] = 0.0;
+    for (Eigen::Index r = m; ; --r) {
+      if (r % step == 0) {
+	std::copy(row, row + width, &checkpoint[(r / step) * width]);
+      }
+      if (r == 0) {
+	break;
+      }
+      log_poly_step(row, d, log_x[r - 1]);
+    }
+    const double log_e_d = checkpoint[d];
+
+    loglik(0) -= w_avg * sat;
+    loglik(1) += numerator - w_avg * log_e_d;
+
+    // prefix holds the log coefficients, to degree d - 1, of the product
+    // over the members before r
+    prefix.assign(d, minus_inf);
+    prefix[0] = 0.0;
+    for (Eigen::Index lo = 0; lo < m; lo += step) {
+      // rows lo + 1, ..., hi of the backward sweep, row r + 1 in stretch
+      // row r - lo, from row hi: kept, or the empty product
+      const Eigen::Index hi = std::min(lo + step, m);
+      double * top = &stretch[(hi - 1 - lo) * width];
+      if (hi % step == 0) {
+	std::copy(&checkpoint[(hi / step) * width], &checkpoint[(hi / step) * width] + width, top);
+      } else {
+	std::fill(top, top + width, minus_inf);
+	top[0] = 0.0;
+      }
+      for (Eigen::Index r = hi - 1; r > lo; --r) {
+	double * cur = &stretch[(r - 1 - lo) * width];
+	std::copy(cur + width, cur + 2 * width, cur);
+	log_poly_step(cur, d, log_x[r]);
+      }
+
+      for (Eigen::Index r = lo; r < hi; ++r) {
+	const double * next = &stretch[(r - lo) * width];
+	double log_q = minus_inf;
+	for (Eigen::Index a = 0; a < d; ++a) {
+	  log_q = log_add_exp(log_q, prefix[a] + next[d - 1 - a]);
+	}
+	const double pi = std::exp(log_x[r] + log_q - log_e_d);
+	pi_sum(member[r]) += w_avg * pi;
+	pi2_sum(member[r]) += w_avg * pi * pi;
+	log_poly_step(prefix.data(), d - 1, log_x[r]);
+      }
+    }
+  }
+}
+
+// Exact partial likelihood deviance at eta (native order, length n) with
+// weights (null for unit weights), whatever tie breaking the design was
+// made with; gradient and diag_hessian, when not null, receive its gradient
+// and the diagonal of its Hessian. Returns the deviance.
+template <typename IndexType>
+double exact_deviance(const CoxDesignData<IndexType> & data,
+		      const double *eta,
+		      const double *weight,
+		      double *gradient,
+		      double *diag_hessian)
+{
+  const Eigen::Index n = data.size();
+  const CoxDesign<IndexType> design = data.design();
+  Eigen::VectorXd centered = Eigen::Map<const Eigen::VectorXd>(eta, n);
+  centered.array() -= centered.mean();
+  Eigen::VectorXd unit;
+  if (weight == nullptr) {
+    unit.setOnes(n);
+  }
+  Eigen::Map<const Eigen::VectorXd> w(weight != nullptr ? weight : unit.data(), n);
+  Eigen::VectorXd loglik = Eigen::VectorXd::Zero(2), pi_sum = Eigen::VectorXd::Zero(n), pi2_sum = Eigen::VectorXd::Zero(n);
+  exact_partial_likelihood<IndexType, double>(design, data.preproc.event.head(n), data.start_event,
+					      centered, w, 0, n, loglik, pi_sum, pi2_sum);
+  // pi_sum and pi2_sum are in event order
+  for (Eigen::Index k = 0; k < n; ++k) {
+    const IndexType i = design.event_order(k);
+    if (gradient != nullptr) {
+      gradient[i] = -2.0 * (w(i) * design.status(k) - pi_sum(k));
+    }
+    if (diag_hessian != nullptr) {
+      diag_hessian[i] = 2.0 * (pi_sum(k) - pi2_sum(k));
+    }
+  }
+  return 2.0 * (loglik(0) - loglik(1));
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef COXDEV_FINEGRAY_H
+#define COXDEV_FINEGRAY_H
+
+// The Fine-Gray model of the subdistribution hazard of one cause among
+// competing risks. A subject whose competing event came at T_j < t stays
+// in the risk set at t with weight G(t-) / G(T_j-), G the Kaplan-Meier
+// estimate of the censoring survival, P(C >= t) = G(t-), events at a time
+// preceding its censorings as in the sort order. Everyone else is at risk
+// as in the Cox model of the cause with competing events as censorings,
+// which is what the design holds. The usual fit expands each competing
+// subject into a weighted row per later event time; here the weights are
+// applied in the sums themselves:
+//
+//   R_k = sum_{T_j >= t_k} exp_w_j + G(t_k-) sum_{competing, T_j < t_k} exp_w_j / G(T_j-),
+//
+// the second a forward cumsum in event order, so the risk sums, gradient,
+// diagonal Hessian and Hessian products take O(n) after the sort, with
+// Efron's correction over the tied events of the cause. Subject j enters
+// event k's risk sum with multiplier m_jk: 1 (1 - scaling(k) within k's
+// tie block with Efron), G(t_k-) / G(T_j-) when competing before t_k, and
+// the gradient and Hessian are sums over events of m_jk and m_jk^2 terms.
+// Start times are not supported.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// The censoring survival G(t-) just before each stop time (event order),
+// from the Kaplan-Meier estimate with weights w_event (event order); a
+// subject with either event at t is not at risk of censoring at t.
+template <typename IndexType>
+void censoring_survival(const CoxDesign<IndexType> & design,
+			const StatusRef & competing,
+			const ConstVectorRef & event_time,
+			const ConstVectorRef & w_event,
+			VectorRef G_minus)
+{
+  const Eigen::Index n = design.status.size();
+  double at_risk = w_event.sum();
+  double G = 1.0;
+  for (Eigen::Index i = 0; i < n; ) {
+    Eigen::Index j = i;
+    double censored = 0.0, failed = 0.0, total = 0.0;
+    for (; j < n && event_time(j) == event_time(i); ++j) {
+      if (design.status(j) == 1 || competing(j) == 1) {
+	failed += w_event(j);
+      } else {
+	censored += w_event(j);
+      }
+      total += w_event(j);
+    }
+    G_minus.segment(i, j - i).setConstant(G);
+    const double censor_risk = at_risk - failed;
+    if (censored > 0 && censor_risk > 0) {
+      G *= std::max(0.0, 1.0 - censored / censor_risk);
+    }
+    at_risk -= total;
+    i = j;
+  }
+}
+
+// Fine-Gray risk sums (event order) of arg (event order), e.g. exp_w:
+// event_cumsum and competing_cumsum (length n + 1) receive the reversed
+// cumsum of arg and the forward cumsum of arg / G(T-) over competing
+// subjects.
+template <typename IndexType>
+void finegray_sum_over_risk_set(const CoxDesign<IndexType> & design,
+				const StatusRef & competing,
+				const ConstVectorRef & G_minus,
+				const ConstVectorRef & arg,
+				VectorRef risk_sum_buffer,
+				VectorRef event_cumsum,
+				VectorRef competing_cumsum)
+{
+  const Eigen::Index n = design.status.size();
+  PhaseTimer timer(PHASE_RISK_SET, n * ((design.efron ? 3.0 : 2.0) * sizeof(IndexType) + sizeof(int) + 7.0 * sizeof(double)));
+  event_cumsum(n) = 0.0;
+  for (Eigen::Index i = n - 1; i >= 0; --i) {
+    event_cumsum(i) = event_cumsum(i + 1) + arg(i);
+  }
+  competing_cumsum(0) = 0.0;
+  for (Eigen::Index i = 0; i < n; ++i) {
+    competing_cumsum(i + 1) = competing_cumsum(i) + (competing(i) == 1 && G_minus(i) > 0 ? arg(i) / G_minus(i) : 0.0);
+  }
+  // competing subjects before first(i) are those with T_j < t_i, as the
+  // events at a time sort before everyone else
+  for (Eigen::Index i = 0; i < n; ++i) {
+    risk_sum_buffer(i) = event_cumsum(design.first(i)) + G_minus(i) * competing_cumsum(design.first(i));
+  }
+  if (design.efron) {
+    for (Eigen::Index i = 0; i < n; ++i) {
+      risk_sum_buffer(i) -= (event_cumsum(design.first(i)) - event_cumsum(design.last(i) + 1)) * design.scaling(i);
+    }
+  }
+}
+
+// value_j = sum_k coef_k m_jk^power (event order) for coef (event order,
+// zero off the events) and power 1 or 2, with C, C_scale and C_competing
+// (length n + 1) for the forward, Efron and competing cumsums.
+template <typename IndexType>
+void finegray_sum_over_events(const CoxDesign<IndexType> & design,
+			      const StatusRef & competing,
+			      const ConstVectorRef & G_minus,
+			      const ConstVectorRef & coef,
+			      int power,
+			      VectorRef C,
+			      VectorRef C_scale,
+			      VectorRef C_competing,
+			      VectorRef value_buffer)
+{
+  const Eigen::Index n = design.status.size();
+  PhaseTimer timer(PHASE_EVENT_SUMS, n * ((design.efron ? 3.0 : 2.0) * sizeof(IndexType) + sizeof(int) + 8.0 * sizeof(double)));
+  forward_cumsum(coef, C);
+  for (Eigen::Index j = 0; j < n; ++j) {
+    value_buffer(j) = C(design.last(j) + 1);
+  }
+  if (design.efron) {
+    // within the block m_jk is 1 - scaling(k), so take off 1 - (1 - scaling(k))^power
+    C_scale(0) = 0.0;
+    for (Eigen::Index k = 0; k < n; ++k) {
+      const double c = design.scaling(k);
+      C_scale(k + 1) = C_scale(k) + coef(k) * (power == 1 ? c : c * (2.0 - c));
+    }
+    for (Eigen::Index j = 0; j < n; ++j) {
+      value_buffer(j) -= C_scale(design.last(j) + 1) - C_scale(design.first(j));
+    }
+  }
+  // events after a competing subject's time are those after last(j) = j
+  C_competing(n) = 0.0;
+  for (Eigen::Index k = n - 1; k >= 0; --k) {
+    C_competing(k) = C_competing(k + 1) + coef(k) * (power == 1 ? G_minus(k) : G_minus(k) * G_minus(k));
+  }
+  for (Eigen::Index j = 0; j < n; ++j) {
+    if (competing(j) == 1 && G_minus(j) > 0) {
+      const double scale = power == 1 ? G_minus(j) : G_minus(j) * G_minus(j);
+      value_buffer(j) += C_competing(design.last(j) + 1) / scale;
+    }
+  }
+}
+
+// The Fine-Gray deviance, as cox_dev: exp_w = sample_weight * exp(eta) is
+// expected in ws.exp_w and the forward cumsum of sample_weight * status
+// from compute_sat_loglik in ws.forward_cumsum[0]; competing and event_time
+// are in event order. Leaves grad, diag_hessian and diag_part in native
+// order and, for finegray_hessian_matvec, the censoring survival G(t-) at
+// each stop time (event order) in ws.T_2_term.
+template <typename IndexType, typename ValueType>
+double finegray_dev(const CoxDesign<IndexType> & design,
+		    CoxWorkspace & ws,
+		    const StatusRef & competing,
+		    const ConstVectorRef & event_time,
+		    const InputVector<ValueType> & eta,
+		    const InputVector<ValueType> & sample_weight,
+		    double loglik_sat)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  if (design.have_start_times) {
+    throw std::runtime_error("finegray_dev: start times are not supported.");
+  }
+  if (competing.size() != n || event_time.size() != n || eta.size() != n || sample_weight.size() != n) {
+    throw std::runtime_error("finegray_dev: competing, event_time, eta and sample_weight must have an entry per observation.");
+  }
+  PhaseTimer timer(PHASE_FINEGRAY, n * (2.0 * sizeof(ValueType) + sizeof(int) + 4.0 * sizeof(double)));
+
+  Eigen::Map<Eigen::VectorXd> & eta_event = ws.event_reorder[0];
+  Eigen::Map<Eigen::VectorXd> & w_event = ws.event_reorder[1];
+  Eigen::Map<Eigen::VectorXd> & exp_w_event = ws.event_reorder[2];
+  Eigen::Map<Eigen::VectorXd> & risk_sums = ws.risk_sums[0];
+  // G(t-) is kept in risk_sums[1] until T_2_term is no longer needed
+  Eigen::Map<Eigen::VectorXd> & G_minus = ws.risk_sums[1];
+  to_event_from_native<IndexType, ValueType>(eta, design.event_order, eta_event);
+  to_event_from_native<IndexType, ValueType>(sample_weight, design.event_order, w_event);
+  to_event_from_native<IndexType, double>(ws.exp_w, design.event_order, exp_w_event);
+
+  censoring_survival<IndexType>(design, competing, event_time, w_event, G_minus);
+  finegray_sum_over_risk_set<IndexType>(design, competing, G_minus, exp_w_event, risk_sums,
+					ws.reverse_cumsum[0], ws.reverse_cumsum[1]);
+
+  const Eigen::Map<Eigen::VectorXd> & w_cumsum = ws.forward_cumsum[0];
+  for (Eigen::Index i = 0; i < n; ++i) {
+    ws.w_avg(i) = (w_cumsum(design.last(i) + 1) - w_cumsum(design.first(i))) /
+      ((double) (design.last(i) + 1 - design.first(i)));
+  }
+  const auto status = design.status.template cast<double>().array();
+  const double loglik = (w_event.array() * eta_event.array() * status).sum() -
+    (risk_sums.array() > 0).select(risk_sums.array().log() * ws.w_avg.array() * status, 0.0).sum();
+
+  Eigen::Map<Eigen::VectorXd> dummy_map(nullptr, 0);
+  forward_prework(design.status, ws.w_avg, design.scaling, risk_sums, 0, 1, ws.forward_scratch, dummy_map, true);
+  finegray_sum_over_events<IndexType>(design, competing, G_minus, ws.forward_scratch, 1,
+				      ws.forward_cumsum[1], ws.forward_cumsum[2], ws.forward_cumsum[3], ws.T_1_term);
+  forward_prework(design.status, ws.w_avg, design.scaling, risk_sums, 0, 2, ws.forward_scratch, dummy_map, true);
+  finegray_sum_over_events<IndexType>(design, competing, G_minus, ws.forward_scratch, 2,
+				      ws.forward_cumsum[1], ws.forward_cumsum[2], ws.forward_cumsum[3], ws.T_2_term);
+
+  // grad last, as in cox_dev
+  ws.diag_part = exp_w_event.array() * ws.T_1_term.array();
+  ws.diag_hessian = -2.0 * (exp_w_event.array().square() * ws.T_2_term.array() - ws.diag_part.array());
+  ws.grad = -2.0 * (w_event.array() * status - ws.diag_part.array());
+  ws.T_2_term = G_minus;
+
+  to_native_from_event<IndexType>(ws.grad, design.event_order, ws.forward_scratch);
+  to_native_from_event<IndexType>(ws.diag_hessian, design.event_order, ws.forward_scratch);
+  to_native_from_event<IndexType>(ws.diag_part, design.event_order, ws.forward_scratch);
+
+  return 2.0 * (loglik_sat - loglik);
+}
+
+// Product of arg with (half) the Hessian of the Fine-Gray deviance at the
+// point finegray_dev last evaluated with this workspace, into
+// ws.hess_matvec (native order), as hessian_matvec.
+template <typename IndexType, typename ValueType>
+void finegray_hessian_matvec(const CoxDesign<IndexType> & design,
+			     CoxWorkspace & ws,
+			     const StatusRef & competing,
+			     const InputVector<ValueType> & arg)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  PhaseTimer timer(PHASE_FINEGRAY, n * (2.0 * sizeof(ValueType) + sizeof(IndexType) + 5.0 * sizeof(double)));
+  const Eigen::Map<Eigen::VectorXd> & G_minus = ws.T_2_term;
+
+  // exp_w * arg in event order, in hess_matvec until the sums below
+  for (Eigen::Index k = 0; k < n; ++k) {
+    const IndexType i = design.event_order(k);
+    ws.hess_matvec(k) = ws.exp_w(i) * static_cast<double>(arg(i));
+  }
+  finegray_sum_over_risk_set<IndexType>(design, competing, G_minus, ws.hess_matvec, ws.risk_sums[1],
+					ws.reverse_cumsum[2], ws.reverse_cumsum[3]);
+  ws.forward_scratch = (ws.risk_sums[0].array() > 0).select(design.status.template cast<double>().array() *
+							   ws.w_avg.array() * ws.risk_sums[1].array() /
+							   ws.risk_sums[0].array().square(), 0.0);
+  finegray_sum_over_events<IndexType>(design, competing, G_minus, ws.forward_scratch, 1,
+				      ws.forward_cumsum[0], ws.forward_cumsum[1], ws.forward_cumsum[2], ws.hess_matvec);
+  to_native_from_event<IndexType>(ws.hess_matvec, design.event_order, ws.forward_scratch);
+  ws.hess_matvec = ws.hess_matvec.array() * ws.exp_w.array() - ws.diag_part.array() * arg.array().template cast<double>();
+}
+
+// Competing event indicators in event order from the status codes (0
+// censored, 1 the cause, 2 a competing event) in native order.
+template <typename IndexType>
+Eigen::VectorXi competing_events(const IndexRef<IndexType> & event_order,
+				 const int *status)
+{
+  Eigen::VectorXi competing(event_order.size());
+  for (Eigen::Index k = 0; k < event_order.size(); ++k) {
+    competing(k) = status[event_order(k)] == 2;
+  }
+  return competing;
+}
+
+// Fine-Gray deviance at eta (native order, length n) with weights (null for
+// unit weights), for data preprocessed with the cause as status and the
+// competing indicators in event order; as deviance, with gradient and
+// diag_hessian filled when not null.
+template <typename IndexType>
+double finegray_deviance(const CoxDesignData<IndexType> & data,
+			 const StatusRef & competing,
+			 CoxWorkspaceData & work,
+			 const double *eta,
+			 const double *weight,
+			 double *gradient,
+			 double *diag_hessian)
+{
+  const Eigen::Index n = data.size();
+  const CoxDesign<IndexType> design = data.design();
+  CoxWorkspace & ws = work.ws;
+  Eigen::Map<const Eigen::VectorXd> eta_in(eta, n);
+  Eigen::Map<const Eigen::VectorXd> w(data.weights(weight), n);
+
+  const double loglik_sat = compute_sat_loglik<IndexType, double>(design.first, design.last, w,
+								  design.event_order, design.status,
+								  ws.forward_cumsum[0]);
+  work.center = eta_in.mean();
+  work.eta = eta_in.array() - work.center;
+  ws.exp_w = w.array() * work.eta.array().min(30.0).exp();
+  const double dev = finegray_dev<IndexType, double>(design, ws, competing, data.preproc.event.head(n),
+						     work.eta, w, loglik_sat);
+  if (gradient != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(gradient, n) = ws.grad;
+  }
+  if (diag_hessian != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(diag_hessian, n) = ws.diag_hessian;
+  }
+  return dev;
+}
+
+// Information (half the Hessian of the Fine-Gray deviance) times arg into
+// out, at the point finegray_deviance last evaluated with work.
+template <typename IndexType>
+void finegray_information_matvec(const CoxDesignData<IndexType> & data,
+				 const StatusRef & competing,
+				 CoxWorkspaceData & work,
+				 const double *arg,
+				 double *out)
+{
+  const Eigen::Index n = data.size();
+  Eigen::Map<const Eigen::VectorXd> v(arg, n);
+  finegray_hessian_matvec<IndexType, double>(data.design(), work.ws, competing, v);
+  Eigen::Map<Eigen::VectorXd>(out, n) = -work.ws.hess_matvec;
+}
+
+} // namespace coxdev
+
+#endif
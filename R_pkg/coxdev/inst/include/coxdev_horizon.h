@@ -0,0 +1,150 @@
+#ifndef COXDEV_HORIZON_H
+#define COXDEV_HORIZON_H
+
+// Deviances under administrative censoring at many horizons tau.
+//
+// Censoring at tau sets each stop time to min(t, tau) and drops the events
+// after tau. A subject still followed at tau stays in the risk set of every
+// event before it, so the risk sums, w_avg and Efron blocks of the events
+// up to tau are those of the full data: the log likelihood at tau is the
+// part of the full one's sum over events up to tau, and so is the saturated
+// one. One sweep of the event times in event order, with the horizons
+// sorted, then gives every deviance from the state cox_dev left.
+//
+// The gradient at tau is that of cox_dev with its forward cumsums cut off
+// at L, the number of stop times up to tau: every index into them is
+// clamped to L, which drops the events after tau from each subject's T_1
+// term (and their Efron parts, which lie on one side of tau with their
+// block).
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// Saturated log likelihoods and deviances at the horizons (non-decreasing)
+// into loglik_sat and deviance, and unless it is 0 x 0 the gradients into
+// the columns of gradient (n x horizons, native order), from the state
+// cox_dev last left in ws. event_time is in event order. Overwrites the
+// forward cumsums and forward_scratch, which hessian_matvec does not read.
+template <typename IndexType>
+void horizon_sweep(const CoxDesign<IndexType> & design,
+		   CoxWorkspace & ws,
+		   const ConstVectorRef & event_time,
+		   const ConstVectorRef & horizon,
+		   VectorRef loglik_sat,
+		   VectorRef deviance,
+		   MatrixRef gradient)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index m = horizon.size();
+  const bool do_gradient = gradient.size() > 0;
+  if (event_time.size() != n) {
+    throw std::runtime_error("horizon_sweep: event_time must have an entry per observation.");
+  }
+  if (loglik_sat.size() != m || deviance.size() != m || (do_gradient && (gradient.rows() != n || gradient.cols() != m))) {
+    throw std::runtime_error("horizon_sweep: the outputs must have an entry per horizon.");
+  }
+  for (Eigen::Index j = 1; j < m; ++j) {
+    if (horizon(j) < horizon(j - 1)) {
+      throw std::runtime_error("horizon_sweep: horizons must be sorted.");
+    }
+  }
+  // one pass over the event order state, then one per gradient column
+  PhaseTimer timer(PHASE_HORIZON, n * (sizeof(int) + 8.0 * sizeof(double) + 2.0 * sizeof(IndexType)) +
+		   (do_gradient ? m * n * ((design.efron ? 5.0 : 3.0) * sizeof(double) + 4.0 * sizeof(IndexType)) : 0.0));
+
+  const Eigen::Map<Eigen::VectorXd> & eta_event = ws.event_reorder[0];
+  const Eigen::Map<Eigen::VectorXd> & w_event = ws.event_reorder[1];
+  const Eigen::Map<Eigen::VectorXd> & risk_sums = ws.risk_sums[0];
+
+  // forward cumsum of weight * status, as compute_sat_loglik leaves it
+  Eigen::Map<Eigen::VectorXd> & W_status = ws.forward_cumsum[1];
+  ws.forward_scratch = w_event.array() * design.status.template cast<double>().array();
+  forward_cumsum(ws.forward_scratch, W_status);
+
+  double loglik = 0.0, sat = 0.0;
+  IndexType prev_first = -1;
+  Eigen::Index k = 0;
+  for (Eigen::Index j = 0; j < m; ++j) {
+    for (; k < n && event_time(k) <= horizon(j); ++k) {
+      if (design.status(k) == 1) {
+	loglik += w_event(k) * eta_event(k);
+	if (risk_sums(k) > 0) {
+	  loglik -= ws.w_avg(k) * std::log(risk_sums(k));
+	}
+      }
+      const IndexType f = design.first(k);
+      const double s = W_status(design.last(k) + 1) - W_status(f);
+      if (s > 0 && f != prev_first) {
+	sat -= s * std::log(s);
+      }
+      prev_first = f;
+    }
+    loglik_sat(j) = sat;
+    deviance(j) = 2.0 * (sat - loglik);
+  }
+  if (!do_gradient) {
+    return;
+  }
+
+  Eigen::Map<Eigen::VectorXd> dummy_map(nullptr, 0);
+  Eigen::Map<Eigen::VectorXd> & C_01 = ws.forward_cumsum[0];
+  forward_prework(design.status, ws.w_avg, design.scaling, risk_sums, 0, 1, ws.forward_scratch, dummy_map, true);
+  forward_cumsum(ws.forward_scratch, C_01);
+  Eigen::Map<Eigen::VectorXd> & C_11 = ws.forward_cumsum[2];
+  if (design.efron) {
+    forward_prework(design.status, ws.w_avg, design.scaling, risk_sums, 1, 1, ws.forward_scratch, dummy_map, true);
+    forward_cumsum(ws.forward_scratch, C_11);
+  }
+  Eigen::Index L = 0;
+  for (Eigen::Index j = 0; j < m; ++j) {
+    while (L < n && event_time(L) <= horizon(j)) {
+      ++L;
+    }
+    auto clamp = [L](Eigen::Index i) { return std::min(i, L); };
+    auto grad = gradient.col(j);
+    for (Eigen::Index i = 0; i < n; ++i) {
+      const Eigen::Index end = clamp(design.last(i) + 1);
+      double T_1 = C_01(end);
+      if (design.efron) {
+	T_1 -= C_11(end) - C_11(clamp(design.first(i)));
+      }
+      if (design.have_start_times) {
+	T_1 -= C_01(clamp(design.start_map(i)));
+      }
+      const double event_term = i < L ? w_event(i) * design.status(i) : 0.0;
+      // exp_w in event order is gathered again: cox_dev may have left grad over it
+      const IndexType row = design.event_order(i);
+      grad(row) = -2.0 * (event_term - ws.exp_w(row) * T_1);
+    }
+  }
+}
+
+// Saturated log likelihoods, deviances and, when gradient is not null, the
+// gradients (column major n x m) at the m sorted horizons, from the deviance
+// last evaluated with work.
+template <typename IndexType>
+void horizon_sweep(const CoxDesignData<IndexType> & data,
+		   CoxWorkspaceData & work,
+		   const double *horizon,
+		   Eigen::Index m,
+		   double *loglik_sat,
+		   double *deviance,
+		   double *gradient)
+{
+  const Eigen::Index n = data.size();
+  horizon_sweep<IndexType>(data.design(), work.ws, data.preproc.event.head(n),
+			   Eigen::Map<const Eigen::VectorXd>(horizon, m),
+			   Eigen::Map<Eigen::VectorXd>(loglik_sat, m),
+			   Eigen::Map<Eigen::VectorXd>(deviance, m),
+			   Eigen::Map<Eigen::MatrixXd>(gradient, gradient != nullptr ? n : 0,
+						       gradient != nullptr ? m : 0));
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef COXDEV_INFORMATION_H
+#define COXDEV_INFORMATION_H
+
+// Entries of the n x n information matrix in eta, the matrix hessian_matvec
+// multiplies by (up to sign), from its structure rather than n products.
+//
+// In event order, with e = exp_w, R_k the (Efron) risk sums and
+// gamma_k = status_k w_avg_k / R_k^2, the information is
+//
+//   I_pq = diag_part_p 1{p = q} - e_p e_q sum_k gamma_k a_kp a_kq,
+//
+// a_kp = 1{s_p <= k <= l_p} - sigma_k 1{f_p <= k <= l_p} the coefficient of
+// row p in the risk set of event k (sum_over_events), s = start_map (0
+// without start times), f = first, l = last and sigma = scaling (Efron only).
+// Each sum over k is over an interval, so with forward cumsums G_i of
+// gamma sigma^i every entry takes O(1) work.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+namespace detail {
+
+// sum over k in [lo, hi] of the cumsum G (length n + 1), 0 for an empty interval
+inline double interval_sum(const Eigen::Map<Eigen::VectorXd> & G, Eigen::Index lo, Eigen::Index hi)
+{
+  return hi >= lo ? G(hi + 1) - G(lo) : 0.0;
+}
+
+} // namespace detail
+
+// Entries rows x columns[begin:end] of the information matrix at the point
+// cox_dev last evaluated with ws, for rows and columns in native order, into
+// the same columns of the rows.size() x columns.size() matrix out. Other
+// columns are left alone, so disjoint column ranges may be filled by
+// different threads, each with its own workspace. Overwrites the
+// hessian_matvec scratch: forward_cumsum[1:4] and forward_scratch.
+template <typename IndexType>
+void information_matrix(const CoxDesign<IndexType> & design,
+			CoxWorkspace & ws,
+			const IndexRef<IndexType> & rows,
+			const IndexRef<IndexType> & columns,
+			Eigen::Index begin,
+			Eigen::Index end,
+			MatrixRef out)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index m = rows.size();
+  if (out.rows() != m || out.cols() != columns.size()) {
+    throw std::runtime_error("information_matrix: out must have a row per row and a column per column.");
+  }
+  if (begin < 0 || begin > end || end > columns.size()) {
+    throw std::runtime_error("information_matrix: invalid column range.");
+  }
+  for (Eigen::Index r = 0; r < m; ++r) {
+    if (rows(r) < 0 || rows(r) >= n) {
+      throw std::runtime_error("information_matrix: rows must lie in 0, ..., n - 1.");
+    }
+  }
+  for (Eigen::Index c = begin; c < end; ++c) {
+    if (columns(c) < 0 || columns(c) >= n) {
+      throw std::runtime_error("information_matrix: columns must lie in 0, ..., n - 1.");
+    }
+  }
+  const bool efron = design.efron;
+  Eigen::Map<Eigen::VectorXd> dummy_map(nullptr, 0);
+
+  // G_0, G_1, G_2: cumsums of gamma, gamma sigma, gamma sigma^2
+  Eigen::Map<Eigen::VectorXd> & G_0 = ws.forward_cumsum[1];
+  Eigen::Map<Eigen::VectorXd> & G_1 = ws.forward_cumsum[2];
+  Eigen::Map<Eigen::VectorXd> & G_2 = ws.forward_cumsum[3];
+  forward_prework(design.status, ws.w_avg, design.scaling, ws.risk_sums[0], 0, 2, ws.forward_scratch, dummy_map, true);
+  forward_cumsum(ws.forward_scratch, G_0);
+  if (efron) {
+    forward_prework(design.status, ws.w_avg, design.scaling, ws.risk_sums[0], 1, 2, ws.forward_scratch, dummy_map, true);
+    forward_cumsum(ws.forward_scratch, G_1);
+    forward_prework(design.status, ws.w_avg, design.scaling, ws.risk_sums[0], 2, 2, ws.forward_scratch, dummy_map, true);
+    forward_cumsum(ws.forward_scratch, G_2);
+  }
+
+  // event order positions of the requested rows, and their intervals,
+  // gathered once so the inner loop runs over contiguous arrays
+  IndexVector<IndexType> position(n);
+  for (Eigen::Index k = 0; k < n; ++k) {
+    position(design.event_order(k)) = static_cast<IndexType>(k);
+  }
+  IndexVector<IndexType> row_start(m), row_first(m), row_last(m);
+  Eigen::VectorXd row_exp_w(m);
+  for (Eigen::Index r = 0; r < m; ++r) {
+    const IndexType p = position(rows(r));
+    row_start(r) = design.have_start_times ? design.start_map(p) : 0;
+    row_first(r) = design.first(p);
+    row_last(r) = design.last(p);
+    row_exp_w(r) = ws.exp_w(rows(r));
+  }
+
+  for (Eigen::Index c = begin; c < end; ++c) {
+    const IndexType j = columns(c);
+    const IndexType q = position(j);
+    const Eigen::Index s_q = design.have_start_times ? design.start_map(q) : 0;
+    const Eigen::Index f_q = design.first(q);
+    const Eigen::Index l_q = design.last(q);
+    const double e_q = ws.exp_w(j);
+    for (Eigen::Index r = 0; r < m; ++r) {
+      const Eigen::Index l = std::min<Eigen::Index>(row_last(r), l_q);
+      double S = detail::interval_sum(G_0, std::max<Eigen::Index>(row_start(r), s_q), l);
+      if (efron) {
+	S -= (detail::interval_sum(G_1, std::max<Eigen::Index>(row_start(r), f_q), l) +
+	      detail::interval_sum(G_1, std::max<Eigen::Index>(row_first(r), s_q), l));
+	S += detail::interval_sum(G_2, std::max<Eigen::Index>(row_first(r), f_q), l);
+      }
+      out(r, c) = -row_exp_w(r) * e_q * S + (rows(r) == j ? ws.diag_part(j) : 0.0);
+    }
+  }
+}
+
+// The rows x columns block (n_rows x n_cols, column major) of the
+// information matrix at the point deviance last evaluated with work; null
+// rows or columns stand for all n in native order.
+template <typename IndexType>
+void information_matrix(const CoxDesignData<IndexType> & data,
+			CoxWorkspaceData & work,
+			const int64_t *rows,
+			Eigen::Index n_rows,
+			const int64_t *columns,
+			Eigen::Index n_columns,
+			double *out)
+{
+  const Eigen::Index n = data.size();
+  for (Eigen::Index r = 0; rows != nullptr && r < n_rows; ++r) {
+    if (rows[r] < 0 || rows[r] >= n) {
+      throw std::runtime_error("information_matrix: rows must lie in 0, ..., n - 1.");
+    }
+  }
+  for (Eigen::Index c = 0; columns != nullptr && c < n_columns; ++c) {
+    if (columns[c] < 0 || columns[c] >= n) {
+      throw std::runtime_error("information_matrix: columns must lie in 0, ..., n - 1.");
+    }
+  }
+  IndexVector<IndexType> row_index, column_index;
+  if (rows != nullptr) {
+    row_index = Eigen::Map<const VectorXi64>(rows, n_rows).cast<IndexType>();
+  } else {
+    row_index = IndexVector<IndexType>::LinSpaced(n, 0, static_cast<IndexType>(n - 1));
+  }
+  if (columns != nullptr) {
+    column_index = Eigen::Map<const VectorXi64>(columns, n_columns).cast<IndexType>();
+  } else {
+    column_index = IndexVector<IndexType>::LinSpaced(n, 0, static_cast<IndexType>(n - 1));
+  }
+  information_matrix<IndexType>(data.design(), work.ws, row_index, column_index, 0, column_index.size(),
+				Eigen::Map<Eigen::MatrixXd>(out, row_index.size(), column_index.size()));
+}
+
+} // namespace coxdev
+
+#endif
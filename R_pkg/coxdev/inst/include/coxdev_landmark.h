@@ -0,0 +1,199 @@
+#ifndef COXDEV_LANDMARK_H
+#define COXDEV_LANDMARK_H
+
+// The landmark supermodel: the cohort stacked at landmark times s_1, ...,
+// s_L, copy l holding the subjects still followed at s_l (stop time after
+// s_l and, with start times, start at most s_l) with start s_l, stop
+// min(t, h_l) and the events up to h_l, each copy a stratum of its own with
+// its own linear predictor. The stacked deviance is the sum of the copies'.
+//
+// The copies are never formed. Copy l's subjects are a suffix of the shared
+// event order, less those entering after s_l, and its events the stop times
+// in (s_l, h_l] of its subjects. Its risk set at t <= h_l is its subjects
+// with stop time at least t, as censoring at h_l moves no one out of it,
+// so a reversed cumsum over the suffix gives the risk sums and a forward
+// sweep from s_l the log likelihood and gradient, in O(n - a_l) for the
+// a_l stop times up to s_l, with no sort or copy of the data. Tied events
+// of a copy are the members of a tie block of the full data that are in
+// it, so Efron's correction is taken over those.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// Saturated log likelihoods and deviances of the copies begin, ..., end - 1
+// into the same entries of loglik_sat and deviance (length L), and unless
+// it is 0 x 0 their gradients into the same columns of gradient (n x L,
+// native order, zero off the copy). eta is n x L in native order, column l
+// the linear predictor of copy l (centered as for cox_dev). event is in
+// event order and start in start order, as preprocess returns them (start
+// unread without start times). Disjoint ranges may be filled by different
+// threads sharing the design.
+template <typename IndexType, typename ValueType>
+void landmark_deviances(const CoxDesign<IndexType> & design,
+			const ConstVectorRef & event,
+			const ConstVectorRef & start,
+			const InputMatrix<ValueType> & eta,
+			const InputVector<ValueType> & sample_weight,
+			const ConstVectorRef & landmark,
+			const ConstVectorRef & horizon,
+			Eigen::Index begin,
+			Eigen::Index end,
+			VectorRef loglik_sat,
+			VectorRef deviance,
+			MatrixRef gradient)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index L = landmark.size();
+  const bool do_gradient = gradient.size() > 0;
+  if (event.size() != n || (design.have_start_times && start.size() != n) || sample_weight.size() != n) {
+    throw std::runtime_error("landmark_deviances: event, start and sample_weight must have an entry per observation.");
+  }
+  if (eta.rows() != n || eta.cols() != L) {
+    throw std::runtime_error("landmark_deviances: eta must have a row per observation and a column per landmark.");
+  }
+  if (horizon.size() != L || loglik_sat.size() != L || deviance.size() != L ||
+      (do_gradient && (gradient.rows() != n || gradient.cols() != L))) {
+    throw std::runtime_error("landmark_deviances: the horizons and outputs must have an entry per landmark.");
+  }
+  if (begin < 0 || begin > end || end > L) {
+    throw std::runtime_error("landmark_deviances: invalid landmark range.");
+  }
+  for (Eigen::Index l = begin; l < end; ++l) {
+    if (!(horizon(l) > landmark(l))) {
+      throw std::runtime_error("landmark_deviances: each horizon must follow its landmark.");
+    }
+  }
+  // per copy: eta gathered to event order, the event order arrays read
+  // twice and the cumsum written and read once
+  PhaseTimer timer(PHASE_LANDMARK, (end - begin) * n * (sizeof(ValueType) + 2.0 * sizeof(IndexType) + sizeof(int) +
+							 (do_gradient ? 7.0 : 5.0) * sizeof(double)));
+
+  // shared by the copies: weights and start times in event order
+  Eigen::VectorXd w_event(n), start_event(design.have_start_times ? n : 0);
+  for (Eigen::Index k = 0; k < n; ++k) {
+    w_event(k) = static_cast<double>(sample_weight(design.event_order(k)));
+  }
+  if (design.have_start_times) {
+    Eigen::VectorXd start_native(n);
+    for (Eigen::Index j = 0; j < n; ++j) {
+      start_native(design.start_order(j)) = start(j);
+    }
+    for (Eigen::Index k = 0; k < n; ++k) {
+      start_event(k) = start_native(design.event_order(k));
+    }
+  }
+  Eigen::VectorXd eta_event(n), exp_w_event(n), risk_cumsum(n + 1);
+
+  for (Eigen::Index l = begin; l < end; ++l) {
+    const double s = landmark(l);
+    const double h = horizon(l);
+    // the copy's subjects are those of [a, n) entered by s, its events those
+    // of [a, b)
+    const Eigen::Index a = std::upper_bound(event.data(), event.data() + n, s) - event.data();
+    const Eigen::Index b = std::upper_bound(event.data() + a, event.data() + n, h) - event.data();
+    auto member = [&](Eigen::Index k) { return !design.have_start_times || start_event(k) <= s; };
+
+    risk_cumsum(n) = 0.0;
+    for (Eigen::Index k = n - 1; k >= a; --k) {
+      const IndexType i = design.event_order(k);
+      eta_event(k) = static_cast<double>(eta(i, l));
+      exp_w_event(k) = member(k) ? w_event(k) * std::exp(std::min(eta_event(k), 30.0)) : 0.0;
+      risk_cumsum(k) = risk_cumsum(k + 1) + exp_w_event(k);
+    }
+
+    // A sums w_avg / R over the tie blocks so far, B is the Efron part of
+    // the current block: a subject's gradient reads both
+    double loglik = 0.0, sat = 0.0, A = 0.0, B = 0.0;
+    if (do_gradient) {
+      gradient.col(l).setZero();
+    }
+    for (Eigen::Index k = a; k < n; ++k) {
+      const bool event_k = k < b && design.status(k) == 1 && member(k);
+      if (k < b && design.status(k) == 1 && design.first(k) == k) {
+	// a tie block of the full data, [k, last(k)]
+	const Eigen::Index last = design.last(k);
+	double W = 0.0, D = 0.0;
+	int d = 0;
+	for (Eigen::Index j = k; j <= last; ++j) {
+	  if (member(j)) {
+	    W += w_event(j);
+	    D += exp_w_event(j);
+	    loglik += w_event(j) * eta_event(j);
+	    ++d;
+	  }
+	}
+	B = 0.0;
+	if (d > 0) {
+	  const double R = risk_cumsum(k);
+	  const double w_avg = W / d;
+	  if (design.efron) {
+	    for (int r = 0; r < d; ++r) {
+	      const double c = static_cast<double>(r) / d;
+	      loglik -= w_avg * std::log(R - c * D);
+	      A += w_avg / (R - c * D);
+	      B += w_avg * c / (R - c * D);
+	    }
+	  } else {
+	    loglik -= W * std::log(R);
+	    A += W / R;
+	  }
+	  if (W > 0) {
+	    sat -= W * std::log(W);
+	  }
+	}
+      }
+      if (do_gradient && member(k)) {
+	const double T_1 = A - (event_k ? B : 0.0);
+	gradient(design.event_order(k), l) = -2.0 * ((event_k ? w_event(k) : 0.0) - exp_w_event(k) * T_1);
+      }
+    }
+    loglik_sat(l) = sat;
+    deviance(l) = 2.0 * (sat - loglik);
+  }
+}
+
+// Saturated log likelihoods, deviances and, when gradient is not null, the
+// gradients (column major n x L) of the L landmark copies at landmark times
+// and horizons (infinite for no truncation), eta column major n x L with
+// column l the linear predictor of copy l and weights weight (null for unit
+// weights). Each column of eta is centered on its own.
+template <typename IndexType>
+void landmark_deviances(const CoxDesignData<IndexType> & data,
+			const double *eta,
+			const double *weight,
+			const double *landmark,
+			const double *horizon,
+			Eigen::Index L,
+			double *loglik_sat,
+			double *deviance,
+			double *gradient)
+{
+  const Eigen::Index n = data.size();
+  Eigen::MatrixXd centered = Eigen::Map<const Eigen::MatrixXd>(eta, n, L);
+  for (Eigen::Index l = 0; l < L; ++l) {
+    centered.col(l).array() -= centered.col(l).mean();
+  }
+  Eigen::VectorXd unit;
+  if (weight == nullptr) {
+    unit.setOnes(n);
+  }
+  landmark_deviances<IndexType, double>(data.design(), data.preproc.event.head(n), data.preproc.start.head(n),
+					centered,
+					Eigen::Map<const Eigen::VectorXd>(weight != nullptr ? weight : unit.data(), n),
+					Eigen::Map<const Eigen::VectorXd>(landmark, L),
+					Eigen::Map<const Eigen::VectorXd>(horizon, L),
+					0, L,
+					Eigen::Map<Eigen::VectorXd>(loglik_sat, L),
+					Eigen::Map<Eigen::VectorXd>(deviance, L),
+					Eigen::Map<Eigen::MatrixXd>(gradient, gradient != nullptr ? n : 0,
+								    gradient != nullptr ? L : 0));
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef COXDEV_MULTI_H
+#define COXDEV_MULTI_H
+
+// Many outcomes (event, status) of the same n subjects, as in a phenome
+// wide scan, evaluated at one linear predictor.
+//
+// Each outcome is preprocessed on its own into column k of n x K arrays, so
+// the K designs live in a handful of flat allocations rather than K
+// objects, and ranges of outcomes may be preprocessed by different threads.
+// An evaluation computes exp(eta) once and then runs cox_dev for each
+// outcome of its range in one workspace, so a thread needs one workspace
+// whatever the number of outcomes.
+
+#include <limits>
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+template <typename IndexType>
+using IndexMatrix = Eigen::Matrix<IndexType, Eigen::Dynamic, Eigen::Dynamic>;
+
+// Column k holds outcome k's arrays, as Preprocessed has them; start_order,
+// event_map and start_map have no columns without start times. efron(k) is
+// 1 when Efron's correction applies to outcome k, i.e. it was asked for and
+// the outcome has tied deaths.
+template <typename IndexType>
+struct OutcomeArrays {
+  Eigen::Ref<IndexMatrix<IndexType> > event_order;
+  Eigen::Ref<IndexMatrix<IndexType> > start_order;
+  Eigen::Ref<IndexMatrix<IndexType> > first;
+  Eigen::Ref<IndexMatrix<IndexType> > last;
+  Eigen::Ref<IndexMatrix<IndexType> > event_map;
+  Eigen::Ref<IndexMatrix<IndexType> > start_map;
+  Eigen::Ref<Eigen::MatrixXi> status;
+  Eigen::Ref<Eigen::MatrixXd> scaling;
+  Eigen::Ref<Eigen::VectorXi> efron;
+};
+
+// The same arrays, read only, with the design of each outcome.
+template <typename IndexType>
+struct OutcomeDesigns {
+  Eigen::Ref<const IndexMatrix<IndexType> > event_order;
+  Eigen::Ref<const IndexMatrix<IndexType> > start_order;
+  Eigen::Ref<const IndexMatrix<IndexType> > first;
+  Eigen::Ref<const IndexMatrix<IndexType> > last;
+  Eigen::Ref<const IndexMatrix<IndexType> > event_map;
+  Eigen::Ref<const IndexMatrix<IndexType> > start_map;
+  Eigen::Ref<const Eigen::MatrixXi> status;
+  Eigen::Ref<const Eigen::MatrixXd> scaling;
+  Eigen::Ref<const Eigen::VectorXi> efron;
+  bool have_start_times;
+
+  Eigen::Index size() const { return status.rows(); }
+
+  Eigen::Index outcomes() const { return status.cols(); }
+
+  CoxDesign<IndexType> design(Eigen::Index k) const {
+    const Eigen::Index n = have_start_times ? size() : 0;
+    auto column = [n](const Eigen::Ref<const IndexMatrix<IndexType> > & x, Eigen::Index k) {
+      return Eigen::Map<const IndexVector<IndexType> >(n > 0 ? x.col(k).data() : nullptr, n);
+    };
+    return CoxDesign<IndexType>{event_order.col(k), column(start_order, k), first.col(k), last.col(k),
+	column(event_map, k), column(start_map, k), status.col(k), scaling.col(k),
+	have_start_times, efron(k) != 0};
+  }
+};
+
+// Preprocess the outcomes begin, ..., end - 1: the columns of event and
+// status (n x K), with start times the one column of start shared by all,
+// a column per outcome, or none. Other columns of out are left alone, so
+// disjoint ranges may be preprocessed by different threads.
+template <typename IndexType>
+void preprocess_outcomes(const InputMatrix<double> & start,
+			 const InputMatrix<double> & event,
+			 const Eigen::Ref<const Eigen::MatrixXi> & status,
+			 bool efron_ties,
+			 Eigen::Index begin,
+			 Eigen::Index end,
+			 OutcomeArrays<IndexType> & out)
+{
+  const Eigen::Index n = event.rows();
+  const Eigen::Index K = event.cols();
+  const bool have_start_times = start.cols() > 0;
+  if (status.rows() != n || status.cols() != K || (have_start_times && start.rows() != n) ||
+      (start.cols() > 1 && start.cols() != K)) {
+    throw std::runtime_error("preprocess_outcomes: event and status must be n x K, start n x 1 or n x K.");
+  }
+  if (out.event_order.rows() != n || out.event_order.cols() != K || out.first.cols() != K ||
+      out.last.cols() != K || out.status.cols() != K || out.scaling.cols() != K || out.efron.size() != K ||
+      (have_start_times && (out.start_order.cols() != K || out.event_map.cols() != K || out.start_map.cols() != K))) {
+    throw std::runtime_error("preprocess_outcomes: the outcome arrays must have a column per outcome.");
+  }
+  if (begin < 0 || begin > end || end > K) {
+    throw std::runtime_error("preprocess_outcomes: invalid outcome range.");
+  }
+  const Eigen::VectorXd no_start = have_start_times ? Eigen::VectorXd() :
+    Eigen::VectorXd::Constant(n, -std::numeric_limits<double>::infinity());
+
+  for (Eigen::Index k = begin; k < end; ++k) {
+    const Preprocessed<IndexType> p =
+      have_start_times ? preprocess<IndexType>(start.col(start.cols() > 1 ? k : 0), event.col(k), status.col(k)) :
+      preprocess<IndexType>(no_start, event.col(k), status.col(k));
+    out.event_order.col(k) = p.event_order;
+    out.first.col(k) = p.first;
+    out.last.col(k) = p.last;
+    out.status.col(k) = p.status;
+    out.scaling.col(k) = p.scaling;
+    if (have_start_times) {
+      out.start_order.col(k) = p.start_order;
+      out.event_map.col(k) = p.event_map;
+      out.start_map.col(k) = p.start_map;
+    }
+    out.efron(k) = efron_ties && p.scaling.norm() > 0;
+  }
+}
+
+// Saturated log likelihoods and deviances of the outcomes begin, ..., end - 1
+// at eta (centered as for cox_dev) with weights sample_weight, into the same
+// entries of loglik_sat and deviance (length K). Unless they are 0 x 0, the
+// same columns of gradient (n x K) receive the gradients and of X_gradient
+// (p x K) X' times them. Disjoint ranges may be filled by different threads,
+// each with its own workspace; exp_w is formed once per call.
+template <typename IndexType, typename ValueType>
+void outcome_deviances(const OutcomeDesigns<IndexType> & designs,
+		       CoxWorkspace & ws,
+		       const InputVector<ValueType> & eta,
+		       const InputVector<ValueType> & sample_weight,
+		       const InputMatrix<ValueType> & X,
+		       Eigen::Index begin,
+		       Eigen::Index end,
+		       VectorRef loglik_sat,
+		       VectorRef deviance,
+		       MatrixRef gradient,
+		       MatrixRef X_gradient)
+{
+  const Eigen::Index n = designs.size();
+  const Eigen::Index K = designs.outcomes();
+  const bool do_gradient = gradient.size() > 0;
+  const bool do_X_gradient = X_gradient.size() > 0;
+  if (eta.size() != n || sample_weight.size() != n) {
+    throw std::runtime_error("outcome_deviances: eta and sample_weight must have an entry per observation.");
+  }
+  if (begin < 0 || begin > end || end > K || loglik_sat.size() != K || deviance.size() != K) {
+    throw std::runtime_error("outcome_deviances: deviance and loglik_sat must have an entry per outcome.");
+  }
+  if (do_gradient && (gradient.rows() != n || gradient.cols() != K)) {
+    throw std::runtime_error("outcome_deviances: gradient must be n x K.");
+  }
+  if (do_X_gradient && (X.rows() != n || X_gradient.rows() != X.cols() || X_gradient.cols() != K)) {
+    throw std::runtime_error("outcome_deviances: X_gradient must have a row per column of X and a column per outcome.");
+  }
+
+  // exp_w once, as the bindings clip eta; cox_dev only reads it
+  ws.exp_w = sample_weight.template cast<double>().array() * eta.template cast<double>().array().min(30.0).exp();
+
+  for (Eigen::Index k = begin; k < end; ++k) {
+    const CoxDesign<IndexType> design = designs.design(k);
+    loglik_sat(k) = compute_sat_loglik<IndexType, ValueType>(design.first, design.last, sample_weight,
+							     design.event_order, design.status,
+							     ws.forward_cumsum[0]);
+    deviance(k) = cox_dev<IndexType, ValueType>(design, ws, eta, sample_weight, loglik_sat(k));
+    if (do_gradient) {
+      gradient.col(k) = ws.grad;
+    }
+    if (do_X_gradient) {
+      for (Eigen::Index j = 0; j < X.cols(); ++j) {
+	X_gradient(j, k) = X.col(j).template cast<double>().dot(ws.grad);
+      }
+    }
+  }
+}
+
+// K outcomes of n subjects preprocessed as above, owning their arrays.
+template <typename IndexType>
+struct CoxOutcomesData {
+  IndexMatrix<IndexType> event_order, start_order, first, last, event_map, start_map;
+  Eigen::MatrixXi status;
+  Eigen::MatrixXd scaling;
+  Eigen::VectorXi efron;
+  bool have_start_times;
+  Eigen::VectorXd unit_weight; // the weights when none are given
+
+  // event and status column major n x K, start (null without start times)
+  // the n start times all outcomes share
+  CoxOutcomesData(Eigen::Index n,
+		  Eigen::Index K,
+		  const double *start,
+		  const double *event,
+		  const int *status_,
+		  bool efron_ties) :
+    event_order(n, K), start_order(n, start != nullptr ? K : 0), first(n, K), last(n, K),
+    event_map(n, start != nullptr ? K : 0), start_map(n, start != nullptr ? K : 0),
+    status(n, K), scaling(n, K), efron(K), have_start_times(start != nullptr) {
+    OutcomeArrays<IndexType> out{event_order, start_order, first, last, event_map, start_map, status, scaling, efron};
+    preprocess_outcomes<IndexType>(Eigen::Map<const Eigen::MatrixXd>(start, n, start != nullptr ? 1 : 0),
+				   Eigen::Map<const Eigen::MatrixXd>(event, n, K),
+				   Eigen::Map<const Eigen::MatrixXi>(status_, n, K),
+				   efron_ties, 0, K, out);
+    unit_weight.setOnes(n);
+  }
+
+  Eigen::Index size() const { return status.rows(); }
+
+  // weight, or unit weights when it is null
+  const double * weights(const double *weight) const {
+    return weight != nullptr ? weight : unit_weight.data();
+  }
+
+  Eigen::Index outcomes() const { return status.cols(); }
+
+  OutcomeDesigns<IndexType> designs() const {
+    return OutcomeDesigns<IndexType>{event_order, start_order, first, last, event_map, start_map,
+	status, scaling, efron, have_start_times};
+  }
+};
+
+// Deviances of the outcomes first_outcome, ..., first_outcome + count - 1 at
+// linear predictor eta with weights weight (null for unit weights), eta
+// centered as by deviance, into deviance (length count) and, when not null,
+// their gradients into gradient (column major n x count).
+template <typename IndexType>
+void outcome_deviances(const CoxOutcomesData<IndexType> & data,
+		       CoxWorkspaceData & work,
+		       const double *eta,
+		       const double *weight,
+		       Eigen::Index first_outcome,
+		       Eigen::Index count,
+		       double *deviance,
+		       double *gradient)
+{
+  const Eigen::Index n = data.size();
+  const Eigen::Index K = data.outcomes();
+  if (first_outcome < 0 || count < 0 || first_outcome + count > K) {
+    throw std::runtime_error("outcome_deviances: invalid outcome range.");
+  }
+  Eigen::Map<const Eigen::VectorXd> eta_in(eta, n);
+  Eigen::Map<const Eigen::VectorXd> w(data.weights(weight), n);
+  work.center = eta_in.mean();
+  work.eta = eta_in.array() - work.center;
+  // the range's columns of the K outcome arrays, as the outcomes of their own
+  const OutcomeDesigns<IndexType> all = data.designs();
+  const bool s = data.have_start_times;
+  const OutcomeDesigns<IndexType> range{all.event_order.middleCols(first_outcome, count),
+      all.start_order.middleCols(s ? first_outcome : 0, s ? count : 0),
+      all.first.middleCols(first_outcome, count), all.last.middleCols(first_outcome, count),
+      all.event_map.middleCols(s ? first_outcome : 0, s ? count : 0),
+      all.start_map.middleCols(s ? first_outcome : 0, s ? count : 0),
+      all.status.middleCols(first_outcome, count), all.scaling.middleCols(first_outcome, count),
+      all.efron.segment(first_outcome, count), s};
+  Eigen::VectorXd loglik_sat(count);
+  outcome_deviances<IndexType, double>(range, work.ws, work.eta, w, Eigen::Map<const Eigen::MatrixXd>(nullptr, 0, 0),
+				       0, count, loglik_sat, Eigen::Map<Eigen::VectorXd>(deviance, count),
+				       Eigen::Map<Eigen::MatrixXd>(gradient, gradient != nullptr ? n : 0,
+								   gradient != nullptr ? count : 0),
+				       Eigen::Map<Eigen::MatrixXd>(nullptr, 0, 0));
+}
+
+} // namespace coxdev
+
+#endif
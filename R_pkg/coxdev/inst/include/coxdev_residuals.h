@@ -0,0 +1,190 @@
+#ifndef COXDEV_RESIDUALS_H
+#define COXDEV_RESIDUALS_H
+
+// Martingale, deviance, score and Schoenfeld residuals from the state cox_dev
+// leaves in the workspace, unweighted as in survival::residuals.coxph.
+//
+// T_1_term holds, for each row in event order, the baseline hazard
+// accumulated over its risk interval (with Efron's (1 - k / K) factor on its
+// own tied events), per unit of exp(eta): the martingale residual is
+// status - exp(eta) T_1_term. For a covariate x the score residual is
+//
+//   status_i (x_i - xbar_i) - exp(eta_i) sum_t (x_i - xbar(t)) dH(t)
+//
+// over the event times t in i's risk interval, xbar(t) the risk weighted
+// mean of x at t and xbar_i the mean of xbar over the (Efron) steps of i's
+// own event time; the first term is the Schoenfeld residual. Per column of
+// x this takes the same risk set and event sums as hessian_matvec, in the
+// same scratch buffers, so it may be called between information products.
+
+#include <algorithm>
+#include <cmath>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// Martingale residuals, and deviance residuals unless deviance has size 0,
+// in native order at the point cox_dev last evaluated with ws.
+template <typename IndexType>
+void martingale_residuals(const CoxDesign<IndexType> & design,
+			  const CoxWorkspace & ws,
+			  VectorRef martingale,
+			  VectorRef deviance)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  if (martingale.size() != n || (deviance.size() != 0 && deviance.size() != n)) {
+    throw std::runtime_error("martingale_residuals: outputs must have one entry per observation.");
+  }
+  const Eigen::Map<Eigen::VectorXd> & eta_event = ws.event_reorder[0];
+  for (Eigen::Index k = 0; k < n; ++k) {
+    const IndexType i = design.event_order(k);
+    const double status = design.status(k);
+    // as in the bindings, eta is clipped at 30 before exponentiating
+    const double M = status - std::exp(std::min(eta_event(k), 30.0)) * ws.T_1_term(k);
+    martingale(i) = M;
+    if (deviance.size() > 0) {
+      const double d2 = -2.0 * (M + (status > 0 ? status * std::log(status - M) : 0.0));
+      deviance(i) = (M > 0 ? 1.0 : (M < 0 ? -1.0 : 0.0)) * std::sqrt(std::max(d2, 0.0));
+    }
+  }
+}
+
+// The score and Schoenfeld residual pass for the column x (native order), at
+// the point cox_dev last evaluated with ws: calls emit(k, i, schoenfeld, score)
+// for each row, k in event order and i in native order, with Schoenfeld 0 for
+// censored rows. Overwrites the hessian_matvec scratch: risk_sums[1],
+// reverse_cumsum[2:4], forward_cumsum[0:3], forward_scratch and hess_matvec.
+template <typename IndexType, typename Column, typename Emit>
+void score_residual_column(const CoxDesign<IndexType> & design,
+			   CoxWorkspace & ws,
+			   const Column & x,
+			   Emit emit)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Map<Eigen::VectorXd> & eta_event = ws.event_reorder[0];
+  const Eigen::Map<Eigen::VectorXd> & risk_sums = ws.risk_sums[0];
+  Eigen::Map<Eigen::VectorXd> & risk_sums_x = ws.risk_sums[1];
+  Eigen::Map<Eigen::VectorXd> & xbar_cumsum = ws.forward_cumsum[2];
+  Eigen::Map<Eigen::VectorXd> & event_sums = ws.hess_matvec;
+
+  // S_1(t), the risk set sums of exp_w * x, in event order
+  ws.forward_scratch = ws.exp_w.array() * x.template cast<double>().array();
+  sum_over_risk_set<IndexType>(ws.forward_scratch,
+			       design.event_order,
+			       design.start_order,
+			       design.first,
+			       design.last,
+			       design.event_map,
+			       design.scaling,
+			       design.efron,
+			       risk_sums_x,
+			       ws.reverse_cumsum[2],
+			       ws.reverse_cumsum[3]);
+
+  // xbar = S_1 / S_0 at each event, summed up for the tied block means
+  for (Eigen::Index k = 0; k < n; ++k) {
+    ws.forward_scratch(k) = (design.status(k) != 0 && risk_sums(k) > 0) ? risk_sums_x(k) / risk_sums(k) : 0.0;
+  }
+  forward_cumsum(ws.forward_scratch, xbar_cumsum);
+
+  // sum_t xbar(t) dH(t) over each risk interval, as in hessian_matvec
+  ws.forward_scratch = (risk_sums.array() > 0).select((design.status.template cast<double>().array() * ws.w_avg.array() *
+							risk_sums_x.array()) / risk_sums.array().pow(2), 0.0);
+  sum_over_events<IndexType>(design.event_order,
+			     design.start_order,
+			     design.first,
+			     design.last,
+			     design.start_map,
+			     design.scaling,
+			     design.status,
+			     design.efron,
+			     ws.forward_cumsum[0],
+			     ws.forward_cumsum[1],
+			     ws.forward_scratch,
+			     event_sums);
+
+  for (Eigen::Index k = 0; k < n; ++k) {
+    const IndexType i = design.event_order(k);
+    const double xi = static_cast<double>(x(i));
+    double schoen = 0.0;
+    if (design.status(k) != 0) {
+      const double xbar = (xbar_cumsum(design.last(k) + 1) - xbar_cumsum(design.first(k))) /
+	((double) (design.last(k) + 1 - design.first(k)));
+      schoen = xi - xbar;
+    }
+    emit(k, i, schoen, schoen - std::exp(std::min(eta_event(k), 30.0)) * (xi * ws.T_1_term(k) - event_sums(k)));
+  }
+}
+
+// Score residuals and Schoenfeld residuals (0 for censored rows) of the
+// columns of X, n x p matrices in native order, at the point cox_dev last
+// evaluated with ws; either output may be 0 x 0 to skip it. Overwrites the
+// hessian_matvec scratch, see score_residual_column.
+template <typename IndexType, typename ValueType>
+void score_residuals(const CoxDesign<IndexType> & design,
+		     CoxWorkspace & ws,
+		     const InputMatrix<ValueType> & X,
+		     MatrixRef score,
+		     MatrixRef schoenfeld)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index p = X.cols();
+  const bool do_score = score.size() > 0;
+  const bool do_schoenfeld = schoenfeld.size() > 0;
+  if (X.rows() != n ||
+      (do_score && (score.rows() != n || score.cols() != p)) ||
+      (do_schoenfeld && (schoenfeld.rows() != n || schoenfeld.cols() != p))) {
+    throw std::runtime_error("score_residuals: X and the residuals must have a row per observation and the same columns.");
+  }
+  for (Eigen::Index j = 0; j < p; ++j) {
+    score_residual_column<IndexType>(design, ws, X.col(j),
+				     [&](Eigen::Index, IndexType i, double schoen, double s) {
+				       if (do_schoenfeld) {
+					 schoenfeld(i, j) = schoen;
+				       }
+				       if (do_score) {
+					 score(i, j) = s;
+				       }
+				     });
+  }
+}
+
+// Martingale and (when not null) deviance residuals at the point deviance
+// last evaluated with work.
+template <typename IndexType>
+void martingale_residuals(const CoxDesignData<IndexType> & data,
+			  const CoxWorkspaceData & work,
+			  double *martingale,
+			  double *deviance)
+{
+  const Eigen::Index n = data.size();
+  martingale_residuals<IndexType>(data.design(), work.ws,
+				  Eigen::Map<Eigen::VectorXd>(martingale, n),
+				  Eigen::Map<Eigen::VectorXd>(deviance, deviance != nullptr ? n : 0));
+}
+
+// Score and Schoenfeld residuals (either may be null) of the p columns of the
+// column major n x p matrix X, written column major, at the point deviance
+// last evaluated with work.
+template <typename IndexType>
+void score_residuals(const CoxDesignData<IndexType> & data,
+		     CoxWorkspaceData & work,
+		     const double *X,
+		     Eigen::Index p,
+		     double *score,
+		     double *schoenfeld)
+{
+  const Eigen::Index n = data.size();
+  score_residuals<IndexType, double>(data.design(), work.ws,
+				     Eigen::Map<const Eigen::MatrixXd>(X, n, p),
+				     Eigen::Map<Eigen::MatrixXd>(score, score != nullptr ? n : 0, score != nullptr ? p : 0),
+				     Eigen::Map<Eigen::MatrixXd>(schoenfeld, schoenfeld != nullptr ? n : 0,
+								 schoenfeld != nullptr ? p : 0));
+}
+
+} // namespace coxdev
+
+#endif
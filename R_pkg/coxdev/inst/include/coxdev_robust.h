@@ -0,0 +1,122 @@
+#ifndef COXDEV_ROBUST_H
+#define COXDEV_ROBUST_H
+
+// Cluster-robust (sandwich) variance of the coefficients beta of a linear
+// predictor X beta, from the state cox_dev leaves in the workspace.
+//
+// With U_g the sum over the rows of cluster g of the weighted score
+// residuals of X and I = X' H X the information in beta, the meat is
+// M = sum_g U_g U_g' and the covariance I^{-1} M I^{-1}, the robust variance
+// of survival::coxph(..., cluster = g). Each column's score residual pass is
+// reduced into U as it is formed, so no n x p matrix of residuals is held,
+// and the column of I comes from one hessian_matvec.
+
+#include <stdexcept>
+
+#include "coxdev_core.h"
+#include "coxdev_residuals.h"
+
+namespace coxdev {
+
+// Per cluster sums U (n_clusters x p) of the weighted score residuals of the
+// columns begin, ..., end - 1 of X and, unless information is 0 x 0, the same
+// columns of the p x p information X' H X, at the point cox_dev last
+// evaluated with ws. cluster holds codes 0, ..., n_clusters - 1 in native
+// order. Other columns are left alone, so disjoint column ranges may be
+// filled by different threads, each with its own workspace. Overwrites the
+// hessian_matvec scratch.
+template <typename IndexType, typename ValueType, typename ClusterType>
+void cluster_scores(const CoxDesign<IndexType> & design,
+		    CoxWorkspace & ws,
+		    const InputMatrix<ValueType> & X,
+		    const IndexRef<ClusterType> & cluster,
+		    Eigen::Index begin,
+		    Eigen::Index end,
+		    MatrixRef U,
+		    MatrixRef information)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index p = X.cols();
+  const bool do_information = information.size() > 0;
+  if (X.rows() != n || cluster.size() != n) {
+    throw std::runtime_error("cluster_scores: X and cluster must have a row per observation.");
+  }
+  if (U.cols() != p || (do_information && (information.rows() != p || information.cols() != p))) {
+    throw std::runtime_error("cluster_scores: U and information must have a column per column of X.");
+  }
+  if (begin < 0 || begin > end || end > p) {
+    throw std::runtime_error("cluster_scores: invalid column range.");
+  }
+  for (Eigen::Index i = 0; i < n; ++i) {
+    if (cluster(i) < 0 || cluster(i) >= U.rows()) {
+      throw std::runtime_error("cluster_scores: cluster codes must lie in 0, ..., n_clusters - 1.");
+    }
+  }
+  const Eigen::Map<Eigen::VectorXd> & w_event = ws.event_reorder[1];
+
+  for (Eigen::Index j = begin; j < end; ++j) {
+    U.col(j).setZero();
+    score_residual_column<IndexType>(design, ws, X.col(j),
+				     [&](Eigen::Index k, IndexType i, double, double score) {
+				       U(cluster(i), j) += w_event(k) * score;
+				     });
+    if (do_information) {
+      // hess_matvec is (half) the Hessian of the deviance, i.e. minus the information
+      hessian_matvec<IndexType, ValueType>(design, ws, X.col(j));
+      for (Eigen::Index r = 0; r < p; ++r) {
+	information(r, j) = -X.col(r).template cast<double>().dot(ws.hess_matvec);
+      }
+    }
+  }
+}
+
+// The meat U'U of the per cluster score sums U and the sandwich
+// I^{-1} U'U I^{-1}, both p x p.
+inline void sandwich(const Eigen::Ref<const Eigen::MatrixXd> & information,
+		     const Eigen::Ref<const Eigen::MatrixXd> & U,
+		     MatrixRef meat,
+		     MatrixRef covariance)
+{
+  const Eigen::Index p = U.cols();
+  if (information.rows() != p || information.cols() != p ||
+      meat.rows() != p || meat.cols() != p || covariance.rows() != p || covariance.cols() != p) {
+    throw std::runtime_error("sandwich: information, meat and covariance must be p x p.");
+  }
+  meat.noalias() = U.transpose() * U;
+  Eigen::LLT<Eigen::MatrixXd> llt(information);
+  if (llt.info() != Eigen::Success) {
+    throw std::runtime_error("sandwich: the information matrix is not positive definite.");
+  }
+  const Eigen::MatrixXd bread = llt.solve(Eigen::MatrixXd::Identity(p, p));
+  covariance.noalias() = bread * meat * bread;
+}
+
+// Meat and robust covariance (p x p, column major) of the coefficients of
+// the column major n x p matrix X, for cluster codes 0, ..., n_clusters - 1,
+// at the point deviance last evaluated with work.
+template <typename IndexType, typename ClusterType>
+void robust_variance(const CoxDesignData<IndexType> & data,
+		     CoxWorkspaceData & work,
+		     const double *X,
+		     Eigen::Index p,
+		     const ClusterType *cluster,
+		     Eigen::Index n_clusters,
+		     double *meat,
+		     double *covariance)
+{
+  const Eigen::Index n = data.size();
+  Eigen::MatrixXd U(n_clusters, p);
+  Eigen::MatrixXd information(p, p);
+  cluster_scores<IndexType, double, ClusterType>(data.design(), work.ws,
+						 Eigen::Map<const Eigen::MatrixXd>(X, n, p),
+						 Eigen::Map<const IndexVector<ClusterType> >(cluster, n),
+						 0, p, U, information);
+  sandwich(information, U,
+	   Eigen::Map<Eigen::MatrixXd>(meat, p, p),
+	   Eigen::Map<Eigen::MatrixXd>(covariance, p, p));
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef COXDEV_SAMPLED_H
+#define COXDEV_SAMPLED_H
+
+// An approximate deviance from subsampled risk sets, as in a nested
+// case-control design, for exploratory fits to cohorts too large for
+// exact risk sums to be worth their cost.
+//
+// The risk set of the tie block f, ..., l (event order) is the block's
+// events plus the at risk rows among the N = n - l - 1 positions after
+// it, those whose start time precedes the event time. The events' sum is
+// taken exactly; m controls are drawn uniformly, with replacement, from
+// the N positions and the sum over the at risk ones scaled by N / m, an
+// unbiased estimate S of the risk sum. When N <= m all N positions are
+// taken, and the block's terms are those of cox_dev. The block's log
+// likelihood and its derivatives are then those of cox_dev (Breslow or
+// Efron) with S for the risk sum: a smooth function of eta whose
+// gradient and Hessian diagonal are nonzero only at the events and the
+// drawn controls, so a block costs O(d + m log m) whatever n is. The
+// derivatives are written as entries (row, gradient, Hessian diagonal),
+// at most d + m per block, for the caller to add up: a range of blocks
+// needs room for its draws, not for the cohort.
+//
+// Draw s of block f is a function of (seed, f, s) alone (the counter
+// based generator of coxdev_bootstrap.h), so ranges of blocks may be
+// evaluated by different threads with the same results as one. The
+// sampling variance of S, estimated from the draws, gives by the delta
+// method a variance for the log likelihood, blocks being drawn
+// independently.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "coxdev_core.h"
+#include "coxdev_bootstrap.h"
+
+namespace coxdev {
+
+// Room for the entries of sampled_cox_dev over the tie blocks whose first
+// event is in begin, ..., end - 1 (event order) with n_controls draws each.
+template <typename IndexType>
+Eigen::Index sampled_entries(const CoxDesign<IndexType> & design,
+			     Eigen::Index n_controls,
+			     Eigen::Index begin,
+			     Eigen::Index end)
+{
+  const Eigen::Index n = design.status.size();
+  Eigen::Index size = 0;
+  for (Eigen::Index f = begin; f < end; ++f) {
+    if (design.status(f) == 1 && design.first(f) == f) {
+      const Eigen::Index l = design.last(f);
+      size += l - f + 1 + std::min(n - l - 1, n_controls);
+    }
+  }
+  return size;
+}
+
+// The tie blocks whose first event is in begin, ..., end - 1 (event order)
+// with n_controls draws each: their saturated log likelihoods, log
+// likelihoods and the estimated variance of the latter are added to
+// loglik(0), loglik(1) and loglik(2), and the first and second derivatives
+// of the log likelihood in eta written as entries (row(e), gradient(e),
+// diag_hessian(e)), rows in native order and repeated as often as blocks
+// reach them, to be summed. Returns the number of entries, which
+// sampled_entries bounds. eta - center is the linear predictor centered as
+// for cox_dev; event and start_event hold the event and start times in
+// event order (start_event is unread without start times).
+template <typename IndexType, typename ValueType>
+Eigen::Index sampled_cox_dev(const CoxDesign<IndexType> & design,
+			     const ConstVectorRef & event,
+			     const ConstVectorRef & start_event,
+			     const InputVector<ValueType> & eta,
+			     double center,
+			     const InputVector<ValueType> & sample_weight,
+			     Eigen::Index n_controls,
+			     std::uint64_t seed,
+			     Eigen::Index begin,
+			     Eigen::Index end,
+			     VectorRef loglik,
+			     Eigen::Ref<IndexVector<IndexType> > row,
+			     VectorRef gradient,
+			     VectorRef diag_hessian)
+{
+  COXDEV_KERNEL_SCOPE
+  const Eigen::Index n = design.status.size();
+  if (event.size() != n || (design.have_start_times && start_event.size() != n) ||
+      eta.size() != n || sample_weight.size() != n) {
+    throw std::runtime_error("sampled_cox_dev: event, start_event, eta and sample_weight must have an entry per observation.");
+  }
+  if (loglik.size() != 3 || gradient.size() != row.size() || diag_hessian.size() != row.size()) {
+    throw std::runtime_error("sampled_cox_dev: loglik must have 3 entries and row, gradient and diag_hessian the same number.");
+  }
+  if (n_controls < 1) {
+    throw std::runtime_error("sampled_cox_dev: n_controls must be positive.");
+  }
+  if (begin < 0 || begin > end || end > n) {
+    throw std::runtime_error("sampled_cox_dev: invalid range.");
+  }
+  PhaseTimer timer(PHASE_SAMPLED, (end - begin) * (2.0 * sizeof(ValueType) + 2.0 * sizeof(IndexType) + sizeof(int)));
+
+  // the draws of a block, as event order positions, and the at risk
+  // controls' rows (native order) with their x = w exp(eta) and counts
+  std::vector<Eigen::Index> draw;
+  std::vector<IndexType> control;
+  std::vector<double> control_x;
+  std::vector<double> control_count;
+  Eigen::Index entries = 0;
+
+  for (Eigen::Index f = begin; f < end; ++f) {
+    if (design.status(f) != 1 || design.first(f) != f) {
+      continue;
+    }
+    const Eigen::Index l = design.last(f);
+    const Eigen::Index d = l - f + 1;
+    const double t = event(f);
+
+    double W = 0.0, numerator = 0.0, E = 0.0;
+    for (Eigen::Index k = f; k <= l; ++k) {
+      const IndexType i = design.event_order(k);
+      const double w = static_cast<double>(sample_weight(i));
+      const double eta_i = static_cast<double>(eta(i)) - center;
+      W += w;
+      numerator += w * eta_i;
+      E += w * std::exp(std::min(eta_i, 30.0));
+    }
+    const double w_avg = W / d;
+
+    // the controls: every position after the block, or n_controls draws
+    const Eigen::Index N = n - l - 1;
+    const bool exact = N <= n_controls;
+    draw.clear();
+    if (exact) {
+      for (Eigen::Index k = l + 1; k < n; ++k) {
+	draw.push_back(k);
+      }
+    } else {
+      for (Eigen::Index s = 0; s < n_controls; ++s) {
+	const double u = bootstrap_uniform(seed, static_cast<std::uint64_t>(f), static_cast<std::uint64_t>(s));
+	draw.push_back(l + 1 + std::min(N - 1, static_cast<Eigen::Index>(u * N)));
+      }
+      std::sort(draw.begin(), draw.end());
+    }
+    const double scale = exact ? 1.0 : static_cast<double>(N) / n_controls;
+
+    // at risk: started before the block's events; the start of an event
+    // row is before its own time, so only the controls need checking
+    control.clear();
+    control_x.clear();
+    control_count.clear();
+    double C = 0.0, C2 = 0.0;
+    for (std::size_t s = 0; s < draw.size(); ++s) {
+      const Eigen::Index k = draw[s];
+      if (design.have_start_times && start_event(k) >= t) {
+	continue;
+      }
+      const IndexType i = design.event_order(k);
+      const double x = static_cast<double>(sample_weight(i)) *
+	std::exp(std::min(static_cast<double>(eta(i)) - center, 30.0));
+      C += x;
+      C2 += x * x;
+      if (!control.empty() && s > 0 && draw[s - 1] == k) {
+	control_count.back() += 1.0;
+      } else {
+	control.push_back(i);
+	control_x.push_back(x);
+	control_count.push_back(1.0);
+      }
+    }
+    const double S = E + scale * C;
+
+    // the block's terms, risk sum S - sigma_k E for its k-th event, sigma
+    // the Efron scaling; A for the derivatives in S, B in the events' eta
+    double A1 = 0.0, A2 = 0.0, B1 = 0.0, B2 = 0.0;
+    loglik(1) += numerator;
+    for (Eigen::Index k = f; k <= l; ++k) {
+      const double sigma = design.efron ? design.scaling(k) : 0.0;
+      const double R = S - sigma * E;
+      if (R > 0) {
+	loglik(1) -= w_avg * std::log(R);
+	A1 += w_avg / R;
+	A2 += w_avg / (R * R);
+	B1 += w_avg * (1 - sigma) / R;
+	B2 += w_avg * (1 - sigma) * (1 - sigma) / (R * R);
+      }
+    }
+    if (W > 0) {
+      loglik(0) -= W * std::log(W);
+    }
+
+    if (entries + d + static_cast<Eigen::Index>(control.size()) > row.size()) {
+      throw std::runtime_error("sampled_cox_dev: row, gradient and diag_hessian have no room for the entries of the range.");
+    }
+    for (Eigen::Index k = f; k <= l; ++k, ++entries) {
+      const IndexType i = design.event_order(k);
+      const double w = static_cast<double>(sample_weight(i));
+      const double x = w * std::exp(std::min(static_cast<double>(eta(i)) - center, 30.0));
+      row(entries) = i;
+      gradient(entries) = w - x * B1;
+      diag_hessian(entries) = -(x * B1 - x * x * B2);
+    }
+    for (std::size_t c = 0; c < control.size(); ++c, ++entries) {
+      const double a = scale * control_count[c] * control_x[c];
+      row(entries) = control[c];
+      gradient(entries) = -a * A1;
+      diag_hessian(entries) = -(a * A1 - a * a * A2);
+    }
+
+    // Var(S) = N^2 Var(y) / m for the m draws y (0 off the risk set);
+    // dloglik / dS = -A1
+    if (!exact) {
+      const double m = static_cast<double>(n_controls);
+      const double var_y = n_controls > 1 ? (C2 - C * C / m) / (m - 1) :
+	std::numeric_limits<double>::quiet_NaN();
+      loglik(2) += A1 * A1 * static_cast<double>(N) * N * var_y / m;
+    }
+  }
+  return entries;
+}
+
+// Approximate deviance at eta (native order, length n) with weights (null
+// for unit weights) from n_controls draws per tie block, returning it and
+// its estimated sampling variance in variance; gradient and diag_hessian,
+// when not null, receive those of the approximation.
+template <typename IndexType>
+double sampled_deviance(const CoxDesignData<IndexType> & data,
+			const double *eta,
+			const double *weight,
+			Eigen::Index n_controls,
+			std::uint64_t seed,
+			double *variance,
+			double *gradient,
+			double *diag_hessian)
+{
+  const Eigen::Index n = data.size();
+  const CoxDesign<IndexType> design = data.design();
+  const Eigen::Map<const Eigen::VectorXd> linear_predictor(eta, n);
+  Eigen::VectorXd unit;
+  if (weight == nullptr) {
+    unit.setOnes(n);
+  }
+  Eigen::Map<const Eigen::VectorXd> w(weight != nullptr ? weight : unit.data(), n);
+  const Eigen::Index size = sampled_entries<IndexType>(design, n_controls, 0, n);
+  IndexVector<IndexType> row(size);
+  Eigen::VectorXd loglik = Eigen::VectorXd::Zero(3), G(size), H(size);
+  const Eigen::Index entries =
+    sampled_cox_dev<IndexType, double>(design, data.preproc.event.head(n), data.start_event, linear_predictor,
+				       n > 0 ? linear_predictor.mean() : 0.0, w, n_controls, seed, 0, n,
+				       loglik, row, G, H);
+  if (variance != nullptr) {
+    *variance = 4.0 * loglik(2);
+  }
+  if (gradient != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(gradient, n).setZero();
+    for (Eigen::Index e = 0; e < entries; ++e) {
+      gradient[row(e)] -= 2.0 * G(e);
+    }
+  }
+  if (diag_hessian != nullptr) {
+    Eigen::Map<Eigen::VectorXd>(diag_hessian, n).setZero();
+    for (Eigen::Index e = 0; e < entries; ++e) {
+      diag_hessian[row(e)] -= 2.0 * H(e);
+    }
+  }
+  return 2.0 * (loglik(0) - loglik(1));
+}
+
+} // namespace coxdev
+
+#endif
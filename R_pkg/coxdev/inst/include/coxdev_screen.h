@@ -0,0 +1,192 @@
+#ifndef COXDEV_SCREEN_H
+#define COXDEV_SCREEN_H
+
+// Score tests of many candidate columns against one null model, as in a
+// genome wide screen: for each column x the score U = x' g, g the score of
+// the null model in eta, and its variance
+//
+//   V = x' I x - (x' I Z) (Z' I Z)^{-1} (Z' I x),
+//
+// I the information in eta and Z the null model's covariates, whose
+// coefficients the score test profiles out. U / sqrt(V) is the test
+// statistic. With the notation of coxdev_information.h,
+//
+//   x' I x = sum_p diag_part_p x_p^2 - sum_k gamma_k R_k(e x)^2,
+//
+// R_k(e x) the (Efron) risk sum of exp_w * x at event k. So one reversed
+// cumsum of exp_w * x in event order (and one in start order) gives x' I x
+// in O(n), without the full hessian_matvec, and the adjustment is the
+// squared norm of L^{-1} (I Z)' x, L the Cholesky factor of Z' I Z. The
+// null model's part is frozen once, after which columns are tested with
+// no workspace: threads share the state and need only their own cumsums.
+
+#include <stdexcept>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// The null model state score_screen reads: score (minus half the deviance
+// gradient) and diag_part in native order, exp_w in event and start order
+// (the latter empty without start times), gamma = status w_avg / risk_sums^2
+// in event order and adjust = L^{-1} (I Z)', q x n (0 x n without Z).
+struct ScreeningState {
+  ConstVectorRef score;
+  ConstVectorRef diag_part;
+  ConstVectorRef exp_w_event;
+  ConstVectorRef exp_w_start;
+  ConstVectorRef gamma;
+  Eigen::Ref<const Eigen::MatrixXd> adjust;
+};
+
+// Freeze the state at the point cox_dev last evaluated with ws into the
+// ScreeningState arrays, for null model covariates Z (n x q, possibly
+// q = 0). adjust is q x n. Overwrites the hessian_matvec scratch.
+template <typename IndexType, typename ValueType>
+void freeze_screening(const CoxDesign<IndexType> & design,
+		      CoxWorkspace & ws,
+		      const InputMatrix<ValueType> & Z,
+		      VectorRef score,
+		      VectorRef diag_part,
+		      VectorRef exp_w_event,
+		      VectorRef exp_w_start,
+		      VectorRef gamma,
+		      MatrixRef adjust)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index q = Z.cols();
+  if (Z.rows() != n && q > 0) {
+    throw std::runtime_error("freeze_screening: Z must have a row per observation.");
+  }
+  if (score.size() != n || diag_part.size() != n || exp_w_event.size() != n || gamma.size() != n ||
+      exp_w_start.size() != (design.have_start_times ? n : 0) || adjust.rows() != q || adjust.cols() != n) {
+    throw std::runtime_error("freeze_screening: the state arrays must have an entry per observation.");
+  }
+  score = -0.5 * ws.grad;
+  diag_part = ws.diag_part;
+  for (Eigen::Index k = 0; k < n; ++k) {
+    exp_w_event(k) = ws.exp_w(design.event_order(k));
+    const double R = ws.risk_sums[0](k);
+    gamma(k) = R > 0 ? design.status(k) * ws.w_avg(k) / (R * R) : 0.0;
+  }
+  for (Eigen::Index j = 0; j < exp_w_start.size(); ++j) {
+    exp_w_start(j) = ws.exp_w(design.start_order(j));
+  }
+  if (q == 0) {
+    return;
+  }
+
+  // I Z from q products, then the factor of Z' I Z
+  Eigen::MatrixXd IZ(n, q);
+  for (Eigen::Index j = 0; j < q; ++j) {
+    hessian_matvec<IndexType, ValueType>(design, ws, Z.col(j));
+    IZ.col(j) = -ws.hess_matvec;
+  }
+  Eigen::MatrixXd ZIZ = Z.transpose().template cast<double>() * IZ;
+  ZIZ = 0.5 * (ZIZ + ZIZ.transpose()).eval();
+  Eigen::LLT<Eigen::MatrixXd> llt(ZIZ);
+  if (llt.info() != Eigen::Success) {
+    throw std::runtime_error("freeze_screening: Z' I Z is not positive definite.");
+  }
+  adjust = llt.matrixL().solve(IZ.transpose());
+}
+
+// Scores and variances of the columns begin, ..., end - 1 of X into the
+// same entries of score and variance (length X.cols()). Other entries are
+// left alone, so disjoint column ranges may be filled by different threads
+// sharing state.
+template <typename IndexType, typename ValueType>
+void score_screen(const CoxDesign<IndexType> & design,
+		  const ScreeningState & state,
+		  const InputMatrix<ValueType> & X,
+		  Eigen::Index begin,
+		  Eigen::Index end,
+		  VectorRef score,
+		  VectorRef variance)
+{
+  const Eigen::Index n = design.status.size();
+  const Eigen::Index q = state.adjust.rows();
+  if (X.rows() != n) {
+    throw std::runtime_error("score_screen: X must have a row per observation.");
+  }
+  if (score.size() != X.cols() || variance.size() != X.cols()) {
+    throw std::runtime_error("score_screen: score and variance must have an entry per column of X.");
+  }
+  if (begin < 0 || begin > end || end > X.cols()) {
+    throw std::runtime_error("score_screen: invalid column range.");
+  }
+  // each column read three or four times, and the state once
+  PhaseTimer timer(PHASE_SCREEN, (end - begin) * n * ((design.have_start_times ? 4.0 : 3.0) * sizeof(ValueType) +
+						      (5.0 + q) * sizeof(double) + 3.0 * sizeof(IndexType)));
+
+  // reversed cumsums of exp_w * x in event and start order, length n + 1
+  Eigen::VectorXd event_cumsum(n + 1), start_cumsum(design.have_start_times ? n + 1 : 0);
+  Eigen::VectorXd projection(q);
+
+  for (Eigen::Index j = begin; j < end; ++j) {
+    const auto x = X.col(j);
+    double U = 0.0;
+    double quadratic = 0.0;
+    event_cumsum(n) = 0.0;
+    for (Eigen::Index k = n - 1; k >= 0; --k) {
+      const double x_k = static_cast<double>(x(k));
+      U += state.score(k) * x_k;
+      quadratic += state.diag_part(k) * x_k * x_k;
+      event_cumsum(k) = event_cumsum(k + 1) + state.exp_w_event(k) * static_cast<double>(x(design.event_order(k)));
+    }
+    if (design.have_start_times) {
+      start_cumsum(n) = 0.0;
+      for (Eigen::Index k = n - 1; k >= 0; --k) {
+	start_cumsum(k) = start_cumsum(k + 1) + state.exp_w_start(k) * static_cast<double>(x(design.start_order(k)));
+      }
+    }
+    for (Eigen::Index k = 0; k < n; ++k) {
+      if (state.gamma(k) == 0) {
+	continue;
+      }
+      double R = event_cumsum(design.first(k));
+      if (design.have_start_times) {
+	R -= start_cumsum(design.event_map(k));
+      }
+      if (design.efron) {
+	R -= (event_cumsum(design.first(k)) - event_cumsum(design.last(k) + 1)) * design.scaling(k);
+      }
+      quadratic -= state.gamma(k) * R * R;
+    }
+    if (q > 0) {
+      projection.noalias() = state.adjust * x.template cast<double>();
+      quadratic -= projection.squaredNorm();
+    }
+    score(j) = U;
+    variance(j) = quadratic;
+  }
+}
+
+// Scores and variances (length p) of the columns of the column major n x p
+// matrix X against the null model deviance last evaluated with work, with
+// covariates the column major n x q matrix Z (null when q = 0).
+template <typename IndexType>
+void score_screen(const CoxDesignData<IndexType> & data,
+		  CoxWorkspaceData & work,
+		  const double *Z,
+		  Eigen::Index q,
+		  const double *X,
+		  Eigen::Index p,
+		  double *score,
+		  double *variance)
+{
+  const Eigen::Index n = data.size();
+  const CoxDesign<IndexType> design = data.design();
+  Eigen::VectorXd null_score(n), diag_part(n), exp_w_event(n), exp_w_start(data.have_start_times ? n : 0), gamma(n);
+  Eigen::MatrixXd adjust(q, n);
+  freeze_screening<IndexType, double>(design, work.ws, Eigen::Map<const Eigen::MatrixXd>(Z, Z != nullptr ? n : 0, q),
+				      null_score, diag_part, exp_w_event, exp_w_start, gamma, adjust);
+  const ScreeningState state{null_score, diag_part, exp_w_event, exp_w_start, gamma, adjust};
+  score_screen<IndexType, double>(design, state, Eigen::Map<const Eigen::MatrixXd>(X, n, p), 0, p,
+				  Eigen::Map<Eigen::VectorXd>(score, p),
+				  Eigen::Map<Eigen::VectorXd>(variance, p));
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef COXDEV_STREAM_H
+#define COXDEV_STREAM_H
+
+// Appending rows to a preprocessed cohort without preprocessing it again.
+//
+// preprocess sorts the 2n stacked start and event times together; at equal
+// times deaths come before censorings and both before starts. All it
+// returns follows from the event times in event order and the start times
+// in start order:
+//
+//   event_map(k)  the number of starts before event k, those < t_k
+//   start_map(k)  the number of events before the start s of row k, those
+//                 with time <= s
+//   first, last   the tied block of deaths holding position k (k itself
+//                 for a censored row), scaling = (k - first) / (last + 1 - first)
+//
+// So a batch of m rows is sorted on its own and merged into both orders
+// from the back. Only positions after the first insertion move, and only
+// the maps the new rows change are recomputed, by walks over the sorted
+// times: when the batch lands after the existing follow up, as in calendar
+// time streaming, the work is sorting the batch plus the tail it joins,
+// not a sort of all 2(n + m) times.
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// The arrays of a cohort being appended to, each with room for at least
+// the rows after the append: those of Preprocessed (event and start the
+// times in event and start order) and event_position, the position of each
+// row in event order (native order).
+template <typename IndexType>
+struct AppendableDesign {
+  Eigen::Ref<IndexVector<IndexType> > event_order;
+  Eigen::Ref<IndexVector<IndexType> > start_order;
+  Eigen::Ref<IndexVector<IndexType> > first;
+  Eigen::Ref<IndexVector<IndexType> > last;
+  Eigen::Ref<IndexVector<IndexType> > event_map;
+  Eigen::Ref<IndexVector<IndexType> > start_map;
+  Eigen::Ref<IndexVector<IndexType> > event_position;
+  Eigen::Ref<Eigen::VectorXi> status;
+  Eigen::Ref<Eigen::VectorXd> event;
+  Eigen::Ref<Eigen::VectorXd> start;
+  Eigen::Ref<Eigen::VectorXd> scaling;
+};
+
+// event_position from event_order, for the first n rows.
+template <typename IndexType>
+void event_positions(const IndexRef<IndexType> & event_order,
+		     Eigen::Ref<IndexVector<IndexType> > event_position)
+{
+  for (Eigen::Index k = 0; k < event_order.size(); ++k) {
+    event_position(event_order(k)) = static_cast<IndexType>(k);
+  }
+}
+
+// Append the m rows (start, event, status) to the first n rows of d, as
+// rows n, ..., n + m - 1. start is ignored without start times, as are
+// event_map and start_map, which the kernels then do not read. Rows tied
+// with existing ones are placed after them. Returns whether the positions
+// recomputed hold tied deaths: with whether the cohort had ties before,
+// whether it has them now, for the Efron flag.
+template <typename IndexType>
+bool append_rows(AppendableDesign<IndexType> & d,
+		 Eigen::Index n,
+		 const InputVector<double> & start,
+		 const InputVector<double> & event,
+		 const StatusRef & status,
+		 bool have_start_times)
+{
+  const Eigen::Index m = status.size();
+  const Eigen::Index N = n + m;
+  if (event.size() != m || (have_start_times && start.size() != m)) {
+    throw std::runtime_error("append_rows: start, event and status must have an entry per new row.");
+  }
+  if (d.event_order.size() < N || d.start_order.size() < N || d.first.size() < N ||
+      d.last.size() < N || d.event_position.size() < N || d.status.size() < N ||
+      d.event.size() < N || d.start.size() < N || d.scaling.size() < N ||
+      (have_start_times && (d.event_map.size() < N || d.start_map.size() < N))) {
+    throw std::runtime_error("append_rows: the design arrays have no room for the new rows.");
+  }
+  if (m == 0) {
+    return false;
+  }
+  // the batch's start and event times, as in preprocess
+  PhaseTimer timer(PHASE_APPEND, m * (3.0 * sizeof(double) + sizeof(int)));
+  const double no_start = -std::numeric_limits<double>::infinity();
+  auto new_start = [&](Eigen::Index b) { return have_start_times ? start(b) : no_start; };
+
+  // (time, death first) order of events
+  auto event_before = [](double t_a, int s_a, double t_b, int s_b) {
+    return t_a < t_b || (t_a == t_b && s_a > s_b);
+  };
+
+  // the batch in event and in start order, ties by row
+  std::vector<IndexType> batch_event(m), batch_start(m);
+  std::iota(batch_event.begin(), batch_event.end(), 0);
+  std::iota(batch_start.begin(), batch_start.end(), 0);
+  std::sort(batch_event.begin(), batch_event.end(), [&](IndexType a, IndexType b) {
+      if (event_before(event(a), status(a), event(b), status(b))) return true;
+      if (event_before(event(b), status(b), event(a), status(a))) return false;
+      return a < b;
+    });
+  if (have_start_times) {
+    std::sort(batch_start.begin(), batch_start.end(), [&](IndexType a, IndexType b) {
+	return start(a) < start(b) || (start(a) == start(b) && a < b);
+      });
+  }
+  const double t_min = event(batch_event[0]);
+  const double s_min = new_start(batch_start[0]);
+
+  // events: the first existing position after the earliest new event,
+  // then a merge from the back over the positions from there on
+  Eigen::Index k0 = 0;
+  {
+    Eigen::Index hi = n;
+    const int s0 = status(batch_event[0]);
+    while (k0 < hi) {
+      const Eigen::Index mid = k0 + (hi - k0) / 2;
+      if (event_before(t_min, s0, d.event(mid), d.status(mid))) {
+	hi = mid;
+      } else {
+	k0 = mid + 1;
+      }
+    }
+  }
+  for (Eigen::Index i = n - 1, j = m - 1, out = N - 1; j >= 0; --out) {
+    const IndexType b = batch_event[j];
+    if (i >= k0 && event_before(event(b), status(b), d.event(i), d.status(i))) {
+      d.event_order(out) = d.event_order(i);
+      d.status(out) = d.status(i);
+      d.event(out) = d.event(i);
+      if (have_start_times) {
+	d.start_map(out) = d.start_map(i);
+      }
+      d.event_position(d.event_order(out)) = static_cast<IndexType>(out);
+      --i;
+    } else {
+      d.event_order(out) = static_cast<IndexType>(n + b);
+      d.status(out) = status(b);
+      d.event(out) = event(b);
+      d.event_position(n + b) = static_cast<IndexType>(out);
+      --j;
+    }
+  }
+
+  // starts likewise, by time alone
+  const Eigen::Index j0 = std::upper_bound(d.start.data(), d.start.data() + n, s_min) - d.start.data();
+  for (Eigen::Index i = n - 1, j = m - 1, out = N - 1; j >= 0; --out) {
+    const IndexType b = batch_start[j];
+    if (i >= j0 && new_start(b) < d.start(i)) {
+      d.start_order(out) = d.start_order(i);
+      d.start(out) = d.start(i);
+      --i;
+    } else {
+      d.start_order(out) = static_cast<IndexType>(n + b);
+      d.start(out) = new_start(b);
+      --j;
+    }
+  }
+
+  // tied blocks, from the start of the block the first insertion may join
+  const Eigen::Index kb = k0 > 0 ? static_cast<Eigen::Index>(d.first(k0 - 1)) : 0;
+  for (Eigen::Index k = kb; k < N; ++k) {
+    const bool tied = k > 0 && d.status(k) == 1 && d.status(k - 1) == 1 && d.event(k - 1) == d.event(k);
+    d.first(k) = tied ? d.first(k - 1) : static_cast<IndexType>(k);
+  }
+  bool ties = false;
+  for (Eigen::Index k = N - 1; k >= kb; --k) {
+    d.last(k) = (k == N - 1 || d.first(k + 1) != d.first(k)) ? static_cast<IndexType>(k) : d.last(k + 1);
+    const double f = static_cast<double>(d.first(k));
+    d.scaling(k) = ((double) k - f) / ((double) d.last(k) + 1.0 - f);
+    ties = ties || d.scaling(k) > 0;
+  }
+
+  if (have_start_times) {
+    // events after the earliest new start count it, as do all moved ones
+    const Eigen::Index kE = std::min(k0, static_cast<Eigen::Index>(std::upper_bound(d.event.data(), d.event.data() + k0, s_min) -
+								   d.event.data()));
+    Eigen::Index js = kE < N ? std::lower_bound(d.start.data(), d.start.data() + N, d.event(kE)) - d.start.data() : N;
+    for (Eigen::Index k = kE; k < N; ++k) {
+      while (js < N && d.start(js) < d.event(k)) {
+	++js;
+      }
+      d.event_map(k) = static_cast<IndexType>(js);
+    }
+
+    // starts at or after the earliest new event count it, as do all new rows
+    const Eigen::Index jS = std::min(j0, static_cast<Eigen::Index>(std::lower_bound(d.start.data(), d.start.data() + j0, t_min) -
+								   d.start.data()));
+    Eigen::Index ke = jS < N ? std::upper_bound(d.event.data(), d.event.data() + N, d.start(jS)) - d.event.data() : N;
+    for (Eigen::Index j = jS; j < N; ++j) {
+      while (ke < N && d.event(ke) <= d.start(j)) {
+	++ke;
+      }
+      d.start_map(d.event_position(d.start_order(j))) = static_cast<IndexType>(ke);
+    }
+  }
+  return ties;
+}
+
+// Append the m rows (start, event, status) to data, at least doubling the
+// room in its arrays when they are full. start is null exactly when data
+// has no start times. A workspace holds buffers for a number of rows, so
+// those made for data before must be made again.
+template <typename IndexType>
+void append(CoxDesignData<IndexType> & data,
+	    Eigen::Index m,
+	    const double *start,
+	    const double *event,
+	    const int *status)
+{
+  if ((start != nullptr) != data.have_start_times) {
+    throw std::runtime_error("append: start times must be given exactly when the cohort has them.");
+  }
+  const Eigen::Index n = data.size();
+  Preprocessed<IndexType> & p = data.preproc;
+  const bool positions = data.event_position.size() > 0 || n == 0; // kept since an earlier append
+  if (n + m > data.capacity()) {
+    const Eigen::Index capacity = std::max(n + m, 2 * data.capacity());
+    p.event_order.conservativeResize(capacity);
+    p.start_order.conservativeResize(capacity);
+    p.start.conservativeResize(capacity);
+    p.event.conservativeResize(capacity);
+    p.first.conservativeResize(capacity);
+    p.last.conservativeResize(capacity);
+    p.scaling.conservativeResize(capacity);
+    p.start_map.conservativeResize(capacity);
+    p.event_map.conservativeResize(capacity);
+    p.status.conservativeResize(capacity);
+  }
+  data.event_position.conservativeResize(data.capacity());
+  if (!positions) {
+    event_positions<IndexType>(p.event_order.head(n), data.event_position);
+  }
+  AppendableDesign<IndexType> d{p.event_order, p.start_order, p.first, p.last, p.event_map, p.start_map,
+      data.event_position, p.status, p.event, p.start, p.scaling};
+  const bool ties = append_rows<IndexType>(d, n,
+					   Eigen::Map<const Eigen::VectorXd>(start, start != nullptr ? m : 0),
+					   Eigen::Map<const Eigen::VectorXd>(event, m),
+					   Eigen::Map<const Eigen::VectorXi>(status, m),
+					   data.have_start_times);
+  data.n = n + m;
+  data.efron = data.efron_ties && (data.efron || ties);
+  data.set_start_event();
+  data.unit_weight.setOnes(data.n);
+}
+
+} // namespace coxdev
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef COXDEV_SURVIVAL_H
+#define COXDEV_SURVIVAL_H
+
+// Baseline cumulative hazard and predicted survival curves.
+//
+// After cox_dev, the workspace holds everything the Breslow / Efron
+// estimator of the baseline hazard needs: risk_sums[0] is, for each event in
+// event order, the weighted sum of exp(eta) over its risk set (with Efron's
+// correction applied to tied events) and w_avg the mean weight of its tied
+// block. The jump of the cumulative hazard at an event time is then the sum
+// of w_avg / risk_sums over the block, i.e. d / R for Breslow and
+// sum_k (d / K) / (R - k / K * R_tied) for Efron.
+//
+// Curves S(t | eta) = exp(-H_0(t) exp(eta)) are read off the step function
+// H_0 by binary search on its time grid.
+
+#include <algorithm>
+#include <cmath>
+
+#include "coxdev_core.h"
+
+namespace coxdev {
+
+// Baseline cumulative hazard on the unique event times, from the state cox_dev
+// left in risk_sums and w_avg (both in event order). event_time is in event
+// order and center is the value subtracted from eta before exponentiating, so
+// the hazard is that of eta = 0 on the caller's scale. time and cumhaz need
+// room for one entry per unique event time (n is always enough); returns the
+// number written.
+template <typename IndexType>
+Eigen::Index baseline_hazard(const CoxDesign<IndexType> & design,
+			     const ConstVectorRef & event_time,
+			     const ConstVectorRef & risk_sums,
+			     const ConstVectorRef & w_avg,
+			     double center,
+			     VectorRef time,
+			     VectorRef cumhaz)
+{
+  const Eigen::Index n = design.status.size();
+  if (event_time.size() != n || risk_sums.size() != n || w_avg.size() != n) {
+    throw std::runtime_error("baseline_hazard: event times, risk sums and w_avg must have one entry per observation.");
+  }
+  const double scale = std::exp(-center);
+  double H = 0.0;
+  Eigen::Index count = 0;
+  Eigen::Index k = 0;
+  while (k < n) {
+    if (design.status(k) == 0) {
+      ++k;
+      continue;
+    }
+    // the tied events first(k), ..., last(k) share an event time
+    const Eigen::Index last = design.last(k);
+    double jump = 0.0;
+    for (Eigen::Index m = k; m <= last; ++m) {
+      if (w_avg(m) > 0) {
+	jump += w_avg(m) / risk_sums(m);
+      }
+    }
+    H += scale * jump;
+    if (count >= time.size() || count >= cumhaz.size()) {
+      throw std::runtime_error("baseline_hazard: output is too short for the unique event times.");
+    }
+    time(count) = event_time(k);
+    cumhaz(count) = H;
+    ++count;
+    k = last + 1;
+  }
+  return count;
+}
+
+// Value of the step function cumhaz (right continuous, 0 before time(0)) at t.
+inline double cumulative_hazard_at(const ConstVectorRef & time,
+				   const ConstVectorRef & cumhaz,
+				   double t)
+{
+  const double *begin = time.data();
+  const Eigen::Index pos = std::upper_bound(begin, begin + time.size(), t) - begin;
+  return pos > 0 ? cumhaz(pos - 1) : 0.0;
+}
+
+// Survival curves exp(-H_0(t) exp(eta_i)) for each eta_i (rows) at each query
+// time t (columns) of the baseline (time, cumhaz) from baseline_hazard. out
+// is an eta.size() x query.size() matrix of either storage order.
+template <typename ValueType, typename Derived>
+void survival_curves(const ConstVectorRef & time,
+		     const ConstVectorRef & cumhaz,
+		     const InputVector<ValueType> & eta,
+		     const ConstVectorRef & query,
+		     const Eigen::MatrixBase<Derived> & out_)
+{
+  Eigen::MatrixBase<Derived> & out = const_cast<Eigen::MatrixBase<Derived> &>(out_);
+  if (time.size() != cumhaz.size()) {
+    throw std::runtime_error("survival_curves: time and cumhaz must have the same length.");
+  }
+  if (out.rows() != eta.size() || out.cols() != query.size()) {
+    throw std::runtime_error("survival_curves: out must have a row per linear predictor and a column per query time.");
+  }
+  // one binary search per query time, shared by all rows
+  Eigen::VectorXd H(query.size());
+  for (Eigen::Index j = 0; j < query.size(); ++j) {
+    H(j) = cumulative_hazard_at(time, cumhaz, query(j));
+  }
+  if (Derived::IsRowMajor) {
+    for (Eigen::Index i = 0; i < eta.size(); ++i) {
+      const double risk = std::exp(static_cast<double>(eta(i)));
+      for (Eigen::Index j = 0; j < H.size(); ++j) {
+	out(i, j) = std::exp(-risk * H(j));
+      }
+    }
+  } else {
+    const Eigen::VectorXd risk = eta.template cast<double>().array().exp();
+    for (Eigen::Index j = 0; j < H.size(); ++j) {
+      out.col(j) = (-H(j) * risk.array()).exp().matrix();
+    }
+  }
+}
+
+// Baseline cumulative hazard at the point deviance last evaluated with work,
+// see baseline_hazard above.
+template <typename IndexType>
+Eigen::Index baseline_hazard(const CoxDesignData<IndexType> & data,
+			     const CoxWorkspaceData & work,
+			     double *time,
+			     double *cumhaz)
+{
+  const Eigen::Index n = data.size();
+  return baseline_hazard<IndexType>(data.design(), data.preproc.event.head(n),
+				    work.ws.risk_sums[0], work.ws.w_avg, work.center,
+				    Eigen::Map<Eigen::VectorXd>(time, n),
+				    Eigen::Map<Eigen::VectorXd>(cumhaz, n));
+}
+
+} // namespace coxdev
+
+#endif
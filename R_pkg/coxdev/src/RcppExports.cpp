@@ -12,54 +12,54 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
-// forward_cumsum
-void forward_cumsum(const EIGEN_REF<Eigen::VectorXd> sequence, EIGEN_REF<Eigen::VectorXd> output);
-RcppExport SEXP _coxdev_forward_cumsum(SEXP sequenceSEXP, SEXP outputSEXP) {
+// allocation_count
+double allocation_count();
+RcppExport SEXP _coxdev_allocation_count() {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sequence(sequenceSEXP);
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type output(outputSEXP);
-    forward_cumsum(sequence, output);
-    return R_NilValue;
+    rcpp_result_gen = Rcpp::wrap(allocation_count());
+    return rcpp_result_gen;
 END_RCPP
 }
-// reverse_cumsums
-void reverse_cumsums(const EIGEN_REF<Eigen::VectorXd> sequence, EIGEN_REF<Eigen::VectorXd> event_buffer, EIGEN_REF<Eigen::VectorXd> start_buffer, const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> start_order, bool do_event, bool do_start);
-RcppExport SEXP _coxdev_reverse_cumsums(SEXP sequenceSEXP, SEXP event_bufferSEXP, SEXP start_bufferSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP do_eventSEXP, SEXP do_startSEXP) {
+// set_stats_enabled
+bool set_stats_enabled(bool enabled);
+RcppExport SEXP _coxdev_set_stats_enabled(SEXP enabledSEXP) {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sequence(sequenceSEXP);
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type event_buffer(event_bufferSEXP);
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type start_buffer(start_bufferSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_order(start_orderSEXP);
-    Rcpp::traits::input_parameter< bool >::type do_event(do_eventSEXP);
-    Rcpp::traits::input_parameter< bool >::type do_start(do_startSEXP);
-    reverse_cumsums(sequence, event_buffer, start_buffer, event_order, start_order, do_event, do_start);
-    return R_NilValue;
+    Rcpp::traits::input_parameter< bool >::type enabled(enabledSEXP);
+    rcpp_result_gen = Rcpp::wrap(set_stats_enabled(enabled));
+    return rcpp_result_gen;
 END_RCPP
 }
-// to_native_from_event
-void to_native_from_event(EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXi> event_order, EIGEN_REF<Eigen::VectorXd> reorder_buffer);
-RcppExport SEXP _coxdev_to_native_from_event(SEXP argSEXP, SEXP event_orderSEXP, SEXP reorder_bufferSEXP) {
+// reset_stats
+void reset_stats();
+RcppExport SEXP _coxdev_reset_stats() {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type reorder_buffer(reorder_bufferSEXP);
-    to_native_from_event(arg, event_order, reorder_buffer);
+    reset_stats();
     return R_NilValue;
 END_RCPP
 }
-// to_event_from_native
-void to_event_from_native(const EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXi> event_order, EIGEN_REF<Eigen::VectorXd> reorder_buffer);
-RcppExport SEXP _coxdev_to_event_from_native(SEXP argSEXP, SEXP event_orderSEXP, SEXP reorder_bufferSEXP) {
+// stats
+STATS_TYPE stats();
+RcppExport SEXP _coxdev_stats() {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type reorder_buffer(reorder_bufferSEXP);
-    to_event_from_native(arg, event_order, reorder_buffer);
+    rcpp_result_gen = Rcpp::wrap(stats());
+    return rcpp_result_gen;
+END_RCPP
+}
+// forward_cumsum
+void forward_cumsum(const EIGEN_REF<Eigen::VectorXd> sequence, EIGEN_REF<Eigen::VectorXd> output);
+RcppExport SEXP _coxdev_forward_cumsum(SEXP sequenceSEXP, SEXP outputSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sequence(sequenceSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type output(outputSEXP);
+    forward_cumsum(sequence, output);
     return R_NilValue;
 END_RCPP
 }
@@ -81,80 +81,151 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
-// compute_sat_loglik
-double compute_sat_loglik(const EIGEN_REF<Eigen::VectorXi> first, const EIGEN_REF<Eigen::VectorXi> last, const EIGEN_REF<Eigen::VectorXd> weight, const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> status, EIGEN_REF<Eigen::VectorXd> W_status);
-RcppExport SEXP _coxdev_compute_sat_loglik(SEXP firstSEXP, SEXP lastSEXP, SEXP weightSEXP, SEXP event_orderSEXP, SEXP statusSEXP, SEXP W_statusSEXP) {
+// c_preprocess
+PREPROCESS_TYPE c_preprocess(const InputVector<double> start, const InputVector<double> event, const EIGEN_REF<Eigen::VectorXi> status, bool use_int64);
+RcppExport SEXP _coxdev_c_preprocess(SEXP startSEXP, SEXP eventSEXP, SEXP statusSEXP, SEXP use_int64SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const InputVector<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< const InputVector<double> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< bool >::type use_int64(use_int64SEXP);
+    rcpp_result_gen = Rcpp::wrap(c_preprocess(start, event, status, use_int64));
+    return rcpp_result_gen;
+END_RCPP
+}
+// append_rows_R
+Rcpp::List append_rows_R(const InputVector<double> start, const InputVector<double> event, const EIGEN_REF<Eigen::VectorXi> status, bool have_start_times, const Rcpp::List preproc, SEXP event_order, SEXP start_order);
+RcppExport SEXP _coxdev_append_rows_R(SEXP startSEXP, SEXP eventSEXP, SEXP statusSEXP, SEXP have_start_timesSEXP, SEXP preprocSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const InputVector<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< const InputVector<double> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List >::type preproc(preprocSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    rcpp_result_gen = Rcpp::wrap(append_rows_R(start, event, status, have_start_times, preproc, event_order, start_order));
+    return rcpp_result_gen;
+END_RCPP
+}
+// reverse_cumsums_R
+void reverse_cumsums_R(const EIGEN_REF<Eigen::VectorXd> sequence, EIGEN_REF<Eigen::VectorXd> event_buffer, EIGEN_REF<Eigen::VectorXd> start_buffer, SEXP event_order, SEXP start_order, bool do_event, bool do_start);
+RcppExport SEXP _coxdev_reverse_cumsums_R(SEXP sequenceSEXP, SEXP event_bufferSEXP, SEXP start_bufferSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP do_eventSEXP, SEXP do_startSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sequence(sequenceSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type event_buffer(event_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type start_buffer(start_bufferSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< bool >::type do_event(do_eventSEXP);
+    Rcpp::traits::input_parameter< bool >::type do_start(do_startSEXP);
+    reverse_cumsums_R(sequence, event_buffer, start_buffer, event_order, start_order, do_event, do_start);
+    return R_NilValue;
+END_RCPP
+}
+// to_native_from_event_R
+void to_native_from_event_R(EIGEN_REF<Eigen::VectorXd> arg, SEXP event_order, EIGEN_REF<Eigen::VectorXd> reorder_buffer);
+RcppExport SEXP _coxdev_to_native_from_event_R(SEXP argSEXP, SEXP event_orderSEXP, SEXP reorder_bufferSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type reorder_buffer(reorder_bufferSEXP);
+    to_native_from_event_R(arg, event_order, reorder_buffer);
+    return R_NilValue;
+END_RCPP
+}
+// to_event_from_native_R
+void to_event_from_native_R(const EIGEN_REF<Eigen::VectorXd> arg, SEXP event_order, EIGEN_REF<Eigen::VectorXd> reorder_buffer);
+RcppExport SEXP _coxdev_to_event_from_native_R(SEXP argSEXP, SEXP event_orderSEXP, SEXP reorder_bufferSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type reorder_buffer(reorder_bufferSEXP);
+    to_event_from_native_R(arg, event_order, reorder_buffer);
+    return R_NilValue;
+END_RCPP
+}
+// compute_sat_loglik_R
+double compute_sat_loglik_R(SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> weight, SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, EIGEN_REF<Eigen::VectorXd> W_status);
+RcppExport SEXP _coxdev_compute_sat_loglik_R(SEXP firstSEXP, SEXP lastSEXP, SEXP weightSEXP, SEXP event_orderSEXP, SEXP statusSEXP, SEXP W_statusSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type first(firstSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type weight(weightSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type W_status(W_statusSEXP);
-    rcpp_result_gen = Rcpp::wrap(compute_sat_loglik(first, last, weight, event_order, status, W_status));
+    rcpp_result_gen = Rcpp::wrap(compute_sat_loglik_R(first, last, weight, event_order, status, W_status));
     return rcpp_result_gen;
 END_RCPP
 }
-// sum_over_events
-void sum_over_events(const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> start_order, const EIGEN_REF<Eigen::VectorXi> first, const EIGEN_REF<Eigen::VectorXi> last, const EIGEN_REF<Eigen::VectorXi> start_map, const EIGEN_REF<Eigen::VectorXd> scaling, const EIGEN_REF<Eigen::VectorXi> status, bool efron, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, EIGEN_REF<Eigen::VectorXd> value_buffer);
-RcppExport SEXP _coxdev_sum_over_events(SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP start_mapSEXP, SEXP scalingSEXP, SEXP statusSEXP, SEXP efronSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP value_bufferSEXP) {
+// sum_over_events_R
+void sum_over_events_R(SEXP event_order, SEXP start_order, SEXP first, SEXP last, SEXP start_map, const EIGEN_REF<Eigen::VectorXd> scaling, const EIGEN_REF<Eigen::VectorXi> status, bool efron, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, EIGEN_REF<Eigen::VectorXd> value_buffer);
+RcppExport SEXP _coxdev_sum_over_events_R(SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP start_mapSEXP, SEXP scalingSEXP, SEXP statusSEXP, SEXP efronSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP value_bufferSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_order(start_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type first(firstSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type last(lastSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
     Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
     Rcpp::traits::input_parameter< BUFFER_LIST >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type value_buffer(value_bufferSEXP);
-    sum_over_events(event_order, start_order, first, last, start_map, scaling, status, efron, forward_cumsum_buffers, forward_scratch_buffer, value_buffer);
+    sum_over_events_R(event_order, start_order, first, last, start_map, scaling, status, efron, forward_cumsum_buffers, forward_scratch_buffer, value_buffer);
     return R_NilValue;
 END_RCPP
 }
-// sum_over_risk_set
-void sum_over_risk_set(const EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> start_order, const EIGEN_REF<Eigen::VectorXi> first, const EIGEN_REF<Eigen::VectorXi> last, const EIGEN_REF<Eigen::VectorXi> event_map, const EIGEN_REF<Eigen::VectorXd> scaling, bool efron, BUFFER_LIST risk_sum_buffers, int risk_sum_buffers_offset, BUFFER_LIST reverse_cumsum_buffers, int reverse_cumsum_buffers_offset);
-RcppExport SEXP _coxdev_sum_over_risk_set(SEXP argSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP event_mapSEXP, SEXP scalingSEXP, SEXP efronSEXP, SEXP risk_sum_buffersSEXP, SEXP risk_sum_buffers_offsetSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP reverse_cumsum_buffers_offsetSEXP) {
+// sum_over_risk_set_R
+void sum_over_risk_set_R(const EIGEN_REF<Eigen::VectorXd> arg, SEXP event_order, SEXP start_order, SEXP first, SEXP last, SEXP event_map, const EIGEN_REF<Eigen::VectorXd> scaling, bool efron, BUFFER_LIST risk_sum_buffers, int risk_sum_buffers_offset, BUFFER_LIST reverse_cumsum_buffers, int reverse_cumsum_buffers_offset);
+RcppExport SEXP _coxdev_sum_over_risk_set_R(SEXP argSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP event_mapSEXP, SEXP scalingSEXP, SEXP efronSEXP, SEXP risk_sum_buffersSEXP, SEXP risk_sum_buffers_offsetSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP reverse_cumsum_buffers_offsetSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_order(start_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type first(firstSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type last(lastSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
     Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
     Rcpp::traits::input_parameter< BUFFER_LIST >::type risk_sum_buffers(risk_sum_buffersSEXP);
     Rcpp::traits::input_parameter< int >::type risk_sum_buffers_offset(risk_sum_buffers_offsetSEXP);
     Rcpp::traits::input_parameter< BUFFER_LIST >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
     Rcpp::traits::input_parameter< int >::type reverse_cumsum_buffers_offset(reverse_cumsum_buffers_offsetSEXP);
-    sum_over_risk_set(arg, event_order, start_order, first, last, event_map, scaling, efron, risk_sum_buffers, risk_sum_buffers_offset, reverse_cumsum_buffers, reverse_cumsum_buffers_offset);
+    sum_over_risk_set_R(arg, event_order, start_order, first, last, event_map, scaling, efron, risk_sum_buffers, risk_sum_buffers_offset, reverse_cumsum_buffers, reverse_cumsum_buffers_offset);
     return R_NilValue;
 END_RCPP
 }
-// cox_dev
-double cox_dev(const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> exp_w, const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> start_order, const EIGEN_REF<Eigen::VectorXi> status, const EIGEN_REF<Eigen::VectorXi> first, const EIGEN_REF<Eigen::VectorXi> last, const EIGEN_REF<Eigen::VectorXd> scaling, const EIGEN_REF<Eigen::VectorXi> event_map, const EIGEN_REF<Eigen::VectorXi> start_map, double loglik_sat, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> T_2_term, EIGEN_REF<Eigen::VectorXd> grad_buffer, EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer, EIGEN_REF<Eigen::VectorXd> diag_part_buffer, EIGEN_REF<Eigen::VectorXd> w_avg_buffer, BUFFER_LIST event_reorder_buffers, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, bool have_start_times, bool efron);
-RcppExport SEXP _coxdev_cox_dev(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP loglik_satSEXP, SEXP T_1_termSEXP, SEXP T_2_termSEXP, SEXP grad_bufferSEXP, SEXP diag_hessian_bufferSEXP, SEXP diag_part_bufferSEXP, SEXP w_avg_bufferSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+// cox_dev_R
+double cox_dev_R(const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, double loglik_sat, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> T_2_term, EIGEN_REF<Eigen::VectorXd> grad_buffer, EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer, EIGEN_REF<Eigen::VectorXd> diag_part_buffer, EIGEN_REF<Eigen::VectorXd> w_avg_buffer, BUFFER_LIST event_reorder_buffers, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_cox_dev_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP loglik_satSEXP, SEXP T_1_termSEXP, SEXP T_2_termSEXP, SEXP grad_bufferSEXP, SEXP diag_hessian_bufferSEXP, SEXP diag_part_bufferSEXP, SEXP w_avg_bufferSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type first(firstSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_map(event_mapSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
     Rcpp::traits::input_parameter< double >::type loglik_sat(loglik_satSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_2_term(T_2_termSEXP);
@@ -169,13 +240,13 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< BUFFER_LIST >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
     Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
     Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
-    rcpp_result_gen = Rcpp::wrap(cox_dev(eta, sample_weight, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, loglik_sat, T_1_term, T_2_term, grad_buffer, diag_hessian_buffer, diag_part_buffer, w_avg_buffer, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, have_start_times, efron));
+    rcpp_result_gen = Rcpp::wrap(cox_dev_R(eta, sample_weight, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, loglik_sat, T_1_term, T_2_term, grad_buffer, diag_hessian_buffer, diag_part_buffer, w_avg_buffer, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, have_start_times, efron));
     return rcpp_result_gen;
 END_RCPP
 }
-// hessian_matvec
-HESSIAN_MATVEC_TYPE hessian_matvec(const EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> risk_sums, const EIGEN_REF<Eigen::VectorXd> diag_part, const EIGEN_REF<Eigen::VectorXd> w_avg, const EIGEN_REF<Eigen::VectorXd> exp_w, const EIGEN_REF<Eigen::VectorXd> event_cumsum, const EIGEN_REF<Eigen::VectorXd> start_cumsum, const EIGEN_REF<Eigen::VectorXi> event_order, const EIGEN_REF<Eigen::VectorXi> start_order, const EIGEN_REF<Eigen::VectorXi> status, const EIGEN_REF<Eigen::VectorXi> first, const EIGEN_REF<Eigen::VectorXi> last, const EIGEN_REF<Eigen::VectorXd> scaling, const EIGEN_REF<Eigen::VectorXi> event_map, const EIGEN_REF<Eigen::VectorXi> start_map, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool have_start_times, bool efron);
-RcppExport SEXP _coxdev_hessian_matvec(SEXP argSEXP, SEXP etaSEXP, SEXP sample_weightSEXP, SEXP risk_sumsSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP exp_wSEXP, SEXP event_cumsumSEXP, SEXP start_cumsumSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+// hessian_matvec_R
+HESSIAN_MATVEC_TYPE hessian_matvec_R(const EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> risk_sums, const EIGEN_REF<Eigen::VectorXd> diag_part, const EIGEN_REF<Eigen::VectorXd> w_avg, const EIGEN_REF<Eigen::VectorXd> exp_w, const EIGEN_REF<Eigen::VectorXd> event_cumsum, const EIGEN_REF<Eigen::VectorXd> start_cumsum, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_hessian_matvec_R(SEXP argSEXP, SEXP etaSEXP, SEXP sample_weightSEXP, SEXP risk_sumsSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP exp_wSEXP, SEXP event_cumsumSEXP, SEXP start_cumsumSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -188,14 +259,14 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event_cumsum(event_cumsumSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type start_cumsum(start_cumsumSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_order(event_orderSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type first(firstSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type event_map(event_mapSEXP);
-    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
     Rcpp::traits::input_parameter< BUFFER_LIST >::type risk_sum_buffers(risk_sum_buffersSEXP);
     Rcpp::traits::input_parameter< BUFFER_LIST >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
@@ -203,36 +274,482 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type hess_matvec_buffer(hess_matvec_bufferSEXP);
     Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
     Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
-    rcpp_result_gen = Rcpp::wrap(hessian_matvec(arg, eta, sample_weight, risk_sums, diag_part, w_avg, exp_w, event_cumsum, start_cumsum, event_order, start_order, status, first, last, scaling, event_map, start_map, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, have_start_times, efron));
+    rcpp_result_gen = Rcpp::wrap(hessian_matvec_R(arg, eta, sample_weight, risk_sums, diag_part, w_avg, exp_w, event_cumsum, start_cumsum, event_order, start_order, status, first, last, scaling, event_map, start_map, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// concordance_R
+Eigen::VectorXd concordance_R(const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, SEXP event_map, SEXP start_map, const EIGEN_REF<Eigen::VectorXd> event, bool have_start_times, bool ipcw, double tau);
+RcppExport SEXP _coxdev_concordance_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP eventSEXP, SEXP have_start_timesSEXP, SEXP ipcwSEXP, SEXP tauSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type ipcw(ipcwSEXP);
+    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
+    rcpp_result_gen = Rcpp::wrap(concordance_R(eta, sample_weight, event_order, start_order, status, first, last, event_map, start_map, event, have_start_times, ipcw, tau));
+    return rcpp_result_gen;
+END_RCPP
+}
+// baseline_hazard_R
+double baseline_hazard_R(SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXd> risk_sums, const EIGEN_REF<Eigen::VectorXd> w_avg, double center, EIGEN_REF<Eigen::VectorXd> time, EIGEN_REF<Eigen::VectorXd> cumhaz);
+RcppExport SEXP _coxdev_baseline_hazard_R(SEXP event_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP eventSEXP, SEXP risk_sumsSEXP, SEXP w_avgSEXP, SEXP centerSEXP, SEXP timeSEXP, SEXP cumhazSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type risk_sums(risk_sumsSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< double >::type center(centerSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type cumhaz(cumhazSEXP);
+    rcpp_result_gen = Rcpp::wrap(baseline_hazard_R(event_order, status, first, last, event, risk_sums, w_avg, center, time, cumhaz));
+    return rcpp_result_gen;
+END_RCPP
+}
+// survival_R
+Eigen::MatrixXd survival_R(const EIGEN_REF<Eigen::VectorXd> time, const EIGEN_REF<Eigen::VectorXd> cumhaz, const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> query);
+RcppExport SEXP _coxdev_survival_R(SEXP timeSEXP, SEXP cumhazSEXP, SEXP etaSEXP, SEXP querySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type cumhaz(cumhazSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type query(querySEXP);
+    rcpp_result_gen = Rcpp::wrap(survival_R(time, cumhaz, eta, query));
+    return rcpp_result_gen;
+END_RCPP
+}
+// martingale_residuals_R
+void martingale_residuals_R(SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> eta_event, EIGEN_REF<Eigen::VectorXd> martingale, EIGEN_REF<Eigen::VectorXd> deviance);
+RcppExport SEXP _coxdev_martingale_residuals_R(SEXP event_orderSEXP, SEXP statusSEXP, SEXP T_1_termSEXP, SEXP eta_eventSEXP, SEXP martingaleSEXP, SEXP devianceSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type eta_event(eta_eventSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type martingale(martingaleSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type deviance(devianceSEXP);
+    martingale_residuals_R(event_order, status, T_1_term, eta_event, martingale, deviance);
+    return R_NilValue;
+END_RCPP
+}
+// score_residuals_R
+Rcpp::List score_residuals_R(const EIGEN_REF<Eigen::MatrixXd> X, EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> w_avg, Rcpp::List event_reorder_buffers, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, Rcpp::List reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_score_residuals_R(SEXP XSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP T_1_termSEXP, SEXP w_avgSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type X(XSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type event_reorder_buffers(event_reorder_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type hess_matvec_buffer(hess_matvec_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(score_residuals_R(X, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, T_1_term, w_avg, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, have_start_times, efron));
     return rcpp_result_gen;
 END_RCPP
 }
-// preprocess
-PREPROCESS_TYPE preprocess(const EIGEN_REF<Eigen::VectorXd> start, const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXi> status);
-RcppExport SEXP _coxdev_preprocess(SEXP startSEXP, SEXP eventSEXP, SEXP statusSEXP) {
+// cluster_scores_R
+Rcpp::List cluster_scores_R(const EIGEN_REF<Eigen::MatrixXd> X, SEXP cluster, int n_clusters, EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> diag_part, EIGEN_REF<Eigen::VectorXd> w_avg, Rcpp::List event_reorder_buffers, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, Rcpp::List reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_cluster_scores_R(SEXP XSEXP, SEXP clusterSEXP, SEXP n_clustersSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP T_1_termSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type X(XSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type cluster(clusterSEXP);
+    Rcpp::traits::input_parameter< int >::type n_clusters(n_clustersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_part(diag_partSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type event_reorder_buffers(event_reorder_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type hess_matvec_buffer(hess_matvec_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(cluster_scores_R(X, cluster, n_clusters, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, T_1_term, diag_part, w_avg, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// score_screen_R
+Rcpp::List score_screen_R(const EIGEN_REF<Eigen::MatrixXd> Z, const EIGEN_REF<Eigen::MatrixXd> X, EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, EIGEN_REF<Eigen::VectorXd> grad, EIGEN_REF<Eigen::VectorXd> diag_part, EIGEN_REF<Eigen::VectorXd> w_avg, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, Rcpp::List reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_score_screen_R(SEXP ZSEXP, SEXP XSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP gradSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type Z(ZSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type X(XSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type grad(gradSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_part(diag_partSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type hess_matvec_buffer(hess_matvec_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(score_screen_R(Z, X, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, grad, diag_part, w_avg, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// horizon_sweep_R
+Rcpp::List horizon_sweep_R(const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXd> horizon, SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP start_map, EIGEN_REF<Eigen::VectorXd> w_avg, Rcpp::List event_reorder_buffers, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, bool gradient, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_horizon_sweep_R(SEXP eventSEXP, SEXP horizonSEXP, SEXP event_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP start_mapSEXP, SEXP w_avgSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP gradientSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type horizon(horizonSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type event_reorder_buffers(event_reorder_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type gradient(gradientSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(horizon_sweep_R(event, horizon, event_order, status, first, last, scaling, start_map, w_avg, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, gradient, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// landmark_deviances_R
+Rcpp::List landmark_deviances_R(const EIGEN_REF<Eigen::MatrixXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> landmark, const EIGEN_REF<Eigen::VectorXd> horizon, const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXd> start, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, bool gradient, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_landmark_deviances_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP landmarkSEXP, SEXP horizonSEXP, SEXP eventSEXP, SEXP startSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP gradientSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type landmark(landmarkSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type horizon(horizonSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< bool >::type gradient(gradientSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(landmark_deviances_R(eta, sample_weight, landmark, horizon, event, start, event_order, start_order, status, first, last, scaling, gradient, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// finegray_dev_R
+double finegray_dev_R(const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> exp_w, const EIGEN_REF<Eigen::VectorXi> competing, const EIGEN_REF<Eigen::VectorXd> event, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, double loglik_sat, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> T_2_term, EIGEN_REF<Eigen::VectorXd> grad_buffer, EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer, EIGEN_REF<Eigen::VectorXd> diag_part_buffer, EIGEN_REF<Eigen::VectorXd> w_avg_buffer, BUFFER_LIST event_reorder_buffers, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, bool efron);
+RcppExport SEXP _coxdev_finegray_dev_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP exp_wSEXP, SEXP competingSEXP, SEXP eventSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP loglik_satSEXP, SEXP T_1_termSEXP, SEXP T_2_termSEXP, SEXP grad_bufferSEXP, SEXP diag_hessian_bufferSEXP, SEXP diag_part_bufferSEXP, SEXP w_avg_bufferSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type competing(competingSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< double >::type loglik_sat(loglik_satSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_2_term(T_2_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type grad_buffer(grad_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_hessian_buffer(diag_hessian_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_part_buffer(diag_part_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg_buffer(w_avg_bufferSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type event_reorder_buffers(event_reorder_buffersSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(finegray_dev_R(eta, sample_weight, exp_w, competing, event, event_order, start_order, status, first, last, scaling, loglik_sat, T_1_term, T_2_term, grad_buffer, diag_hessian_buffer, diag_part_buffer, w_avg_buffer, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// finegray_hessian_matvec_R
+HESSIAN_MATVEC_TYPE finegray_hessian_matvec_R(const EIGEN_REF<Eigen::VectorXd> arg, const EIGEN_REF<Eigen::VectorXi> competing, const EIGEN_REF<Eigen::VectorXd> exp_w, const EIGEN_REF<Eigen::VectorXd> diag_part, const EIGEN_REF<Eigen::VectorXd> w_avg, const EIGEN_REF<Eigen::VectorXd> risk_sums, const EIGEN_REF<Eigen::VectorXd> G_minus, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, BUFFER_LIST risk_sum_buffers, BUFFER_LIST forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, BUFFER_LIST reverse_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer, bool efron);
+RcppExport SEXP _coxdev_finegray_hessian_matvec_R(SEXP argSEXP, SEXP competingSEXP, SEXP exp_wSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP risk_sumsSEXP, SEXP G_minusSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP hess_matvec_bufferSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type arg(argSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type competing(competingSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type diag_part(diag_partSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type risk_sums(risk_sumsSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type G_minus(G_minusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
     Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
-    rcpp_result_gen = Rcpp::wrap(preprocess(start, event, status));
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< BUFFER_LIST >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type hess_matvec_buffer(hess_matvec_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(finegray_hessian_matvec_R(arg, competing, exp_w, diag_part, w_avg, risk_sums, G_minus, event_order, start_order, status, first, last, scaling, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// exact_partial_likelihood_R
+Rcpp::List exact_partial_likelihood_R(const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXd> start_event, SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, bool have_start_times);
+RcppExport SEXP _coxdev_exact_partial_likelihood_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP eventSEXP, SEXP start_eventSEXP, SEXP event_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP have_start_timesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type start_event(start_eventSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    rcpp_result_gen = Rcpp::wrap(exact_partial_likelihood_R(eta, sample_weight, event, start_event, event_order, status, first, last, have_start_times));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sampled_cox_dev_R
+Rcpp::List sampled_cox_dev_R(const EIGEN_REF<Eigen::VectorXd> eta, double center, const EIGEN_REF<Eigen::VectorXd> sample_weight, int n_controls, double seed, const EIGEN_REF<Eigen::VectorXd> event, const EIGEN_REF<Eigen::VectorXd> start_event, SEXP event_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_sampled_cox_dev_R(SEXP etaSEXP, SEXP centerSEXP, SEXP sample_weightSEXP, SEXP n_controlsSEXP, SEXP seedSEXP, SEXP eventSEXP, SEXP start_eventSEXP, SEXP event_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< double >::type center(centerSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< int >::type n_controls(n_controlsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type start_event(start_eventSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(sampled_cox_dev_R(eta, center, sample_weight, n_controls, seed, event, start_event, event_order, status, first, last, scaling, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// preprocess_outcomes_R
+Rcpp::List preprocess_outcomes_R(const EIGEN_REF<Eigen::MatrixXd> start, const EIGEN_REF<Eigen::MatrixXd> event, const EIGEN_REF<Eigen::MatrixXi> status, bool efron, bool use_int64);
+RcppExport SEXP _coxdev_preprocess_outcomes_R(SEXP startSEXP, SEXP eventSEXP, SEXP statusSEXP, SEXP efronSEXP, SEXP use_int64SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type event(eventSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    Rcpp::traits::input_parameter< bool >::type use_int64(use_int64SEXP);
+    rcpp_result_gen = Rcpp::wrap(preprocess_outcomes_R(start, event, status, efron, use_int64));
+    return rcpp_result_gen;
+END_RCPP
+}
+// outcome_deviances_R
+Rcpp::List outcome_deviances_R(Rcpp::List outcomes, const EIGEN_REF<Eigen::VectorXd> eta, const EIGEN_REF<Eigen::VectorXd> sample_weight, const EIGEN_REF<Eigen::MatrixXd> X, bool gradient, bool have_start_times);
+RcppExport SEXP _coxdev_outcome_deviances_R(SEXP outcomesSEXP, SEXP etaSEXP, SEXP sample_weightSEXP, SEXP XSEXP, SEXP gradientSEXP, SEXP have_start_timesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type outcomes(outcomesSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type X(XSEXP);
+    Rcpp::traits::input_parameter< bool >::type gradient(gradientSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    rcpp_result_gen = Rcpp::wrap(outcome_deviances_R(outcomes, eta, sample_weight, X, gradient, have_start_times));
+    return rcpp_result_gen;
+END_RCPP
+}
+// information_matrix_R
+Eigen::MatrixXd information_matrix_R(SEXP rows, int n_rows, SEXP columns, int n_columns, EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, EIGEN_REF<Eigen::VectorXd> diag_part, EIGEN_REF<Eigen::VectorXd> w_avg, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_information_matrix_R(SEXP rowsSEXP, SEXP n_rowsSEXP, SEXP columnsSEXP, SEXP n_columnsSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP diag_partSEXP, SEXP w_avgSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type rows(rowsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_rows(n_rowsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_columns(n_columnsSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_part(diag_partSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg(w_avgSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(information_matrix_R(rows, n_rows, columns, n_columns, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, diag_part, w_avg, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bootstrap_R
+Rcpp::List bootstrap_R(const InputVector<double> eta, const InputVector<double> sample_weight, const EIGEN_REF<Eigen::MatrixXd> X, bool bayesian, double seed, int n_replicates, EIGEN_REF<Eigen::VectorXd> exp_w, SEXP event_order, SEXP start_order, const EIGEN_REF<Eigen::VectorXi> status, SEXP first, SEXP last, const EIGEN_REF<Eigen::VectorXd> scaling, SEXP event_map, SEXP start_map, EIGEN_REF<Eigen::VectorXd> T_1_term, EIGEN_REF<Eigen::VectorXd> T_2_term, EIGEN_REF<Eigen::VectorXd> grad_buffer, EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer, EIGEN_REF<Eigen::VectorXd> diag_part_buffer, EIGEN_REF<Eigen::VectorXd> w_avg_buffer, Rcpp::List event_reorder_buffers, Rcpp::List risk_sum_buffers, Rcpp::List forward_cumsum_buffers, EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer, Rcpp::List reverse_cumsum_buffers, bool have_start_times, bool efron);
+RcppExport SEXP _coxdev_bootstrap_R(SEXP etaSEXP, SEXP sample_weightSEXP, SEXP XSEXP, SEXP bayesianSEXP, SEXP seedSEXP, SEXP n_replicatesSEXP, SEXP exp_wSEXP, SEXP event_orderSEXP, SEXP start_orderSEXP, SEXP statusSEXP, SEXP firstSEXP, SEXP lastSEXP, SEXP scalingSEXP, SEXP event_mapSEXP, SEXP start_mapSEXP, SEXP T_1_termSEXP, SEXP T_2_termSEXP, SEXP grad_bufferSEXP, SEXP diag_hessian_bufferSEXP, SEXP diag_part_bufferSEXP, SEXP w_avg_bufferSEXP, SEXP event_reorder_buffersSEXP, SEXP risk_sum_buffersSEXP, SEXP forward_cumsum_buffersSEXP, SEXP forward_scratch_bufferSEXP, SEXP reverse_cumsum_buffersSEXP, SEXP have_start_timesSEXP, SEXP efronSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const InputVector<double> >::type eta(etaSEXP);
+    Rcpp::traits::input_parameter< const InputVector<double> >::type sample_weight(sample_weightSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::MatrixXd> >::type X(XSEXP);
+    Rcpp::traits::input_parameter< bool >::type bayesian(bayesianSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type n_replicates(n_replicatesSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type exp_w(exp_wSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_order(event_orderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_order(start_orderSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXi> >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type last(lastSEXP);
+    Rcpp::traits::input_parameter< const EIGEN_REF<Eigen::VectorXd> >::type scaling(scalingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type event_map(event_mapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type start_map(start_mapSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_1_term(T_1_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type T_2_term(T_2_termSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type grad_buffer(grad_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_hessian_buffer(diag_hessian_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type diag_part_buffer(diag_part_bufferSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type w_avg_buffer(w_avg_bufferSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type event_reorder_buffers(event_reorder_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type risk_sum_buffers(risk_sum_buffersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type forward_cumsum_buffers(forward_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< EIGEN_REF<Eigen::VectorXd> >::type forward_scratch_buffer(forward_scratch_bufferSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type reverse_cumsum_buffers(reverse_cumsum_buffersSEXP);
+    Rcpp::traits::input_parameter< bool >::type have_start_times(have_start_timesSEXP);
+    Rcpp::traits::input_parameter< bool >::type efron(efronSEXP);
+    rcpp_result_gen = Rcpp::wrap(bootstrap_R(eta, sample_weight, X, bayesian, seed, n_replicates, exp_w, event_order, start_order, status, first, last, scaling, event_map, start_map, T_1_term, T_2_term, grad_buffer, diag_hessian_buffer, diag_part_buffer, w_avg_buffer, event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer, reverse_cumsum_buffers, have_start_times, efron));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bootstrap_weights_R
+Eigen::VectorXd bootstrap_weights_R(int n, bool bayesian, double seed, double replicate);
+RcppExport SEXP _coxdev_bootstrap_weights_R(SEXP nSEXP, SEXP bayesianSEXP, SEXP seedSEXP, SEXP replicateSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< bool >::type bayesian(bayesianSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< double >::type replicate(replicateSEXP);
+    rcpp_result_gen = Rcpp::wrap(bootstrap_weights_R(n, bayesian, seed, replicate));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_coxdev_allocation_count", (DL_FUNC) &_coxdev_allocation_count, 0},
+    {"_coxdev_set_stats_enabled", (DL_FUNC) &_coxdev_set_stats_enabled, 1},
+    {"_coxdev_reset_stats", (DL_FUNC) &_coxdev_reset_stats, 0},
+    {"_coxdev_stats", (DL_FUNC) &_coxdev_stats, 0},
     {"_coxdev_forward_cumsum", (DL_FUNC) &_coxdev_forward_cumsum, 2},
-    {"_coxdev_reverse_cumsums", (DL_FUNC) &_coxdev_reverse_cumsums, 7},
-    {"_coxdev_to_native_from_event", (DL_FUNC) &_coxdev_to_native_from_event, 3},
-    {"_coxdev_to_event_from_native", (DL_FUNC) &_coxdev_to_event_from_native, 3},
     {"_coxdev_forward_prework", (DL_FUNC) &_coxdev_forward_prework, 9},
-    {"_coxdev_compute_sat_loglik", (DL_FUNC) &_coxdev_compute_sat_loglik, 6},
-    {"_coxdev_sum_over_events", (DL_FUNC) &_coxdev_sum_over_events, 11},
-    {"_coxdev_sum_over_risk_set", (DL_FUNC) &_coxdev_sum_over_risk_set, 12},
-    {"_coxdev_cox_dev", (DL_FUNC) &_coxdev_cox_dev, 25},
-    {"_coxdev_hessian_matvec", (DL_FUNC) &_coxdev_hessian_matvec, 24},
-    {"_coxdev_preprocess", (DL_FUNC) &_coxdev_preprocess, 3},
+    {"_coxdev_c_preprocess", (DL_FUNC) &_coxdev_c_preprocess, 4},
+    {"_coxdev_append_rows_R", (DL_FUNC) &_coxdev_append_rows_R, 7},
+    {"_coxdev_reverse_cumsums_R", (DL_FUNC) &_coxdev_reverse_cumsums_R, 7},
+    {"_coxdev_to_native_from_event_R", (DL_FUNC) &_coxdev_to_native_from_event_R, 3},
+    {"_coxdev_to_event_from_native_R", (DL_FUNC) &_coxdev_to_event_from_native_R, 3},
+    {"_coxdev_compute_sat_loglik_R", (DL_FUNC) &_coxdev_compute_sat_loglik_R, 6},
+    {"_coxdev_sum_over_events_R", (DL_FUNC) &_coxdev_sum_over_events_R, 11},
+    {"_coxdev_sum_over_risk_set_R", (DL_FUNC) &_coxdev_sum_over_risk_set_R, 12},
+    {"_coxdev_cox_dev_R", (DL_FUNC) &_coxdev_cox_dev_R, 25},
+    {"_coxdev_hessian_matvec_R", (DL_FUNC) &_coxdev_hessian_matvec_R, 24},
+    {"_coxdev_concordance_R", (DL_FUNC) &_coxdev_concordance_R, 13},
+    {"_coxdev_baseline_hazard_R", (DL_FUNC) &_coxdev_baseline_hazard_R, 10},
+    {"_coxdev_survival_R", (DL_FUNC) &_coxdev_survival_R, 4},
+    {"_coxdev_martingale_residuals_R", (DL_FUNC) &_coxdev_martingale_residuals_R, 6},
+    {"_coxdev_score_residuals_R", (DL_FUNC) &_coxdev_score_residuals_R, 20},
+    {"_coxdev_cluster_scores_R", (DL_FUNC) &_coxdev_cluster_scores_R, 23},
+    {"_coxdev_score_screen_R", (DL_FUNC) &_coxdev_score_screen_R, 21},
+    {"_coxdev_horizon_sweep_R", (DL_FUNC) &_coxdev_horizon_sweep_R, 16},
+    {"_coxdev_landmark_deviances_R", (DL_FUNC) &_coxdev_landmark_deviances_R, 15},
+    {"_coxdev_finegray_dev_R", (DL_FUNC) &_coxdev_finegray_dev_R, 24},
+    {"_coxdev_finegray_hessian_matvec_R", (DL_FUNC) &_coxdev_finegray_hessian_matvec_R, 19},
+    {"_coxdev_exact_partial_likelihood_R", (DL_FUNC) &_coxdev_exact_partial_likelihood_R, 9},
+    {"_coxdev_sampled_cox_dev_R", (DL_FUNC) &_coxdev_sampled_cox_dev_R, 14},
+    {"_coxdev_preprocess_outcomes_R", (DL_FUNC) &_coxdev_preprocess_outcomes_R, 5},
+    {"_coxdev_outcome_deviances_R", (DL_FUNC) &_coxdev_outcome_deviances_R, 6},
+    {"_coxdev_information_matrix_R", (DL_FUNC) &_coxdev_information_matrix_R, 20},
+    {"_coxdev_bootstrap_R", (DL_FUNC) &_coxdev_bootstrap_R, 28},
+    {"_coxdev_bootstrap_weights_R", (DL_FUNC) &_coxdev_bootstrap_weights_R, 4},
     {NULL, NULL, 0}
 };
 
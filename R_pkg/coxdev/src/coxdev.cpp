@@ -5,109 +5,130 @@
 #include "../inst/include/coxdev.h"
 #endif
 
-//
-// Since we want this to be usable both in R and python, I will use int for indexing rather than
-// Eigen::Index. Later I will use a #define to emit appropriate code
-// Also using doubles for status, which is really only 0, 1
-//
+#ifdef COXDEV_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+std::atomic<long> coxdev_alloc::count(0);
+thread_local int coxdev_alloc::depth = 0;
+
+void * operator new(std::size_t size)
+{
+  coxdev_alloc::note();
+  void *p = std::malloc(size > 0 ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+void * operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#endif
+
+// Number of heap allocations made inside the kernels so far,
+// -1 unless built with COXDEV_COUNT_ALLOCATIONS.
+// [[Rcpp::export(.allocation_count)]]
+double allocation_count()
+{
+#ifdef COXDEV_COUNT_ALLOCATIONS
+  return (double) coxdev_alloc::count.load();
+#else
+  return -1;
+#endif
+}
+
+// The kernels live in coxdev_core.h; what follows maps python / R
+// arguments onto them.
+
+// Turn instrumentation on or off, returning the previous setting.
+// [[Rcpp::export(.set_stats_enabled)]]
+bool set_stats_enabled(bool enabled)
+{
+  return coxdev::set_stats_enabled(enabled);
+}
+
+// [[Rcpp::export(.reset_stats)]]
+void reset_stats()
+{
+  coxdev::reset_stats();
+}
+
+// The counters so far, keyed by phase name, plus the number of
+// buffer list elements mapped as "buffer_remaps".
+// [[Rcpp::export(.stats)]]
+STATS_TYPE stats()
+{
+  const coxdev::PhaseCounters & counters = coxdev::phase_counters();
+#ifdef PY_INTERFACE
+  py::dict result;
+  for (int i = 0; i < coxdev::NUM_PHASES; ++i) {
+    py::dict phase;
+    phase["seconds"] = 1e-9 * (double) counters.nanoseconds[i].load();
+    phase["calls"] = counters.calls[i].load();
+    phase["bytes"] = counters.bytes[i].load();
+    result[coxdev::phase_name(i)] = phase;
+  }
+  result["buffer_remaps"] = counters.buffer_remaps.load();
+  return result;
+#endif
+#ifdef R_INTERFACE
+  Rcpp::List result(coxdev::NUM_PHASES + 1);
+  Rcpp::CharacterVector names(coxdev::NUM_PHASES + 1);
+  for (int i = 0; i < coxdev::NUM_PHASES; ++i) {
+    result[i] = Rcpp::List::create(
+				   Rcpp::_["seconds"] = 1e-9 * (double) counters.nanoseconds[i].load(),
+				   Rcpp::_["calls"] = (double) counters.calls[i].load(),
+				   Rcpp::_["bytes"] = (double) counters.bytes[i].load());
+    names[i] = coxdev::phase_name(i);
+  }
+  result[coxdev::NUM_PHASES] = (double) counters.buffer_remaps.load();
+  names[coxdev::NUM_PHASES] = "buffer_remaps";
+  result.attr("names") = names;
+  return result;
+#endif
+}
 
 // Compute cumsum with a padding of 0 at the beginning
-// @param sequence input sequence [ro]
-// @param output output sequence  [w]
 // [[Rcpp::export(.forward_cumsum)]]
 void forward_cumsum(const EIGEN_REF<Eigen::VectorXd> sequence,
 		    EIGEN_REF<Eigen::VectorXd> output)
 {
-  if (sequence.size() + 1 != output.size()) {
-    ERROR_MSG("forward_cumsum: output size must be one longer than input's.");
-  }
-      
-  double sum = 0.0;
-  output(0) = sum;
-  for (int i = 1; i < output.size(); ++i) {
-    sum = sum + sequence(i - 1);
-    output(i) = sum;
-  }
+  coxdev::forward_cumsum(sequence, output);
 }
 
-// Compute reversed cumsums of a sequence
-// in start and / or event order with a 0 padded at the end.
-// pad by 1 at the end length=n+1 for when last=n-1    
-// @param sequence input sequence [ro]
-// @param event_buffer [w]
-// @param start_buffer [w]
-// @param event_order [ro]
-// @param start_order [ro]
-// @param do_event a flag
-// @param do_start a flag
-// [[Rcpp::export(.reverse_cumsums)]]
+// Compute reversed cumsums of a sequence in start and / or event order
+template <typename IndexType>
 void reverse_cumsums(const EIGEN_REF<Eigen::VectorXd> sequence,
                      EIGEN_REF<Eigen::VectorXd> event_buffer,
                      EIGEN_REF<Eigen::VectorXd> start_buffer,
-                     const EIGEN_REF<Eigen::VectorXi> event_order,
-                     const EIGEN_REF<Eigen::VectorXi> start_order,
+                     const EIGEN_REF<IndexVector<IndexType>> event_order,
+                     const EIGEN_REF<IndexVector<IndexType>> start_order,
 		     bool do_event = false,
 		     bool do_start = false)
 {
-  double sum = 0.0;
-  
-  int n = sequence.size(); // should be size_t
-  if (do_event) {
-    if (sequence.size() + 1 != event_buffer.size()) {
-      ERROR_MSG("reverse_cumsums: event_buffer size must be one more than input's.");
-    }
-    event_buffer(n) = sum;
-    for (int i = n - 1; i >= 0;  --i) {
-      sum = sum + sequence(event_order(i));
-      event_buffer(i) = sum;
-    }
-  }
-
-  if (do_start) {
-    if (sequence.size() + 1 != start_buffer.size()) {
-      ERROR_MSG("reverse_cumsums: event_buffer size must be one more than input's.");
-    }
-    sum = 0.0;
-    start_buffer(n) = sum;
-    for (int i = n - 1; i >= 0;  --i) {
-      sum = sum + sequence(start_order(i));
-      start_buffer(i) = sum;
-    }
-  }
+  coxdev::reverse_cumsums<IndexType>(sequence, event_buffer, start_buffer,
+				     event_order, start_order, do_event, do_start);
 }
 
-
-// reorder an event-ordered vector into native order,
-// uses forward_scratch_buffer to make a temporary copy
-// @param arg
-// @param event_order 
-// @param reorder_buffer 
-// [[Rcpp::export(.to_native_from_event)]]
+// reorder an event-ordered vector into native order
+template <typename IndexType>
 void to_native_from_event(EIGEN_REF<Eigen::VectorXd> arg,
-			  const EIGEN_REF<Eigen::VectorXi> event_order,
+			  const EIGEN_REF<IndexVector<IndexType>> event_order,
 			  EIGEN_REF<Eigen::VectorXd> reorder_buffer)
 {
-  reorder_buffer = arg;
-  for (int i = 0; i < event_order.size(); ++i) {
-    arg(event_order(i)) = reorder_buffer(i);
-  }
+  coxdev::to_native_from_event<IndexType>(arg, event_order, reorder_buffer);
 }
 
-// reorder an event-ordered vector into native order,
-// uses forward_scratch_buffer to make a temporary copy
-
-// [[Rcpp::export(.to_event_from_native)]]
-void to_event_from_native(const EIGEN_REF<Eigen::VectorXd> arg,
-                          const EIGEN_REF<Eigen::VectorXi> event_order,
+// reorder a native-ordered vector into event order
+template <typename IndexType, typename ValueType>
+void to_event_from_native(const InputVector<ValueType> arg,
+                          const EIGEN_REF<IndexVector<IndexType>> event_order,
                           EIGEN_REF<Eigen::VectorXd> reorder_buffer)
 {
-  for (int i = 0; i < event_order.size(); ++i) {
-    reorder_buffer(i) = arg(event_order(i));
-  }
+  coxdev::to_event_from_native<IndexType, ValueType>(arg, event_order, reorder_buffer);
 }
 
-// We need some sort of cumsums of scaling**i / risk_sums**j weighted by w_avg (within status==1)
-// this function fills in appropriate buffer
 // The arg = None is checked by a vector having size 0!
 // [[Rcpp::export(.forward_prework)]]
 void forward_prework(const EIGEN_REF<Eigen::VectorXi> status,
@@ -117,861 +138,1996 @@ void forward_prework(const EIGEN_REF<Eigen::VectorXi> status,
                      int i,
                      int j,
                      EIGEN_REF<Eigen::VectorXd> moment_buffer,
-		     const EIGEN_REF<Eigen::VectorXd> arg,		     
+		     const EIGEN_REF<Eigen::VectorXd> arg,
                      bool use_w_avg = true)
 {
-  // No checks on size compatibility yet.
-  if (use_w_avg) {
-    moment_buffer = status.cast<double>().array() * w_avg.array() * scaling.array().pow(i) / risk_sums.array().pow(j);
-  } else {
-    moment_buffer = status.cast<double>().array() * scaling.array().pow(i) / risk_sums.array().pow(j);    
-  }
-  if (arg.size() > 0) {
-    moment_buffer = moment_buffer.array() * arg.array();
-  }
+  coxdev::forward_prework(status, w_avg, scaling, risk_sums, i, j, moment_buffer, arg, use_w_avg);
 }
 
-// [[Rcpp::export(.compute_sat_loglik)]]
-double compute_sat_loglik(const EIGEN_REF<Eigen::VectorXi> first,
-			  const EIGEN_REF<Eigen::VectorXi> last,
-			  const EIGEN_REF<Eigen::VectorXd> weight, // in natural order!!!
-			  const EIGEN_REF<Eigen::VectorXi> event_order,
+template <typename IndexType, typename ValueType>
+double compute_sat_loglik(const EIGEN_REF<IndexVector<IndexType>> first,
+			  const EIGEN_REF<IndexVector<IndexType>> last,
+			  const InputVector<ValueType> weight, // in natural order!!!
+			  const EIGEN_REF<IndexVector<IndexType>> event_order,
 			  const EIGEN_REF<Eigen::VectorXi> status,
 			  EIGEN_REF<Eigen::VectorXd> W_status)
 {
-  
-  Eigen::VectorXd weight_event_order_times_status(event_order.size());
-  for (int i = 0; i < event_order.size(); ++i) {
-    weight_event_order_times_status(i) = weight(event_order(i)) * status(i);
-  }
-  forward_cumsum(MAKE_MAP_Xd(weight_event_order_times_status), W_status);
+  return coxdev::compute_sat_loglik<IndexType, ValueType>(first, last, weight, event_order, status, W_status);
+}
 
-  Eigen::VectorXd sums(last.size());
-  for (int i = 0; i < last.size(); ++i) {
-    sums(i) = W_status(last(i) + 1) - W_status(first(i));
+// Map element OFFSET of a buffer list. Only done while building a
+// CoxWorkspace, i.e. while the interpreter lock is still held. The map
+// points into the list's own storage, so a buffer that would need
+// converting (and so a temporary outliving the call) is refused.
+inline Eigen::Map<Eigen::VectorXd> buffer_list_map(BUFFER_LIST buffers, int offset)
+{
+  if (coxdev::stats_enabled()) {
+    coxdev::phase_counters().buffer_remaps.fetch_add(1, std::memory_order_relaxed);
   }
-  double loglik_sat = 0.0;
-  int prev_first = -1;
-
-  for (int i = 0; i < first.size(); ++i) {
-    int f = first(i); double s = sums(i);
-    if (s > 0 && f != prev_first) {
-      loglik_sat -= s * log(s);
-    }
-    prev_first = f;
+#ifdef PY_INTERFACE
+  typedef py::array_t<double, py::array::c_style> Buffer;
+  py::object item = buffers[offset];
+  if (!py::isinstance<Buffer>(item)) {
+    ERROR_MSG("scratch buffers must be contiguous float64 arrays");
   }
-  return(loglik_sat);
+  Buffer buffer = py::reinterpret_borrow<Buffer>(item);
+  return Eigen::Map<Eigen::VectorXd>(buffer.mutable_data(), buffer.size());
+#endif
+#ifdef R_INTERFACE
+  SEXP buffer = buffers[offset];
+  if (TYPEOF(buffer) != REALSXP) {
+    ERROR_MSG("scratch buffers must be double vectors");
+  }
+  return Eigen::Map<Eigen::VectorXd>(REAL(buffer), XLENGTH(buffer));
+#endif
 }
 
+// Buffer list version of sum_over_events: C_arg = forward_cumsum_buffers[0],
+// C_arg_scale = forward_cumsum_buffers[1]
+template <typename IndexType>
+void sum_over_events_buffers(const EIGEN_REF<IndexVector<IndexType>> event_order,
+			     const EIGEN_REF<IndexVector<IndexType>> start_order,
+			     const EIGEN_REF<IndexVector<IndexType>> first,
+			     const EIGEN_REF<IndexVector<IndexType>> last,
+			     const EIGEN_REF<IndexVector<IndexType>> start_map,
+			     const EIGEN_REF<Eigen::VectorXd> scaling,
+			     const EIGEN_REF<Eigen::VectorXi> status,
+			     bool efron,
+			     BUFFER_LIST forward_cumsum_buffers, // List of numpy arrays (1-d)
+			     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			     EIGEN_REF<Eigen::VectorXd> value_buffer)
+{
+  Eigen::Map<Eigen::VectorXd> C_arg = buffer_list_map(forward_cumsum_buffers, 0);
+  Eigen::Map<Eigen::VectorXd> C_arg_scale = buffer_list_map(forward_cumsum_buffers, 1);
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
+#endif
+  coxdev::sum_over_events<IndexType>(event_order, start_order, first, last, start_map, scaling, status, efron,
+				     C_arg, C_arg_scale, forward_scratch_buffer, value_buffer);
+}
 
-// compute sum_i (d_i Z_i ((1_{t_k>=t_i} - 1_{s_k>=t_i}) - sigma_i (1_{i <= last(k)} - 1_{i <= first(k)-1})
-// Note how MatrixXd storage mode can affect efficiency in Python versus R for example.
-// [[Rcpp::export(.sum_over_events)]]
-void sum_over_events(const EIGEN_REF<Eigen::VectorXi> event_order,
-                     const EIGEN_REF<Eigen::VectorXi> start_order,
-                     const EIGEN_REF<Eigen::VectorXi> first,
-                     const EIGEN_REF<Eigen::VectorXi> last,
-                     const EIGEN_REF<Eigen::VectorXi> start_map,
-                     const EIGEN_REF<Eigen::VectorXd> scaling,
-                     const EIGEN_REF<Eigen::VectorXi> status,
-                     bool efron,
-                     BUFFER_LIST forward_cumsum_buffers, // List of numpy arrays (1-d)
-		     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
-                     EIGEN_REF<Eigen::VectorXd> value_buffer)
+// Buffer list version of sum_over_risk_set: the sum goes to risk_sum_buffers[risk_sum_buffers_offset],
+// the cumsums to reverse_cumsum_buffers[reverse_cumsum_buffers_offset + 0:2]
+template <typename IndexType>
+void sum_over_risk_set_buffers(const EIGEN_REF<Eigen::VectorXd> arg,
+			       const EIGEN_REF<IndexVector<IndexType>> event_order,
+			       const EIGEN_REF<IndexVector<IndexType>> start_order,
+			       const EIGEN_REF<IndexVector<IndexType>> first,
+			       const EIGEN_REF<IndexVector<IndexType>> last,
+			       const EIGEN_REF<IndexVector<IndexType>> event_map,
+			       const EIGEN_REF<Eigen::VectorXd> scaling,
+			       bool efron,
+			       BUFFER_LIST risk_sum_buffers,
+			       int risk_sum_buffers_offset,
+			       BUFFER_LIST reverse_cumsum_buffers, // List of 1-d numpy arrays
+			       int reverse_cumsum_buffers_offset) // starting index into buffer
 {
+  Eigen::Map<Eigen::VectorXd> risk_sum_buffer = buffer_list_map(risk_sum_buffers, risk_sum_buffers_offset);
+  Eigen::Map<Eigen::VectorXd> event_cumsum = buffer_list_map(reverse_cumsum_buffers, reverse_cumsum_buffers_offset);
+  Eigen::Map<Eigen::VectorXd> start_cumsum = buffer_list_map(reverse_cumsum_buffers, reverse_cumsum_buffers_offset + 1);
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
+#endif
+  coxdev::sum_over_risk_set<IndexType>(arg, event_order, start_order, first, last, event_map, scaling, efron,
+				       risk_sum_buffer, event_cumsum, start_cumsum);
+}
 
-  bool have_start_times = start_map.size() >  0;
+// Buffer list version of cox_dev: the arguments are gathered into a CoxDesign
+// and a CoxWorkspace, after which the python interpreter lock is released.
+// eta and sample_weight are read in place whatever their floating type or stride.
+template <typename IndexType, typename ValueType>
+double cox_dev_buffers(const InputVector<ValueType> eta, //eta is in native order  -- assumes centered (or otherwise normalized for numeric stability)
+		       const InputVector<ValueType> sample_weight, //sample_weight is in native order
+		       EIGEN_REF<Eigen::VectorXd> exp_w,
+		       const EIGEN_REF<IndexVector<IndexType>> event_order,
+		       const EIGEN_REF<IndexVector<IndexType>> start_order,
+		       const EIGEN_REF<Eigen::VectorXi> status,        //everything below in event order
+		       const EIGEN_REF<IndexVector<IndexType>> first,
+		       const EIGEN_REF<IndexVector<IndexType>> last,
+		       const EIGEN_REF<Eigen::VectorXd> scaling,
+		       const EIGEN_REF<IndexVector<IndexType>> event_map,
+		       const EIGEN_REF<IndexVector<IndexType>> start_map,
+		       double loglik_sat,
+		       EIGEN_REF<Eigen::VectorXd> T_1_term,
+		       EIGEN_REF<Eigen::VectorXd> T_2_term,
+		       EIGEN_REF<Eigen::VectorXd> grad_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+		       EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+		       BUFFER_LIST event_reorder_buffers,
+		       BUFFER_LIST risk_sum_buffers,
+		       BUFFER_LIST forward_cumsum_buffers,
+		       EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		       BUFFER_LIST reverse_cumsum_buffers,
+		       bool have_start_times = true,
+		       bool efron = false)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), MAKE_MAP_Xd(T_1_term), MAKE_MAP_Xd(T_2_term),
+      MAKE_MAP_Xd(grad_buffer), MAKE_MAP_Xd(diag_hessian_buffer), MAKE_MAP_Xd(diag_part_buffer),
+      MAKE_MAP_Xd(w_avg_buffer), MAKE_MAP_Xd(forward_scratch_buffer),
+      Eigen::Map<Eigen::VectorXd>(nullptr, 0), // hess_matvec is not used by cox_dev
+      {buffer_list_map(event_reorder_buffers, 0),
+       buffer_list_map(event_reorder_buffers, 1),
+       buffer_list_map(event_reorder_buffers, 2)},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       buffer_list_map(forward_cumsum_buffers, 3),
+       buffer_list_map(forward_cumsum_buffers, 4)},
+      {buffer_list_map(reverse_cumsum_buffers, 0),
+       buffer_list_map(reverse_cumsum_buffers, 1),
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
 
-  // Map first element of list into Eigen vector.
-  // C_arg = forward_cumsum_buffers[0]!
-  
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 0, C_arg, tmp1)	
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp1 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[0]);
-  Eigen::Map<Eigen::VectorXd> C_arg(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp1));
-#endif    
-
-  forward_cumsum(forward_scratch_buffer, C_arg); //length=n+1
-
-  if (have_start_times) {
-    for (int i = 0; i < last.size(); ++i) {
-      value_buffer(i) = C_arg(last(i) + 1) - C_arg(start_map(i));
-    }
-  } else {
-    for (int i = 0; i < last.size(); ++i) {
-      value_buffer(i) = C_arg(last(i) + 1);
-    }
-  }
-  if (efron) {
-    forward_scratch_buffer = forward_scratch_buffer.array() * scaling.array();
-    // Map second element of list into Eigen vector.
-    // C_arg_scale = forward_cumsum_buffers[1]!
-#ifdef PY_INTERFACE 
-    MAP_BUFFER_LIST(forward_cumsum_buffers, 1, C_arg_scale, tmp2)
+  return coxdev::cox_dev<IndexType, ValueType>(design, ws, eta, sample_weight, loglik_sat);
+}
+
+// This is a bit different in R and python since in python, the LinearOperator class takes
+// care of handing whether the arg is a matrix or a column vector automatically by calling
+// this routine on each column. No such luck in R, so it seems easiest to return a vector
+// as a result. We have to "apply" this routine to columns if a matrix is passed.
+// We can make this uniform later by modifying the python code to directly use this returned
+// vector we create for R. Then the code will be the same for both R and python.
+// arg, eta and sample_weight share the caller's floating type (see cox_dev).
+template <typename IndexType, typename ValueType>
+HESSIAN_MATVEC_TYPE hessian_matvec_buffers(const InputVector<ValueType> arg, // # arg is in native order
+					   const InputVector<ValueType> eta, // # eta is in native order
+					   const InputVector<ValueType> sample_weight, //# sample_weight is in native order
+					   EIGEN_REF<Eigen::VectorXd> risk_sums,
+					   EIGEN_REF<Eigen::VectorXd> diag_part,
+					   EIGEN_REF<Eigen::VectorXd> w_avg,
+					   EIGEN_REF<Eigen::VectorXd> exp_w,
+					   EIGEN_REF<Eigen::VectorXd> event_cumsum,
+					   EIGEN_REF<Eigen::VectorXd> start_cumsum,
+					   const EIGEN_REF<IndexVector<IndexType>> event_order,
+					   const EIGEN_REF<IndexVector<IndexType>> start_order,
+					   const EIGEN_REF<Eigen::VectorXi> status, // # everything below in event order
+					   const EIGEN_REF<IndexVector<IndexType>> first,
+					   const EIGEN_REF<IndexVector<IndexType>> last,
+					   const EIGEN_REF<Eigen::VectorXd> scaling,
+					   const EIGEN_REF<IndexVector<IndexType>> event_map,
+					   const EIGEN_REF<IndexVector<IndexType>> start_map,
+					   BUFFER_LIST risk_sum_buffers,
+					   BUFFER_LIST forward_cumsum_buffers,
+					   EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+					   BUFFER_LIST reverse_cumsum_buffers,
+					   EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+					   bool have_start_times = true,
+					   bool efron = false)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  // risk_sums, event_cumsum and start_cumsum are risk_sum_buffers[0] and
+  // reverse_cumsum_buffers[0:2] as left by cox_dev
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by hessian_matvec
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), unused, unused, unused, unused,
+      MAKE_MAP_Xd(diag_part), MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer),
+      MAKE_MAP_Xd(hess_matvec_buffer),
+      {unused, unused, unused},
+      {MAKE_MAP_Xd(risk_sums),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       unused, unused, unused},
+      {MAKE_MAP_Xd(event_cumsum),
+       MAKE_MAP_Xd(start_cumsum),
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
+
+  {
+#ifdef PY_INTERFACE
+    py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-    Rcpp::NumericVector tmp2 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[1]);
-    Eigen::Map<Eigen::VectorXd> C_arg_scale(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp2));
-#endif    
-    
-    forward_cumsum(forward_scratch_buffer, C_arg_scale); // length=n+1
-    for (int i = 0; i < last.size(); ++i) {
-      value_buffer(i) -= (C_arg_scale(last(i) + 1) - C_arg_scale(first(i)));
-    }
+    coxdev::hessian_matvec<IndexType, ValueType>(design, ws, arg);
   }
+#ifdef R_INTERFACE
+  return(Rcpp::wrap(hess_matvec_buffer));
+#endif
 }
 
-// arg is in native order
-// returns a sum in event order
-// [[Rcpp::export(.sum_over_risk_set)]]
-void sum_over_risk_set(const EIGEN_REF<Eigen::VectorXd> arg,
-                       const EIGEN_REF<Eigen::VectorXi> event_order,
-                       const EIGEN_REF<Eigen::VectorXi> start_order,
-                       const EIGEN_REF<Eigen::VectorXi> first,
-                       const EIGEN_REF<Eigen::VectorXi> last,
-                       const EIGEN_REF<Eigen::VectorXi> event_map,
-                       const EIGEN_REF<Eigen::VectorXd> scaling,
-                       bool efron,
-                       BUFFER_LIST risk_sum_buffers,
-		       int risk_sum_buffers_offset,
-                       BUFFER_LIST reverse_cumsum_buffers, // List of 1-d numpy arrays
-		       int reverse_cumsum_buffers_offset) // starting index into buffer
-{
-
-  bool have_start_times = event_map.size() > 0;
-  
-  // Map first element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(reverse_cumsum_buffers, reverse_cumsum_buffers_offset, event_cumsum, tmp1)
+// Weighted concordance of eta with the preprocessed data (event in event
+// order), as the pair weights (concordant, discordant, tied_risk); Uno's
+// inverse probability of censoring weights when ipcw. See coxdev_concordance.h.
+template <typename IndexType, typename ValueType>
+Eigen::VectorXd concordance_counts(const InputVector<ValueType> eta,
+				   const InputVector<ValueType> sample_weight,
+				   const EIGEN_REF<IndexVector<IndexType>> event_order,
+				   const EIGEN_REF<IndexVector<IndexType>> start_order,
+				   const EIGEN_REF<Eigen::VectorXi> status,
+				   const EIGEN_REF<IndexVector<IndexType>> first,
+				   const EIGEN_REF<IndexVector<IndexType>> last,
+				   const EIGEN_REF<IndexVector<IndexType>> event_map,
+				   const EIGEN_REF<IndexVector<IndexType>> start_map,
+				   const EIGEN_REF<Eigen::VectorXd> event,
+				   bool have_start_times,
+				   bool ipcw,
+				   double tau)
+{
+  Eigen::Map<const Eigen::VectorXd> no_scaling(nullptr, 0); // ties are not corrected for
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, no_scaling, have_start_times, false};
+  const coxdev::Concordance c = coxdev::concordance<IndexType, ValueType>(design, event, eta, sample_weight,
+									ipcw, tau);
+  Eigen::VectorXd counts(3);
+  counts << c.concordant, c.discordant, c.tied_risk;
+  return counts;
+}
+
+// Baseline cumulative hazard on the unique event times from the risk sums and
+// w_avg cox_dev left (risk_sum_buffers[0] and w_avg_buffer), for eta centered
+// by center; time and cumhaz have length n and the number of unique event
+// times written is returned. Start times are already accounted for in the
+// risk sums. See coxdev_survival.h.
+template <typename IndexType>
+Eigen::Index baseline_hazard_buffers(const EIGEN_REF<IndexVector<IndexType>> event_order,
+				     const EIGEN_REF<Eigen::VectorXi> status,
+				     const EIGEN_REF<IndexVector<IndexType>> first,
+				     const EIGEN_REF<IndexVector<IndexType>> last,
+				     const EIGEN_REF<Eigen::VectorXd> event,
+				     const EIGEN_REF<Eigen::VectorXd> risk_sums,
+				     const EIGEN_REF<Eigen::VectorXd> w_avg,
+				     double center,
+				     EIGEN_REF<Eigen::VectorXd> time,
+				     EIGEN_REF<Eigen::VectorXd> cumhaz)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  Eigen::Map<const Eigen::VectorXd> no_scaling(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, first, last, no_map, no_map,
+      status, no_scaling, false, false};
+  return coxdev::baseline_hazard<IndexType>(design, event, risk_sums, w_avg, center, time, cumhaz);
+}
+
+// Martingale residuals, and deviance residuals unless deviance has size 0, from
+// the T_1_term and centered eta in event order (event_reorder_buffers[0]) left
+// by cox_dev. See coxdev_residuals.h.
+template <typename IndexType>
+void martingale_residuals_buffers(const EIGEN_REF<IndexVector<IndexType>> event_order,
+				  const EIGEN_REF<Eigen::VectorXi> status,
+				  EIGEN_REF<Eigen::VectorXd> T_1_term,
+				  EIGEN_REF<Eigen::VectorXd> eta_event,
+				  EIGEN_REF<Eigen::VectorXd> martingale,
+				  EIGEN_REF<Eigen::VectorXd> deviance)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  Eigen::Map<const Eigen::VectorXd> no_scaling(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, no_map, no_map, no_map, no_map,
+      status, no_scaling, false, false};
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // only T_1_term and eta are read
+  coxdev::CoxWorkspace ws{unused, MAKE_MAP_Xd(T_1_term), unused, unused, unused, unused,
+      unused, unused, unused,
+      {MAKE_MAP_Xd(eta_event), unused, unused},
+      {unused, unused},
+      {unused, unused, unused, unused, unused},
+      {unused, unused, unused, unused}};
+  coxdev::martingale_residuals<IndexType>(design, ws, martingale, deviance);
+}
+
+// Score and Schoenfeld residuals of the columns of X into score and schoenfeld
+// (either may be 0 x 0), from the state cox_dev left; overwrites the
+// hessian_matvec scratch. See coxdev_residuals.h.
+template <typename IndexType, typename ValueType>
+void score_residuals_buffers(const coxdev::InputMatrix<ValueType> X,
+			     EIGEN_REF<Eigen::VectorXd> exp_w,
+			     const EIGEN_REF<IndexVector<IndexType>> event_order,
+			     const EIGEN_REF<IndexVector<IndexType>> start_order,
+			     const EIGEN_REF<Eigen::VectorXi> status,
+			     const EIGEN_REF<IndexVector<IndexType>> first,
+			     const EIGEN_REF<IndexVector<IndexType>> last,
+			     const EIGEN_REF<Eigen::VectorXd> scaling,
+			     const EIGEN_REF<IndexVector<IndexType>> event_map,
+			     const EIGEN_REF<IndexVector<IndexType>> start_map,
+			     EIGEN_REF<Eigen::VectorXd> T_1_term,
+			     EIGEN_REF<Eigen::VectorXd> w_avg,
+			     BUFFER_LIST event_reorder_buffers,
+			     BUFFER_LIST risk_sum_buffers,
+			     BUFFER_LIST forward_cumsum_buffers,
+			     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			     BUFFER_LIST reverse_cumsum_buffers,
+			     EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			     coxdev::MatrixRef score,
+			     coxdev::MatrixRef schoenfeld,
+			     bool have_start_times,
+			     bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by score_residuals
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), MAKE_MAP_Xd(T_1_term), unused, unused, unused, unused,
+      MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer), MAKE_MAP_Xd(hess_matvec_buffer),
+      {buffer_list_map(event_reorder_buffers, 0), unused, unused},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       unused, unused},
+      {unused, unused,
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
+
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp1 = Rcpp::as<Rcpp::NumericVector>(reverse_cumsum_buffers[reverse_cumsum_buffers_offset]);
-  Eigen::Map<Eigen::VectorXd> event_cumsum(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp1));
-#endif    
+  coxdev::score_residuals<IndexType, ValueType>(design, ws, X, score, schoenfeld);
+}
+
+// Per cluster sums of the weighted score residuals of the columns begin, ...,
+// end - 1 of X into U and the same columns of the information X' H X into
+// information (unless 0 x 0), from the state cox_dev left; cluster holds codes
+// 0, ..., U.rows() - 1. Overwrites the hessian_matvec scratch. See
+// coxdev_robust.h.
+template <typename IndexType, typename ValueType>
+void cluster_scores_buffers(const coxdev::InputMatrix<ValueType> X,
+			    const EIGEN_REF<IndexVector<IndexType>> cluster,
+			    Eigen::Index begin,
+			    Eigen::Index end,
+			    EIGEN_REF<Eigen::VectorXd> exp_w,
+			    const EIGEN_REF<IndexVector<IndexType>> event_order,
+			    const EIGEN_REF<IndexVector<IndexType>> start_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    const EIGEN_REF<IndexVector<IndexType>> first,
+			    const EIGEN_REF<IndexVector<IndexType>> last,
+			    const EIGEN_REF<Eigen::VectorXd> scaling,
+			    const EIGEN_REF<IndexVector<IndexType>> event_map,
+			    const EIGEN_REF<IndexVector<IndexType>> start_map,
+			    EIGEN_REF<Eigen::VectorXd> T_1_term,
+			    EIGEN_REF<Eigen::VectorXd> diag_part,
+			    EIGEN_REF<Eigen::VectorXd> w_avg,
+			    BUFFER_LIST event_reorder_buffers,
+			    BUFFER_LIST risk_sum_buffers,
+			    BUFFER_LIST forward_cumsum_buffers,
+			    EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			    BUFFER_LIST reverse_cumsum_buffers,
+			    EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			    coxdev::MatrixRef U,
+			    coxdev::MatrixRef information,
+			    bool have_start_times,
+			    bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by cluster_scores
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), MAKE_MAP_Xd(T_1_term), unused, unused, unused,
+      MAKE_MAP_Xd(diag_part), MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer),
+      MAKE_MAP_Xd(hess_matvec_buffer),
+      {buffer_list_map(event_reorder_buffers, 0), buffer_list_map(event_reorder_buffers, 1), unused},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       unused, unused},
+      {unused, unused,
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
 
-  // Map second element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(reverse_cumsum_buffers, reverse_cumsum_buffers_offset + 1, start_cumsum, tmp2)	
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp2 = Rcpp::as<Rcpp::NumericVector>(reverse_cumsum_buffers[reverse_cumsum_buffers_offset + 1]);
-  Eigen::Map<Eigen::VectorXd> start_cumsum(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp2));
-#endif    
-  
+  coxdev::cluster_scores<IndexType, ValueType, IndexType>(design, ws, X, cluster, begin, end, U, information);
+}
 
-  reverse_cumsums(arg,
-		  event_cumsum,
-		  start_cumsum,
-		  event_order,
-		  start_order,
-		  true, // do_event 
-		  have_start_times); // do_start
-    
-  // Map first element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(risk_sum_buffers, risk_sum_buffers_offset, risk_sum_buffer, tmp3)  
+// Entries rows x columns[begin:end] of the information matrix into the same
+// columns of out, from the state cox_dev left; rows and columns in native
+// order. Overwrites the hessian_matvec scratch. See coxdev_information.h.
+template <typename IndexType>
+void information_matrix_buffers(const EIGEN_REF<IndexVector<IndexType>> rows,
+				const EIGEN_REF<IndexVector<IndexType>> columns,
+				Eigen::Index begin,
+				Eigen::Index end,
+				EIGEN_REF<Eigen::VectorXd> exp_w,
+				const EIGEN_REF<IndexVector<IndexType>> event_order,
+				const EIGEN_REF<IndexVector<IndexType>> start_order,
+				const EIGEN_REF<Eigen::VectorXi> status,
+				const EIGEN_REF<IndexVector<IndexType>> first,
+				const EIGEN_REF<IndexVector<IndexType>> last,
+				const EIGEN_REF<Eigen::VectorXd> scaling,
+				const EIGEN_REF<IndexVector<IndexType>> event_map,
+				const EIGEN_REF<IndexVector<IndexType>> start_map,
+				EIGEN_REF<Eigen::VectorXd> diag_part,
+				EIGEN_REF<Eigen::VectorXd> w_avg,
+				BUFFER_LIST risk_sum_buffers,
+				BUFFER_LIST forward_cumsum_buffers,
+				EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+				coxdev::MatrixRef out,
+				bool have_start_times,
+				bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by information_matrix
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), unused, unused, unused, unused,
+      MAKE_MAP_Xd(diag_part), MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer), unused,
+      {unused, unused, unused},
+      {buffer_list_map(risk_sum_buffers, 0), unused},
+      {unused,
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       buffer_list_map(forward_cumsum_buffers, 3),
+       unused},
+      {unused, unused, unused, unused}};
+
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp3 = Rcpp::as<Rcpp::NumericVector>(risk_sum_buffers[risk_sum_buffers_offset]);
-  Eigen::Map<Eigen::VectorXd> risk_sum_buffer(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp3));
-#endif    
-    
-  if (have_start_times) {
-    for (int i = 0; i < first.size(); ++i) {
-      risk_sum_buffer(i) = event_cumsum(first(i)) - start_cumsum(event_map(i));
-    }
-  } else {
-    for (int i = 0; i < first.size(); ++i) {
-      risk_sum_buffer(i) = event_cumsum(first(i));
-    }
-  }
-        
-  // compute the Efron correction, adjusting risk_sum if necessary
-    
-  if (efron) {
-    // for K events,
-    // this results in risk sums event_cumsum[first] to
-    // event_cumsum[first] -
-    // (K-1)/K [event_cumsum[last+1] - event_cumsum[first]
-    // or event_cumsum[last+1] + 1/K [event_cumsum[first] - event_cumsum[last+1]]
-    // to event[cumsum_first]
-    for (int i = 0; i < first.size(); ++i) {
-      risk_sum_buffer(i) = risk_sum_buffer(i) - ( event_cumsum(first(i)) - event_cumsum(last(i) + 1) ) * scaling(i);
-    }
-  }
+  coxdev::information_matrix<IndexType>(design, ws, rows, columns, begin, end, out);
 }
 
-// [[Rcpp::export(.cox_dev)]]
-double cox_dev(const EIGEN_REF<Eigen::VectorXd> eta, //eta is in native order  -- assumes centered (or otherwise normalized for numeric stability)
-	       const EIGEN_REF<Eigen::VectorXd> sample_weight, //sample_weight is in native order
-	       const EIGEN_REF<Eigen::VectorXd> exp_w,
-	       const EIGEN_REF<Eigen::VectorXi> event_order,   
-	       const EIGEN_REF<Eigen::VectorXi> start_order,
-	       const EIGEN_REF<Eigen::VectorXi> status,        //everything below in event order
-	       const EIGEN_REF<Eigen::VectorXi> first,
-	       const EIGEN_REF<Eigen::VectorXi> last,
-	       const EIGEN_REF<Eigen::VectorXd> scaling,
-	       const EIGEN_REF<Eigen::VectorXi> event_map,
-	       const EIGEN_REF<Eigen::VectorXi> start_map,
-	       double loglik_sat,
-	       EIGEN_REF<Eigen::VectorXd> T_1_term,
-	       EIGEN_REF<Eigen::VectorXd> T_2_term,
-	       EIGEN_REF<Eigen::VectorXd> grad_buffer,
-	       EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
-	       EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
-	       EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
-	       BUFFER_LIST event_reorder_buffers,
-	       BUFFER_LIST risk_sum_buffers,
-	       BUFFER_LIST forward_cumsum_buffers,
-	       EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
-	       BUFFER_LIST reverse_cumsum_buffers,
-	       bool have_start_times = true,
-	       bool efron = false)
-{
-  // int n = eta.size();
-    
-  // eta_event: map first element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(event_reorder_buffers, 0, eta_event, tmp1)	
+// Deviances of the bootstrap replicates begin, ..., end - 1 over the shared
+// design, their weights drawn inside the kernel from (seed, replicate, row),
+// and X' gradient unless X_gradient is 0 x 0. eta is centered as for cox_dev.
+// See coxdev_bootstrap.h.
+template <typename IndexType, typename ValueType>
+void bootstrap_buffers(const InputVector<ValueType> eta,
+		       const InputVector<ValueType> sample_weight,
+		       const coxdev::InputMatrix<ValueType> X,
+		       bool bayesian,
+		       std::uint64_t seed,
+		       Eigen::Index begin,
+		       Eigen::Index end,
+		       EIGEN_REF<Eigen::VectorXd> exp_w,
+		       const EIGEN_REF<IndexVector<IndexType>> event_order,
+		       const EIGEN_REF<IndexVector<IndexType>> start_order,
+		       const EIGEN_REF<Eigen::VectorXi> status,
+		       const EIGEN_REF<IndexVector<IndexType>> first,
+		       const EIGEN_REF<IndexVector<IndexType>> last,
+		       const EIGEN_REF<Eigen::VectorXd> scaling,
+		       const EIGEN_REF<IndexVector<IndexType>> event_map,
+		       const EIGEN_REF<IndexVector<IndexType>> start_map,
+		       EIGEN_REF<Eigen::VectorXd> T_1_term,
+		       EIGEN_REF<Eigen::VectorXd> T_2_term,
+		       EIGEN_REF<Eigen::VectorXd> grad_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+		       EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+		       BUFFER_LIST event_reorder_buffers,
+		       BUFFER_LIST risk_sum_buffers,
+		       BUFFER_LIST forward_cumsum_buffers,
+		       EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		       BUFFER_LIST reverse_cumsum_buffers,
+		       coxdev::VectorRef deviance,
+		       coxdev::MatrixRef X_gradient,
+		       bool have_start_times,
+		       bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), MAKE_MAP_Xd(T_1_term), MAKE_MAP_Xd(T_2_term),
+      MAKE_MAP_Xd(grad_buffer), MAKE_MAP_Xd(diag_hessian_buffer), MAKE_MAP_Xd(diag_part_buffer),
+      MAKE_MAP_Xd(w_avg_buffer), MAKE_MAP_Xd(forward_scratch_buffer),
+      Eigen::Map<Eigen::VectorXd>(nullptr, 0), // hess_matvec is not used by cox_dev
+      {buffer_list_map(event_reorder_buffers, 0),
+       buffer_list_map(event_reorder_buffers, 1),
+       buffer_list_map(event_reorder_buffers, 2)},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       buffer_list_map(forward_cumsum_buffers, 3),
+       buffer_list_map(forward_cumsum_buffers, 4)},
+      {buffer_list_map(reverse_cumsum_buffers, 0),
+       buffer_list_map(reverse_cumsum_buffers, 1),
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
+
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
+  coxdev::bootstrap_deviances<IndexType, ValueType>(design, ws, eta, sample_weight, X, bayesian, seed,
+						    begin, end, deviance, X_gradient);
+}
+
 #ifdef R_INTERFACE
-  Rcpp::NumericVector tmp1 = Rcpp::as<Rcpp::NumericVector>(event_reorder_buffers[0]);
-  Eigen::Map<Eigen::VectorXd> eta_event(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp1));
-#endif    
-  to_event_from_native(eta, event_order, eta_event);
-
-  // w_event: map second element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(event_reorder_buffers, 1, w_event, tmp2)	  
+// 32 bit indices go back to R as integer vectors, wider ones as doubles
+// carrying their int64 copy (see RIndexCache in coxdev.h), so the design
+// is converted once rather than on every call
+inline SEXP r_index_cached(SEXP wrapped, const int64_t *indices, Eigen::Index size)
+{
+  Rcpp::RObject x(wrapped);
+  Rcpp::XPtr<RIndexCache> cache(new RIndexCache{REAL(x), Eigen::Map<const VectorXi64>(indices, size)}, true);
+  x.attr("coxdev_int64") = cache;
+  return x;
+}
+inline SEXP r_index_wrap(const IndexVector<int32_t> & x) { return Rcpp::wrap(x); }
+inline SEXP r_index_wrap(const IndexVector<int64_t> & x)
+{
+  return r_index_cached(Rcpp::wrap(Eigen::VectorXd(x.cast<double>())), x.data(), x.size());
+}
+inline SEXP r_index_wrap(const coxdev::IndexMatrix<int32_t> & x) { return Rcpp::wrap(x); }
+inline SEXP r_index_wrap(const coxdev::IndexMatrix<int64_t> & x)
+{
+  return r_index_cached(Rcpp::wrap(Eigen::MatrixXd(x.cast<double>())), x.data(), x.size());
+}
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp2 = Rcpp::as<Rcpp::NumericVector>(event_reorder_buffers[1]);
-  Eigen::Map<Eigen::VectorXd> w_event(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp2));  
-#endif    
-  to_event_from_native(sample_weight, event_order, w_event);
-
-  // exp_eta_w_event: map third element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(event_reorder_buffers, 2, exp_eta_w_event, tmp3)	
+
+// The preprocessed arrays as a python dict / R list, with the two orders.
+template <typename IndexType>
+PREPROCESS_TYPE preprocess(const InputVector<double> start,
+			   const InputVector<double> event,
+			   const EIGEN_REF<Eigen::VectorXi> status)
+{
+  coxdev::Preprocessed<IndexType> p = coxdev::preprocess<IndexType>(start, event, status);
+
+#ifdef PY_INTERFACE
+  py::dict preproc;
+  preproc["start"] = p.start;
+  preproc["event"] = p.event;
+  preproc["first"] = p.first;
+  preproc["last"] = p.last;
+  preproc["scaling"] = p.scaling;
+  preproc["start_map"] = p.start_map;
+  preproc["event_map"] = p.event_map;
+  preproc["status"] = p.status;
+  
+  return py::make_tuple(preproc, p.event_order, p.start_order);
 #endif
 #ifdef R_INTERFACE
-  Rcpp::NumericVector tmp3 = Rcpp::as<Rcpp::NumericVector>(event_reorder_buffers[2]);
-  Eigen::Map<Eigen::VectorXd> exp_eta_w_event(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp3));  
-#endif    
-  to_event_from_native(exp_w, event_order, exp_eta_w_event);
-
-  // risk_sum_buffer[0]: map first element of list into Eigen vector.
-  // We will name it risk_sums as that is what it is called in the ensuing code
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(risk_sum_buffers, 0, risk_sums, tmp4)
+  Rcpp::List preproc = Rcpp::List::create(
+					  Rcpp::_["start"] = Rcpp::wrap(p.start),
+					  Rcpp::_["event"] = Rcpp::wrap(p.event),
+					  Rcpp::_["first"] = r_index_wrap(p.first),
+					  Rcpp::_["last"] = r_index_wrap(p.last),
+					  Rcpp::_["scaling"] = Rcpp::wrap(p.scaling),
+					  Rcpp::_["start_map"] = r_index_wrap(p.start_map),
+					  Rcpp::_["event_map"] = r_index_wrap(p.event_map),
+					  Rcpp::_["status"] = Rcpp::wrap(p.status)
+					  );
+  return(Rcpp::List::create(
+			    Rcpp::_["preproc"] = preproc,
+			    Rcpp::_["event_order"] = r_index_wrap(p.event_order),
+			    Rcpp::_["start_order"] = r_index_wrap(p.start_order)));
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp4 = Rcpp::as<Rcpp::NumericVector>(risk_sum_buffers[0]);
-  Eigen::Map<Eigen::VectorXd> risk_sums(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp4));  
-#endif    
-
-  if (have_start_times) {
-    sum_over_risk_set(exp_w, // native order
-		      event_order,
-		      start_order,
-		      first,
-		      last,
-		      event_map,
-		      scaling,
-		      efron,
-		      risk_sum_buffers, 
-		      0, // 0 offset into risk_sum_buffer
-		      reverse_cumsum_buffers, // We send the whole list even if only the first two will be used!
-		      0); // we use zero offset
-  } else {
-    Eigen::VectorXi dummy;
-    sum_over_risk_set(exp_w, // native order
-		      event_order,
-		      start_order,
-		      first,
-		      last,
-		      MAKE_MAP_Xi(dummy),
-		      scaling,
-		      efron,
-		      risk_sum_buffers,
-		      0, // 0 offset into risk_sum_buffer
-		      reverse_cumsum_buffers, // We send the whole list even if only the first two will be used!
-		      0); // we use zero offset
+
+}
+
+// Picks the index width from the number of observations: int32 unless
+// the data are too large for it (or use_int64 asks for the wide path).
+// [[Rcpp::export(.preprocess)]]
+PREPROCESS_TYPE c_preprocess(const InputVector<double> start,
+			     const InputVector<double> event,
+			     const EIGEN_REF<Eigen::VectorXi> status,
+			     bool use_int64 = false)
+{
+  if (!use_int64 && use_int32_index(status.size())) {
+    return preprocess<int32_t>(start, event, status);
   }
+  return preprocess<int64_t>(start, event, status);
+}
 
-  // event_cumsum: map first element of list into Eigen vector.
-// #ifdef PY_INTERFACE 
-//   MAP_BUFFER_LIST(reverse_cumsum_buffers, 0, event_cumsum, tmp5)
-// #endif
-// #ifdef R_INTERFACE
-//   Rcpp::NumericVector tmp5 = Rcpp::as<Rcpp::NumericVector>(reverse_cumsum_buffers[0]);
-//   Eigen::Map<Eigen::VectorXd> event_cumsum(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp5));  
-// #endif    
-
-  // start_cumsum: map second element of list into Eigen vector.
-// #ifdef PY_INTERFACE 
-//   MAP_BUFFER_LIST(reverse_cumsum_buffers, 1, start_cumsum, tmp6)    
-// #endif
-// #ifdef R_INTERFACE
-//   Rcpp::NumericVector tmp6 = Rcpp::as<Rcpp::NumericVector>(reverse_cumsum_buffers[1]);
-//   Eigen::Map<Eigen::VectorXd> start_cumsum(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp6));  
-// #endif    
-
-  // forward_cumsum_buffers[0]: map first element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 0, forward_cumsum_buffers0, tmp7)
-#endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp7 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[0]);
-  Eigen::Map<Eigen::VectorXd> forward_cumsum_buffers0(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp7));  
-#endif    
+// Freeze the state score_screen reads, from the state cox_dev left, for null
+// model covariates Z (n x q, possibly q = 0). Overwrites the hessian_matvec
+// scratch. See coxdev_screen.h.
+template <typename IndexType, typename ValueType>
+void freeze_screening_buffers(const coxdev::InputMatrix<ValueType> Z,
+			      EIGEN_REF<Eigen::VectorXd> exp_w,
+			      const EIGEN_REF<IndexVector<IndexType>> event_order,
+			      const EIGEN_REF<IndexVector<IndexType>> start_order,
+			      const EIGEN_REF<Eigen::VectorXi> status,
+			      const EIGEN_REF<IndexVector<IndexType>> first,
+			      const EIGEN_REF<IndexVector<IndexType>> last,
+			      const EIGEN_REF<Eigen::VectorXd> scaling,
+			      const EIGEN_REF<IndexVector<IndexType>> event_map,
+			      const EIGEN_REF<IndexVector<IndexType>> start_map,
+			      EIGEN_REF<Eigen::VectorXd> grad,
+			      EIGEN_REF<Eigen::VectorXd> diag_part,
+			      EIGEN_REF<Eigen::VectorXd> w_avg,
+			      BUFFER_LIST risk_sum_buffers,
+			      BUFFER_LIST forward_cumsum_buffers,
+			      EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			      BUFFER_LIST reverse_cumsum_buffers,
+			      EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			      coxdev::VectorRef score_state,
+			      coxdev::VectorRef diag_part_state,
+			      coxdev::VectorRef exp_w_event,
+			      coxdev::VectorRef exp_w_start,
+			      coxdev::VectorRef gamma,
+			      coxdev::MatrixRef adjust,
+			      bool have_start_times,
+			      bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by freeze_screening
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), unused, unused, MAKE_MAP_Xd(grad), unused,
+      MAKE_MAP_Xd(diag_part), MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer),
+      MAKE_MAP_Xd(hess_matvec_buffer),
+      {unused, unused, unused},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       unused, unused, unused},
+      {unused, unused,
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
 
-  // forward_cumsum_buffers[1]: map second element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 1, forward_cumsum_buffers1, tmp8)
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp8 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[1]);
-  Eigen::Map<Eigen::VectorXd> forward_cumsum_buffers1(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp8));  
-#endif    
+  coxdev::freeze_screening<IndexType, ValueType>(design, ws, Z, score_state, diag_part_state,
+						 exp_w_event, exp_w_start, gamma, adjust);
+}
+
+// Saturated log likelihoods and deviances under administrative censoring at
+// each of the sorted horizons, and unless it is 0 x 0 their gradients into
+// the columns of gradient (n x horizons), from the state cox_dev left.
+// event holds the stop times in event order. Overwrites the forward cumsums
+// and forward_scratch_buffer. See coxdev_horizon.h.
+template <typename IndexType>
+void horizon_sweep_buffers(const EIGEN_REF<Eigen::VectorXd> event,
+			   const EIGEN_REF<Eigen::VectorXd> horizon,
+			   const EIGEN_REF<IndexVector<IndexType>> event_order,
+			   const EIGEN_REF<Eigen::VectorXi> status,
+			   const EIGEN_REF<IndexVector<IndexType>> first,
+			   const EIGEN_REF<IndexVector<IndexType>> last,
+			   const EIGEN_REF<Eigen::VectorXd> scaling,
+			   const EIGEN_REF<IndexVector<IndexType>> start_map,
+			   EIGEN_REF<Eigen::VectorXd> w_avg,
+			   BUFFER_LIST event_reorder_buffers,
+			   BUFFER_LIST risk_sum_buffers,
+			   BUFFER_LIST forward_cumsum_buffers,
+			   EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			   coxdev::VectorRef loglik_sat,
+			   coxdev::VectorRef deviance,
+			   coxdev::MatrixRef gradient,
+			   bool have_start_times,
+			   bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, first, last, no_map,
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by horizon_sweep
+  coxdev::CoxWorkspace ws{unused, unused, unused, unused, unused,
+      unused, MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer), unused,
+      {buffer_list_map(event_reorder_buffers, 0),
+       buffer_list_map(event_reorder_buffers, 1),
+       buffer_list_map(event_reorder_buffers, 2)},
+      {buffer_list_map(risk_sum_buffers, 0), unused},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       unused, unused},
+      {unused, unused, unused, unused}};
 
-  // forward_cumsum_buffers[0]: map third element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 2, forward_cumsum_buffers2, tmp9)
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp9 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[2]);
-  Eigen::Map<Eigen::VectorXd> forward_cumsum_buffers2(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp9));  
-#endif    
+  coxdev::horizon_sweep<IndexType>(design, ws, event, horizon, loglik_sat, deviance, gradient);
+}
 
-  // forward_cumsum_buffers[0]: map fourth element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 3, forward_cumsum_buffers3, tmp10)
+// Saturated log likelihoods and deviances of the landmark copies begin, ...,
+// end - 1 into the same entries of loglik_sat and deviance, with eta n x L
+// (a centered column per copy) and their gradients into the same columns
+// of gradient unless it is 0 x 0. event is in event order and start in
+// start order. Threads may evaluate disjoint ranges. See coxdev_landmark.h.
+template <typename IndexType, typename ValueType>
+void landmark_deviances_buffers(const coxdev::InputMatrix<ValueType> eta,
+				const InputVector<ValueType> sample_weight,
+				const EIGEN_REF<Eigen::VectorXd> landmark,
+				const EIGEN_REF<Eigen::VectorXd> horizon,
+				Eigen::Index begin,
+				Eigen::Index end,
+				const EIGEN_REF<Eigen::VectorXd> event,
+				const EIGEN_REF<Eigen::VectorXd> start,
+				const EIGEN_REF<IndexVector<IndexType>> event_order,
+				const EIGEN_REF<IndexVector<IndexType>> start_order,
+				const EIGEN_REF<Eigen::VectorXi> status,
+				const EIGEN_REF<IndexVector<IndexType>> first,
+				const EIGEN_REF<IndexVector<IndexType>> last,
+				const EIGEN_REF<Eigen::VectorXd> scaling,
+				coxdev::VectorRef loglik_sat,
+				coxdev::VectorRef deviance,
+				coxdev::MatrixRef gradient,
+				bool have_start_times,
+				bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last, no_map, no_map,
+      status, scaling, have_start_times, efron};
+  coxdev::landmark_deviances<IndexType, ValueType>(design, event, start, eta, sample_weight, landmark, horizon,
+						   begin, end, loglik_sat, deviance, gradient);
+}
+
+// Buffer list version of finegray_dev, laid out as cox_dev_buffers: the data
+// were preprocessed with the cause as status, competing holds the competing
+// event indicators and event the stop times, both in event order. Leaves
+// the censoring survival in T_2_term. See coxdev_finegray.h.
+template <typename IndexType, typename ValueType>
+double finegray_dev_buffers(const InputVector<ValueType> eta,
+			    const InputVector<ValueType> sample_weight,
+			    EIGEN_REF<Eigen::VectorXd> exp_w,
+			    const EIGEN_REF<Eigen::VectorXi> competing,
+			    const EIGEN_REF<Eigen::VectorXd> event,
+			    const EIGEN_REF<IndexVector<IndexType>> event_order,
+			    const EIGEN_REF<IndexVector<IndexType>> start_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    const EIGEN_REF<IndexVector<IndexType>> first,
+			    const EIGEN_REF<IndexVector<IndexType>> last,
+			    const EIGEN_REF<Eigen::VectorXd> scaling,
+			    double loglik_sat,
+			    EIGEN_REF<Eigen::VectorXd> T_1_term,
+			    EIGEN_REF<Eigen::VectorXd> T_2_term,
+			    EIGEN_REF<Eigen::VectorXd> grad_buffer,
+			    EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+			    EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+			    EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+			    BUFFER_LIST event_reorder_buffers,
+			    BUFFER_LIST risk_sum_buffers,
+			    BUFFER_LIST forward_cumsum_buffers,
+			    EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			    BUFFER_LIST reverse_cumsum_buffers,
+			    bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last, no_map, no_map,
+      status, scaling, false, efron};
+
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), MAKE_MAP_Xd(T_1_term), MAKE_MAP_Xd(T_2_term),
+      MAKE_MAP_Xd(grad_buffer), MAKE_MAP_Xd(diag_hessian_buffer), MAKE_MAP_Xd(diag_part_buffer),
+      MAKE_MAP_Xd(w_avg_buffer), MAKE_MAP_Xd(forward_scratch_buffer),
+      Eigen::Map<Eigen::VectorXd>(nullptr, 0), // hess_matvec is not used by finegray_dev
+      {buffer_list_map(event_reorder_buffers, 0),
+       buffer_list_map(event_reorder_buffers, 1),
+       buffer_list_map(event_reorder_buffers, 2)},
+      {buffer_list_map(risk_sum_buffers, 0),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       buffer_list_map(forward_cumsum_buffers, 3),
+       buffer_list_map(forward_cumsum_buffers, 4)},
+      {buffer_list_map(reverse_cumsum_buffers, 0),
+       buffer_list_map(reverse_cumsum_buffers, 1),
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
+
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp10 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[3]);
-  Eigen::Map<Eigen::VectorXd> forward_cumsum_buffers3(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp10));  
-#endif    
+  return coxdev::finegray_dev<IndexType, ValueType>(design, ws, competing, event, eta, sample_weight, loglik_sat);
+}
 
-  // forward_cumsum_buffers[0]: map fifth element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(forward_cumsum_buffers, 4, forward_cumsum_buffers4, tmp11)
+// Fine-Gray Hessian product from the state finegray_dev_buffers left:
+// risk_sums is risk_sum_buffers[0] and G_minus its T_2_term. As
+// hessian_matvec_buffers, returns the product in R.
+template <typename IndexType, typename ValueType>
+HESSIAN_MATVEC_TYPE finegray_hessian_matvec_buffers(const InputVector<ValueType> arg,
+						    const EIGEN_REF<Eigen::VectorXi> competing,
+						    EIGEN_REF<Eigen::VectorXd> exp_w,
+						    EIGEN_REF<Eigen::VectorXd> diag_part,
+						    EIGEN_REF<Eigen::VectorXd> w_avg,
+						    EIGEN_REF<Eigen::VectorXd> risk_sums,
+						    EIGEN_REF<Eigen::VectorXd> G_minus,
+						    const EIGEN_REF<IndexVector<IndexType>> event_order,
+						    const EIGEN_REF<IndexVector<IndexType>> start_order,
+						    const EIGEN_REF<Eigen::VectorXi> status,
+						    const EIGEN_REF<IndexVector<IndexType>> first,
+						    const EIGEN_REF<IndexVector<IndexType>> last,
+						    const EIGEN_REF<Eigen::VectorXd> scaling,
+						    BUFFER_LIST risk_sum_buffers,
+						    BUFFER_LIST forward_cumsum_buffers,
+						    EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+						    BUFFER_LIST reverse_cumsum_buffers,
+						    EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+						    bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last, no_map, no_map,
+      status, scaling, false, efron};
+
+  Eigen::Map<Eigen::VectorXd> unused(nullptr, 0); // not read by finegray_hessian_matvec
+  coxdev::CoxWorkspace ws{MAKE_MAP_Xd(exp_w), unused, MAKE_MAP_Xd(G_minus), unused, unused,
+      MAKE_MAP_Xd(diag_part), MAKE_MAP_Xd(w_avg), MAKE_MAP_Xd(forward_scratch_buffer),
+      MAKE_MAP_Xd(hess_matvec_buffer),
+      {unused, unused, unused},
+      {MAKE_MAP_Xd(risk_sums),
+       buffer_list_map(risk_sum_buffers, 1)},
+      {buffer_list_map(forward_cumsum_buffers, 0),
+       buffer_list_map(forward_cumsum_buffers, 1),
+       buffer_list_map(forward_cumsum_buffers, 2),
+       unused, unused},
+      {unused, unused,
+       buffer_list_map(reverse_cumsum_buffers, 2),
+       buffer_list_map(reverse_cumsum_buffers, 3)}};
+
+  {
+#ifdef PY_INTERFACE
+    py::gil_scoped_release release;
 #endif
+    coxdev::finegray_hessian_matvec<IndexType, ValueType>(design, ws, competing, arg);
+  }
 #ifdef R_INTERFACE
-  Rcpp::NumericVector tmp11 = Rcpp::as<Rcpp::NumericVector>(forward_cumsum_buffers[4]);
-  Eigen::Map<Eigen::VectorXd> forward_cumsum_buffers4(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp11));  
-#endif    
+  return(Rcpp::wrap(hess_matvec_buffer));
+#endif
+}
 
+// Exact partial likelihood of the tie blocks starting at event order
+// positions begin, ..., end - 1: the saturated log likelihood and log
+// likelihood are added to loglik's two entries, and the blocks' weighted
+// inclusion probabilities and their squares to pi_sum and pi2_sum, in
+// event order from position begin on. event and start_event are in event
+// order. Threads may evaluate disjoint ranges into their own outputs. See
+// coxdev_exact.h.
+template <typename IndexType, typename ValueType>
+void exact_partial_likelihood_buffers(const InputVector<ValueType> eta,
+				      const InputVector<ValueType> sample_weight,
+				      Eigen::Index begin,
+				      Eigen::Index end,
+				      const EIGEN_REF<Eigen::VectorXd> event,
+				      const EIGEN_REF<Eigen::VectorXd> start_event,
+				      const EIGEN_REF<IndexVector<IndexType>> event_order,
+				      const EIGEN_REF<Eigen::VectorXi> status,
+				      const EIGEN_REF<IndexVector<IndexType>> first,
+				      const EIGEN_REF<IndexVector<IndexType>> last,
+				      coxdev::VectorRef loglik,
+				      coxdev::VectorRef pi_sum,
+				      coxdev::VectorRef pi2_sum,
+				      bool have_start_times)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  Eigen::Map<const Eigen::VectorXd> no_scaling(nullptr, 0); // not read by exact_partial_likelihood
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, first, last, no_map, no_map,
+      status, no_scaling, have_start_times, false};
+  coxdev::exact_partial_likelihood<IndexType, ValueType>(design, event, start_event, eta, sample_weight,
+							 begin, end, loglik, pi_sum, pi2_sum);
+}
 
-  // some ordered terms to complete likelihood
-  // calculation
+// Subsampled risk sets of the tie blocks starting at event order positions
+// begin, ..., end - 1, n_controls draws each: the saturated log likelihood,
+// log likelihood and its estimated variance are added to loglik's three
+// entries and the log likelihood's derivatives written as entries (row,
+// gradient, diag_hessian), returning their number. eta - center is the
+// centered linear predictor; event and start_event are in event order.
+// Threads may evaluate disjoint ranges into their own outputs. See
+// coxdev_sampled.h.
+template <typename IndexType, typename ValueType>
+Eigen::Index sampled_cox_dev_buffers(const InputVector<ValueType> eta,
+				     double center,
+				     const InputVector<ValueType> sample_weight,
+				     Eigen::Index n_controls,
+				     std::uint64_t seed,
+				     Eigen::Index begin,
+				     Eigen::Index end,
+				     const EIGEN_REF<Eigen::VectorXd> event,
+				     const EIGEN_REF<Eigen::VectorXd> start_event,
+				     const EIGEN_REF<IndexVector<IndexType>> event_order,
+				     const EIGEN_REF<Eigen::VectorXi> status,
+				     const EIGEN_REF<IndexVector<IndexType>> first,
+				     const EIGEN_REF<IndexVector<IndexType>> last,
+				     const EIGEN_REF<Eigen::VectorXd> scaling,
+				     coxdev::VectorRef loglik,
+				     EIGEN_REF<IndexVector<IndexType>> row,
+				     coxdev::VectorRef gradient,
+				     coxdev::VectorRef diag_hessian,
+				     bool have_start_times,
+				     bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, first, last, no_map, no_map,
+      status, scaling, have_start_times, efron};
+  return coxdev::sampled_cox_dev<IndexType, ValueType>(design, event, start_event, eta, center, sample_weight,
+						       n_controls, seed, begin, end, loglik, row, gradient,
+						       diag_hessian);
+}
 
-  // w_cumsum is only used here, can write over forward_cumsum_buffers
-  // after computing w_avg
+// Scores and variances of the candidate columns begin, ..., end - 1 of X
+// into the same entries of score and variance, from the frozen state, which
+// threads may share. See coxdev_screen.h.
+template <typename IndexType, typename ValueType>
+void score_screen_buffers(const coxdev::InputMatrix<ValueType> X,
+			  Eigen::Index begin,
+			  Eigen::Index end,
+			  const EIGEN_REF<IndexVector<IndexType>> event_order,
+			  const EIGEN_REF<IndexVector<IndexType>> start_order,
+			  const EIGEN_REF<Eigen::VectorXi> status,
+			  const EIGEN_REF<IndexVector<IndexType>> first,
+			  const EIGEN_REF<IndexVector<IndexType>> last,
+			  const EIGEN_REF<Eigen::VectorXd> scaling,
+			  const EIGEN_REF<IndexVector<IndexType>> event_map,
+			  const EIGEN_REF<IndexVector<IndexType>> start_map,
+			  const EIGEN_REF<Eigen::VectorXd> score_state,
+			  const EIGEN_REF<Eigen::VectorXd> diag_part_state,
+			  const EIGEN_REF<Eigen::VectorXd> exp_w_event,
+			  const EIGEN_REF<Eigen::VectorXd> exp_w_start,
+			  const EIGEN_REF<Eigen::VectorXd> gamma,
+			  const EIGEN_REF<Eigen::MatrixXd> adjust,
+			  coxdev::VectorRef score,
+			  coxdev::VectorRef variance,
+			  bool have_start_times,
+			  bool efron)
+{
+  coxdev::CoxDesign<IndexType> design{event_order, start_order, first, last,
+      coxdev::start_times_map<IndexType>(event_map, have_start_times),
+      coxdev::start_times_map<IndexType>(start_map, have_start_times),
+      status, scaling, have_start_times, efron};
+  const coxdev::ScreeningState state{score_state, diag_part_state, exp_w_event, exp_w_start, gamma, adjust};
+  coxdev::score_screen<IndexType, ValueType>(design, state, X, begin, end, score, variance);
+}
 
-  // For us w_cumsum is forward_cumsum_buffers[0] which in C++ is forward_cumsum_buffers0
-  for (int i = 0; i < w_avg_buffer.size(); ++i) {
-    w_avg_buffer(i) = (forward_cumsum_buffers0(last(i) + 1) - forward_cumsum_buffers0(first(i))) / ((double) (last(i) + 1 - first(i)));
-  }
-  // w_avg = w_avg_buffer # shorthand
-  double loglik = ( w_event.array() * eta_event.array() * status.cast<double>().array() ).sum() -
-		   ( risk_sums.array().log() * w_avg_buffer.array() * status.cast<double>().array() ).sum();
-    
-  // forward cumsums for gradient and Hessian
-  
-  //# length of cumsums is n+1
-  //# 0 is prepended for first(k)-1, start(k)-1 lookups
-  //# a 1 is added to all indices
-
-  Eigen::VectorXd dummy; // dummy argument for use where None is used
-  Eigen::Map<Eigen::VectorXd> dummy_map(dummy.data(), dummy.size());  
-#ifdef PY_INTERFACE  
-  forward_prework(status, w_avg_buffer, scaling, risk_sums, 0, 1, forward_scratch_buffer, dummy_map, true);
-  Eigen::Ref<Eigen::VectorXd> A_01 = forward_scratch_buffer; // Make a reference rather than a copy
-  forward_cumsum(A_01, forward_cumsum_buffers0); // length=n+1 
-  Eigen::Ref<Eigen::VectorXd> C_01 = forward_cumsum_buffers0; // Make a reference rather than a copy
-  
-  forward_prework(status, w_avg_buffer, scaling, risk_sums, 0, 2, forward_scratch_buffer, dummy_map, true);
-  Eigen::Ref<Eigen::VectorXd> A_02 = forward_scratch_buffer; // Make a reference rather than a copy
-  forward_cumsum(A_02, forward_cumsum_buffers1); // # length=n+1
-  Eigen::Ref<Eigen::VectorXd> C_02 = forward_cumsum_buffers1; // Make a reference rather than a copy
-#endif
-#ifdef R_INTERFACE
-  forward_prework(status, w_avg_buffer, scaling, risk_sums, 0, 1, forward_scratch_buffer, dummy_map, true);
-  Eigen::Map<Eigen::VectorXd> A_01 = forward_scratch_buffer; // Make a reference rather than a copy
-  forward_cumsum(A_01, forward_cumsum_buffers0); // length=n+1 
-  Eigen::Map<Eigen::VectorXd> C_01 = forward_cumsum_buffers0; // Make a reference rather than a copy
-  
-  forward_prework(status, w_avg_buffer, scaling, risk_sums, 0, 2, forward_scratch_buffer, dummy_map, true);
-  Eigen::Map<Eigen::VectorXd> A_02 = forward_scratch_buffer; // Make a reference rather than a copy
-  forward_cumsum(A_02, forward_cumsum_buffers1); // # length=n+1
-  Eigen::Map<Eigen::VectorXd> C_02 = forward_cumsum_buffers1; // Make a reference rather than a copy
-#endif
-  
-  if (!efron) {
-    if (have_start_times) {
-      // # +1 for start_map? depends on how  
-      // # a tie between a start time and an event time
-      // # if that means the start individual is excluded
-      // # we should add +1, otherwise there should be
-      // # no +1 in the [start_map+1] above
-      for (int i = 0; i < last.size(); ++i) {
-	T_1_term(i) = C_01(last(i) + 1) - C_01(start_map(i));
-	T_2_term(i) = C_02(last(i) + 1) - C_02(start_map(i));
-      }
-    } else {
-      for (int i = 0; i < last.size(); ++i) {
-	T_1_term(i) = C_01(last(i) + 1);
-	T_2_term(i) = C_02(last(i) + 1);
-      }
-    }
-  } else {
-    // # compute the other necessary cumsums
-#ifdef PY_INTERFACE 
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 1, 1, forward_scratch_buffer, dummy_map, true);
-    Eigen::Ref<Eigen::VectorXd> A_11 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_11, forward_cumsum_buffers2); // # length=n+1
-    Eigen::Ref<Eigen::VectorXd> C_11 = forward_cumsum_buffers2; // Make a reference rather than a copy
-
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 2, 1, forward_scratch_buffer, dummy_map, true);
-    Eigen::Ref<Eigen::VectorXd> A_21 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_21, forward_cumsum_buffers3); // # length=n+1
-    Eigen::Ref<Eigen::VectorXd> C_21 = forward_cumsum_buffers3; // Make a reference rather than a copy
-
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 2, 2, forward_scratch_buffer, dummy_map, true);
-    Eigen::Ref<Eigen::VectorXd> A_22 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_22, forward_cumsum_buffers4); // # length=n+1
-    Eigen::Ref<Eigen::VectorXd> C_22 = forward_cumsum_buffers4; // Make a reference rather than a copy
+// Preprocess the outcomes begin, ..., end - 1 (columns of the n x K event and
+// status) into the same columns of the outcome arrays, with start n x 0, the
+// n x 1 start times all outcomes share or n x K. Other columns are left
+// alone, so threads may fill disjoint ranges. See coxdev_multi.h.
+template <typename IndexType>
+void preprocess_outcomes_buffers(const coxdev::InputMatrix<double> start,
+				 const coxdev::InputMatrix<double> event,
+				 const EIGEN_REF<Eigen::MatrixXi> status,
+				 bool efron,
+				 Eigen::Index begin,
+				 Eigen::Index end,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> event_order,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> start_order,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> first,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> last,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> event_map,
+				 EIGEN_REF<coxdev::IndexMatrix<IndexType>> start_map,
+				 EIGEN_REF<Eigen::MatrixXi> status_out,
+				 EIGEN_REF<Eigen::MatrixXd> scaling,
+				 EIGEN_REF<Eigen::VectorXi> efron_out)
+{
+  coxdev::OutcomeArrays<IndexType> out{event_order, start_order, first, last, event_map, start_map,
+      status_out, scaling, efron_out};
+  coxdev::preprocess_outcomes<IndexType>(start, event, status, efron, begin, end, out);
+}
+
+// Saturated log likelihoods and deviances of the outcomes begin, ..., end - 1
+// at eta (centered) into the same entries of loglik_sat and deviance, with
+// their gradients into the same columns of gradient (n x K) and X' times them
+// into those of X_gradient (p x K) unless these are 0 x 0. The call has a
+// workspace of its own, so threads may evaluate disjoint ranges.
+template <typename IndexType, typename ValueType>
+void outcome_deviances_buffers(const InputVector<ValueType> eta,
+			       const InputVector<ValueType> sample_weight,
+			       const coxdev::InputMatrix<ValueType> X,
+			       Eigen::Index begin,
+			       Eigen::Index end,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> event_order,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> start_order,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> first,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> last,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> event_map,
+			       const EIGEN_REF<coxdev::IndexMatrix<IndexType>> start_map,
+			       const EIGEN_REF<Eigen::MatrixXi> status,
+			       const EIGEN_REF<Eigen::MatrixXd> scaling,
+			       const EIGEN_REF<Eigen::VectorXi> efron,
+			       coxdev::VectorRef loglik_sat,
+			       coxdev::VectorRef deviance,
+			       coxdev::MatrixRef gradient,
+			       coxdev::MatrixRef X_gradient,
+			       bool have_start_times)
+{
+  const coxdev::OutcomeDesigns<IndexType> designs{event_order, start_order, first, last, event_map, start_map,
+      status, scaling, efron, have_start_times};
+  coxdev::CoxWorkspaceData work(status.rows());
+  coxdev::outcome_deviances<IndexType, ValueType>(designs, work.ws, eta, sample_weight, X, begin, end,
+						  loglik_sat, deviance, gradient, X_gradient);
+}
+
+// Append the rows (start, event, status) in place to the first n rows of
+// preprocessed arrays with room for them, event and start being the times in
+// event and start order and event_position the position of each row in
+// event order. Returns whether the rows recomputed have tied deaths. See
+// coxdev_stream.h.
+template <typename IndexType>
+bool append_rows_buffers(const InputVector<double> start,
+			 const InputVector<double> event,
+			 const EIGEN_REF<Eigen::VectorXi> status,
+			 Eigen::Index n,
+			 bool have_start_times,
+			 EIGEN_REF<IndexVector<IndexType>> event_order,
+			 EIGEN_REF<IndexVector<IndexType>> start_order,
+			 EIGEN_REF<IndexVector<IndexType>> first,
+			 EIGEN_REF<IndexVector<IndexType>> last,
+			 EIGEN_REF<IndexVector<IndexType>> event_map,
+			 EIGEN_REF<IndexVector<IndexType>> start_map,
+			 EIGEN_REF<IndexVector<IndexType>> event_position,
+			 EIGEN_REF<Eigen::VectorXi> status_sorted,
+			 EIGEN_REF<Eigen::VectorXd> event_sorted,
+			 EIGEN_REF<Eigen::VectorXd> start_sorted,
+			 EIGEN_REF<Eigen::VectorXd> scaling)
+{
+  coxdev::AppendableDesign<IndexType> design{event_order, start_order, first, last, event_map, start_map,
+      event_position, status_sorted, event_sorted, start_sorted, scaling};
+#ifdef PY_INTERFACE
+  py::gil_scoped_release release;
 #endif
+  return coxdev::append_rows<IndexType>(design, n, start, event, status, have_start_times);
+}
+
 #ifdef R_INTERFACE
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 1, 1, forward_scratch_buffer, dummy_map, true);
-    Eigen::Map<Eigen::VectorXd> A_11 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_11, forward_cumsum_buffers2); // # length=n+1
-    Eigen::Map<Eigen::VectorXd> C_11 = forward_cumsum_buffers2; // Make a reference rather than a copy
-
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 2, 1, forward_scratch_buffer, dummy_map, true);
-    Eigen::Map<Eigen::VectorXd> A_21 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_21, forward_cumsum_buffers3); // # length=n+1
-    Eigen::Map<Eigen::VectorXd> C_21 = forward_cumsum_buffers3; // Make a reference rather than a copy
-
-    forward_prework(status, w_avg_buffer, scaling, risk_sums, 2, 2, forward_scratch_buffer, dummy_map, true);
-    Eigen::Map<Eigen::VectorXd> A_22 = forward_scratch_buffer; // Make a reference rather than a copy
-    forward_cumsum(A_22, forward_cumsum_buffers4); // # length=n+1
-    Eigen::Map<Eigen::VectorXd> C_22 = forward_cumsum_buffers4; // Make a reference rather than a copy
-#endif    
-
-    for (int i = 0; i < last.size(); ++i) {
-      T_1_term(i) = (C_01(last(i) + 1) - 
-		     (C_11(last(i) + 1) - C_11(first(i))));
-      T_2_term(i) = ((C_22(last(i) + 1) - C_22(first(i))) 
-		      - 2 * (C_21(last(i) + 1) - C_21(first(i))) + 
-		      C_02(last(i) + 1));
-    }
-    if (have_start_times) {
-      for (int i = 0; i < start_map.size(); ++i) {
-	T_1_term(i) -= C_01(start_map(i));
-      }
-      for (int i = 0; i < first.size(); ++i) {      
-	T_2_term(i) -= C_02(first(i));
-      }
-    }
-  }
-  // # could do multiply by exp_w after reorder...
-  // # save a reorder of w * exp(eta)
-  
-  diag_part_buffer = exp_eta_w_event.array() * T_1_term.array();
-  grad_buffer = w_event.array() * status.cast<double>().array() - diag_part_buffer.array();
-  grad_buffer.array() *= -2.0;
-  
-  // # now the diagonal of the Hessian
-  
-  diag_hessian_buffer = exp_eta_w_event.array().pow(2) * T_2_term.array() - diag_part_buffer.array();
-  diag_hessian_buffer.array() *= -2.0;
-  
-  to_native_from_event(grad_buffer, event_order, forward_scratch_buffer);
-  to_native_from_event(diag_hessian_buffer, event_order, forward_scratch_buffer);
-  to_native_from_event(diag_part_buffer, event_order, forward_scratch_buffer);
-  
-  double deviance = 2.0 * (loglik_sat - loglik);
-  return(deviance);
+
+// R entry points: index vectors arrive as integer or double vectors
+// (see R_INDEX_DISPATCH in coxdev.h) and are handed to the matching instantiation.
+
+// R vectors have no room to grow in place: the preprocessed arrays come
+// back lengthened by the new rows, as from .preprocess, with whether the rows
+// recomputed have tied deaths.
+template <typename IndexType>
+Rcpp::List append_rows_copy(const InputVector<double> start,
+			    const InputVector<double> event,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    bool have_start_times,
+			    const Rcpp::List preproc,
+			    SEXP event_order,
+			    SEXP start_order)
+{
+  const Eigen::Index m = status.size();
+  const Eigen::Index n = R_INDEX_MAP(event_order).size();
+  const Eigen::Index N = n + m;
+  IndexVector<IndexType> event_order_(N), start_order_(N), first(N), last(N), event_map(N), start_map(N), event_position(N);
+  event_order_.head(n) = R_INDEX_MAP(event_order);
+  start_order_.head(n) = R_INDEX_MAP(start_order);
+  first.head(n) = R_INDEX_MAP(preproc["first"]);
+  last.head(n) = R_INDEX_MAP(preproc["last"]);
+  event_map.head(n) = R_INDEX_MAP(preproc["event_map"]);
+  start_map.head(n) = R_INDEX_MAP(preproc["start_map"]);
+  coxdev::event_positions<IndexType>(event_order_.head(n), event_position);
+  Eigen::VectorXi status_(N);
+  Eigen::VectorXd event_(N), start_(N), scaling(N);
+  status_.head(n) = Rcpp::as<Eigen::Map<Eigen::VectorXi> >(preproc["status"]);
+  event_.head(n) = Rcpp::as<Eigen::Map<Eigen::VectorXd> >(preproc["event"]);
+  start_.head(n) = Rcpp::as<Eigen::Map<Eigen::VectorXd> >(preproc["start"]);
+  scaling.head(n) = Rcpp::as<Eigen::Map<Eigen::VectorXd> >(preproc["scaling"]);
+
+  auto map = [](IndexVector<IndexType> & x) { return Eigen::Map<IndexVector<IndexType> >(x.data(), x.size()); };
+  const bool ties = append_rows_buffers<IndexType>(start, event, status, n, have_start_times,
+						   map(event_order_), map(start_order_), map(first), map(last),
+						   map(event_map), map(start_map), map(event_position),
+						   MAKE_MAP_Xi(status_), MAKE_MAP_Xd(event_), MAKE_MAP_Xd(start_),
+						   MAKE_MAP_Xd(scaling));
+  Rcpp::List appended = Rcpp::List::create(
+					   Rcpp::_["start"] = Rcpp::wrap(start_),
+					   Rcpp::_["event"] = Rcpp::wrap(event_),
+					   Rcpp::_["first"] = r_index_wrap(first),
+					   Rcpp::_["last"] = r_index_wrap(last),
+					   Rcpp::_["scaling"] = Rcpp::wrap(scaling),
+					   Rcpp::_["start_map"] = r_index_wrap(start_map),
+					   Rcpp::_["event_map"] = r_index_wrap(event_map),
+					   Rcpp::_["status"] = Rcpp::wrap(status_)
+					   );
+  return Rcpp::List::create(
+			    Rcpp::_["preproc"] = appended,
+			    Rcpp::_["event_order"] = r_index_wrap(event_order_),
+			    Rcpp::_["start_order"] = r_index_wrap(start_order_),
+			    Rcpp::_["ties"] = (double) ties);
+}
+
+// start is ignored without start times; see append_rows_copy
+// [[Rcpp::export(.append_rows)]]
+Rcpp::List append_rows_R(const InputVector<double> start,
+			 const InputVector<double> event,
+			 const EIGEN_REF<Eigen::VectorXi> status,
+			 bool have_start_times,
+			 const Rcpp::List preproc,
+			 SEXP event_order,
+			 SEXP start_order)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return append_rows_copy<IndexType>(start, event, status, have_start_times,
+						      preproc, event_order, start_order));
+}
+
+// [[Rcpp::export(.reverse_cumsums)]]
+void reverse_cumsums_R(const EIGEN_REF<Eigen::VectorXd> sequence,
+		       EIGEN_REF<Eigen::VectorXd> event_buffer,
+		       EIGEN_REF<Eigen::VectorXd> start_buffer,
+		       SEXP event_order,
+		       SEXP start_order,
+		       bool do_event = false,
+		       bool do_start = false)
+{
+  R_INDEX_DISPATCH(event_order,
+		   reverse_cumsums<IndexType>(sequence, event_buffer, start_buffer,
+					      R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+					      do_event, do_start));
+}
+
+// [[Rcpp::export(.to_native_from_event)]]
+void to_native_from_event_R(EIGEN_REF<Eigen::VectorXd> arg,
+			    SEXP event_order,
+			    EIGEN_REF<Eigen::VectorXd> reorder_buffer)
+{
+  R_INDEX_DISPATCH(event_order,
+		   to_native_from_event<IndexType>(arg, R_INDEX_MAP(event_order), reorder_buffer));
+}
+
+// [[Rcpp::export(.to_event_from_native)]]
+void to_event_from_native_R(const EIGEN_REF<Eigen::VectorXd> arg,
+			    SEXP event_order,
+			    EIGEN_REF<Eigen::VectorXd> reorder_buffer)
+{
+  R_INDEX_DISPATCH(event_order,
+		   to_event_from_native<IndexType, double>(arg, R_INDEX_MAP(event_order), reorder_buffer));
+}
+
+// [[Rcpp::export(.compute_sat_loglik)]]
+double compute_sat_loglik_R(SEXP first,
+			    SEXP last,
+			    const EIGEN_REF<Eigen::VectorXd> weight,
+			    SEXP event_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    EIGEN_REF<Eigen::VectorXd> W_status)
+{
+  R_INDEX_DISPATCH(first,
+		   return compute_sat_loglik<IndexType, double>(R_INDEX_MAP(first), R_INDEX_MAP(last), weight,
+							R_INDEX_MAP(event_order), status, W_status));
+}
+
+// [[Rcpp::export(.sum_over_events)]]
+void sum_over_events_R(SEXP event_order,
+		       SEXP start_order,
+		       SEXP first,
+		       SEXP last,
+		       SEXP start_map,
+		       const EIGEN_REF<Eigen::VectorXd> scaling,
+		       const EIGEN_REF<Eigen::VectorXi> status,
+		       bool efron,
+		       BUFFER_LIST forward_cumsum_buffers,
+		       EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		       EIGEN_REF<Eigen::VectorXd> value_buffer)
+{
+  R_INDEX_DISPATCH(event_order,
+		   sum_over_events_buffers<IndexType>(R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+					      R_INDEX_MAP(first), R_INDEX_MAP(last), R_INDEX_MAP(start_map),
+					      scaling, status, efron, forward_cumsum_buffers,
+					      forward_scratch_buffer, value_buffer));
+}
+
+// [[Rcpp::export(.sum_over_risk_set)]]
+void sum_over_risk_set_R(const EIGEN_REF<Eigen::VectorXd> arg,
+			 SEXP event_order,
+			 SEXP start_order,
+			 SEXP first,
+			 SEXP last,
+			 SEXP event_map,
+			 const EIGEN_REF<Eigen::VectorXd> scaling,
+			 bool efron,
+			 BUFFER_LIST risk_sum_buffers,
+			 int risk_sum_buffers_offset,
+			 BUFFER_LIST reverse_cumsum_buffers,
+			 int reverse_cumsum_buffers_offset)
+{
+  R_INDEX_DISPATCH(event_order,
+		   sum_over_risk_set_buffers<IndexType>(arg, R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+						R_INDEX_MAP(first), R_INDEX_MAP(last), R_INDEX_MAP(event_map),
+						scaling, efron, risk_sum_buffers, risk_sum_buffers_offset,
+						reverse_cumsum_buffers, reverse_cumsum_buffers_offset));
+}
+
+// [[Rcpp::export(.cox_dev)]]
+double cox_dev_R(const EIGEN_REF<Eigen::VectorXd> eta,
+		 const EIGEN_REF<Eigen::VectorXd> sample_weight,
+		 const EIGEN_REF<Eigen::VectorXd> exp_w,
+		 SEXP event_order,
+		 SEXP start_order,
+		 const EIGEN_REF<Eigen::VectorXi> status,
+		 SEXP first,
+		 SEXP last,
+		 const EIGEN_REF<Eigen::VectorXd> scaling,
+		 SEXP event_map,
+		 SEXP start_map,
+		 double loglik_sat,
+		 EIGEN_REF<Eigen::VectorXd> T_1_term,
+		 EIGEN_REF<Eigen::VectorXd> T_2_term,
+		 EIGEN_REF<Eigen::VectorXd> grad_buffer,
+		 EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+		 EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+		 EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+		 BUFFER_LIST event_reorder_buffers,
+		 BUFFER_LIST risk_sum_buffers,
+		 BUFFER_LIST forward_cumsum_buffers,
+		 EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		 BUFFER_LIST reverse_cumsum_buffers,
+		 bool have_start_times = true,
+		 bool efron = false)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return cox_dev_buffers<IndexType, double>(eta, sample_weight, exp_w,
+					     R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+					     R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+					     R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+					     loglik_sat, T_1_term, T_2_term, grad_buffer,
+					     diag_hessian_buffer, diag_part_buffer, w_avg_buffer,
+					     event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers,
+					     forward_scratch_buffer, reverse_cumsum_buffers,
+					     have_start_times, efron));
 }
 
-// This is a bit different in R and python since in python, the LinearOperator class takes
-// care of handing whether the arg is a matrix or a column vector automatically by calling
-// this routine on each column. No such luck in R, so it seems easiest to return a vector
-// as a result. We have to "apply" this routine to columns if a matrix is passed. 
-// We can make this uniform later by modifying the python code to directly use this returned
-// vector we create for R. Then the code will be the same for both R and python.
 // [[Rcpp::export(.hessian_matvec)]]
-HESSIAN_MATVEC_TYPE hessian_matvec(const EIGEN_REF<Eigen::VectorXd> arg, // # arg is in native order
-				   const EIGEN_REF<Eigen::VectorXd> eta, // # eta is in native order 
-				   const EIGEN_REF<Eigen::VectorXd> sample_weight, //# sample_weight is in native order
-				   const EIGEN_REF<Eigen::VectorXd> risk_sums,
-				   const EIGEN_REF<Eigen::VectorXd> diag_part,
-				   const EIGEN_REF<Eigen::VectorXd> w_avg,
-				   const EIGEN_REF<Eigen::VectorXd> exp_w,
-				   const EIGEN_REF<Eigen::VectorXd> event_cumsum,
-				   const EIGEN_REF<Eigen::VectorXd> start_cumsum,
-				   const EIGEN_REF<Eigen::VectorXi> event_order,   
-				   const EIGEN_REF<Eigen::VectorXi> start_order,
-				   const EIGEN_REF<Eigen::VectorXi> status, // # everything below in event order
-				   const EIGEN_REF<Eigen::VectorXi> first,
-				   const EIGEN_REF<Eigen::VectorXi> last,
-				   const EIGEN_REF<Eigen::VectorXd> scaling,
-				   const EIGEN_REF<Eigen::VectorXi> event_map,
-				   const EIGEN_REF<Eigen::VectorXi> start_map,
-				   BUFFER_LIST risk_sum_buffers,
-				   BUFFER_LIST forward_cumsum_buffers,
-				   EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
-				   BUFFER_LIST reverse_cumsum_buffers,
-				   EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
-				   bool have_start_times = true,
-				   bool efron = false)
+HESSIAN_MATVEC_TYPE hessian_matvec_R(const EIGEN_REF<Eigen::VectorXd> arg,
+				     const EIGEN_REF<Eigen::VectorXd> eta,
+				     const EIGEN_REF<Eigen::VectorXd> sample_weight,
+				     const EIGEN_REF<Eigen::VectorXd> risk_sums,
+				     const EIGEN_REF<Eigen::VectorXd> diag_part,
+				     const EIGEN_REF<Eigen::VectorXd> w_avg,
+				     const EIGEN_REF<Eigen::VectorXd> exp_w,
+				     const EIGEN_REF<Eigen::VectorXd> event_cumsum,
+				     const EIGEN_REF<Eigen::VectorXd> start_cumsum,
+				     SEXP event_order,
+				     SEXP start_order,
+				     const EIGEN_REF<Eigen::VectorXi> status,
+				     SEXP first,
+				     SEXP last,
+				     const EIGEN_REF<Eigen::VectorXd> scaling,
+				     SEXP event_map,
+				     SEXP start_map,
+				     BUFFER_LIST risk_sum_buffers,
+				     BUFFER_LIST forward_cumsum_buffers,
+				     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+				     BUFFER_LIST reverse_cumsum_buffers,
+				     EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+				     bool have_start_times = true,
+				     bool efron = false)
 {
-  
-  
-  Eigen::VectorXd exp_w_times_arg = exp_w.array() * arg.array();
-
-  if (have_start_times) {
-    // # now in event_order
-    sum_over_risk_set(MAKE_MAP_Xd(exp_w_times_arg), // # in native order
-		      event_order,
-		      start_order,
-		      first,
-		      last,
-		      event_map,
-		      scaling,
-		      efron,
-		      risk_sum_buffers,
-		      1, // offset 1 into risk_sum_buffers
-		      reverse_cumsum_buffers,
-		      2); // offset from index 2 of reverse_cumsum_buffers 
-  } else {
-    Eigen::VectorXi dummy;
-    Eigen::Map<Eigen::VectorXi> dummy_map(dummy.data(), dummy.size());        
-    sum_over_risk_set(MAKE_MAP_Xd(exp_w_times_arg), // # in native order
-		      event_order,
-		      start_order,
-		      first,
-		      last,
-		      dummy_map,
-		      scaling,
-		      efron,
-		      risk_sum_buffers,
-		      1, // offset 1 into risk_sum_buffers
-		      reverse_cumsum_buffers,
-		      2);// offset from index 2 of reverse_cumsum_buffers 
-  }
-  // risk_sums_arg: map second element of list into Eigen vector.
-#ifdef PY_INTERFACE 
-  MAP_BUFFER_LIST(risk_sum_buffers, 1, risk_sums_arg, tmp1)
-#endif
-#ifdef R_INTERFACE
-  Rcpp::NumericVector tmp1 = Rcpp::as<Rcpp::NumericVector>(risk_sum_buffers[1]);
-  Eigen::Map<Eigen::VectorXd> risk_sums_arg(Rcpp::as<Eigen::Map<Eigen::VectorXd>>(tmp1));  
-#endif    
-
-  // # E_arg = risk_sums_arg / risk_sums -- expecations under the probabilistic interpretation
-  // # forward_scratch_buffer[:] = status * w_avg * E_arg / risk_sums
-
-  // # one less step to compute from above representation
-  forward_scratch_buffer = ( status.cast<double>().array() * w_avg.array() * risk_sums_arg.array() ) / risk_sums.array().pow(2);
-
-  if (have_start_times) {
-    sum_over_events(event_order,
-		    start_order,
-		    first,
-		    last,
-		    start_map,
-		    scaling,
-		    status,
-		    efron,
-		    forward_cumsum_buffers,
-		    forward_scratch_buffer,
-		    hess_matvec_buffer);
-  } else {
-    Eigen::VectorXi dummy;
-    sum_over_events(event_order,
-		    start_order,
-		    first,
-		    last,
-                    MAKE_MAP_Xi(dummy),
-		    scaling,
-		    status,
-		    efron,
-		    forward_cumsum_buffers,
-		    forward_scratch_buffer,
-		    hess_matvec_buffer);
-  }
-  
-  to_native_from_event(hess_matvec_buffer, event_order, forward_scratch_buffer);
-  // Eigen::VectorXd buffer = hess_matvec_buffer.array() * exp_w.array();
-  hess_matvec_buffer = hess_matvec_buffer.array() * exp_w.array() - (diag_part.array() * arg.array());
-#ifdef R_INTERFACE  
-  return(Rcpp::wrap(hess_matvec_buffer));
-#endif
+  R_INDEX_DISPATCH(event_order,
+		   return hessian_matvec_buffers<IndexType, double>(arg, eta, sample_weight, risk_sums, diag_part, w_avg,
+						    exp_w, event_cumsum, start_cumsum,
+						    R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+						    R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+						    R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+						    risk_sum_buffers, forward_cumsum_buffers,
+						    forward_scratch_buffer, reverse_cumsum_buffers,
+						    hess_matvec_buffer, have_start_times, efron));
 }
 
-/* Start of C implementation of preprocess */
 
-#include <vector>
-#include <tuple>
-#include <algorithm> // For std::sort and other algorithms
+// [[Rcpp::export(.concordance)]]
+Eigen::VectorXd concordance_R(const EIGEN_REF<Eigen::VectorXd> eta,
+			      const EIGEN_REF<Eigen::VectorXd> sample_weight,
+			      SEXP event_order,
+			      SEXP start_order,
+			      const EIGEN_REF<Eigen::VectorXi> status,
+			      SEXP first,
+			      SEXP last,
+			      SEXP event_map,
+			      SEXP start_map,
+			      const EIGEN_REF<Eigen::VectorXd> event,
+			      bool have_start_times,
+			      bool ipcw,
+			      double tau)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return concordance_counts<IndexType, double>(eta, sample_weight,
+						R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+						R_INDEX_MAP(first), R_INDEX_MAP(last),
+						R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+						event, have_start_times, ipcw, tau));
+}
 
-/**
- * Equivalent of numpy.lexsort for our case where a is stacked_is_start, b is stacked_status_c,
- * and c is stacked event time.
- */
-std::vector<int> lexsort(const Eigen::VectorXi & a, 
-                         const Eigen::VectorXi & b, 
-                         const Eigen::VectorXd & c) {
-  std::vector<int> idx(a.size());
-  std::iota(idx.begin(), idx.end(), 0); // Fill idx with 0, 1, ..., a.size() - 1
-  
-  auto comparator = [&](int i, int j) {
-    if (c[i] != c[j]) return c[i] < c[j];
-    if (b[i] != b[j]) return b[i] < b[j];
-    return a[i] < a[j];
-  };
-  
-  std::sort(idx.begin(), idx.end(), comparator);
-  
-  return idx;
+// [[Rcpp::export(.baseline_hazard)]]
+double baseline_hazard_R(SEXP event_order,
+			 const EIGEN_REF<Eigen::VectorXi> status,
+			 SEXP first,
+			 SEXP last,
+			 const EIGEN_REF<Eigen::VectorXd> event,
+			 const EIGEN_REF<Eigen::VectorXd> risk_sums,
+			 const EIGEN_REF<Eigen::VectorXd> w_avg,
+			 double center,
+			 EIGEN_REF<Eigen::VectorXd> time,
+			 EIGEN_REF<Eigen::VectorXd> cumhaz)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return (double) baseline_hazard_buffers<IndexType>(R_INDEX_MAP(event_order), status,
+								      R_INDEX_MAP(first), R_INDEX_MAP(last),
+								      event, risk_sums, w_avg, center, time, cumhaz));
 }
 
-/**
- * Compute various functions of the start / event / status to be used to help in computing cumsums
- * This is best done in C++ also to avoid dealing with 1-based indexing in R  and 0-based indexing 
- * elsewhere.
- */
-// [[Rcpp::export(.preprocess)]]
-PREPROCESS_TYPE preprocess(const EIGEN_REF<Eigen::VectorXd> start,
-			   const EIGEN_REF<Eigen::VectorXd> event,
-			   const EIGEN_REF<Eigen::VectorXi> status)
+// [[Rcpp::export(.survival)]]
+Eigen::MatrixXd survival_R(const EIGEN_REF<Eigen::VectorXd> time,
+			   const EIGEN_REF<Eigen::VectorXd> cumhaz,
+			   const EIGEN_REF<Eigen::VectorXd> eta,
+			   const EIGEN_REF<Eigen::VectorXd> query)
 {
-  int nevent = status.size();
-  Eigen::VectorXi ones = Eigen::VectorXi::Ones(nevent);
-  Eigen::VectorXi zeros = Eigen::VectorXi::Zero(nevent);
-
-  // second column of stacked_array is 1-status...
-  Eigen::VectorXd stacked_time(nevent + nevent);
-  stacked_time.segment(0, nevent) = start;
-  stacked_time.segment(nevent, nevent) = event;
-
-  Eigen::VectorXi stacked_status_c(nevent + nevent);
-  stacked_status_c.segment(0, nevent) = ones;
-  stacked_status_c.segment(nevent, nevent) = ones - status; // complement of status
-
-  Eigen::VectorXi stacked_is_start(nevent + nevent);
-  stacked_is_start.segment(0, nevent) = ones;
-  stacked_is_start.segment(nevent, nevent) = zeros;
-
-  Eigen::VectorXi stacked_index(nevent + nevent);
-  stacked_index.segment(0, nevent) = Eigen::VectorXi::LinSpaced(nevent, 0, nevent - 1);
-  stacked_index.segment(nevent, nevent) =  Eigen::VectorXi::LinSpaced(nevent, 0, nevent - 1);
-
-  std::vector<int> sort_order = lexsort(stacked_is_start, stacked_status_c, stacked_time);
-  Eigen::VectorXi argsort = Eigen::Map<const Eigen::VectorXi>(sort_order.data(), sort_order.size());
-
-  // Since they are all the same size, we can put them in one loop for efficiency!
-  Eigen::VectorXd sorted_time(stacked_time.size()), sorted_status(stacked_status_c.size()),
-    sorted_is_start(stacked_is_start.size()), sorted_index(stacked_index.size());
-  for (int i = 0; i < sorted_time.size(); ++i) {
-    int j = argsort(i);
-    sorted_time(i) = stacked_time(j);
-    sorted_status(i) = 1 - stacked_status_c(j);
-    sorted_is_start(i) = stacked_is_start(j);
-    sorted_index(i) = stacked_index(j);    
-  }
+  Eigen::MatrixXd out(eta.size(), query.size());
+  coxdev::survival_curves<double>(time, cumhaz, eta, query, out);
+  return out;
+}
 
-  // do the joint sort
-
-  int event_count = 0, start_count = 0;
-  std::vector<int> event_order_vec, start_order_vec, start_map_vec, event_map_vec, first_vec;
-  // int which_event = -1
-  int first_event = -1, num_successive_event = 1;
-  double last_row_time;
-  bool last_row_time_set = false;
-
-  for (int i = 0; i < sorted_time.size(); ++i) {
-    double _time = sorted_time(i); 
-    int _status = sorted_status(i);
-    int _is_start = sorted_is_start(i);
-    int _index = sorted_index(i);
-    if (_is_start == 1) { //a start time
-      start_order_vec.push_back(_index);
-      start_map_vec.push_back(event_count);
-      start_count++;
-    } else { // an event / stop time
-      if (_status == 1) {
-	// if it's an event and the time is same as last row 
-	// it is the same event
-	// else it's the next "which_event"
-	// CHANGED THE ORIGINAL COMPARISON time != last_row_time below to
-	// _time > last_row_time since time is sorted! 
-	if (last_row_time_set  && _time > last_row_time) {// # index of next `status==1` 
-	  first_event += num_successive_event;
-	  num_successive_event = 1;
-	  // which_event++;
-	} else {
-	  num_successive_event++;
-	}
-	first_vec.push_back(first_event);
-      } else {
-	first_event += num_successive_event;
-	num_successive_event = 1;
-	first_vec.push_back(first_event); // # this event time was not an failure time
-      }
-      event_map_vec.push_back(start_count);
-      event_order_vec.push_back(_index);
-      event_count++;
-    }
-    last_row_time = _time;
-    last_row_time_set = true;
-  }
+// [[Rcpp::export(.martingale_residuals)]]
+void martingale_residuals_R(SEXP event_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    EIGEN_REF<Eigen::VectorXd> T_1_term,
+			    EIGEN_REF<Eigen::VectorXd> eta_event,
+			    EIGEN_REF<Eigen::VectorXd> martingale,
+			    EIGEN_REF<Eigen::VectorXd> deviance)
+{
+  R_INDEX_DISPATCH(event_order,
+		   martingale_residuals_buffers<IndexType>(R_INDEX_MAP(event_order), status,
+							   T_1_term, eta_event, martingale, deviance));
+}
 
-  // Except for start_order and event_order which are returned, we can probably not make copies
-  // for others here.
-  Eigen::VectorXi _first = Eigen::Map<Eigen::VectorXi>(first_vec.data(), first_vec.size());
-  Eigen::VectorXi start_order = Eigen::Map<Eigen::VectorXi>(start_order_vec.data(), start_order_vec.size());
-  Eigen::VectorXi event_order = Eigen::Map<Eigen::VectorXi>(event_order_vec.data(), event_order_vec.size());
-  Eigen::VectorXi start_map = Eigen::Map<Eigen::VectorXi>(start_map_vec.data(), start_map_vec.size());
-  Eigen::VectorXi _event_map = Eigen::Map<Eigen::VectorXi>(event_map_vec.data(), event_map_vec.size());
-
-  // Eigen::VectorXi first(first_vec.size());
-  // for (size_t i = 0; i < first.size(); ++i) {
-  //   first[i] = first_vec[i];
-  // }
-  // Eigen::VectorXi start_order(start_order_vec.size());
-  // for (size_t i = 0; i < start_order.size(); ++i) {
-  //   start_order[i] = start_order_vec[i];
-  // }
-  // Eigen::VectorXi event_order(event_order_vec.size());
-  // for (size_t i = 0; i < event_order.size(); ++i) {
-  //   event_order[i] = event_order_vec[i];
-  // }
-  // Eigen::VectorXi start_map(start_map_vec.size());
-  // for (size_t i = 0; i < start_map.size(); ++i) {
-  //   start_map[i] = start_map_vec[i];
-  // }
-  // Eigen::VectorXi event_map(event_map_vec.size());
-  // for (size_t i = 0; i < event_map.size(); ++i) {
-  //   event_map[i] = event_map_vec[i];
-  // }
-
-  // reset start_map to original order
-  Eigen::VectorXi start_map_cp = start_map;
-  for (int i = 0; i < start_map.size(); ++i) {
-    start_map(start_order(i)) = start_map_cp(i);
-  }
+// [[Rcpp::export(.score_residuals)]]
+Rcpp::List score_residuals_R(const EIGEN_REF<Eigen::MatrixXd> X,
+			     EIGEN_REF<Eigen::VectorXd> exp_w,
+			     SEXP event_order,
+			     SEXP start_order,
+			     const EIGEN_REF<Eigen::VectorXi> status,
+			     SEXP first,
+			     SEXP last,
+			     const EIGEN_REF<Eigen::VectorXd> scaling,
+			     SEXP event_map,
+			     SEXP start_map,
+			     EIGEN_REF<Eigen::VectorXd> T_1_term,
+			     EIGEN_REF<Eigen::VectorXd> w_avg,
+			     Rcpp::List event_reorder_buffers,
+			     Rcpp::List risk_sum_buffers,
+			     Rcpp::List forward_cumsum_buffers,
+			     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			     Rcpp::List reverse_cumsum_buffers,
+			     EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			     bool have_start_times,
+			     bool efron)
+{
+  Eigen::MatrixXd score(X.rows(), X.cols());
+  Eigen::MatrixXd schoenfeld(X.rows(), X.cols());
+  R_INDEX_DISPATCH(event_order,
+		   score_residuals_buffers<IndexType, double>(X, exp_w,
+							      R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+							      R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+							      R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+							      T_1_term, w_avg, event_reorder_buffers, risk_sum_buffers,
+							      forward_cumsum_buffers, forward_scratch_buffer,
+							      reverse_cumsum_buffers, hess_matvec_buffer,
+							      score, schoenfeld, have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["score"] = Rcpp::wrap(score),
+			    Rcpp::_["schoenfeld"] = Rcpp::wrap(schoenfeld));
+}
 
-  // set to event order
-  Eigen::VectorXi _status(status.size());
-  for (int i = 0; i < status.size(); ++i) {
-    _status(i) = status(event_order(i));
-  }
-  
-  // Eigen::VectorXi _first = first;
-  
-  Eigen::VectorXi _start_map(start_map.size());
-  for (int i = 0; i < start_map.size(); ++i) {
-    _start_map(i) = start_map(event_order(i));
-  }
+// [[Rcpp::export(.cluster_scores)]]
+Rcpp::List cluster_scores_R(const EIGEN_REF<Eigen::MatrixXd> X,
+			    SEXP cluster,
+			    int n_clusters,
+			    EIGEN_REF<Eigen::VectorXd> exp_w,
+			    SEXP event_order,
+			    SEXP start_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    SEXP first,
+			    SEXP last,
+			    const EIGEN_REF<Eigen::VectorXd> scaling,
+			    SEXP event_map,
+			    SEXP start_map,
+			    EIGEN_REF<Eigen::VectorXd> T_1_term,
+			    EIGEN_REF<Eigen::VectorXd> diag_part,
+			    EIGEN_REF<Eigen::VectorXd> w_avg,
+			    Rcpp::List event_reorder_buffers,
+			    Rcpp::List risk_sum_buffers,
+			    Rcpp::List forward_cumsum_buffers,
+			    EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			    Rcpp::List reverse_cumsum_buffers,
+			    EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			    bool have_start_times,
+			    bool efron)
+{
+  Eigen::MatrixXd U(n_clusters, X.cols());
+  Eigen::MatrixXd information(X.cols(), X.cols());
+  R_INDEX_DISPATCH(event_order,
+		   cluster_scores_buffers<IndexType, double>(X, R_INDEX_MAP(cluster), 0, X.cols(), exp_w,
+							     R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+							     R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+							     R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+							     T_1_term, diag_part, w_avg, event_reorder_buffers,
+							     risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer,
+							     reverse_cumsum_buffers, hess_matvec_buffer,
+							     U, information, have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["U"] = Rcpp::wrap(U),
+			    Rcpp::_["information"] = Rcpp::wrap(information));
+}
 
-  // Eigen::VectorXi _event_map = event_map;
+// Z is n x 0 without null model covariates
+// [[Rcpp::export(.score_screen)]]
+Rcpp::List score_screen_R(const EIGEN_REF<Eigen::MatrixXd> Z,
+			  const EIGEN_REF<Eigen::MatrixXd> X,
+			  EIGEN_REF<Eigen::VectorXd> exp_w,
+			  SEXP event_order,
+			  SEXP start_order,
+			  const EIGEN_REF<Eigen::VectorXi> status,
+			  SEXP first,
+			  SEXP last,
+			  const EIGEN_REF<Eigen::VectorXd> scaling,
+			  SEXP event_map,
+			  SEXP start_map,
+			  EIGEN_REF<Eigen::VectorXd> grad,
+			  EIGEN_REF<Eigen::VectorXd> diag_part,
+			  EIGEN_REF<Eigen::VectorXd> w_avg,
+			  Rcpp::List risk_sum_buffers,
+			  Rcpp::List forward_cumsum_buffers,
+			  EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			  Rcpp::List reverse_cumsum_buffers,
+			  EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+			  bool have_start_times,
+			  bool efron)
+{
+  const Eigen::Index n = status.size();
+  Eigen::VectorXd score_state(n), diag_part_state(n), exp_w_event(n), exp_w_start(have_start_times ? n : 0), gamma(n);
+  Eigen::MatrixXd adjust(Z.cols(), n);
+  Eigen::VectorXd score(X.cols()), variance(X.cols());
+  R_INDEX_DISPATCH(event_order,
+		   freeze_screening_buffers<IndexType, double>(Z, exp_w, R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+							       status, R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+							       R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+							       grad, diag_part, w_avg, risk_sum_buffers, forward_cumsum_buffers,
+							       forward_scratch_buffer, reverse_cumsum_buffers, hess_matvec_buffer,
+							       score_state, diag_part_state, exp_w_event, exp_w_start, gamma,
+							       adjust, have_start_times, efron);
+		   score_screen_buffers<IndexType, double>(X, 0, X.cols(), R_INDEX_MAP(event_order),
+							   R_INDEX_MAP(start_order), status, R_INDEX_MAP(first),
+							   R_INDEX_MAP(last), scaling, R_INDEX_MAP(event_map),
+							   R_INDEX_MAP(start_map), MAKE_MAP_Xd(score_state),
+							   MAKE_MAP_Xd(diag_part_state), MAKE_MAP_Xd(exp_w_event),
+							   MAKE_MAP_Xd(exp_w_start), MAKE_MAP_Xd(gamma),
+							   Eigen::Map<Eigen::MatrixXd>(adjust.data(), adjust.rows(), adjust.cols()),
+							   score, variance, have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["score"] = Rcpp::wrap(score),
+			    Rcpp::_["variance"] = Rcpp::wrap(variance));
+}
 
-  Eigen::VectorXd _event(event.size());
-  for (int i = 0; i < event.size(); ++i) {
-    _event(i) = event(event_order(i));
-  }
+// [[Rcpp::export(.horizon_sweep)]]
+Rcpp::List horizon_sweep_R(const EIGEN_REF<Eigen::VectorXd> event,
+			   const EIGEN_REF<Eigen::VectorXd> horizon,
+			   SEXP event_order,
+			   const EIGEN_REF<Eigen::VectorXi> status,
+			   SEXP first,
+			   SEXP last,
+			   const EIGEN_REF<Eigen::VectorXd> scaling,
+			   SEXP start_map,
+			   EIGEN_REF<Eigen::VectorXd> w_avg,
+			   Rcpp::List event_reorder_buffers,
+			   Rcpp::List risk_sum_buffers,
+			   Rcpp::List forward_cumsum_buffers,
+			   EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+			   bool gradient,
+			   bool have_start_times,
+			   bool efron)
+{
+  const Eigen::Index n = status.size(), m = horizon.size();
+  Eigen::VectorXd loglik_sat(m), deviance(m);
+  Eigen::MatrixXd G(gradient ? n : 0, gradient ? m : 0);
+  R_INDEX_DISPATCH(event_order,
+		   horizon_sweep_buffers<IndexType>(event, horizon, R_INDEX_MAP(event_order), status,
+						    R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+						    R_INDEX_MAP(start_map), w_avg, event_reorder_buffers,
+						    risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer,
+						    loglik_sat, deviance, G, have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["loglik_sat"] = Rcpp::wrap(loglik_sat),
+			    Rcpp::_["deviance"] = Rcpp::wrap(deviance),
+			    Rcpp::_["gradient"] = Rcpp::wrap(G));
+}
 
-  Eigen::VectorXd _start(event.size());
-  for (int i = 0; i < event.size(); ++i) {
-    _start(i) = event(start_order(i));
-  }
+// eta n x L, a centered column per landmark copy
+// [[Rcpp::export(.landmark_deviances)]]
+Rcpp::List landmark_deviances_R(const EIGEN_REF<Eigen::MatrixXd> eta,
+				const EIGEN_REF<Eigen::VectorXd> sample_weight,
+				const EIGEN_REF<Eigen::VectorXd> landmark,
+				const EIGEN_REF<Eigen::VectorXd> horizon,
+				const EIGEN_REF<Eigen::VectorXd> event,
+				const EIGEN_REF<Eigen::VectorXd> start,
+				SEXP event_order,
+				SEXP start_order,
+				const EIGEN_REF<Eigen::VectorXi> status,
+				SEXP first,
+				SEXP last,
+				const EIGEN_REF<Eigen::VectorXd> scaling,
+				bool gradient,
+				bool have_start_times,
+				bool efron)
+{
+  const Eigen::Index n = status.size(), L = landmark.size();
+  Eigen::VectorXd loglik_sat(L), deviance(L);
+  Eigen::MatrixXd G(gradient ? n : 0, gradient ? L : 0);
+  R_INDEX_DISPATCH(event_order,
+		   landmark_deviances_buffers<IndexType, double>(eta, sample_weight, landmark, horizon, 0, L,
+								 event, start, R_INDEX_MAP(event_order),
+								 R_INDEX_MAP(start_order), status,
+								 R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+								 loglik_sat, deviance, G, have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["loglik_sat"] = Rcpp::wrap(loglik_sat),
+			    Rcpp::_["deviance"] = Rcpp::wrap(deviance),
+			    Rcpp::_["gradient"] = Rcpp::wrap(G));
+}
 
-  std::vector<int> last_vec;
-  int last_event = nevent - 1, first_size = _first.size();
-  for (int i = 0; i < first_size; ++i) {
-    int f = _first(first_size - i - 1);
-    last_vec.push_back(last_event);
-    // immediately following a last event, `first` will agree with np.arange
-    if (f - (nevent - 1 - i) == 0) {
-      last_event = f - 1;
-    }
-  }
-  Eigen::VectorXi last = Eigen::Map<Eigen::VectorXi>(last_vec.data(), last_vec.size());  
+// [[Rcpp::export(.finegray_dev)]]
+double finegray_dev_R(const EIGEN_REF<Eigen::VectorXd> eta,
+		      const EIGEN_REF<Eigen::VectorXd> sample_weight,
+		      const EIGEN_REF<Eigen::VectorXd> exp_w,
+		      const EIGEN_REF<Eigen::VectorXi> competing,
+		      const EIGEN_REF<Eigen::VectorXd> event,
+		      SEXP event_order,
+		      SEXP start_order,
+		      const EIGEN_REF<Eigen::VectorXi> status,
+		      SEXP first,
+		      SEXP last,
+		      const EIGEN_REF<Eigen::VectorXd> scaling,
+		      double loglik_sat,
+		      EIGEN_REF<Eigen::VectorXd> T_1_term,
+		      EIGEN_REF<Eigen::VectorXd> T_2_term,
+		      EIGEN_REF<Eigen::VectorXd> grad_buffer,
+		      EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+		      EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+		      EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+		      BUFFER_LIST event_reorder_buffers,
+		      BUFFER_LIST risk_sum_buffers,
+		      BUFFER_LIST forward_cumsum_buffers,
+		      EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		      BUFFER_LIST reverse_cumsum_buffers,
+		      bool efron)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return finegray_dev_buffers<IndexType, double>(eta, sample_weight, exp_w, competing, event,
+								  R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+								  R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+								  loglik_sat, T_1_term, T_2_term, grad_buffer,
+								  diag_hessian_buffer, diag_part_buffer, w_avg_buffer,
+								  event_reorder_buffers, risk_sum_buffers, forward_cumsum_buffers,
+								  forward_scratch_buffer, reverse_cumsum_buffers, efron));
+}
 
-  int last_size = last.size();
-  Eigen::VectorXi _last(last_size);
-  // Now reverse last into _last
-  for (int i = 0; i < _last.size(); ++i) {
-    _last(i) = last_vec[last_size - i - 1];
-  }
+// [[Rcpp::export(.finegray_hessian_matvec)]]
+HESSIAN_MATVEC_TYPE finegray_hessian_matvec_R(const EIGEN_REF<Eigen::VectorXd> arg,
+					      const EIGEN_REF<Eigen::VectorXi> competing,
+					      const EIGEN_REF<Eigen::VectorXd> exp_w,
+					      const EIGEN_REF<Eigen::VectorXd> diag_part,
+					      const EIGEN_REF<Eigen::VectorXd> w_avg,
+					      const EIGEN_REF<Eigen::VectorXd> risk_sums,
+					      const EIGEN_REF<Eigen::VectorXd> G_minus,
+					      SEXP event_order,
+					      SEXP start_order,
+					      const EIGEN_REF<Eigen::VectorXi> status,
+					      SEXP first,
+					      SEXP last,
+					      const EIGEN_REF<Eigen::VectorXd> scaling,
+					      BUFFER_LIST risk_sum_buffers,
+					      BUFFER_LIST forward_cumsum_buffers,
+					      EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+					      BUFFER_LIST reverse_cumsum_buffers,
+					      EIGEN_REF<Eigen::VectorXd> hess_matvec_buffer,
+					      bool efron)
+{
+  R_INDEX_DISPATCH(event_order,
+		   return finegray_hessian_matvec_buffers<IndexType, double>(arg, competing, exp_w, diag_part, w_avg,
+									     risk_sums, G_minus,
+									     R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+									     status, R_INDEX_MAP(first), R_INDEX_MAP(last),
+									     scaling, risk_sum_buffers, forward_cumsum_buffers,
+									     forward_scratch_buffer, reverse_cumsum_buffers,
+									     hess_matvec_buffer, efron));
+}
 
-  Eigen::VectorXd _scaling(nevent);
-  for (int i = 0; i < nevent; ++i) {
-    double fi = (double) _first(i);
-    _scaling(i) = ((double) i - fi) / ((double) _last(i) + 1.0 - fi);
-  }
+// start_event: the start times in event order, empty without them; pi_sum
+// and pi2_sum come back in event order
+// [[Rcpp::export(.exact_partial_likelihood)]]
+Rcpp::List exact_partial_likelihood_R(const EIGEN_REF<Eigen::VectorXd> eta,
+				      const EIGEN_REF<Eigen::VectorXd> sample_weight,
+				      const EIGEN_REF<Eigen::VectorXd> event,
+				      const EIGEN_REF<Eigen::VectorXd> start_event,
+				      SEXP event_order,
+				      const EIGEN_REF<Eigen::VectorXi> status,
+				      SEXP first,
+				      SEXP last,
+				      bool have_start_times)
+{
+  const Eigen::Index n = status.size();
+  Eigen::VectorXd loglik = Eigen::VectorXd::Zero(2), pi_sum = Eigen::VectorXd::Zero(n),
+    pi2_sum = Eigen::VectorXd::Zero(n);
+  R_INDEX_DISPATCH(event_order,
+		   exact_partial_likelihood_buffers<IndexType, double>(eta, sample_weight, 0, n, event, start_event,
+								       R_INDEX_MAP(event_order), status,
+								       R_INDEX_MAP(first), R_INDEX_MAP(last),
+								       loglik, pi_sum, pi2_sum, have_start_times));
+  return Rcpp::List::create(Rcpp::_["loglik_sat"] = loglik(0),
+			    Rcpp::_["loglik"] = loglik(1),
+			    Rcpp::_["pi_sum"] = Rcpp::wrap(pi_sum),
+			    Rcpp::_["pi2_sum"] = Rcpp::wrap(pi2_sum));
+}
 
-  // This is just a check
-  bool check_ok = true;
-  for (int i = 0; (i < _first.size()) && (check_ok); ++i) {
-    check_ok = (_first[_start_map[i]] == _start_map[i]);
+// Subsampled risk sets of all the tie blocks, their derivatives' entries
+// summed into gradient and diag_hessian (native order).
+template <typename IndexType>
+void sampled_cox_dev_summed(const InputVector<double> eta,
+			    double center,
+			    const InputVector<double> sample_weight,
+			    Eigen::Index n_controls,
+			    std::uint64_t seed,
+			    const EIGEN_REF<Eigen::VectorXd> event,
+			    const EIGEN_REF<Eigen::VectorXd> start_event,
+			    const EIGEN_REF<IndexVector<IndexType>> event_order,
+			    const EIGEN_REF<Eigen::VectorXi> status,
+			    const EIGEN_REF<IndexVector<IndexType>> first,
+			    const EIGEN_REF<IndexVector<IndexType>> last,
+			    const EIGEN_REF<Eigen::VectorXd> scaling,
+			    coxdev::VectorRef loglik,
+			    coxdev::VectorRef gradient,
+			    coxdev::VectorRef diag_hessian,
+			    bool have_start_times,
+			    bool efron)
+{
+  Eigen::Map<const IndexVector<IndexType> > no_map(nullptr, 0);
+  coxdev::CoxDesign<IndexType> design{event_order, no_map, first, last, no_map, no_map,
+      status, scaling, have_start_times, efron};
+  const Eigen::Index n = status.size();
+  const Eigen::Index size = coxdev::sampled_entries<IndexType>(design, n_controls, 0, n);
+  IndexVector<IndexType> row(size);
+  Eigen::VectorXd G(size), H(size);
+  const Eigen::Index entries =
+    coxdev::sampled_cox_dev<IndexType, double>(design, event, start_event, eta, center, sample_weight,
+					       n_controls, seed, 0, n, loglik, row, G, H);
+  for (Eigen::Index e = 0; e < entries; ++e) {
+    gradient(row(e)) += G(e);
+    diag_hessian(row(e)) += H(e);
   }
-  if (!check_ok) {
-    ERROR_MSG("first_start disagrees with start_map");
+}
+
+// start_event: the start times in event order, empty without them; eta -
+// center is the centered linear predictor
+// [[Rcpp::export(.sampled_cox_dev)]]
+Rcpp::List sampled_cox_dev_R(const EIGEN_REF<Eigen::VectorXd> eta,
+			     double center,
+			     const EIGEN_REF<Eigen::VectorXd> sample_weight,
+			     int n_controls,
+			     double seed,
+			     const EIGEN_REF<Eigen::VectorXd> event,
+			     const EIGEN_REF<Eigen::VectorXd> start_event,
+			     SEXP event_order,
+			     const EIGEN_REF<Eigen::VectorXi> status,
+			     SEXP first,
+			     SEXP last,
+			     const EIGEN_REF<Eigen::VectorXd> scaling,
+			     bool have_start_times,
+			     bool efron)
+{
+  const Eigen::Index n = status.size();
+  Eigen::VectorXd loglik = Eigen::VectorXd::Zero(3), G = Eigen::VectorXd::Zero(n), H = Eigen::VectorXd::Zero(n);
+  // R has no unsigned 64 bit type; seeds are whole numbers below 2^53
+  R_INDEX_DISPATCH(event_order,
+		   sampled_cox_dev_summed<IndexType>(eta, center, sample_weight, n_controls,
+						     static_cast<std::uint64_t>(seed), event, start_event,
+						     R_INDEX_MAP(event_order), status, R_INDEX_MAP(first),
+						     R_INDEX_MAP(last), scaling, loglik, G, H,
+						     have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["loglik_sat"] = loglik(0),
+			    Rcpp::_["loglik"] = loglik(1),
+			    Rcpp::_["loglik_variance"] = loglik(2),
+			    Rcpp::_["gradient"] = Rcpp::wrap(G),
+			    Rcpp::_["diag_hessian"] = Rcpp::wrap(H));
+}
+
+// The outcome arrays, as matrices, of the n x K event and status, with start
+// n x 0 or the n x 1 start times all outcomes share.
+template <typename IndexType>
+Rcpp::List preprocess_outcomes_copy(const EIGEN_REF<Eigen::MatrixXd> start,
+				    const EIGEN_REF<Eigen::MatrixXd> event,
+				    const EIGEN_REF<Eigen::MatrixXi> status,
+				    bool efron)
+{
+  const Eigen::Index n = event.rows(), K = event.cols(), K_start = start.cols() > 0 ? K : 0;
+  coxdev::IndexMatrix<IndexType> event_order(n, K), start_order(n, K_start), first(n, K), last(n, K),
+    event_map(n, K_start), start_map(n, K_start);
+  Eigen::MatrixXi status_out(n, K);
+  Eigen::MatrixXd scaling(n, K);
+  Eigen::VectorXi efron_out(K);
+  coxdev::OutcomeArrays<IndexType> out{event_order, start_order, first, last, event_map, start_map,
+      status_out, scaling, efron_out};
+  coxdev::preprocess_outcomes<IndexType>(start, event, status, efron, 0, K, out);
+  return Rcpp::List::create(Rcpp::_["event_order"] = r_index_wrap(event_order),
+			    Rcpp::_["start_order"] = r_index_wrap(start_order),
+			    Rcpp::_["first"] = r_index_wrap(first),
+			    Rcpp::_["last"] = r_index_wrap(last),
+			    Rcpp::_["event_map"] = r_index_wrap(event_map),
+			    Rcpp::_["start_map"] = r_index_wrap(start_map),
+			    Rcpp::_["status"] = Rcpp::wrap(status_out),
+			    Rcpp::_["scaling"] = Rcpp::wrap(scaling),
+			    Rcpp::_["efron"] = Rcpp::wrap(efron_out));
+}
+
+// [[Rcpp::export(.preprocess_outcomes)]]
+Rcpp::List preprocess_outcomes_R(const EIGEN_REF<Eigen::MatrixXd> start,
+				 const EIGEN_REF<Eigen::MatrixXd> event,
+				 const EIGEN_REF<Eigen::MatrixXi> status,
+				 bool efron,
+				 bool use_int64 = false)
+{
+  if (!use_int64 && use_int32_index(event.rows())) {
+    return preprocess_outcomes_copy<int32_t>(start, event, status, efron);
   }
-  
-#ifdef PY_INTERFACE
-  py::dict preproc;
-  preproc["start"] = _start;
-  preproc["event"] = _event;
-  preproc["first"] = _first;
-  preproc["last"] = _last;
-  preproc["scaling"] = _scaling;
-  preproc["start_map"] = _start_map;
-  preproc["event_map"] = _event_map;
-  preproc["status"] = _status;
-  
-  return std::make_tuple(preproc, event_order, start_order);
-#endif
-#ifdef R_INTERFACE
-  Rcpp::List preproc = Rcpp::List::create(
-					  Rcpp::_["start"] = Rcpp::wrap(_start),
-					  Rcpp::_["event"] = Rcpp::wrap(_event),
-					  Rcpp::_["first"] = Rcpp::wrap(_first),
-					  Rcpp::_["last"] = Rcpp::wrap(_last),
-					  Rcpp::_["scaling"] = Rcpp::wrap(_scaling),
-					  Rcpp::_["start_map"] = Rcpp::wrap(_start_map),
-					  Rcpp::_["event_map"] = Rcpp::wrap(_event_map),
-					  Rcpp::_["status"] = Rcpp::wrap(_status)
-					  );
-  return(Rcpp::List::create(
-			    Rcpp::_["preproc"] = preproc,
-			    Rcpp::_["event_order"] = Rcpp::wrap(event_order),
-			    Rcpp::_["start_order"] = Rcpp::wrap(start_order)));
-#endif
+  return preprocess_outcomes_copy<int64_t>(start, event, status, efron);
+}
+
+// An index matrix of .preprocess_outcomes, n x cols.
+#define R_INDEX_MATRIX(X, cols) Eigen::Map<coxdev::IndexMatrix<IndexType>>(R_INDEX_MAP(X).data(), n, cols)
+
+// outcomes as from .preprocess_outcomes, eta centered and X n x 0 unless
+// X' times the gradients is wanted
+// [[Rcpp::export(.outcome_deviances)]]
+Rcpp::List outcome_deviances_R(Rcpp::List outcomes,
+			       const EIGEN_REF<Eigen::VectorXd> eta,
+			       const EIGEN_REF<Eigen::VectorXd> sample_weight,
+			       const EIGEN_REF<Eigen::MatrixXd> X,
+			       bool gradient,
+			       bool have_start_times)
+{
+  Eigen::Map<Eigen::MatrixXi> status = Rcpp::as<Eigen::Map<Eigen::MatrixXi> >(outcomes["status"]);
+  const Eigen::Index n = status.rows(), K = status.cols(), K_start = have_start_times ? K : 0;
+  Eigen::VectorXd loglik_sat(K), deviance(K);
+  Eigen::MatrixXd G(gradient ? n : 0, gradient ? K : 0), XG(X.cols(), X.cols() > 0 ? K : 0);
+  SEXP event_order = outcomes["event_order"], start_order = outcomes["start_order"], first = outcomes["first"],
+    last = outcomes["last"], event_map = outcomes["event_map"], start_map = outcomes["start_map"];
+  R_INDEX_DISPATCH(event_order,
+		   outcome_deviances_buffers<IndexType, double>(eta, sample_weight, X, 0, K,
+								R_INDEX_MATRIX(event_order, K),
+								R_INDEX_MATRIX(start_order, K_start),
+								R_INDEX_MATRIX(first, K), R_INDEX_MATRIX(last, K),
+								R_INDEX_MATRIX(event_map, K_start),
+								R_INDEX_MATRIX(start_map, K_start), status,
+								Rcpp::as<Eigen::Map<Eigen::MatrixXd> >(outcomes["scaling"]),
+								Rcpp::as<Eigen::Map<Eigen::VectorXi> >(outcomes["efron"]),
+								loglik_sat, deviance, G, XG, have_start_times));
+  return Rcpp::List::create(Rcpp::_["deviance"] = Rcpp::wrap(deviance),
+			    Rcpp::_["loglik_sat"] = Rcpp::wrap(loglik_sat),
+			    Rcpp::_["gradient"] = Rcpp::wrap(G),
+			    Rcpp::_["X_gradient"] = Rcpp::wrap(XG));
+}
 
+// rows and columns are 0 based, with the storage of the indices
+// [[Rcpp::export(.information_matrix)]]
+Eigen::MatrixXd information_matrix_R(SEXP rows,
+				     int n_rows,
+				     SEXP columns,
+				     int n_columns,
+				     EIGEN_REF<Eigen::VectorXd> exp_w,
+				     SEXP event_order,
+				     SEXP start_order,
+				     const EIGEN_REF<Eigen::VectorXi> status,
+				     SEXP first,
+				     SEXP last,
+				     const EIGEN_REF<Eigen::VectorXd> scaling,
+				     SEXP event_map,
+				     SEXP start_map,
+				     EIGEN_REF<Eigen::VectorXd> diag_part,
+				     EIGEN_REF<Eigen::VectorXd> w_avg,
+				     Rcpp::List risk_sum_buffers,
+				     Rcpp::List forward_cumsum_buffers,
+				     EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+				     bool have_start_times,
+				     bool efron)
+{
+  Eigen::MatrixXd out(n_rows, n_columns);
+  R_INDEX_DISPATCH(event_order,
+		   information_matrix_buffers<IndexType>(R_INDEX_MAP(rows), R_INDEX_MAP(columns), 0, out.cols(),
+							 exp_w, R_INDEX_MAP(event_order), R_INDEX_MAP(start_order),
+							 status, R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+							 R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+							 diag_part, w_avg, risk_sum_buffers, forward_cumsum_buffers,
+							 forward_scratch_buffer, out, have_start_times, efron));
+  return out;
 }
 
+// [[Rcpp::export(.bootstrap)]]
+Rcpp::List bootstrap_R(const InputVector<double> eta,
+		       const InputVector<double> sample_weight,
+		       const EIGEN_REF<Eigen::MatrixXd> X,
+		       bool bayesian,
+		       double seed,
+		       int n_replicates,
+		       EIGEN_REF<Eigen::VectorXd> exp_w,
+		       SEXP event_order,
+		       SEXP start_order,
+		       const EIGEN_REF<Eigen::VectorXi> status,
+		       SEXP first,
+		       SEXP last,
+		       const EIGEN_REF<Eigen::VectorXd> scaling,
+		       SEXP event_map,
+		       SEXP start_map,
+		       EIGEN_REF<Eigen::VectorXd> T_1_term,
+		       EIGEN_REF<Eigen::VectorXd> T_2_term,
+		       EIGEN_REF<Eigen::VectorXd> grad_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_hessian_buffer,
+		       EIGEN_REF<Eigen::VectorXd> diag_part_buffer,
+		       EIGEN_REF<Eigen::VectorXd> w_avg_buffer,
+		       Rcpp::List event_reorder_buffers,
+		       Rcpp::List risk_sum_buffers,
+		       Rcpp::List forward_cumsum_buffers,
+		       EIGEN_REF<Eigen::VectorXd> forward_scratch_buffer,
+		       Rcpp::List reverse_cumsum_buffers,
+		       bool have_start_times,
+		       bool efron)
+{
+  // R has no unsigned 64 bit type; seeds are whole numbers below 2^53
+  Eigen::VectorXd deviance(n_replicates);
+  Eigen::MatrixXd X_gradient(X.size() > 0 ? X.cols() : 0, X.size() > 0 ? n_replicates : 0);
+  R_INDEX_DISPATCH(event_order,
+		   bootstrap_buffers<IndexType, double>(eta, sample_weight, X, bayesian,
+							static_cast<std::uint64_t>(seed), 0, n_replicates, exp_w,
+							R_INDEX_MAP(event_order), R_INDEX_MAP(start_order), status,
+							R_INDEX_MAP(first), R_INDEX_MAP(last), scaling,
+							R_INDEX_MAP(event_map), R_INDEX_MAP(start_map),
+							T_1_term, T_2_term, grad_buffer, diag_hessian_buffer,
+							diag_part_buffer, w_avg_buffer, event_reorder_buffers,
+							risk_sum_buffers, forward_cumsum_buffers, forward_scratch_buffer,
+							reverse_cumsum_buffers, deviance, X_gradient,
+							have_start_times, efron));
+  return Rcpp::List::create(Rcpp::_["deviance"] = Rcpp::wrap(deviance),
+			    Rcpp::_["X_gradient"] = Rcpp::wrap(X_gradient));
+}
+
+// [[Rcpp::export(.bootstrap_weights)]]
+Eigen::VectorXd bootstrap_weights_R(int n, bool bayesian, double seed, double replicate)
+{
+  Eigen::VectorXd weight(n);
+  coxdev::bootstrap_weights(bayesian, static_cast<std::uint64_t>(seed),
+			    static_cast<std::uint64_t>(replicate), weight);
+  return weight;
+}
+
+#endif
 
 #ifdef PY_INTERFACE
+// Survival curves of the baseline (time, cumhaz) at the query times, one row
+// per eta, written to the C ordered out; callers split the rows between threads.
+template <typename ValueType>
+void survival_buffer(const EIGEN_REF<Eigen::VectorXd> time,
+		     const EIGEN_REF<Eigen::VectorXd> cumhaz,
+		     const InputVector<ValueType> eta,
+		     const EIGEN_REF<Eigen::VectorXd> query,
+		     Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> > out)
+{
+  coxdev::survival_curves<ValueType>(time, cumhaz, eta, query, out);
+}
+
 // pybind11 module stuff
+// Functions taking index vectors are registered for int32 and int64 indices,
+// and those reading caller data (eta, weights, arg) for float64 and float32
+// (score_screen also for int8 dosages); pybind11 picks the overload matching the dtypes of the arrays passed in.
+// Anything else falls through to the first (double) overload with a copy.
+// None of the kernels touch python objects once their arguments are mapped, so the
+// interpreter lock is released while they run: through call_guard for those with
+// only array arguments, after mapping the buffer lists for the others.
 PYBIND11_MODULE(coxc, m) {
+  typedef py::call_guard<py::gil_scoped_release> release_gil;
   m.doc() = "Cumsum implementations";
-  m.def("forward_cumsum", &forward_cumsum, "Cumsum a vector");
-  m.def("reverse_cumsums", &reverse_cumsums, "Reversed cumsum a vector");
-  m.def("to_native_from_event", &to_native_from_event, "To Native from event");
-  m.def("to_event_from_native", &to_event_from_native, "To Event from native");
-  m.def("forward_prework", &forward_prework, "Cumsums of scaled and weighted quantities");
-  m.def("compute_sat_loglik", &compute_sat_loglik, "Compute saturated log likelihood");
-  m.def("cox_dev", &cox_dev, "Compute Cox deviance");
-  m.def("hessian_matvec", &hessian_matvec, "Hessian Matrix Vector");
-  m.def("c_preprocess", &preprocess, "C Preprocessing");
-  
+  m.def("forward_cumsum", &forward_cumsum, "Cumsum a vector", release_gil());
+  m.def("reverse_cumsums", &reverse_cumsums<int32_t>, "Reversed cumsum a vector", release_gil());
+  m.def("reverse_cumsums", &reverse_cumsums<int64_t>, "Reversed cumsum a vector", release_gil());
+  m.def("to_native_from_event", &to_native_from_event<int32_t>, "To Native from event", release_gil());
+  m.def("to_native_from_event", &to_native_from_event<int64_t>, "To Native from event", release_gil());
+  m.def("to_event_from_native", &to_event_from_native<int32_t, double>, "To Event from native", release_gil());
+  m.def("to_event_from_native", &to_event_from_native<int64_t, double>, "To Event from native", release_gil());
+  m.def("forward_prework", &forward_prework, "Cumsums of scaled and weighted quantities", release_gil());
+  m.def("compute_sat_loglik", &compute_sat_loglik<int32_t, double>, "Compute saturated log likelihood", release_gil());
+  m.def("compute_sat_loglik", &compute_sat_loglik<int64_t, double>, "Compute saturated log likelihood", release_gil());
+  m.def("compute_sat_loglik", &compute_sat_loglik<int32_t, float>, "Compute saturated log likelihood", release_gil());
+  m.def("compute_sat_loglik", &compute_sat_loglik<int64_t, float>, "Compute saturated log likelihood", release_gil());
+  m.def("cox_dev", &cox_dev_buffers<int32_t, double>, "Compute Cox deviance");
+  m.def("cox_dev", &cox_dev_buffers<int64_t, double>, "Compute Cox deviance");
+  m.def("cox_dev", &cox_dev_buffers<int32_t, float>, "Compute Cox deviance");
+  m.def("cox_dev", &cox_dev_buffers<int64_t, float>, "Compute Cox deviance");
+  m.def("hessian_matvec", &hessian_matvec_buffers<int32_t, double>, "Hessian Matrix Vector");
+  m.def("hessian_matvec", &hessian_matvec_buffers<int64_t, double>, "Hessian Matrix Vector");
+  m.def("hessian_matvec", &hessian_matvec_buffers<int32_t, float>, "Hessian Matrix Vector");
+  m.def("hessian_matvec", &hessian_matvec_buffers<int64_t, float>, "Hessian Matrix Vector");
+  m.def("concordance", &concordance_counts<int32_t, double>, "Weighted concordant, discordant and tied pairs", release_gil());
+  m.def("concordance", &concordance_counts<int64_t, double>, "Weighted concordant, discordant and tied pairs", release_gil());
+  m.def("concordance", &concordance_counts<int32_t, float>, "Weighted concordant, discordant and tied pairs", release_gil());
+  m.def("concordance", &concordance_counts<int64_t, float>, "Weighted concordant, discordant and tied pairs", release_gil());
+  m.def("baseline_hazard", &baseline_hazard_buffers<int32_t>, "Baseline cumulative hazard on the event times", release_gil());
+  m.def("baseline_hazard", &baseline_hazard_buffers<int64_t>, "Baseline cumulative hazard on the event times", release_gil());
+  m.def("survival", &survival_buffer<double>, "Survival curves of a baseline hazard", release_gil());
+  m.def("survival", &survival_buffer<float>, "Survival curves of a baseline hazard", release_gil());
+  m.def("martingale_residuals", &martingale_residuals_buffers<int32_t>, "Martingale and deviance residuals", release_gil());
+  m.def("martingale_residuals", &martingale_residuals_buffers<int64_t>, "Martingale and deviance residuals", release_gil());
+  m.def("score_residuals", &score_residuals_buffers<int32_t, double>, "Score and Schoenfeld residuals");
+  m.def("score_residuals", &score_residuals_buffers<int64_t, double>, "Score and Schoenfeld residuals");
+  m.def("score_residuals", &score_residuals_buffers<int32_t, float>, "Score and Schoenfeld residuals");
+  m.def("score_residuals", &score_residuals_buffers<int64_t, float>, "Score and Schoenfeld residuals");
+  m.def("cluster_scores", &cluster_scores_buffers<int32_t, double>, "Per cluster score sums and information columns");
+  m.def("cluster_scores", &cluster_scores_buffers<int64_t, double>, "Per cluster score sums and information columns");
+  m.def("cluster_scores", &cluster_scores_buffers<int32_t, float>, "Per cluster score sums and information columns");
+  m.def("cluster_scores", &cluster_scores_buffers<int64_t, float>, "Per cluster score sums and information columns");
+  m.def("information_matrix", &information_matrix_buffers<int32_t>, "Block of the dense information matrix");
+  m.def("information_matrix", &information_matrix_buffers<int64_t>, "Block of the dense information matrix");
+  m.def("bootstrap", &bootstrap_buffers<int32_t, double>, "Deviances of bootstrap replicates");
+  m.def("bootstrap", &bootstrap_buffers<int64_t, double>, "Deviances of bootstrap replicates");
+  m.def("bootstrap", &bootstrap_buffers<int32_t, float>, "Deviances of bootstrap replicates");
+  m.def("bootstrap", &bootstrap_buffers<int64_t, float>, "Deviances of bootstrap replicates");
+  m.def("freeze_screening", &freeze_screening_buffers<int32_t, double>, "Null model state of a score screen");
+  m.def("freeze_screening", &freeze_screening_buffers<int64_t, double>, "Null model state of a score screen");
+  m.def("freeze_screening", &freeze_screening_buffers<int32_t, float>, "Null model state of a score screen");
+  m.def("freeze_screening", &freeze_screening_buffers<int64_t, float>, "Null model state of a score screen");
+  m.def("score_screen", &score_screen_buffers<int32_t, double>, "Score tests of candidate columns", release_gil());
+  m.def("score_screen", &score_screen_buffers<int64_t, double>, "Score tests of candidate columns", release_gil());
+  m.def("score_screen", &score_screen_buffers<int32_t, float>, "Score tests of candidate columns", release_gil());
+  m.def("score_screen", &score_screen_buffers<int64_t, float>, "Score tests of candidate columns", release_gil());
+  m.def("score_screen", &score_screen_buffers<int32_t, int8_t>, "Score tests of candidate columns", release_gil());
+  m.def("score_screen", &score_screen_buffers<int64_t, int8_t>, "Score tests of candidate columns", release_gil());
+  m.def("horizon_sweep", &horizon_sweep_buffers<int32_t>, "Deviances censored at many horizons");
+  m.def("horizon_sweep", &horizon_sweep_buffers<int64_t>, "Deviances censored at many horizons");
+  m.def("preprocess_outcomes", &preprocess_outcomes_buffers<int32_t>, "Preprocess a range of outcomes", release_gil());
+  m.def("preprocess_outcomes", &preprocess_outcomes_buffers<int64_t>, "Preprocess a range of outcomes", release_gil());
+  m.def("landmark_deviances", &landmark_deviances_buffers<int32_t, double>, "Deviances of landmark copies", release_gil());
+  m.def("landmark_deviances", &landmark_deviances_buffers<int64_t, double>, "Deviances of landmark copies", release_gil());
+  m.def("landmark_deviances", &landmark_deviances_buffers<int32_t, float>, "Deviances of landmark copies", release_gil());
+  m.def("landmark_deviances", &landmark_deviances_buffers<int64_t, float>, "Deviances of landmark copies", release_gil());
+  m.def("finegray_dev", &finegray_dev_buffers<int32_t, double>, "Compute Fine-Gray deviance");
+  m.def("finegray_dev", &finegray_dev_buffers<int64_t, double>, "Compute Fine-Gray deviance");
+  m.def("finegray_dev", &finegray_dev_buffers<int32_t, float>, "Compute Fine-Gray deviance");
+  m.def("finegray_dev", &finegray_dev_buffers<int64_t, float>, "Compute Fine-Gray deviance");
+  m.def("finegray_hessian_matvec", &finegray_hessian_matvec_buffers<int32_t, double>, "Fine-Gray Hessian Matrix Vector");
+  m.def("finegray_hessian_matvec", &finegray_hessian_matvec_buffers<int64_t, double>, "Fine-Gray Hessian Matrix Vector");
+  m.def("finegray_hessian_matvec", &finegray_hessian_matvec_buffers<int32_t, float>, "Fine-Gray Hessian Matrix Vector");
+  m.def("finegray_hessian_matvec", &finegray_hessian_matvec_buffers<int64_t, float>, "Fine-Gray Hessian Matrix Vector");
+  m.def("exact_partial_likelihood", &exact_partial_likelihood_buffers<int32_t, double>, "Exact partial likelihood of tie blocks", release_gil());
+  m.def("exact_partial_likelihood", &exact_partial_likelihood_buffers<int64_t, double>, "Exact partial likelihood of tie blocks", release_gil());
+  m.def("exact_partial_likelihood", &exact_partial_likelihood_buffers<int32_t, float>, "Exact partial likelihood of tie blocks", release_gil());
+  m.def("exact_partial_likelihood", &exact_partial_likelihood_buffers<int64_t, float>, "Exact partial likelihood of tie blocks", release_gil());
+  m.def("sampled_cox_dev", &sampled_cox_dev_buffers<int32_t, double>, "Deviance from subsampled risk sets", release_gil());
+  m.def("sampled_cox_dev", &sampled_cox_dev_buffers<int64_t, double>, "Deviance from subsampled risk sets", release_gil());
+  m.def("sampled_cox_dev", &sampled_cox_dev_buffers<int32_t, float>, "Deviance from subsampled risk sets", release_gil());
+  m.def("sampled_cox_dev", &sampled_cox_dev_buffers<int64_t, float>, "Deviance from subsampled risk sets", release_gil());
+  m.def("outcome_deviances", &outcome_deviances_buffers<int32_t, double>, "Deviances of a range of outcomes", release_gil());
+  m.def("outcome_deviances", &outcome_deviances_buffers<int64_t, double>, "Deviances of a range of outcomes", release_gil());
+  m.def("outcome_deviances", &outcome_deviances_buffers<int32_t, float>, "Deviances of a range of outcomes", release_gil());
+  m.def("outcome_deviances", &outcome_deviances_buffers<int64_t, float>, "Deviances of a range of outcomes", release_gil());
+  m.def("bootstrap_weights", &coxdev::bootstrap_weights, "Weights of a bootstrap replicate", release_gil());
+  m.def("append_rows", &append_rows_buffers<int32_t>, "Append rows to preprocessed arrays in place");
+  m.def("append_rows", &append_rows_buffers<int64_t>, "Append rows to preprocessed arrays in place");
+  m.def("c_preprocess", &c_preprocess, "C Preprocessing",
+	py::arg("start"), py::arg("event"), py::arg("status"), py::arg("use_int64") = false);
+  m.def("set_stats_enabled", &set_stats_enabled,
+	"Turn per-phase timing counters on or off, returning the previous setting");
+  m.def("stats", &stats, "Per-phase seconds, calls and bytes, and buffer list remaps");
+  m.def("reset_stats", &reset_stats, "Zero the per-phase counters");
+  m.def("allocation_count", &allocation_count,
+	"Heap allocations made inside the kernels, -1 unless built with COXDEV_COUNT_ALLOCATIONS");
 }
 #endif
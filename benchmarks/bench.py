@@ -0,0 +1,189 @@
+"""
+Macro benchmarks of the coxdev python package on synthetic data.
+
+Every combination of the settings below is run in a fresh python process,
+so the reported peak resident set size is that of one configuration. One
+JSON object is written per line and kernel::
+
+    python benchmarks/bench.py --n 1e3 1e4 1e5 1e6 --ties 0 0.5 \\
+        --start 0 1 --tie-breaking efron breslow --strata 1 100 \\
+        --reps 5 --output python.jsonl
+
+Kernels are 'preprocess' (constructing `CoxDeviance`), 'cox_dev'
+(an evaluation), 'hessian_matvec' (one product with the information)
+and 'fit' (Newton's method on `--p` covariates), prefixed with
+'stratified_' when there is more than one stratum (`StratifiedCoxDeviance`).
+With `--baselines`, lifelines' `CoxPHFitter` (or `CoxTimeVaryingFitter`
+with start times) fits the same data as 'lifelines_fit', for Efron ties
+and n up to `--max-baseline-n`. Times are the median and minimum over
+reps, throughput is observations per second at the median.
+"""
+
+import argparse
+import itertools
+import json
+import resource
+import subprocess
+import sys
+from time import perf_counter
+
+import numpy as np
+
+
+def simulate(n, ties, start_times, strata, p, rng):
+    """
+    Synthetic cohort as in bench_core.cpp: integer event times with about
+    n * (1 - ties) distinct values (continuous when ties is 0), 70% events,
+    start times a uniform fraction of the event time, uniform strata and
+    `p` standard normal covariates.
+    """
+    distinct = max(1, round(n * (1 - ties)))
+    if ties > 0:
+        event = 1. + np.floor(rng.uniform(size=n) * distinct)
+    else:
+        event = 1. + rng.uniform(size=n) * n
+    start = event * rng.uniform(size=n) * 0.9 if start_times else None
+    status = (rng.uniform(size=n) < 0.7).astype(np.int32)
+    stratum = np.floor(rng.uniform(size=n) * strata).astype(np.int32)
+    X = rng.standard_normal((n, p))
+    return event, start, status, stratum, X
+
+
+def peak_rss_bytes():
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return rss if sys.platform == 'darwin' else rss * 1024
+
+
+def time_reps(reps, f):
+    """Median and minimum seconds of `reps` calls of `f(rep)`."""
+    seconds = []
+    for rep in range(reps):
+        tic = perf_counter()
+        f(rep)
+        seconds.append(perf_counter() - tic)
+    return np.median(seconds), np.min(seconds)
+
+
+def newton_fit(cox, X, maxiter=25, tol=1e-9):
+    """
+    Fit by Newton's method on the deviance, whose Hessian with respect to
+    the linear predictor is twice the information.
+    """
+    beta = np.zeros(X.shape[1])
+    deviance = np.inf
+    for _ in range(maxiter):
+        eta = X @ beta
+        result = cox(eta)
+        I = cox.information(eta)
+        beta = beta - np.linalg.solve(X.T @ (I @ X), X.T @ result.gradient / 2)
+        if abs(deviance - result.deviance) < tol * abs(result.deviance):
+            break
+        deviance = result.deviance
+    return beta
+
+
+def lifelines_fit(event, start, status, stratum, X, strata):
+    import pandas as pd
+    from lifelines import CoxPHFitter, CoxTimeVaryingFitter
+
+    df = pd.DataFrame(X, columns=[f'x{i}' for i in range(X.shape[1])])
+    df['event'] = event
+    df['status'] = status
+    strata_col = None
+    if strata > 1:
+        df['stratum'] = stratum
+        strata_col = ['stratum']
+    if start is None:
+        CoxPHFitter().fit(df, 'event', 'status', strata=strata_col)
+    else:
+        df['start'] = start
+        df['id'] = np.arange(df.shape[0])
+        CoxTimeVaryingFitter().fit(df, id_col='id', event_col='status',
+                                   start_col='start', stop_col='event',
+                                   strata=strata_col)
+
+
+def run(config):
+    """Benchmark one configuration, yielding a dict per kernel."""
+    from coxdev import CoxDeviance, StratifiedCoxDeviance
+
+    n, ties, start_times, tie_breaking, strata, reps, p, seed = (
+        config[k] for k in ['n', 'ties', 'start_times', 'tie_breaking',
+                            'strata', 'reps', 'p', 'seed'])
+    rng = np.random.default_rng(seed)
+    event, start, status, stratum, X = simulate(n, ties, start_times, strata, p, rng)
+    # distinct linear predictors so no evaluation is served from the cache
+    etas = [0.5 * rng.standard_normal(n) for _ in range(reps)]
+    arg = rng.standard_normal(n)
+
+    prefix = 'stratified_' if strata > 1 else ''
+
+    def record(kernel, timing):
+        median, fastest = timing
+        return dict(suite='python', kernel=prefix + kernel, **config,
+                    seconds=median, min_seconds=fastest,
+                    throughput=n / median, peak_rss_bytes=peak_rss_bytes())
+
+    holder = {}
+    def preprocess(rep):
+        if strata > 1:
+            holder['cox'] = StratifiedCoxDeviance(event=event, status=status, strata=stratum,
+                                                  start=start, tie_breaking=tie_breaking)
+        else:
+            holder['cox'] = CoxDeviance(event=event, status=status, start=start,
+                                        tie_breaking=tie_breaking)
+    yield record('preprocess', time_reps(reps, preprocess))
+    cox = holder['cox']
+
+    yield record('cox_dev', time_reps(reps, lambda rep: cox(etas[rep])))
+    I = cox.information(etas[0])
+    yield record('hessian_matvec', time_reps(reps, lambda rep: I @ arg))
+    yield record('fit', time_reps(reps, lambda rep: newton_fit(cox, X)))
+
+    if config['baselines'] and tie_breaking == 'efron' and n <= config['max_baseline_n']:
+        prefix = ''
+        yield record('lifelines_fit',
+                     time_reps(reps, lambda rep: lifelines_fit(event, start, status, stratum, X, strata)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--n', nargs='+', type=float, default=[1e3, 1e4, 1e5, 1e6])
+    parser.add_argument('--ties', nargs='+', type=float, default=[0, 0.5])
+    parser.add_argument('--start', nargs='+', type=int, default=[0, 1])
+    parser.add_argument('--tie-breaking', nargs='+', default=['efron', 'breslow'])
+    parser.add_argument('--strata', nargs='+', type=int, default=[1, 100])
+    parser.add_argument('--reps', type=int, default=5)
+    parser.add_argument('--p', type=int, default=5, help='covariates for the fits')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--baselines', action='store_true', help='also fit with lifelines')
+    parser.add_argument('--max-baseline-n', type=float, default=1e5)
+    parser.add_argument('--output', help='file to write to, default stdout')
+    parser.add_argument('--worker', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker:
+        for result in run(json.loads(args.worker)):
+            print(json.dumps(result), flush=True)
+        return
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    failed = False
+    for n, ties, start, tie_breaking, strata in itertools.product(
+            args.n, args.ties, args.start, args.tie_breaking, args.strata):
+        config = dict(n=int(n), ties=ties, start_times=bool(start),
+                      tie_breaking=tie_breaking, strata=strata, reps=args.reps,
+                      p=args.p, seed=args.seed, baselines=args.baselines,
+                      max_baseline_n=args.max_baseline_n)
+        worker = subprocess.run([sys.executable, __file__, '--worker', json.dumps(config)],
+                                stdout=subprocess.PIPE, text=True)
+        out.write(worker.stdout)
+        out.flush()
+        if worker.returncode != 0:
+            print(f'configuration {config} failed', file=sys.stderr)
+            failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,315 @@
+// Microbenchmarks of the coxdev core (coxdev_core.h) on synthetic data,
+// with the legacy kernels of src/cox_loglike.c as a baseline where they
+// apply (Breslow ties, no start times, one stratum).
+//
+// Every combination of the comma separated lists below is run in a child
+// process, so the reported peak resident set size is that of the one
+// configuration. One JSON object is written per line and kernel:
+//
+//   bench_core --n=1e3,1e4,1e5,1e6 --ties=0,0.5 --start=0,1
+//              --tie-breaking=efron,breslow --strata=1,100 --reps=5 --seed=0
+//
+// Times are the median and minimum over reps, throughput is observations
+// per second at the median.
+
+#include "coxdev_core.h"
+#include "cox_loglike.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Config {
+  int64_t n;
+  double ties;       // fraction of event times repeating an earlier one
+  bool start_times;  // left truncated
+  bool efron;
+  int strata;
+};
+
+// Synthetic cohort: integer event times with about n * (1 - ties) distinct
+// values (continuous when ties is 0), 70% events, start times a uniform
+// fraction of the event time and strata drawn uniformly.
+struct Data {
+  Eigen::VectorXd start, event, eta, arg;
+  Eigen::VectorXi status;
+  std::vector<int> stratum;
+};
+
+Data simulate(const Config & config, uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  const int64_t n = config.n;
+  const double distinct = std::max(1.0, std::round(n * (1.0 - config.ties)));
+
+  Data data;
+  data.start.resize(n); data.event.resize(n); data.eta.resize(n); data.arg.resize(n);
+  data.status.resize(n); data.stratum.resize(n);
+  for (int64_t i = 0; i < n; ++i) {
+    data.event(i) = config.ties > 0 ? 1.0 + std::floor(unif(rng) * distinct) : 1.0 + unif(rng) * n;
+    data.start(i) = data.event(i) * unif(rng) * 0.9;
+    data.status(i) = unif(rng) < 0.7;
+    data.eta(i) = 0.5 * normal(rng);
+    data.arg(i) = normal(rng);
+    data.stratum[i] = (int) (unif(rng) * config.strata);
+  }
+  return data;
+}
+
+struct Timing {
+  double median, min;
+};
+
+Timing time_reps(int reps, const std::function<void()> & f)
+{
+  std::vector<double> seconds;
+  for (int r = 0; r < reps; ++r) {
+    auto tic = std::chrono::steady_clock::now();
+    f();
+    seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - tic).count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  return Timing{seconds[seconds.size() / 2], seconds[0]};
+}
+
+long peak_rss_bytes()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024L;
+#endif
+}
+
+void report(const Config & config, const char *kernel, int reps, const Timing & t)
+{
+  std::printf("{\"suite\": \"core\", \"kernel\": \"%s\", \"n\": %lld, \"ties\": %g, "
+	      "\"start_times\": %s, \"tie_breaking\": \"%s\", \"strata\": %d, \"reps\": %d, "
+	      "\"seconds\": %.9g, \"min_seconds\": %.9g, \"throughput\": %.9g, \"peak_rss_bytes\": %ld}\n",
+	      kernel, (long long) config.n, config.ties,
+	      config.start_times ? "true" : "false", config.efron ? "efron" : "breslow",
+	      config.strata, reps, t.median, t.min, config.n / t.median, peak_rss_bytes());
+  std::fflush(stdout);
+}
+
+volatile double sink; // keeps results alive
+
+template <typename IndexType>
+void bench_single(const Config & config, const Data & data, int reps)
+{
+  const int64_t n = config.n;
+  const double *start = config.start_times ? data.start.data() : nullptr;
+  std::unique_ptr<coxdev::CoxDesignData<IndexType> > design;
+  report(config, "preprocess", reps, time_reps(reps, [&]() {
+	design.reset(new coxdev::CoxDesignData<IndexType>(n, start, data.event.data(),
+							   data.status.data(), config.efron));
+      }));
+
+  coxdev::CoxWorkspaceData work(n);
+  Eigen::VectorXd grad(n), diag_hessian(n), out(n);
+  report(config, "cox_dev", reps, time_reps(reps, [&]() {
+	sink = coxdev::deviance(*design, work, data.eta.data(), nullptr, grad.data(), diag_hessian.data());
+      }));
+  report(config, "hessian_matvec", reps, time_reps(reps, [&]() {
+	coxdev::information_matvec(*design, work, data.arg.data(), out.data());
+	sink = out(0);
+      }));
+}
+
+// As StratifiedCoxDeviance does it: one design per stratum, the linear
+// predictor and matvec argument gathered into per stratum buffers.
+template <typename IndexType>
+void bench_stratified(const Config & config, const Data & data, int reps)
+{
+  struct Stratum {
+    std::vector<int64_t> index;
+    Eigen::VectorXd start, event, eta, arg, grad, out;
+    Eigen::VectorXi status;
+    std::unique_ptr<coxdev::CoxDesignData<IndexType> > design;
+    std::unique_ptr<coxdev::CoxWorkspaceData> work;
+  };
+  std::map<int, Stratum> strata;
+  for (int64_t i = 0; i < config.n; ++i) {
+    strata[data.stratum[i]].index.push_back(i);
+  }
+  for (auto & kv : strata) {
+    Stratum & s = kv.second;
+    const Eigen::Index m = s.index.size();
+    s.start.resize(m); s.event.resize(m); s.status.resize(m);
+    s.eta.resize(m); s.arg.resize(m); s.grad.resize(m); s.out.resize(m);
+    for (Eigen::Index k = 0; k < m; ++k) {
+      s.start(k) = data.start(s.index[k]);
+      s.event(k) = data.event(s.index[k]);
+      s.status(k) = data.status(s.index[k]);
+    }
+  }
+
+  report(config, "stratified_preprocess", reps, time_reps(reps, [&]() {
+	for (auto & kv : strata) {
+	  Stratum & s = kv.second;
+	  s.design.reset(new coxdev::CoxDesignData<IndexType>(s.index.size(),
+							      config.start_times ? s.start.data() : nullptr,
+							      s.event.data(), s.status.data(), config.efron));
+	}
+      }));
+  for (auto & kv : strata) {
+    kv.second.work.reset(new coxdev::CoxWorkspaceData(kv.second.index.size()));
+  }
+
+  report(config, "stratified_cox_dev", reps, time_reps(reps, [&]() {
+	double total = 0;
+	for (auto & kv : strata) {
+	  Stratum & s = kv.second;
+	  for (size_t k = 0; k < s.index.size(); ++k) s.eta(k) = data.eta(s.index[k]);
+	  total += coxdev::deviance(*s.design, *s.work, s.eta.data(), nullptr, s.grad.data(), nullptr);
+	}
+	sink = total;
+      }));
+  Eigen::VectorXd out(config.n);
+  report(config, "stratified_hessian_matvec", reps, time_reps(reps, [&]() {
+	for (auto & kv : strata) {
+	  Stratum & s = kv.second;
+	  for (size_t k = 0; k < s.index.size(); ++k) s.arg(k) = data.arg(s.index[k]);
+	  coxdev::information_matvec(*s.design, *s.work, s.arg.data(), s.out.data());
+	  for (size_t k = 0; k < s.index.size(); ++k) out(s.index[k]) = s.out(k);
+	}
+	sink = out(0);
+      }));
+}
+
+// The kernels of src/cox_loglike.c: Breslow ties, right censored only.
+void bench_legacy(const Config & config, const Data & data, int reps)
+{
+  const size_t n = config.n;
+  std::vector<size_t> ordering(n), rankmin(n), rankmax(n), censoring(n);
+  report(config, "legacy_preprocess", reps, time_reps(reps, [&]() {
+	std::iota(ordering.begin(), ordering.end(), 0);
+	std::sort(ordering.begin(), ordering.end(),
+		  [&](size_t i, size_t j) { return data.event(i) < data.event(j); });
+	for (size_t k = 0; k < n; ) {
+	  size_t l = k;
+	  while (l + 1 < n && data.event(ordering[l + 1]) == data.event(ordering[k])) ++l;
+	  for (size_t m = k; m <= l; ++m) {
+	    rankmin[ordering[m]] = k;
+	    rankmax[ordering[m]] = l;
+	  }
+	  k = l + 1;
+	}
+	for (size_t i = 0; i < n; ++i) censoring[i] = data.status(i);
+      }));
+
+  std::vector<double> eta(data.eta.data(), data.eta.data() + n), arg(data.arg.data(), data.arg.data() + n);
+  std::vector<double> weight(n, 1.0), exp_eta(n), exp_accum(n), expZ_accum(n);
+  std::vector<double> outer_1st(n), outer_2nd(n), grad(n), out(n);
+  report(config, "legacy_cox_dev", reps, time_reps(reps, [&]() {
+	_update_cox_exp(eta.data(), exp_eta.data(), exp_accum.data(), weight.data(),
+			censoring.data(), ordering.data(), rankmin.data(), n);
+	_update_outer_1st(eta.data(), exp_accum.data(), outer_1st.data(), weight.data(),
+			  censoring.data(), ordering.data(), rankmin.data(), n);
+	sink = _cox_objective(eta.data(), exp_accum.data(), outer_1st.data(), weight.data(),
+			      censoring.data(), ordering.data(), rankmin.data(), rankmax.data(), n);
+	_cox_gradient(grad.data(), exp_eta.data(), outer_1st.data(), weight.data(),
+		      censoring.data(), ordering.data(), rankmin.data(), rankmax.data(), n);
+      }));
+  report(config, "legacy_hessian_matvec", reps, time_reps(reps, [&]() {
+	_update_cox_expZ(eta.data(), arg.data(), exp_eta.data(), expZ_accum.data(), weight.data(),
+			 censoring.data(), ordering.data(), rankmin.data(), n);
+	_update_outer_2nd(eta.data(), exp_accum.data(), expZ_accum.data(), outer_2nd.data(), weight.data(),
+			  censoring.data(), ordering.data(), rankmin.data(), n);
+	_cox_hessian(out.data(), exp_eta.data(), arg.data(), outer_1st.data(), outer_2nd.data(),
+		     weight.data(), censoring.data(), ordering.data(), rankmax.data(), n);
+	sink = out[0];
+      }));
+}
+
+void run(const Config & config, int reps, uint64_t seed)
+{
+  const Data data = simulate(config, seed);
+  const bool narrow = coxdev::use_int32_index(config.n);
+  if (config.strata > 1) {
+    narrow ? bench_stratified<int32_t>(config, data, reps) : bench_stratified<int64_t>(config, data, reps);
+  } else {
+    narrow ? bench_single<int32_t>(config, data, reps) : bench_single<int64_t>(config, data, reps);
+    if (!config.efron && !config.start_times) {
+      bench_legacy(config, data, reps);
+    }
+  }
+}
+
+std::vector<std::string> split(const std::string & s)
+{
+  std::vector<std::string> parts;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) parts.push_back(item);
+  return parts;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  std::map<std::string, std::string> options = {
+    {"n", "1e3,1e4,1e5,1e6"},
+    {"ties", "0,0.5"},
+    {"start", "0,1"},
+    {"tie-breaking", "efron,breslow"},
+    {"strata", "1,100"},
+    {"reps", "5"},
+    {"seed", "0"}
+  };
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos || options.count(arg.substr(2, eq - 2)) == 0) {
+      std::fprintf(stderr, "usage: %s [--n=..] [--ties=..] [--start=..] [--tie-breaking=..] "
+		   "[--strata=..] [--reps=..] [--seed=..]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+  }
+  const int reps = std::atoi(options["reps"].c_str());
+  const uint64_t seed = std::strtoull(options["seed"].c_str(), nullptr, 10);
+
+  int status = EXIT_SUCCESS;
+  for (const std::string & n : split(options["n"]))
+    for (const std::string & ties : split(options["ties"]))
+      for (const std::string & start : split(options["start"]))
+	for (const std::string & method : split(options["tie-breaking"]))
+	  for (const std::string & strata : split(options["strata"])) {
+	    Config config{(int64_t) std::atof(n.c_str()), std::atof(ties.c_str()),
+		start == "1", method == "efron", std::atoi(strata.c_str())};
+	    pid_t pid = fork();
+	    if (pid == 0) {
+	      run(config, reps, seed);
+	      std::_Exit(EXIT_SUCCESS);
+	    }
+	    int child;
+	    waitpid(pid, &child, 0);
+	    if (!WIFEXITED(child) || WEXITSTATUS(child) != EXIT_SUCCESS) {
+	      std::fprintf(stderr, "configuration n=%s ties=%s start=%s %s strata=%s failed\n",
+			   n.c_str(), ties.c_str(), start.c_str(), method.c_str(), strata.c_str());
+	      status = EXIT_FAILURE;
+	    }
+	  }
+  return status;
+}
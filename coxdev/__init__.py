@@ -10,6 +10,37 @@ CoxDeviance
     Standard Cox model deviance and information computation.
 StratifiedCoxDeviance
     Stratified Cox model deviance and information computation.
+ConcordanceResult
+    Harrell's or Uno's concordance with the weighted pair counts.
+BaselineHazard
+    Baseline cumulative hazard, predicting survival curves.
+CoxResiduals
+    Martingale, deviance, score and Schoenfeld residuals.
+RobustVariance
+    Cluster-robust (sandwich) variance of the coefficients.
+CoxBootstrap
+    Deviances of bootstrap replicates, weights drawn in the kernel.
+ScoreScreen
+    Score tests of candidate columns against a null model.
+HorizonSweep
+    Deviances under administrative censoring at many horizons.
+LandmarkDeviances
+    Deviances of the copies of a landmark supermodel.
+SampledDeviance
+    Approximate deviance from subsampled risk sets.
+CoxCV
+    Cross-validated partial likelihood over folds sharing one design.
+CoxMultiEndpoint
+    Deviances of many outcomes of the same subjects at one linear predictor.
+FineGrayDeviance
+    Fine-Gray subdistribution hazard deviance for competing risks.
+
+Functions
+---------
+set_stats_enabled
+    Turn per-phase instrumentation on or off.
+bootstrap_weights
+    Weights of one bootstrap replicate.
 
 See Also
 --------
@@ -17,5 +48,19 @@ coxdev.base : Core Cox model implementation.
 coxdev.stratified : Stratified Cox model implementation.
 """
 
-from .base import CoxDeviance
+from .base import (CoxDeviance,
+                   ConcordanceResult,
+                   BaselineHazard,
+                   CoxResiduals,
+                   RobustVariance,
+                   CoxBootstrap,
+                   ScoreScreen,
+                   HorizonSweep,
+                   LandmarkDeviances,
+                   SampledDeviance,
+                   bootstrap_weights,
+                   set_stats_enabled)
 from .stratified import StratifiedCoxDeviance
+from .cv import CoxCV, CoxCVResult
+from .multi import CoxMultiEndpoint, CoxMultiEndpointResult
+from .finegray import FineGrayDeviance, FineGrayInformation
@@ -6,11 +6,16 @@ and Hessian information matrices for survival analysis with support for
 different tie-breaking methods (Efron and Breslow).
 """
 
-from dataclasses import dataclass, InitVar
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from time import perf_counter
+from dataclasses import dataclass, InitVar, replace
 from typing import Literal, Optional
 # for Hessian
 
 from scipy.sparse.linalg import LinearOperator
+from scipy.stats import norm
 
 from . import _version
 __version__ = _version.get_versions()['version']
@@ -18,12 +23,298 @@ __version__ = _version.get_versions()['version']
 import numpy as np
 from joblib import hash as _hash
 
+from .shared import SharedArrays
 from .coxc import (cox_dev as _cox_dev,
                    hessian_matvec as _hessian_matvec,
                    compute_sat_loglik as _compute_sat_loglik,
-                   c_preprocess)
+                   concordance as _concordance,
+                   baseline_hazard as _baseline_hazard,
+                   survival as _survival,
+                   martingale_residuals as _martingale_residuals,
+                   score_residuals as _score_residuals,
+                   cluster_scores as _cluster_scores,
+                   information_matrix as _information_matrix,
+                   bootstrap as _bootstrap,
+                   bootstrap_weights as _bootstrap_weights,
+                   append_rows as _append_rows,
+                   freeze_screening as _freeze_screening,
+                   score_screen as _score_screen,
+                   horizon_sweep as _horizon_sweep,
+                   landmark_deviances as _landmark_deviances,
+                   exact_partial_likelihood as _exact_partial_likelihood,
+                   sampled_cox_dev as _sampled_cox_dev,
+                   c_preprocess,
+                   set_stats_enabled as _set_stats_enabled,
+                   stats as _compiled_stats,
+                   reset_stats as _reset_compiled_stats)
+
+_stats_enabled = False
+
+def set_stats_enabled(enabled=True):
+    """
+    Turn per-phase instrumentation on or off.
+
+    While enabled, the compiled routines and the python wrappers record
+    wall clock time, calls and approximate bytes touched for each phase
+    of an evaluation; see `CoxDeviance.stats`. Disabled, the cost is a
+    flag check per phase.
+
+    Parameters
+    ----------
+    enabled : bool
+        Whether to record.
+
+    Returns
+    -------
+    bool
+        The previous setting.
+    """
+    global _stats_enabled
+    previous = _stats_enabled
+    _stats_enabled = bool(enabled)
+    _set_stats_enabled(_stats_enabled)
+    return previous
+
+
+class _PhaseStats(object):
+    """Counters for the phases run in python, in the layout of `coxc.stats`."""
+
+    def __init__(self, phases):
+        self._phases = phases
+        self.reset()
+
+    def reset(self):
+        self._counts = {phase: dict(seconds=0., calls=0, bytes=0) for phase in self._phases}
+
+    def add(self, phase, tic, nbytes):
+        """Record one call of `phase` started at `tic` (a `perf_counter` value)."""
+        counts = self._counts[phase]
+        counts['seconds'] += perf_counter() - tic
+        counts['calls'] += 1
+        counts['bytes'] += int(nbytes)
+
+    def merged(self):
+        """Compiled counters updated with these."""
+        stats = _compiled_stats()
+        stats.update({phase: counts.copy() for phase, counts in self._counts.items()})
+        return stats
 
     
+@dataclass(frozen=True)
+class CoxDesign(object):
+    """
+    Preprocessed survival data for one cohort.
+
+    Holds the output of the preprocessing step: the sort orders and the
+    index arrays used to form risk set sums. The compiled routines only
+    read these arrays, so one design can be shared by any number of
+    threads, each evaluating with its own `Workspace`.
+
+    Attributes
+    ----------
+    event_order, start_order : np.ndarray
+        Permutations sorting the data by event and by start time.
+    status : np.ndarray
+        Event indicators, in event order.
+    first, last : np.ndarray
+        First and last index of each tied block, in event order.
+    scaling : np.ndarray
+        Efron scaling factors, in event order.
+    event_map, start_map : np.ndarray
+        Maps between the event and start orderings.
+    have_start_times : bool
+        Whether start times were provided.
+    efron : bool
+        Whether Efron's correction is applied.
+    """
+
+    event_order: np.ndarray
+    start_order: np.ndarray
+    status: np.ndarray
+    first: np.ndarray
+    last: np.ndarray
+    scaling: np.ndarray
+    event_map: np.ndarray
+    start_map: np.ndarray
+    have_start_times: bool
+    efron: bool
+
+    @property
+    def n(self):
+        """Number of observations."""
+        return self.status.shape[0]
+
+
+class Workspace(object):
+    """
+    Scratch buffers for evaluating the deviance and information.
+
+    `CoxDeviance.__call__` fills a workspace and the `CoxInformation`
+    returned by `CoxDeviance.information` reads it back. A workspace must
+    only be used by one thread at a time; `CoxDeviance` keeps one per
+    thread, so it can be called concurrently without passing one in.
+
+    Parameters
+    ----------
+    n : int
+        Number of observations.
+    low_memory : bool, default=False
+        Let buffers no computation needs at the same time share storage,
+        16 rather than 24 rows of n doubles, with the same results. The
+        rest hold what later computations read back, except for the
+        weights in event order, which would need the weights themselves.
+    result_views : bool, default=False
+        Return the gradient and Hessian diagonal of results computed in
+        the workspace, and the products of information operators reading
+        it, as read-only views of its buffers rather than as new arrays.
+        Each output alternates between two buffers, so a result stays
+        valid through the next evaluation and is overwritten by the one
+        after.
+    """
+
+    # row of each buffer: its own, or with low_memory shared with those
+    # whose lives never overlap it (see CoxWorkspaceData in coxdev_core.h).
+    # The reverse cumsums are only live while the risk sums are formed,
+    # before forward cumsums 1 and 2 are written; forward cumsums 3 and 4
+    # are read before the diagonal Hessian and diag_part are written;
+    # exp_w in event order is read before the gradient is written, last;
+    # the centered linear predictor is dead by the time any information
+    # product writes hess_matvec.
+    _rows = ['T_1', 'T_2', 'reorder_0', 'reorder_1', 'reorder_2',
+             'forward_0', 'forward_1', 'forward_2', 'forward_3', 'forward_4',
+             'forward_scratch', 'reverse_0', 'reverse_1', 'reverse_2', 'reverse_3',
+             'risk_sum_0', 'risk_sum_1', 'hess_matvec', 'grad', 'diag_hessian',
+             'diag_part', 'w_avg', 'exp_w', 'eta']
+    _low_memory_rows = {'forward_3': 'diag_hessian',
+                        'forward_4': 'diag_part',
+                        'reorder_2': 'grad',
+                        'reverse_0': 'forward_1',
+                        'reverse_1': 'forward_2',
+                        'reverse_2': 'forward_1',
+                        'reverse_3': 'forward_2',
+                        'eta': 'hess_matvec'}
+
+    def __init__(self, n, low_memory=False, result_views=False):
+
+        self.low_memory = low_memory
+        self.result_views = result_views
+        names = self._rows
+        if low_memory:
+            names = [name for name in names if name not in self._low_memory_rows]
+        self._row = {name: row for row, name in enumerate(names)}
+        for name, shared in self._low_memory_rows.items():
+            self._row.setdefault(name, self._row[shared])
+        self._capacity = -1
+        self._resize(n)
+
+    def _resize(self, n):
+        """
+        Size the buffers for `n` observations.
+
+        The buffers are views of storage for `_capacity` observations,
+        reallocated, at least doubling, only when `n` exceeds it: a
+        cohort grown by `CoxDeviance.append` keeps its workspaces.
+        """
+        row = self._row
+        if n > self._capacity:
+            self._capacity = max(n, 2 * self._capacity)
+            # the scratch buffers (9 cumsums of length n + 1) and the
+            # centered linear predictor
+            self._storage = np.zeros((max(row.values()) + 1, self._capacity + 1))
+        self.n = n
+        vector = lambda name: self._storage[row[name]][:n]
+        cumsum = lambda name: self._storage[row[name]][:n+1]
+
+        self._T_1_term = vector('T_1')
+        self._T_2_term = vector('T_2')
+        self._event_reorder_buffers = [vector('reorder_%d' % i) for i in range(3)]
+        self._forward_cumsum_buffers = [cumsum('forward_%d' % i) for i in range(5)]
+        self._forward_scratch_buffer = vector('forward_scratch')
+        self._reverse_cumsum_buffers = [cumsum('reverse_%d' % i) for i in range(4)]
+        self._risk_sum_buffers = [vector('risk_sum_%d' % i) for i in range(2)]
+        self._hess_matvec_buffer = vector('hess_matvec')
+        self._grad_buffer = vector('grad')
+        self._diag_hessian_buffer = vector('diag_hessian')
+        self._diag_part_buffer = vector('diag_part')
+        self._w_avg_buffer = vector('w_avg')
+        self._exp_w_buffer = vector('exp_w')
+
+        # centered linear predictor, kept in the caller's floating type
+        # so it is passed to the kernels as is
+        self._eta_buffer = vector('eta')
+
+        # shorthand, for reference in hessian_matvec
+        self._event_cumsum = self._reverse_cumsum_buffers[0]
+        self._start_cumsum = self._reverse_cumsum_buffers[1]
+
+        # most recent result computed in this workspace
+        self._result = None
+
+        # pairs of output buffers with result_views, by output
+        self._views = {}
+
+        # per task outputs of the tie block kernels, by kernel
+        self._scratch_buffers = {}
+
+    @property
+    def nbytes(self):
+        """Bytes held by the buffers."""
+        nbytes = self._storage.nbytes + sum(pair[0].nbytes for pair in self._views.values())
+        nbytes += sum(buffer.nbytes for buffer in self._scratch_buffers.values())
+        # reallocated in another floating type
+        if self._eta_buffer.base is not self._storage:
+            nbytes += self._eta_buffer.nbytes
+        return nbytes
+
+    def _eta(self, dtype):
+        """Buffer for the centered linear predictor."""
+        if self._eta_buffer.dtype != dtype:
+            self._eta_buffer = np.zeros(self._eta_buffer.shape, dtype)
+        return self._eta_buffer
+
+    def _scratch(self, key, size):
+        """
+        Zeroed buffer of `size` doubles for `key`, kept, and only
+        reallocated when a later call asks for more.
+        """
+        buffer = self._scratch_buffers.get(key)
+        if buffer is None or buffer.shape[0] < size:
+            buffer = self._scratch_buffers[key] = np.empty(size)
+        buffer = buffer[:size]
+        buffer[:] = 0
+        return buffer
+
+    def _output(self, key, values, out=None, negate=False):
+        """
+        Copy `values` (negated if `negate`) out of the workspace as the
+        output `key` of a result: into `out` if given, with
+        `result_views` into the next of the pair of buffers for `key`,
+        else into a new array.
+        """
+        if out is not None:
+            if out.shape != values.shape:
+                raise ValueError('out has shape %s, expecting %s' % (out.shape, values.shape))
+            if negate:
+                np.negative(values, out=out)
+            elif out is not values:
+                np.copyto(out, values)
+            return out
+        if not self.result_views:
+            return -values if negate else values.copy()
+        pair = self._views.get(key)
+        if pair is None:
+            pair = self._views[key] = [np.empty((2, self.n)), 1]
+        pair[1] ^= 1
+        buffer = pair[0][pair[1]]
+        if negate:
+            np.negative(values, out=buffer)
+        else:
+            np.copyto(buffer, values)
+        view = buffer.view()
+        view.flags.writeable = False
+        return view
+
+
 @dataclass
 class CoxDevianceResult(object):
     """
@@ -56,6 +347,441 @@ class CoxDevianceResult(object):
     __hash_args__: str
 
 
+@dataclass
+class ConcordanceResult(object):
+    """
+    Concordance of a linear predictor with survival data.
+
+    A pair is comparable when one observation has an event while the
+    other is still at risk, and concordant when the one with the event
+    has the larger linear predictor. Pairs are weighted by the product
+    of their sample weights, and for Uno's C also by the inverse squared
+    censoring survival at the event time.
+
+    Attributes
+    ----------
+    concordance : float
+        Proportion of comparable pairs that are concordant, pairs tied
+        in the linear predictor counting 1/2 (nan without comparable
+        pairs).
+    concordant : float
+        Weighted number of concordant pairs.
+    discordant : float
+        Weighted number of discordant pairs.
+    tied_risk : float
+        Weighted number of pairs tied in the linear predictor.
+    """
+
+    concordance: float
+    concordant: float
+    discordant: float
+    tied_risk: float
+
+    @classmethod
+    def from_counts(cls, counts):
+        """Result for pair counts (concordant, discordant, tied_risk)."""
+        concordant, discordant, tied_risk = [float(c) for c in counts]
+        total = concordant + discordant + tied_risk
+        concordance = (concordant + 0.5 * tied_risk) / total if total > 0 else np.nan
+        return cls(concordance=concordance,
+                   concordant=concordant,
+                   discordant=discordant,
+                   tied_risk=tied_risk)
+
+
+def _check_concordance_method(method, tau):
+    """Validate `method` and `tau`, returning (ipcw, tau) for the compiled routine."""
+    if method not in ('harrell', 'uno'):
+        raise ValueError("method must be 'harrell' or 'uno'")
+    return method == 'uno', np.inf if tau is None else float(tau)
+
+
+@dataclass
+class CoxResiduals(object):
+    """
+    Residuals of a Cox model at a fitted linear predictor.
+
+    Unweighted, as `residuals.coxph` in R's survival package; e.g.
+    dfbeta is `(sample_weight[:, None] * score) @ cov`.
+
+    Attributes
+    ----------
+    martingale : np.ndarray
+        Martingale residuals, status less the cumulative hazard.
+    deviance : np.ndarray
+        Deviance residuals.
+    score : Optional[np.ndarray]
+        Score residuals, a column per covariate (None without X).
+    schoenfeld : Optional[np.ndarray]
+        Schoenfeld residuals, a column per covariate and 0 in the rows of
+        censored observations (None without X).
+    """
+
+    martingale: np.ndarray
+    deviance: np.ndarray
+    score: Optional[np.ndarray] = None
+    schoenfeld: Optional[np.ndarray] = None
+
+
+def _float_input(x):
+    """x as an array the compiled code reads in place: float32 and float64
+    arrays, and strided views of them, as they are, anything else
+    converted to float64."""
+    x = np.asarray(x)
+    if x.dtype not in (np.float32, np.float64):
+        x = x.astype(float)
+    return x
+
+
+def _covariates(X):
+    """X as a 2-d float32 or float64 array, read in place by the compiled code."""
+    X = _float_input(X)
+    if X.ndim == 1:
+        X = X.reshape((-1, 1))
+    return X
+
+
+@dataclass
+class RobustVariance(object):
+    """
+    Cluster-robust (sandwich) variance of Cox model coefficients.
+
+    Attributes
+    ----------
+    meat : np.ndarray
+        Sum over clusters of the outer products of the summed weighted
+        score residuals, p x p.
+    covariance : np.ndarray
+        The sandwich `inv(information) @ meat @ inv(information)`, the
+        robust variance of `coxph(..., cluster=)` in R's survival package.
+    information : np.ndarray
+        Information of the coefficients, `X.T @ H @ X`.
+    """
+
+    meat: np.ndarray
+    covariance: np.ndarray
+    information: np.ndarray
+
+    @classmethod
+    def from_cluster_scores(cls, U, information):
+        """Meat and sandwich from per cluster score sums `U` (clusters x p)."""
+        meat = U.T @ U
+        bread = np.linalg.inv(information)
+        return cls(meat=meat,
+                   covariance=bread @ meat @ bread,
+                   information=information)
+
+
+_bootstrap_schemes = ('poisson', 'bayesian')
+
+def _check_bootstrap_scheme(scheme):
+    if scheme not in _bootstrap_schemes:
+        raise ValueError(f"scheme must be one of {_bootstrap_schemes}")
+    return scheme == 'bayesian'
+
+
+def bootstrap_weights(n,
+                      replicate,
+                      seed=0,
+                      scheme='poisson'):
+    """
+    Weights of one bootstrap replicate, as `CoxDeviance.bootstrap` draws them.
+
+    Row i's weight is a function of `(seed, replicate, i)` alone: a
+    Poisson(1) count for `'poisson'` (resampling with replacement, up
+    to the total count) or an Exp(1) draw for `'bayesian'` (Rubin's
+    Bayesian bootstrap).
+
+    Parameters
+    ----------
+    n : int
+        Number of observations.
+    replicate : int
+        Replicate number.
+    seed : int, default=0
+        Seed, an unsigned 64 bit integer.
+    scheme : {'poisson', 'bayesian'}, default='poisson'
+        Distribution of the weights.
+
+    Returns
+    -------
+    np.ndarray
+    """
+    weight = np.empty(n)
+    _bootstrap_weights(_check_bootstrap_scheme(scheme), seed, replicate, weight)
+    return weight
+
+
+@dataclass
+class CoxBootstrap(object):
+    """
+    Deviances of bootstrap replicates at a fixed linear predictor.
+
+    Attributes
+    ----------
+    deviance : np.ndarray
+        Deviance of each replicate, shape (n_replicates,).
+    X_gradient : np.ndarray or None
+        `X.T @ gradient` of each replicate, shape (n_replicates, p), the
+        gradient of the deviance in the coefficients of `X`; None unless
+        `X` was given.
+    seed : int
+        Seed the replicate weights were drawn with.
+    scheme : str
+        Distribution of the replicate weights, see `bootstrap_weights`.
+    """
+
+    deviance: np.ndarray
+    X_gradient: Optional[np.ndarray]
+    seed: int
+    scheme: str
+
+
+@dataclass
+class ScoreScreen(object):
+    """
+    Score tests of candidate columns against a null model.
+
+    Attributes
+    ----------
+    score : np.ndarray
+        Score `x.T @ g` of each column, g the null model's score in the
+        linear predictor.
+    variance : np.ndarray
+        Variance of each score, `x.T @ I @ x` less its projection on the
+        null model's covariates `Z`.
+    statistic : np.ndarray
+        `score / sqrt(variance)`, NaN where the variance is not positive
+        (a column in the span of `Z`).
+    pvalue : np.ndarray
+        Two sided p-value of `statistic` as a standard normal.
+    """
+
+    score: np.ndarray
+    variance: np.ndarray
+    statistic: np.ndarray
+    pvalue: np.ndarray
+
+    @classmethod
+    def from_scores(cls, score, variance):
+        """Statistics and p-values from scores and their variances."""
+        with np.errstate(invalid='ignore', divide='ignore'):
+            statistic = np.where(variance > 0, score / np.sqrt(np.maximum(variance, 0)), np.nan)
+        return cls(score=score,
+                   variance=variance,
+                   statistic=statistic,
+                   pvalue=2 * norm.sf(np.abs(statistic)))
+
+
+@dataclass
+class HorizonSweep(object):
+    """
+    Deviances under administrative censoring at many horizons.
+
+    Attributes
+    ----------
+    horizon : np.ndarray
+        The horizons tau, sorted.
+    deviance : np.ndarray
+        Deviance of the data censored at each horizon: stop times
+        `min(t, tau)` and only the events up to `tau`.
+    loglik_sat : np.ndarray
+        Saturated log likelihood at each horizon.
+    n_events : np.ndarray
+        Number of events up to each horizon.
+    gradient : np.ndarray, optional
+        Gradient of each deviance in the linear predictor, shape
+        (n_horizons, n); None unless asked for.
+    """
+
+    horizon: np.ndarray
+    deviance: np.ndarray
+    loglik_sat: np.ndarray
+    n_events: np.ndarray
+    gradient: Optional[np.ndarray] = None
+
+
+@dataclass
+class LandmarkDeviances(object):
+    """
+    Deviances of the copies of a landmark supermodel.
+
+    Copy l holds the subjects still followed at `landmark[l]`, with that
+    as their start time and follow-up truncated at `horizon[l]`; each
+    copy is a stratum of its own.
+
+    Attributes
+    ----------
+    landmark : np.ndarray
+        The landmark times.
+    horizon : np.ndarray
+        The end of follow-up of each copy.
+    deviance : np.ndarray
+        Deviance of each copy; the stacked deviance is their sum.
+    loglik_sat : np.ndarray
+        Saturated log likelihood of each copy.
+    n_at_risk : np.ndarray
+        Number of subjects in each copy.
+    n_events : np.ndarray
+        Number of events in each copy.
+    gradient : np.ndarray, optional
+        Gradient of each copy's deviance in its linear predictor, shape
+        (n, n_landmarks) and zero off the copy; None unless asked for.
+    """
+
+    landmark: np.ndarray
+    horizon: np.ndarray
+    deviance: np.ndarray
+    loglik_sat: np.ndarray
+    n_at_risk: np.ndarray
+    n_events: np.ndarray
+    gradient: Optional[np.ndarray] = None
+
+
+@dataclass
+class SampledDeviance(object):
+    """
+    Approximate deviance from subsampled risk sets.
+
+    Each tie block's risk sum is its events' plus an unbiased estimate
+    from controls drawn among the rows after it in event order, as in a
+    nested case-control design.
+
+    Attributes
+    ----------
+    deviance : float
+        Deviance of the approximation.
+    deviance_variance : float
+        Estimated sampling variance of `deviance` over seeds, by the
+        delta method from the draws; NaN with one control.
+    loglik_sat : float
+        Saturated log likelihood.
+    gradient : np.ndarray
+        Gradient of the approximation in the linear predictor, nonzero
+        only at events and drawn controls.
+    diag_hessian : np.ndarray
+        Diagonal of its Hessian.
+    n_controls : int
+        Controls drawn per tie block.
+    seed : int
+        Seed the draws are a function of.
+    """
+
+    deviance: float
+    deviance_variance: float
+    loglik_sat: float
+    gradient: np.ndarray
+    diag_hessian: np.ndarray
+    n_controls: int
+    seed: int
+
+
+# candidate columns tested per task by score_screen
+_screen_block = 1024
+
+def _cluster_codes(cluster, n, dtype):
+    """Codes 0, ..., G - 1 of the G distinct cluster labels, by sorting."""
+    cluster = np.asarray(cluster).reshape(-1)
+    if cluster.shape[0] != n:
+        raise ValueError('cluster must have an entry per observation')
+    labels, codes = np.unique(cluster, return_inverse=True)
+    return codes.reshape(-1).astype(dtype), labels.shape[0]
+
+
+def _column_blocks(p, n_jobs):
+    """Split range(p) into about one slice per thread for `n_jobs` threads."""
+    n_blocks = n_jobs if n_jobs is not None else (os.cpu_count() or 1)
+    n_blocks = max(1, min(n_blocks, p))
+    bounds = np.linspace(0, p, n_blocks + 1).astype(int)
+    return [slice(a, b) for a, b in zip(bounds[:-1], bounds[1:])]
+
+
+# rows of survival curves computed per task, at least
+_survival_block = 4096
+
+def _row_blocks(n, n_jobs):
+    """Split range(n) into about one slice per thread for `n_jobs` threads."""
+    n_blocks = n_jobs if n_jobs is not None else (os.cpu_count() or 1)
+    n_blocks = max(1, min(n_blocks, n // _survival_block))
+    bounds = np.linspace(0, n, n_blocks + 1).astype(int)
+    return [slice(a, b) for a, b in zip(bounds[:-1], bounds[1:])]
+
+
+def _run_tasks(tasks, n_jobs):
+    """Run the callables `tasks`, in a pool of `n_jobs` threads unless there is one task."""
+    if n_jobs == 1 or len(tasks) <= 1:
+        for task in tasks:
+            task()
+    else:
+        with ThreadPoolExecutor(n_jobs) as pool:
+            list(pool.map(lambda task: task(), tasks))
+
+
+@dataclass
+class BaselineHazard(object):
+    """
+    Baseline cumulative hazard of a Cox model.
+
+    The Breslow estimate, or Efron's when ties are broken by Efron's
+    method, for a linear predictor of 0: a right continuous step function
+    jumping at each unique event time.
+
+    Attributes
+    ----------
+    time : np.ndarray
+        Unique event times, increasing.
+    cumhaz : np.ndarray
+        Cumulative hazard at each of `time`.
+    """
+
+    time: np.ndarray
+    cumhaz: np.ndarray
+
+    def cumulative_hazard(self, times):
+        """Cumulative hazard at `times` (0 before the first event time)."""
+        pos = np.searchsorted(self.time, np.asarray(times, dtype=float), side='right')
+        return np.where(pos > 0, self.cumhaz[np.maximum(pos - 1, 0)], 0.)
+
+    def survival(self,
+                 linear_predictor,
+                 times,
+                 n_jobs=None):
+        """
+        Predicted survival curves exp(-H(t) exp(eta)).
+
+        The cumulative hazard at each query time is found by binary search
+        on `time`, once for all subjects. Rows are computed in blocks by a
+        pool of threads; the compiled routine runs without the GIL.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor of each new subject, on the scale of the one
+            the baseline was computed at.
+        times : np.ndarray
+            Query times.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        np.ndarray
+            Survival probabilities, a row per subject and a column per
+            query time.
+        """
+        linear_predictor = _float_input(linear_predictor)
+        times = np.ascontiguousarray(np.atleast_1d(times), dtype=float)
+        out = np.empty((linear_predictor.shape[0], times.shape[0]))
+        tasks = [lambda rows=rows: _survival(self.time,
+                                             self.cumhaz,
+                                             linear_predictor[rows],
+                                             times,
+                                             out[rows])
+                 for rows in _row_blocks(linear_predictor.shape[0], n_jobs)]
+        _run_tasks(tasks, n_jobs)
+        return out
+
+
 @dataclass
 class CoxDeviance(object):
     """
@@ -75,11 +801,28 @@ class CoxDeviance(object):
         Start times for left-truncated data. If None, assumes no truncation.
     tie_breaking : {'efron', 'breslow'}, default='efron'
         Method for handling tied event times.
+    use_int64 : bool, default=False
+        Use int64 index arrays even when int32 would do. int64 indices
+        are always used when the data are too large for int32.
+    low_memory : bool, default=False
+        Give each thread a low memory `Workspace`, its buffers sharing
+        storage where no computation needs them at the same time: 18
+        rather than 25 doubles per observation, with the same results.
+        See `memory_footprint`.
+    result_views : bool, default=False
+        Return the gradient and Hessian diagonal of results, and the
+        products of `information` operators, as read-only views of
+        workspace buffers rather than as new arrays. Each output is
+        double buffered: a result stays valid through the next evaluation
+        in the same thread and is overwritten by the one after, so copy
+        what must outlive that.
         
     Attributes
     ----------
     tie_breaking : str
         The tie-breaking method being used.
+    design : CoxDesign
+        The preprocessed data, shared by all threads.
     _have_start_times : bool
         Whether start times are provided.
     _efron : bool
@@ -96,12 +839,23 @@ class CoxDeviance(object):
     >>> result = cox(eta)
     >>> print(round(result.deviance, 4))
     20.7998
+
+    Evaluation is thread safe: each thread gets its own `Workspace`
+    and the compiled code runs without holding the GIL.
+
+    >>> from concurrent.futures import ThreadPoolExecutor
+    >>> etas = [eta * s for s in np.linspace(0, 1, 8)]
+    >>> with ThreadPoolExecutor(4) as pool:
+    ...     deviances = list(pool.map(lambda e: cox(e).deviance, etas))
     """
     
     event: InitVar[np.ndarray]
     status: InitVar[np.ndarray]
     start: InitVar[np.ndarray]=None
     tie_breaking: Literal['efron', 'breslow'] = 'efron'
+    use_int64: bool = False
+    low_memory: bool = False
+    result_views: bool = False
     
     def __post_init__(self,
                       event,
@@ -119,12 +873,12 @@ class CoxDeviance(object):
         start : np.ndarray, optional
             Start times for left-truncated data.
         """
-        event = np.asarray(event).astype(float)
+        event = np.asarray(event, dtype=float)
 
         status_arr = np.asarray(status)
         if not set(np.unique(status_arr)).issubset(set([0,1])):
             raise ValueError('status must be binary')
-        status = status_arr.astype(np.int32)
+        status = np.asarray(status_arr, dtype=np.int32)
         
         nevent = event.shape[0]
 
@@ -139,46 +893,360 @@ class CoxDeviance(object):
          self._event_order,
          self._start_order) = c_preprocess(start,
                                            event,
-                                           status)
-        self._event_order = self._event_order.astype(np.int32)
-        self._start_order = self._start_order.astype(np.int32)
+                                           status,
+                                           self.use_int64)
+        # index arrays are int32, or int64 when n is too large for int32;
+        # the compiled routines accept either so they are used as returned
+        self._event_order = np.asarray(self._event_order)
+        self._start_order = np.asarray(self._start_order)
         
         self._efron = self.tie_breaking == 'efron' and np.linalg.norm(self._preproc['scaling']) > 0
 
         self._status = np.asarray(self._preproc['status'])
         self._event = np.asarray(self._preproc['event'])
         self._start = np.asarray(self._preproc['start'])
-        self._first = np.asarray(self._preproc['first']).astype(np.int32)
-        self._last = np.asarray(self._preproc['last']).astype(np.int32)
+        self._first = np.asarray(self._preproc['first'])
+        self._last = np.asarray(self._preproc['last'])
         self._scaling = np.asarray(self._preproc['scaling'])
-        self._event_map = np.asarray(self._preproc['event_map']).astype(np.int32)
-        self._start_map = np.asarray(self._preproc['start_map']).astype(np.int32)
+        self._event_map = np.asarray(self._preproc['event_map'])
+        self._start_map = np.asarray(self._preproc['start_map'])
         self._first_start = self._first[self._start_map]
         
         if not np.all(self._first_start == self._start_map):
             raise ValueError('first_start disagrees with start_map')
 
-        n = self._status.shape[0]
+        self.design = CoxDesign(event_order=self._event_order,
+                                start_order=self._start_order,
+                                status=self._status,
+                                first=self._first,
+                                last=self._last,
+                                scaling=self._scaling,
+                                event_map=self._event_map,
+                                start_map=self._start_map,
+                                have_start_times=self._have_start_times,
+                                efron=self._efron)
 
-        # allocate necessary memory
-        
-        self._T_1_term = np.zeros(n)
-        self._T_2_term = np.zeros(n)
-        self._event_reorder_buffers = [np.zeros(n) for i in range(3)]
-        self._forward_cumsum_buffers = [np.zeros(n+1) for i in range(5)]
-        self._forward_scratch_buffer = np.zeros(n)
-        self._reverse_cumsum_buffers = [np.zeros(n+1) for i in range(4)]
-        self._risk_sum_buffers = [np.zeros(n) for i in range(2)]
-        self._hess_matvec_buffer = np.zeros(n)
-        self._grad_buffer = np.zeros(n)
-        self._diag_hessian_buffer = np.zeros(n)
-        self._diag_part_buffer = np.zeros(n)
-        self._w_avg_buffer = np.zeros(n)
-        self._exp_w_buffer = np.zeros(n)
+        # room to append rows, made by the first append
+        self._arrays = None
+
+        # the preprocessed arrays in shared memory, see `share_memory`
+        self._shared = None
+
+        # scratch memory is allocated per thread on first use
+        self._local = threading.local()
+
+        # arrays derived from the design, see `_design_cached`
+        self._cache = {}
+
+        self._stats = _PhaseStats(['python_hash', 'python_exp_w', 'python_copy'])
+
+    @property
+    def _workspace(self):
+        """The calling thread's workspace, allocated on first use."""
+        if not hasattr(self._local, 'workspace'):
+            self._local.workspace = Workspace(self.design.n, self.low_memory, self.result_views)
+        elif self._local.workspace.n != self.design.n:
+            # rows were appended since it was last used
+            self._local.workspace._resize(self.design.n)
+        return self._local.workspace
+
+    def append(self,
+               event,
+               status,
+               start=None):
+        """
+        Add observations to the cohort without preprocessing it again.
+
+        The new observations, numbered after the existing ones, are
+        sorted on their own and merged into the event and start orders:
+        only positions after the first insertion move and only the risk
+        set maps the new rows change are recomputed. When they arrive
+        after the existing follow up, as in calendar time, the work is
+        sorting the batch plus the tail it joins rather than a sort of
+        the whole cohort. The preprocessed arrays and the workspaces keep
+        spare room, at least doubled when it runs out.
+
+        `design` is replaced; appending while other threads evaluate is
+        not supported. The result is that of a `CoxDeviance` of all the
+        observations, up to the order of tied rows.
+
+        Parameters
+        ----------
+        event : np.ndarray
+            Event times of the new observations.
+        status : np.ndarray
+            Their event indicators (1 for event, 0 for censored).
+        start : np.ndarray, optional
+            Their start times, given exactly when the cohort has them.
+        """
+        event = np.asarray(event, dtype=float).reshape(-1)
+        status_arr = np.asarray(status).reshape(-1)
+        if not set(np.unique(status_arr)).issubset(set([0,1])):
+            raise ValueError('status must be binary')
+        status = np.asarray(status_arr, dtype=np.int32)
+        if self._shared is not None:
+            raise ValueError('cannot append to a cohort in shared memory, call release_shared_memory first')
+        if (start is not None) != self._have_start_times:
+            raise ValueError('start times must be given exactly when the cohort has them')
+        start = np.zeros(0) if start is None else np.asarray(start, dtype=float).reshape(-1)
+        m = event.shape[0]
+        if status.shape[0] != m or (self._have_start_times and start.shape[0] != m):
+            raise ValueError('start, event and status must have an entry per new observation')
+
+        n = self.design.n
+        arrays = self._grow(n + m)
+        ties = _append_rows(start,
+                            event,
+                            status,
+                            n,
+                            self._have_start_times,
+                            arrays['event_order'],
+                            arrays['start_order'],
+                            arrays['first'],
+                            arrays['last'],
+                            arrays['event_map'],
+                            arrays['start_map'],
+                            arrays['event_position'],
+                            arrays['status'],
+                            arrays['event'],
+                            arrays['start'],
+                            arrays['scaling'])
+        self._efron = self.tie_breaking == 'efron' and (self._efron or ties)
+
+        n += m
+        views = {name: arrays[name][:n] for name in self._design_arrays()}
+        # start_map is first_start, as checked when preprocessing
+        views['first_start'] = views['start_map']
+        self._set_design_arrays(views)
+
+    def _grow(self, n):
+        """
+        The preprocessed arrays with room for `n` rows, the design's
+        arrays being views of their first rows. The room at least
+        doubles when it runs out, and the indices widen to int64 when `n`
+        is too large for int32.
+        """
+        arrays = self._arrays
+        capacity = 0 if arrays is None else arrays['status'].shape[0]
+        index_dtype = self._event_order.dtype
+        if index_dtype == np.int32 and 2 * n >= np.iinfo(np.int32).max:
+            index_dtype = np.dtype(np.int64)
+        if n > capacity or index_dtype != self._event_order.dtype:
+            current = self.design.n
+            if arrays is None:
+                event_position = np.empty(current, index_dtype)
+                event_position[self._event_order] = np.arange(current)
+            else:
+                event_position = arrays['event_position'][:current]
+            capacity = max(n, 2 * capacity)
+            arrays = {}
+            for name, values in [('event_order', self._event_order),
+                                 ('start_order', self._start_order),
+                                 ('first', self._first),
+                                 ('last', self._last),
+                                 ('event_map', self._event_map),
+                                 ('start_map', self._start_map),
+                                 ('event_position', event_position),
+                                 ('status', self._status),
+                                 ('event', self._event),
+                                 ('start', self._start),
+                                 ('scaling', self._scaling)]:
+                dtype = index_dtype if values.dtype.kind == 'i' and name != 'status' else values.dtype
+                arrays[name] = np.zeros(capacity, dtype)
+                arrays[name][:current] = values
+            self._arrays = arrays
+        return arrays
+
+    def memory_footprint(self):
+        """
+        Bytes held by the preprocessed arrays and by a workspace.
+
+        Each thread evaluating holds its own workspace, allocated on
+        first use (by this call for the calling thread).
+
+        Returns
+        -------
+        dict
+            With keys 'design' (the preprocessed arrays, with any room
+            kept for `append`), 'workspace' (the calling thread's
+            workspace) and 'workspace_doubles' (the latter in doubles
+            per observation).
+        """
+        if self._arrays is not None:
+            arrays = self._arrays
+        else:
+            arrays = self._design_arrays()
+        design = sum(values.nbytes for values in arrays.values())
+        workspace = self._workspace.nbytes
+        return {'design': design,
+                'workspace': workspace,
+                'workspace_doubles': workspace / (8 * max(self.design.n, 1))}
+
+    def stats(self):
+        """
+        Per-phase instrumentation counters.
+
+        Counts only accumulate while enabled by `set_stats_enabled`.
+        Phases of the compiled code ('preprocess', 'cox_dev',
+        'hessian_matvec', 'sum_over_risk_set', 'forward_cumsums',
+        'reorder', ...) are counted over the whole process, the
+        'python_*' phases (hashing the arguments, forming exp_w,
+        copying results) for this object only. Times of a phase include
+        those of the phases it calls.
+
+        Returns
+        -------
+        dict
+            Maps each phase to a dict with keys 'seconds', 'calls' and
+            'bytes' (an estimate of bytes read and written), and
+            'buffer_remaps' to the number of scratch buffer list
+            elements mapped by the compiled code.
+        """
+        return self._stats.merged()
+
+    def reset_stats(self):
+        """Zero the counters reported by `stats`."""
+        _reset_compiled_stats()
+        self._stats.reset()
+
+    def share_memory(self):
+        """
+        Move the preprocessed arrays to POSIX shared memory.
+
+        The pickle of the object then carries a handle to the shared
+        block in place of the arrays, so process workers (joblib,
+        multiprocessing) attach to the block and read the arrays in place
+        rather than each receiving and holding a copy; each allocates
+        only its own workspaces, as threads do. The arrays become read
+        only and `append` is unavailable until `release_shared_memory`.
+
+        The block is unlinked when this object (the one that made it)
+        is released or garbage collected, so it must outlive the
+        workers' use of their copies.
+
+        Returns
+        -------
+        CoxDeviance
+            This object.
+        """
+        if self._shared is None:
+            arrays = self._design_arrays()
+            arrays['first_start'] = self._first[self._start_map]
+            self._shared = SharedArrays(arrays)
+            self._arrays = None
+            self._set_design_arrays(self._shared.arrays)
+        return self
+
+    def release_shared_memory(self):
+        """
+        Copy the preprocessed arrays back to private memory and release
+        the shared block made by `share_memory`. Copies unpickled from
+        this object in other processes must no longer be used.
+        """
+        if self._shared is not None:
+            shared, self._shared = self._shared, None
+            arrays = {name: np.array(values) for name, values in shared.arrays.items()}
+            self._set_design_arrays(arrays)
+            shared.release()
+
+    def _design_arrays(self):
+        """The preprocessed arrays, by name."""
+        return {'event_order': self._event_order,
+                'start_order': self._start_order,
+                'status': self._status,
+                'event': self._event,
+                'start': self._start,
+                'first': self._first,
+                'last': self._last,
+                'scaling': self._scaling,
+                'event_map': self._event_map,
+                'start_map': self._start_map}
+
+    def _set_design_arrays(self, arrays):
+        """Use `arrays` (as from `_design_arrays`, plus 'first_start')
+        as the preprocessed arrays."""
+        self._preproc = {name: values for name, values in arrays.items()
+                         if name not in ['event_order', 'start_order', 'first_start']}
+        self._event_order = arrays['event_order']
+        self._start_order = arrays['start_order']
+        self._status = arrays['status']
+        self._event = arrays['event']
+        self._start = arrays['start']
+        self._first = arrays['first']
+        self._last = arrays['last']
+        self._scaling = arrays['scaling']
+        self._event_map = arrays['event_map']
+        self._start_map = arrays['start_map']
+        self._first_start = arrays['first_start']
+        self.design = CoxDesign(event_order=self._event_order,
+                                start_order=self._start_order,
+                                status=self._status,
+                                first=self._first,
+                                last=self._last,
+                                scaling=self._scaling,
+                                event_map=self._event_map,
+                                start_map=self._start_map,
+                                have_start_times=self._have_start_times,
+                                efron=self._efron)
+
+    def __getstate__(self):
+        state = self.__dict__.copy()
+        del state['_local']
+        state['_cache'] = {}
+        # the design's arrays are views of the first rows of these, so
+        # only those rows are pickled; the room regrows on the next append
+        state['_arrays'] = None
+        if state['_shared'] is not None:
+            # the arrays are views of the block, pickled as its handle
+            for name in list(self._design_arrays()) + ['first_start', 'preproc']:
+                del state['_' + name]
+            del state['design']
+        return state
+
+    def __setstate__(self, state):
+        state.setdefault('_shared', None)
+        state.setdefault('_cache', {})
+        self.__dict__.update(state)
+        if self._shared is not None:
+            self._set_design_arrays(self._shared.arrays)
+        self._local = threading.local()
+
+    def _design_cached(self, key, compute):
+        """
+        `compute()`, kept until the design changes (rows are appended).
+        """
+        cache = self._cache
+        if cache.get('design') is not self.design:
+            cache.clear()
+            cache['design'] = self.design
+        if key not in cache:
+            cache[key] = compute()
+        return cache[key]
+
+    def _ones(self, dtype):
+        """Read-only unit weights, which every workspace shares."""
+        def compute():
+            ones = np.ones(self.design.n, dtype)
+            ones.flags.writeable = False
+            return ones
+        return self._design_cached(('ones', dtype), compute)
+
+    def _start_event(self):
+        """Start times in event order, empty without start times."""
+        def compute():
+            design = self.design
+            if not design.have_start_times:
+                return np.empty(0)
+            start_event = np.empty(design.n)
+            start_event[design.start_order] = self._start
+            return start_event[design.event_order]
+        return self._design_cached('start_event', compute)
 
     def __call__(self,
                  linear_predictor,
-                 sample_weight=None):
+                 sample_weight=None,
+                 workspace=None,
+                 out=None):
         """
         Compute Cox model deviance and related quantities.
         
@@ -188,80 +1256,132 @@ class CoxDeviance(object):
             Linear predictor values (X @ beta).
         sample_weight : np.ndarray, optional
             Sample weights. If None, uses equal weights.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling
+            thread's workspace.
+        out : tuple of np.ndarray, optional
+            Arrays of shape (n,) the gradient and Hessian diagonal are
+            written to. The result refers to them rather than to arrays
+            of its own, and is returned as is by later calls at the same
+            arguments, so leave them alone while it is in use.
             
         Returns
         -------
         CoxDevianceResult
             Object containing deviance, gradient, and Hessian diagonal.
         """
+        linear_predictor = _float_input(linear_predictor)
+
+        ws = workspace if workspace is not None else self._workspace
+        design = self.design
+        if ws.n != design.n:
+            raise ValueError('workspace is for a cohort of a different size')
+
         if sample_weight is None:
-            sample_weight = np.ones_like(linear_predictor)
+            sample_weight = self._ones(linear_predictor.dtype)
         else:
             sample_weight = np.asarray(sample_weight)
 
-        linear_predictor = np.asarray(linear_predictor)
-            
+        timed = _stats_enabled
+        if timed:
+            tic = perf_counter()
         cur_hash = _hash([linear_predictor, sample_weight])
-        if not hasattr(self, "_result") or self._result.__hash_args__ != cur_hash:
+        if timed:
+            self._stats.add('python_hash', tic, linear_predictor.nbytes + sample_weight.nbytes)
+
+        if ws._result is None or ws._result.__hash_args__ != cur_hash:
 
-            loglik_sat = _compute_sat_loglik(self._first,
-                                             self._last,
+            loglik_sat = _compute_sat_loglik(design.first,
+                                             design.last,
                                              sample_weight, # in natural order
-                                             self._event_order,
-                                             self._status,
-                                             self._forward_cumsum_buffers[0])
+                                             design.event_order,
+                                             design.status,
+                                             ws._forward_cumsum_buffers[0])
             
-            eta = np.asarray(linear_predictor)
-            sample_weight = np.asarray(sample_weight)
-            eta = eta - eta.mean()
-            self._exp_w_buffer[:] = sample_weight * np.exp(np.clip(eta, -np.inf, 30))
+            deviance = self._evaluate(linear_predictor,
+                                      sample_weight,
+                                      loglik_sat,
+                                      ws)
 
+            if timed:
+                tic = perf_counter()
+            gradient, diag_hessian = (None, None) if out is None else out
+            ws._result = CoxDevianceResult(linear_predictor=linear_predictor,
+                                           sample_weight=sample_weight,
+                                           loglik_sat=loglik_sat,
+                                           deviance=deviance,
+                                           gradient=ws._output('gradient', ws._grad_buffer, gradient),
+                                           diag_hessian=ws._output('diag_hessian', ws._diag_hessian_buffer, diag_hessian),
+                                           __hash_args__=cur_hash)
+            if timed:
+                self._stats.add('python_copy', tic, 2 * (ws._grad_buffer.nbytes + ws._diag_hessian_buffer.nbytes))
 
+        elif out is not None:
+            ws._result = _result_into(ws, out)
 
+        return ws._result
 
-            deviance = _cox_dev(eta,
-                                sample_weight,
-                                self._exp_w_buffer,
-                                self._event_order,
-                                self._start_order,
-                                self._status,
-                                self._first,
-                                self._last,
-                                self._scaling,
-                                self._event_map,
-                                self._start_map,
-                                loglik_sat,
-                                self._T_1_term,
-                                self._T_2_term,
-                                self._grad_buffer,
-                                self._diag_hessian_buffer,
-                                self._diag_part_buffer,
-                                self._w_avg_buffer,
-                                self._event_reorder_buffers,
-                                self._risk_sum_buffers, #[0] is for coxdev, [1] is for hessian...
-                                self._forward_cumsum_buffers,
-                                self._forward_scratch_buffer,
-                                self._reverse_cumsum_buffers, #[0:2] are for risk sums, [2:4] used for hessian risk*arg sums
-                                self._have_start_times,
-                                self._efron)
-                                
-            # shorthand, for reference in hessian_matvec
-            self._event_cumsum = self._reverse_cumsum_buffers[0]
-            self._start_cumsum = self._reverse_cumsum_buffers[1]
-
-            self._result = CoxDevianceResult(linear_predictor=linear_predictor,
-                                             sample_weight=sample_weight,
-                                             loglik_sat=loglik_sat,
-                                             deviance=deviance,
-                                             gradient=self._grad_buffer.copy(),
-                                             diag_hessian=self._diag_hessian_buffer.copy(),
-                                             __hash_args__=cur_hash)
-            
-        return self._result
+    def _evaluate(self,
+                  linear_predictor,
+                  sample_weight,
+                  loglik_sat,
+                  ws,
+                  design=None):
+        """
+        Deviance at `linear_predictor`, leaving its state in `ws`.
+
+        The work of `__call__` without its caching: `loglik_sat` is the
+        saturated log likelihood for `sample_weight`. Whatever result `ws`
+        held no longer matches its buffers, so it is forgotten. `design`,
+        if given, replaces `self.design`; it must be of the same rows.
+        """
+        if design is None:
+            design = self.design
+        timed = _stats_enabled
+        ws._result = None
+
+        # centering and exp_w are formed in the workspace, not in temporaries
+        if timed:
+            tic = perf_counter()
+        eta = ws._eta(linear_predictor.dtype)
+        np.subtract(linear_predictor, linear_predictor.mean(), out=eta)
+        exp_w = ws._exp_w_buffer
+        np.minimum(eta, 30, out=exp_w)
+        np.exp(exp_w, out=exp_w)
+        exp_w *= sample_weight
+        if timed:
+            self._stats.add('python_exp_w', tic, 2 * eta.nbytes + 2 * exp_w.nbytes + sample_weight.nbytes)
+
+        return _cox_dev(eta,
+                        sample_weight,
+                        ws._exp_w_buffer,
+                        design.event_order,
+                        design.start_order,
+                        design.status,
+                        design.first,
+                        design.last,
+                        design.scaling,
+                        design.event_map,
+                        design.start_map,
+                        loglik_sat,
+                        ws._T_1_term,
+                        ws._T_2_term,
+                        ws._grad_buffer,
+                        ws._diag_hessian_buffer,
+                        ws._diag_part_buffer,
+                        ws._w_avg_buffer,
+                        ws._event_reorder_buffers,
+                        ws._risk_sum_buffers, #[0] is for coxdev, [1] is for hessian...
+                        ws._forward_cumsum_buffers,
+                        ws._forward_scratch_buffer,
+                        ws._reverse_cumsum_buffers, #[0:2] are for risk sums, [2:4] used for hessian risk*arg sums
+                        design.have_start_times,
+                        design.efron)
 
     def information(self,
                     linear_predictor,
-                    sample_weight=None):
+                    sample_weight=None,
+                    workspace=None):
         """
         Compute the information matrix (negative Hessian) as a linear operator.
         
@@ -271,16 +1391,969 @@ class CoxDeviance(object):
             Linear predictor values (X @ beta).
         sample_weight : np.ndarray, optional
             Sample weights. If None, uses equal weights.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling
+            thread's workspace.
             
         Returns
         -------
         CoxInformation
             Linear operator representing the information matrix.
         """
+        ws = workspace if workspace is not None else self._workspace
         result = self(linear_predictor,
-                      sample_weight)
+                      sample_weight,
+                      workspace=ws)
         return CoxInformation(result=result,
-                              coxdev=self)
+                              coxdev=self,
+                              workspace=ws)
+
+    def concordance(self,
+                    linear_predictor,
+                    sample_weight=None,
+                    method='harrell',
+                    tau=None):
+        """
+        Concordance index of a linear predictor, in O(n log n).
+
+        Computed from the preprocessed orderings: ties in time and in the
+        linear predictor, start times and sample weights are handled as
+        for the deviance, see `ConcordanceResult`.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta), larger meaning higher risk.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        method : {'harrell', 'uno'}, default='harrell'
+            Harrell's C, or Uno's C with inverse probability of censoring
+            weights from the Kaplan-Meier estimate of the censoring
+            distribution.
+        tau : float, optional
+            Only events before `tau` count. If None, all events do.
+
+        Returns
+        -------
+        ConcordanceResult
+        """
+        ipcw, tau = _check_concordance_method(method, tau)
+        linear_predictor = _float_input(linear_predictor)
+        if sample_weight is None:
+            sample_weight = self._ones(linear_predictor.dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=linear_predictor.dtype)
+
+        design = self.design
+        counts = _concordance(linear_predictor,
+                              sample_weight,
+                              design.event_order,
+                              design.start_order,
+                              design.status,
+                              design.first,
+                              design.last,
+                              design.event_map,
+                              design.start_map,
+                              self._event,
+                              design.have_start_times,
+                              ipcw,
+                              tau)
+        return ConcordanceResult.from_counts(counts)
+
+    def baseline_hazard(self,
+                        linear_predictor,
+                        sample_weight=None,
+                        workspace=None):
+        """
+        Baseline cumulative hazard at a fitted linear predictor.
+
+        Read off the risk sums of the evaluation at `linear_predictor`,
+        reusing it when it is the workspace's last one.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Fitted linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling
+            thread's workspace.
+
+        Returns
+        -------
+        BaselineHazard
+        """
+        ws = workspace if workspace is not None else self._workspace
+        result = self(linear_predictor,
+                      sample_weight,
+                      workspace=ws)
+        design = self.design
+        time = np.empty(design.n)
+        cumhaz = np.empty(design.n)
+        # the kernels saw the linear predictor less its mean
+        n_times = _baseline_hazard(design.event_order,
+                                   design.status,
+                                   design.first,
+                                   design.last,
+                                   self._event,
+                                   ws._risk_sum_buffers[0],
+                                   ws._w_avg_buffer,
+                                   float(result.linear_predictor.mean()),
+                                   time,
+                                   cumhaz)
+        return BaselineHazard(time=time[:n_times].copy(),
+                              cumhaz=cumhaz[:n_times].copy())
+
+    def residuals(self,
+                  linear_predictor,
+                  sample_weight=None,
+                  X=None,
+                  workspace=None):
+        """
+        Martingale, deviance and, for covariates X, score and
+        Schoenfeld residuals.
+
+        Read off the risk sums and cumulative hazards of the evaluation
+        at `linear_predictor`, reusing it when it is the workspace's last
+        one. The score and Schoenfeld residuals of all columns of X are
+        filled in one call, each column taking a risk set and an event
+        sum like an information product. Efron's correction applies to
+        tied events when used for the deviance.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Fitted linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        X : np.ndarray, optional
+            Covariates, a row per observation.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling
+            thread's workspace.
+
+        Returns
+        -------
+        CoxResiduals
+        """
+        ws = workspace if workspace is not None else self._workspace
+        self(linear_predictor,
+             sample_weight,
+             workspace=ws)
+        design = self.design
+        martingale = np.empty(design.n)
+        deviance = np.empty(design.n)
+        _martingale_residuals(design.event_order,
+                              design.status,
+                              ws._T_1_term,
+                              ws._event_reorder_buffers[0],
+                              martingale,
+                              deviance)
+        residuals = CoxResiduals(martingale=martingale,
+                                 deviance=deviance)
+        if X is not None:
+            X = _covariates(X)
+            if X.shape[0] != design.n:
+                raise ValueError('X must have a row per observation')
+            # column major, so each column is filled contiguously
+            residuals.score = np.empty(X.shape, order='F')
+            residuals.schoenfeld = np.empty(X.shape, order='F')
+            _score_residuals(X,
+                             ws._exp_w_buffer,
+                             design.event_order,
+                             design.start_order,
+                             design.status,
+                             design.first,
+                             design.last,
+                             design.scaling,
+                             design.event_map,
+                             design.start_map,
+                             ws._T_1_term,
+                             ws._w_avg_buffer,
+                             ws._event_reorder_buffers,
+                             ws._risk_sum_buffers,
+                             ws._forward_cumsum_buffers,
+                             ws._forward_scratch_buffer,
+                             ws._reverse_cumsum_buffers,
+                             ws._hess_matvec_buffer,
+                             residuals.score,
+                             residuals.schoenfeld,
+                             design.have_start_times,
+                             design.efron)
+        return residuals
+
+    def robust_variance(self,
+                        linear_predictor,
+                        X,
+                        cluster,
+                        sample_weight=None,
+                        n_jobs=None):
+        """
+        Cluster-robust (sandwich) variance of the coefficients of X.
+
+        The weighted score residuals of each column of X are summed by
+        cluster as they are formed, so no n x p matrix of residuals is
+        held, and the information X' H X comes from the same pass. The
+        columns are split between a pool of `n_jobs` threads, each
+        evaluating in its own workspace; the compiled routine runs
+        without the GIL.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Fitted linear predictor values (X @ beta).
+        X : np.ndarray
+            Covariates, a row per observation.
+        cluster : np.ndarray
+            Cluster label of each observation, e.g. a patient id.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        RobustVariance
+        """
+        design = self.design
+        X = _covariates(X)
+        if X.shape[0] != design.n:
+            raise ValueError('X must have a row per observation')
+        codes, n_clusters = _cluster_codes(cluster, design.n, design.event_order.dtype)
+        p = X.shape[1]
+        U = np.empty((n_clusters, p), order='F')
+        information = np.empty((p, p), order='F')
+
+        def fill(columns):
+            ws = self._workspace
+            self(linear_predictor,
+                 sample_weight,
+                 workspace=ws)
+            _cluster_scores(X,
+                            codes,
+                            columns.start,
+                            columns.stop,
+                            ws._exp_w_buffer,
+                            design.event_order,
+                            design.start_order,
+                            design.status,
+                            design.first,
+                            design.last,
+                            design.scaling,
+                            design.event_map,
+                            design.start_map,
+                            ws._T_1_term,
+                            ws._diag_part_buffer,
+                            ws._w_avg_buffer,
+                            ws._event_reorder_buffers,
+                            ws._risk_sum_buffers,
+                            ws._forward_cumsum_buffers,
+                            ws._forward_scratch_buffer,
+                            ws._reverse_cumsum_buffers,
+                            ws._hess_matvec_buffer,
+                            U,
+                            information,
+                            design.have_start_times,
+                            design.efron)
+
+        _run_tasks([lambda columns=columns: fill(columns)
+                    for columns in _column_blocks(p, n_jobs)], n_jobs)
+        return RobustVariance.from_cluster_scores(U, information)
+
+    def information_matrix(self,
+                           linear_predictor,
+                           sample_weight=None,
+                           rows=None,
+                           columns=None,
+                           n_jobs=None):
+        """
+        The information matrix in eta as a dense array.
+
+        Entries are formed directly from the structure of the matrix, a
+        diagonal minus a sum of outer products over the risk sets, in
+        O(1) work each, rather than from n products with
+        `CoxInformation`. The columns are split between a pool of
+        `n_jobs` threads, each evaluating in its own workspace; the
+        compiled routine runs without the GIL.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        rows : np.ndarray, optional
+            Indices of the rows to return, None for all.
+        columns : np.ndarray, optional
+            Indices of the columns to return, None for all.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        np.ndarray
+            The `len(rows)` x `len(columns)` block of the n x n
+            information matrix, Fortran ordered.
+        """
+        design = self.design
+        dtype = design.event_order.dtype
+        index = lambda idx: (np.arange(design.n, dtype=dtype) if idx is None
+                             else np.asarray(idx).reshape(-1).astype(dtype))
+        rows, columns = index(rows), index(columns)
+        out = np.empty((rows.shape[0], columns.shape[0]), order='F')
+
+        def fill(block):
+            ws = self._workspace
+            self(linear_predictor,
+                 sample_weight,
+                 workspace=ws)
+            _information_matrix(rows,
+                                columns,
+                                block.start,
+                                block.stop,
+                                ws._exp_w_buffer,
+                                design.event_order,
+                                design.start_order,
+                                design.status,
+                                design.first,
+                                design.last,
+                                design.scaling,
+                                design.event_map,
+                                design.start_map,
+                                ws._diag_part_buffer,
+                                ws._w_avg_buffer,
+                                ws._risk_sum_buffers,
+                                ws._forward_cumsum_buffers,
+                                ws._forward_scratch_buffer,
+                                out,
+                                design.have_start_times,
+                                design.efron)
+
+        _run_tasks([lambda block=block: fill(block)
+                    for block in _column_blocks(columns.shape[0], n_jobs)], n_jobs)
+        return out
+
+    def bootstrap(self,
+                  linear_predictor,
+                  n_replicates,
+                  seed=0,
+                  scheme='poisson',
+                  sample_weight=None,
+                  X=None,
+                  n_jobs=None):
+        """
+        Deviances of bootstrap replicates of the data at `linear_predictor`.
+
+        Replicate b reweights the rows by `sample_weight` times
+        `bootstrap_weights(n, b, seed, scheme)`. The compiled routine
+        draws these row by row as it needs them, so no n x n_replicates
+        weight matrix is formed, and reuses the preprocessed design for
+        every replicate. Replicates are split into tiles over a pool of
+        `n_jobs` threads, each evaluating in its own workspace without
+        the GIL. A replicate's results depend only on `seed` and its
+        number, so they are the same bit for bit whatever `n_jobs`.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        n_replicates : int
+            Number of replicates.
+        seed : int, default=0
+            Seed, an unsigned 64 bit integer.
+        scheme : {'poisson', 'bayesian'}, default='poisson'
+            Distribution of the replicate weights.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        X : np.ndarray, optional
+            Covariates, a row per observation; if given, `X.T @ gradient`
+            of each replicate is returned too.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        CoxBootstrap
+        """
+        bayesian = _check_bootstrap_scheme(scheme)
+        design = self.design
+        linear_predictor = _float_input(linear_predictor)
+        dtype = linear_predictor.dtype
+        if sample_weight is None:
+            sample_weight = np.ones(design.n, dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=dtype)
+
+        deviance = np.empty(n_replicates)
+        if X is not None:
+            X = _covariates(X).astype(dtype, copy=False)
+            if X.shape[0] != design.n:
+                raise ValueError('X must have a row per observation')
+            # replicates are columns, so a tile's block is contiguous
+            X_gradient = np.empty((X.shape[1], n_replicates), order='F')
+        else:
+            X = np.zeros((0, 0), dtype)
+            X_gradient = np.zeros((0, 0), order='F')
+
+        def fill(replicates):
+            ws = self._workspace
+            ws._result = None
+            eta = ws._eta(dtype)
+            np.subtract(linear_predictor, linear_predictor.mean(), out=eta)
+            _bootstrap(eta,
+                       sample_weight,
+                       X,
+                       bayesian,
+                       seed,
+                       replicates.start,
+                       replicates.stop,
+                       ws._exp_w_buffer,
+                       design.event_order,
+                       design.start_order,
+                       design.status,
+                       design.first,
+                       design.last,
+                       design.scaling,
+                       design.event_map,
+                       design.start_map,
+                       ws._T_1_term,
+                       ws._T_2_term,
+                       ws._grad_buffer,
+                       ws._diag_hessian_buffer,
+                       ws._diag_part_buffer,
+                       ws._w_avg_buffer,
+                       ws._event_reorder_buffers,
+                       ws._risk_sum_buffers,
+                       ws._forward_cumsum_buffers,
+                       ws._forward_scratch_buffer,
+                       ws._reverse_cumsum_buffers,
+                       deviance[replicates],
+                       X_gradient[:, replicates] if X_gradient.size > 0 else X_gradient,
+                       design.have_start_times,
+                       design.efron)
+
+        _run_tasks([lambda replicates=replicates: fill(replicates)
+                    for replicates in _column_blocks(n_replicates, n_jobs)], n_jobs)
+        return CoxBootstrap(deviance=deviance,
+                            X_gradient=X_gradient.T if X_gradient.size > 0 else None,
+                            seed=seed,
+                            scheme=scheme)
+
+    def score_screen(self,
+                     linear_predictor,
+                     X,
+                     sample_weight=None,
+                     Z=None,
+                     block_size=None,
+                     n_jobs=None):
+        """
+        Score tests of the columns of X against a null model.
+
+        The null model, fitted with covariates `Z` to `linear_predictor`,
+        is evaluated once and the part of its state the tests need is
+        frozen. Each column x then has score `x.T @ g` and variance
+        `x.T @ I @ x`, less its projection on `Z`, in O(n) work from one
+        reversed cumsum in event order rather than an information
+        product. Columns are taken in blocks of `block_size`, split
+        between a pool of `n_jobs` threads sharing the frozen state,
+        and read in place: `X` may be a memory map of float64, float32 or
+        int8 dosages, of which only the block at hand is touched, and
+        nothing of size n times the block is formed.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor of the fitted null model (Z @ beta).
+        X : np.ndarray
+            Candidate columns, a row per observation. A matrix stored a
+            row per candidate may be passed transposed, `X.T`.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        Z : np.ndarray, optional
+            Covariates of the null model, a row per observation, whose
+            coefficients the tests profile out.
+        block_size : int, optional
+            Columns per task, default 1024.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        ScoreScreen
+        """
+        design = self.design
+        n = design.n
+        X = np.asarray(X)
+        if X.ndim == 1:
+            X = X.reshape((-1, 1))
+        if X.shape[0] != n:
+            raise ValueError('X must have a row per observation')
+        if Z is None:
+            Z = np.zeros((n, 0))
+        else:
+            Z = _covariates(Z)
+            if Z.shape[0] != n:
+                raise ValueError('Z must have a row per observation')
+        p = X.shape[1]
+        block_size = block_size or _screen_block
+
+        # the null model state, frozen once and shared by the threads
+        ws = self._workspace
+        self(linear_predictor,
+             sample_weight,
+             workspace=ws)
+        score_state, diag_part, exp_w_event, gamma = [np.empty(n) for _ in range(4)]
+        exp_w_start = np.empty(n if design.have_start_times else 0)
+        adjust = np.empty((Z.shape[1], n), order='F')
+        _freeze_screening(Z,
+                          ws._exp_w_buffer,
+                          design.event_order,
+                          design.start_order,
+                          design.status,
+                          design.first,
+                          design.last,
+                          design.scaling,
+                          design.event_map,
+                          design.start_map,
+                          ws._grad_buffer,
+                          ws._diag_part_buffer,
+                          ws._w_avg_buffer,
+                          ws._risk_sum_buffers,
+                          ws._forward_cumsum_buffers,
+                          ws._forward_scratch_buffer,
+                          ws._reverse_cumsum_buffers,
+                          ws._hess_matvec_buffer,
+                          score_state,
+                          diag_part,
+                          exp_w_event,
+                          exp_w_start,
+                          gamma,
+                          adjust,
+                          design.have_start_times,
+                          design.efron)
+
+        score = np.empty(p)
+        variance = np.empty(p)
+
+        def fill(columns):
+            block = X[:, columns]
+            if block.dtype not in (np.float64, np.float32, np.int8):
+                block = block.astype(float)
+            _score_screen(block,
+                          0,
+                          block.shape[1],
+                          design.event_order,
+                          design.start_order,
+                          design.status,
+                          design.first,
+                          design.last,
+                          design.scaling,
+                          design.event_map,
+                          design.start_map,
+                          score_state,
+                          diag_part,
+                          exp_w_event,
+                          exp_w_start,
+                          gamma,
+                          adjust,
+                          score[columns],
+                          variance[columns],
+                          design.have_start_times,
+                          design.efron)
+
+        _run_tasks([lambda columns=slice(a, min(a + block_size, p)): fill(columns)
+                    for a in range(0, p, block_size)], n_jobs)
+        return ScoreScreen.from_scores(score, variance)
+
+    def horizon_sweep(self,
+                      linear_predictor,
+                      horizons,
+                      sample_weight=None,
+                      gradient=False,
+                      workspace=None):
+        """
+        Deviances under administrative censoring at each of `horizons`.
+
+        Censoring at tau leaves the risk sets of the events up to tau as
+        they are, so the deviance at every horizon is read off one sweep
+        of the event times from a single evaluation, with no new status
+        or event arrays and no preprocessing per horizon.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        horizons : np.ndarray
+            Horizons tau, in increasing order; `np.inf` follows
+            everyone to the end.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        gradient : bool, default=False
+            Return the gradient at each horizon, (n_horizons, n).
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling
+            thread's workspace.
+
+        Returns
+        -------
+        HorizonSweep
+        """
+        horizons = np.asarray(horizons, dtype=float).reshape(-1)
+        if np.any(np.diff(horizons) < 0):
+            raise ValueError('horizons must be sorted')
+        ws = workspace if workspace is not None else self._workspace
+        self(linear_predictor,
+             sample_weight,
+             workspace=ws)
+        design = self.design
+        m = horizons.shape[0]
+        loglik_sat = np.empty(m)
+        deviance = np.empty(m)
+        # C ordered (m, n), passed as its transpose (n, m) in column major order
+        G = np.empty((m, design.n) if gradient else (0, 0))
+        _horizon_sweep(self._event,
+                       horizons,
+                       design.event_order,
+                       design.status,
+                       design.first,
+                       design.last,
+                       design.scaling,
+                       design.start_map,
+                       ws._w_avg_buffer,
+                       ws._event_reorder_buffers,
+                       ws._risk_sum_buffers,
+                       ws._forward_cumsum_buffers,
+                       ws._forward_scratch_buffer,
+                       loglik_sat,
+                       deviance,
+                       G.T,
+                       design.have_start_times,
+                       design.efron)
+        events = np.concatenate([[0], np.cumsum(design.status)])
+        n_events = events[np.searchsorted(self._event, horizons, side='right')]
+        return HorizonSweep(horizon=horizons,
+                            deviance=deviance,
+                            loglik_sat=loglik_sat,
+                            n_events=n_events,
+                            gradient=G if gradient else None)
+
+    def landmark_deviances(self,
+                           linear_predictor,
+                           landmarks,
+                           horizons=None,
+                           sample_weight=None,
+                           gradient=False,
+                           n_jobs=None):
+        """
+        Deviances of a landmark supermodel, without stacking the data.
+
+        Copy l of the cohort holds the subjects followed at `landmarks[l]`
+        (stop time after it and, with start times, start at or before
+        it), starting there and censored at `horizons[l]`, as in a data set
+        stacked at the landmarks and stratified by landmark. The copies
+        are read off the shared sorted order of the cohort, so there is no
+        stacked copy of the data and no sort per landmark.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor, shape (n,) shared by the copies or
+            (n, n_landmarks) with a column per copy.
+        landmarks : np.ndarray
+            Landmark times.
+        horizons : np.ndarray, optional
+            End of follow-up of each copy, after its landmark; None for
+            no truncation.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        gradient : bool, default=False
+            Return the gradients in the linear predictors, (n, n_landmarks).
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        LandmarkDeviances
+        """
+        design = self.design
+        n = design.n
+        landmarks = np.asarray(landmarks, dtype=float).reshape(-1)
+        L = landmarks.shape[0]
+        if horizons is None:
+            horizons = np.full(L, np.inf)
+        else:
+            horizons = np.broadcast_to(np.asarray(horizons, dtype=float), (L,)).copy()
+        if np.any(horizons <= landmarks):
+            raise ValueError('each horizon must follow its landmark')
+
+        linear_predictor = _float_input(linear_predictor)
+        dtype = linear_predictor.dtype
+        if linear_predictor.ndim == 1:
+            linear_predictor = linear_predictor[:, None]
+        if linear_predictor.shape[0] != n or linear_predictor.shape[1] not in (1, L):
+            raise ValueError('linear_predictor must have a row per observation and one column or a column per landmark')
+        eta = np.asfortranarray(np.broadcast_to(linear_predictor - linear_predictor.mean(0), (n, L)))
+        if sample_weight is None:
+            sample_weight = np.ones(n, dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=dtype).reshape(-1)
+
+        loglik_sat = np.empty(L)
+        deviance = np.empty(L)
+        G = np.empty((n, L) if gradient else (0, 0), order='F')
+
+        def evaluate(block):
+            _landmark_deviances(eta,
+                                sample_weight,
+                                landmarks,
+                                horizons,
+                                block.start,
+                                block.stop,
+                                self._event,
+                                self._start,
+                                design.event_order,
+                                design.start_order,
+                                design.status,
+                                design.first,
+                                design.last,
+                                design.scaling,
+                                loglik_sat,
+                                deviance,
+                                G,
+                                design.have_start_times,
+                                design.efron)
+
+        _run_tasks([lambda block=block: evaluate(block) for block in _column_blocks(L, n_jobs)], n_jobs)
+
+        # the copies' sizes from the sorted stop times, less the subjects
+        # entering after the landmark (whose stop times follow it too)
+        entered = np.searchsorted(self._event, landmarks, side='right')
+        followed = np.searchsorted(self._event, horizons, side='right')
+        events = np.concatenate([[0], np.cumsum(design.status)])
+        n_at_risk = n - entered
+        n_events = events[followed] - events[entered]
+        if design.have_start_times:
+            n_at_risk -= n - np.searchsorted(self._start, landmarks, side='right')
+            start_event = np.empty(n)
+            start_event[design.start_order] = self._start
+            start_event = start_event[design.event_order]
+            n_events -= np.array([design.status[a:b][start_event[a:b] > s].sum()
+                                  for s, a, b in zip(landmarks, entered, followed)], dtype=n_events.dtype)
+        return LandmarkDeviances(landmark=landmarks,
+                                 horizon=horizons,
+                                 deviance=deviance,
+                                 loglik_sat=loglik_sat,
+                                 n_at_risk=n_at_risk,
+                                 n_events=n_events,
+                                 gradient=G if gradient else None)
+
+    def exact_deviance(self,
+                       linear_predictor,
+                       sample_weight=None,
+                       n_jobs=None):
+        """
+        Deviance of the exact partial likelihood for ties.
+
+        The d events tied at a time contribute the conditional (discrete
+        logistic) likelihood that they are the ones chosen among all the
+        d-subsets of the risk set, survival's ``ties="exact"``, whatever
+        `tie_breaking` is. Each tie block costs O(d m) for m at risk, by
+        a recursion over the risk set kept in log scale. Without ties it
+        is the Breslow deviance.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights. Event weights
+            multiply their linear predictors and the risk set terms, the
+            log of the subset sum being scaled by the block's mean event
+            weight; zero weights drop observations.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU; the tie blocks are
+            split into ranges of about equal cost.
+
+        Returns
+        -------
+        CoxDevianceResult
+            Deviance, gradient and Hessian diagonal.
+        """
+        design = self.design
+        n = design.n
+        linear_predictor = _float_input(linear_predictor)
+        dtype = linear_predictor.dtype
+        ws = self._workspace
+        ws._result = None
+        if sample_weight is None:
+            sample_weight = self._ones(dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=dtype).reshape(-1)
+        eta = ws._eta(dtype)
+        np.subtract(linear_predictor, linear_predictor.mean(), out=eta)
+
+        # a block's cost is (d + 1) m; split the event order positions so
+        # the ranges' costs are about equal
+        def cumulative_cost():
+            position = np.arange(n)
+            heads = (design.status == 1) & (design.first == position)
+            return np.cumsum(np.where(heads, (design.last - design.first + 2) * (n - position), 0))
+        cumulative = self._design_cached('exact_cost', cumulative_cost)
+        n_tasks = len(_column_blocks(n, n_jobs))
+        bounds = np.searchsorted(cumulative, np.linspace(0, cumulative[-1] if n else 0, n_tasks + 1)[1:-1])
+        bounds = np.concatenate([[0], bounds, [n]])
+
+        # a range's blocks only reach the rows from its start on in event
+        # order, so each task sums into that tail alone
+        offsets = np.concatenate([[0], np.cumsum(n - bounds[:-1])])
+        scratch = ws._scratch('exact', 2 * offsets[-1])
+        pi, pi2 = scratch[:offsets[-1]], scratch[offsets[-1]:]
+        loglik = np.zeros((n_tasks, 2))
+
+        def evaluate(task):
+            _exact_partial_likelihood(eta,
+                                      sample_weight,
+                                      int(bounds[task]),
+                                      int(bounds[task + 1]),
+                                      self._event,
+                                      self._start_event(),
+                                      design.event_order,
+                                      design.status,
+                                      design.first,
+                                      design.last,
+                                      loglik[task],
+                                      pi[offsets[task]:offsets[task + 1]],
+                                      pi2[offsets[task]:offsets[task + 1]],
+                                      design.have_start_times)
+
+        _run_tasks([lambda task=task: evaluate(task) for task in range(n_tasks)], n_jobs)
+
+        # the first task's tail is the whole cohort
+        pi_sum, pi2_sum = pi[:n], pi2[:n]
+        for task in range(1, n_tasks):
+            pi_sum[bounds[task]:] += pi[offsets[task]:offsets[task + 1]]
+            pi2_sum[bounds[task]:] += pi2[offsets[task]:offsets[task + 1]]
+
+        loglik_sat, loglik = loglik.sum(0)
+        order = design.event_order
+        gradient = np.empty(n)
+        gradient[order] = -2 * (sample_weight[order] * design.status - pi_sum)
+        diag_hessian = np.empty(n)
+        diag_hessian[order] = 2 * (pi_sum - pi2_sum)
+        return CoxDevianceResult(linear_predictor=linear_predictor,
+                                 sample_weight=sample_weight,
+                                 loglik_sat=loglik_sat,
+                                 deviance=2 * (loglik_sat - loglik),
+                                 gradient=gradient,
+                                 diag_hessian=diag_hessian,
+                                 __hash_args__=_hash([linear_predictor, sample_weight]))
+
+    def sampled_deviance(self,
+                         linear_predictor,
+                         n_controls,
+                         sample_weight=None,
+                         seed=0,
+                         n_jobs=None):
+        """
+        Approximate deviance from subsampled risk sets.
+
+        For exploratory fits to very large cohorts: each tie block's risk
+        sum is its events' plus `n_controls` controls drawn uniformly,
+        with replacement, from the rows after the block in event order,
+        those at risk scaled to an unbiased estimate of the rest of the
+        risk sum, as in a nested case-control design. A block costs
+        O(n_controls) whatever the cohort size; blocks with no more than
+        `n_controls` rows after them are exact, so `n_controls >= n` gives
+        the deviance of `__call__`. The risk sum estimates are unbiased
+        but their logarithms are not: the deviance is low by about the sum
+        over blocks of their weighted relative variances.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        n_controls : int
+            Controls drawn per tie block.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        seed : int, default=0
+            The draws are a function of the seed and the blocks alone,
+            whatever `n_jobs` is.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        SampledDeviance
+        """
+        if n_controls < 1:
+            raise ValueError('n_controls must be positive')
+        design = self.design
+        n = design.n
+        linear_predictor = _float_input(linear_predictor)
+        dtype = linear_predictor.dtype
+        if sample_weight is None:
+            sample_weight = self._ones(dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=dtype).reshape(-1)
+        # the kernel centers the linear predictor as it reads it
+        center = float(linear_predictor.mean()) if n else 0.
+
+        # the tie blocks: their first positions in event order, sizes
+        # and numbers of rows after them
+        def blocks():
+            head = np.flatnonzero((design.status == 1) & (design.first == np.arange(n)))
+            last = design.last[head]
+            return head, last - head + 1, n - last - 1
+        head, size, after = self._design_cached('sampled_blocks', blocks)
+
+        # every block costs about the same: split them into ranges of
+        # about as many, each task writing the entries of its blocks'
+        # events and draws into its own stretch of the entries
+        n_tasks = len(_column_blocks(n, n_jobs))
+        split = np.linspace(0, head.shape[0], n_tasks + 1).astype(int)
+        bounds = np.append(head, n)[split]
+        bounds[0] = 0
+        room = np.concatenate([[0], np.cumsum(size + np.minimum(after, n_controls))])[split]
+        # unused entries add 0 to row 0
+        row = np.zeros(room[-1], design.event_order.dtype)
+        G = np.zeros(room[-1])
+        H = np.zeros(room[-1])
+        loglik = np.zeros((n_tasks, 3))
+
+        def evaluate(task):
+            _sampled_cox_dev(linear_predictor,
+                             center,
+                             sample_weight,
+                             int(n_controls),
+                             int(seed),
+                             int(bounds[task]),
+                             int(bounds[task + 1]),
+                             self._event,
+                             self._start_event(),
+                             design.event_order,
+                             design.status,
+                             design.first,
+                             design.last,
+                             design.scaling,
+                             loglik[task],
+                             row[room[task]:room[task + 1]],
+                             G[room[task]:room[task + 1]],
+                             H[room[task]:room[task + 1]],
+                             design.have_start_times,
+                             design.efron)
+
+        _run_tasks([lambda task=task: evaluate(task) for task in range(n_tasks)], n_jobs)
+
+        loglik_sat, loglik, variance = loglik.sum(0)
+        return SampledDeviance(deviance=2 * (loglik_sat - loglik),
+                               deviance_variance=4 * variance,
+                               loglik_sat=loglik_sat,
+                               gradient=-2 * np.bincount(row, weights=G, minlength=n),
+                               diag_hessian=-2 * np.bincount(row, weights=H, minlength=n),
+                               n_controls=int(n_controls),
+                               seed=int(seed))
 
 @dataclass
 class CoxInformation(LinearOperator):
@@ -297,6 +2370,9 @@ class CoxInformation(LinearOperator):
         The CoxDeviance object used for computations.
     result : CoxDevianceResult
         Result from the most recent deviance computation.
+    workspace : Workspace, optional
+        Workspace `result` was computed in. If None, uses the calling
+        thread's workspace of `coxdev`.
         
     Attributes
     ----------
@@ -308,13 +2384,36 @@ class CoxInformation(LinearOperator):
 
     coxdev: CoxDeviance
     result: CoxDevianceResult
+    workspace: Optional[Workspace] = None
 
     def __post_init__(self):
         """Initialize the linear operator dimensions."""
+        if self.workspace is None:
+            self.workspace = self.coxdev._workspace
         n = self.coxdev._status.shape[0]
         self.shape = (n, n)
         self.dtype = float
         
+    def matvec(self, x, out=None):
+        """
+        Matrix-vector product with the information matrix.
+
+        Parameters
+        ----------
+        x : np.ndarray
+            Vector to multiply with the information matrix.
+        out : np.ndarray, optional
+            Array of shape (n,) the product is written to and returned.
+
+        Returns
+        -------
+        np.ndarray
+            The product.
+        """
+        if out is None:
+            return super().matvec(x)
+        return self.workspace._output('matvec', self._hessian_matvec(x), out, negate=True)
+
     def _matvec(self, arg):
         """
         Compute matrix-vector product with the information matrix.
@@ -329,24 +2428,37 @@ class CoxInformation(LinearOperator):
         np.ndarray
             Result of the matrix-vector multiplication.
         """
+        return self.workspace._output('matvec', self._hessian_matvec(arg), negate=True)
+
+    def _hessian_matvec(self, arg):
+        """
+        Hessian of the log likelihood times `arg`, in the workspace's
+        `hess_matvec` buffer.
+        """
         # this will compute risk sums if not already computed
         # at this linear_predictor and sample_weight
         
         result = self.result
         coxdev = self.coxdev
+        ws = self.workspace
+        if ws._result is not result:
+            coxdev(result.linear_predictor,
+                   result.sample_weight,
+                   workspace=ws)
 
         # negative will give 2nd derivative of negative
-        # loglikelihood
-
-        _hessian_matvec(-np.asarray(arg).reshape(-1),
-                        np.asarray(result.linear_predictor),
-                        np.asarray(result.sample_weight),
-                        coxdev._risk_sum_buffers[0],
-                        coxdev._diag_part_buffer,
-                        coxdev._w_avg_buffer,
-                        coxdev._exp_w_buffer,
-                        coxdev._event_cumsum,
-                        coxdev._start_cumsum,
+        # loglikelihood -- we negate the output rather than
+        # copying arg, which is read in place
+
+        _hessian_matvec(np.asarray(arg).reshape(-1),
+                        result.linear_predictor,
+                        result.sample_weight,
+                        ws._risk_sum_buffers[0],
+                        ws._diag_part_buffer,
+                        ws._w_avg_buffer,
+                        ws._exp_w_buffer,
+                        ws._event_cumsum,
+                        ws._start_cumsum,
                         coxdev._event_order,
                         coxdev._start_order,
                         coxdev._status,
@@ -355,15 +2467,15 @@ class CoxInformation(LinearOperator):
                         coxdev._scaling,
                         coxdev._event_map,
                         coxdev._start_map,
-                        coxdev._risk_sum_buffers,
-                        coxdev._forward_cumsum_buffers,
-                        coxdev._forward_scratch_buffer,
-                        coxdev._reverse_cumsum_buffers,
-                        coxdev._hess_matvec_buffer,
+                        ws._risk_sum_buffers,
+                        ws._forward_cumsum_buffers,
+                        ws._forward_scratch_buffer,
+                        ws._reverse_cumsum_buffers,
+                        ws._hess_matvec_buffer,
                         coxdev._have_start_times,                        
                         coxdev._efron)
 
-        return coxdev._hess_matvec_buffer.copy()
+        return ws._hess_matvec_buffer
 
     
     def _adjoint(self, arg):
@@ -388,9 +2500,21 @@ class CoxInformation(LinearOperator):
 
 # private functions
 
+def _result_into(ws, out):
+    """
+    The result cached in `ws` with its gradient and Hessian diagonal
+    copied into `out`, cached in its place.
+    """
+    result = ws._result
+    gradient, diag_hessian = out
+    return replace(result,
+                   gradient=ws._output('gradient', result.gradient, gradient),
+                   diag_hessian=ws._output('diag_hessian', result.diag_hessian, diag_hessian))
+
 def _preprocess(start,
                 event,
-                status):
+                status,
+                use_int64=False):
     """
     Preprocess survival data for Cox model computations.
     
@@ -405,11 +2529,14 @@ def _preprocess(start,
         Event times.
     status : np.ndarray
         Event indicators.
+    use_int64 : bool
+        Return int64 index arrays even when int32 would do; int64 is
+        always used when the data are too large for int32 indices.
         
     Returns
     -------
     tuple
         Preprocessed data structures for efficient computation.
     """
-    return c_preprocess(start, event, status)
+    return c_preprocess(start, event, status, use_int64)
 
@@ -0,0 +1,260 @@
+"""
+Cross-validated Cox partial likelihood.
+
+The cohort is preprocessed once; each fold's training set is the same
+design with the held out rows' weights set to 0, so no fold is re-sorted
+or holds buffers of its own.
+"""
+
+from dataclasses import dataclass, InitVar, replace
+from typing import Literal, Optional
+
+import numpy as np
+
+from .base import (CoxDeviance,
+                   _float_input,
+                   _run_tasks)
+from .coxc import compute_sat_loglik as _compute_sat_loglik
+
+
+@dataclass
+class CoxCVResult(object):
+    """
+    Deviances of the folds of a cross-validation.
+
+    Arrays have a trailing axis over folds, after any leading axes of the
+    linear predictors passed in (e.g. one per value of a penalty).
+
+    Attributes
+    ----------
+    full_deviance : np.ndarray
+        Deviance of all the data at each fold's linear predictor.
+    training_deviance : np.ndarray
+        Deviance of each fold's training data at its linear predictor.
+    cv_deviance : np.ndarray
+        `full_deviance - training_deviance`, the held out fold's share of
+        the cross-validated partial likelihood of Verweij and van
+        Houwelingen, on the deviance scale.
+    """
+
+    full_deviance: np.ndarray
+    training_deviance: np.ndarray
+    cv_deviance: np.ndarray
+
+
+@dataclass
+class CoxCV(object):
+    """
+    Cross-validated partial likelihood over folds of one cohort.
+
+    Parameters
+    ----------
+    event : np.ndarray
+        Event times for each observation.
+    status : np.ndarray
+        Event indicators (1 for event, 0 for censored).
+    foldid : np.ndarray
+        Fold of each observation; any labels, one fold per distinct value
+        (`np.arange(n)` for leave one out).
+    start : np.ndarray, optional
+        Start times for left-truncated data.
+    sample_weight : np.ndarray, optional
+        Sample weights. If None, uses equal weights.
+    tie_breaking : {'efron', 'breslow'}, default='efron'
+        Method for handling tied event times.
+
+    Attributes
+    ----------
+    coxdev : CoxDeviance
+        Deviance of the full data, whose design all folds share.
+    folds : np.ndarray
+        The distinct fold labels, in the order of the fold axis of results.
+
+    Notes
+    -----
+    A training set is the full design with the weights of the held out
+    fold zeroed. With Efron ties, tied blocks holding out events of the
+    fold are first rearranged in O(n), see `training_design`, so that
+    the correction counts the training events only. Each fold's design
+    is built on its first evaluation and kept for later ones.
+    """
+
+    event: InitVar[np.ndarray]
+    status: InitVar[np.ndarray]
+    foldid: InitVar[np.ndarray]
+    start: InitVar[np.ndarray] = None
+    sample_weight: Optional[np.ndarray] = None
+    tie_breaking: Literal['efron', 'breslow'] = 'efron'
+
+    def __post_init__(self,
+                      event,
+                      status,
+                      foldid,
+                      start=None):
+
+        self.coxdev = CoxDeviance(event=event,
+                                  status=status,
+                                  start=start,
+                                  tie_breaking=self.tie_breaking)
+        n = self.coxdev.design.n
+        foldid = np.asarray(foldid).reshape(-1)
+        if foldid.shape[0] != n:
+            raise ValueError('foldid must have an entry per observation')
+        self.folds, self._fold_codes = np.unique(foldid, return_inverse=True)
+        self._fold_codes = self._fold_codes.reshape(-1)
+        self._training_designs = {}
+
+        if self.sample_weight is None:
+            self.sample_weight = np.ones(n)
+        else:
+            self.sample_weight = np.asarray(self.sample_weight, dtype=float)
+
+    @property
+    def n_folds(self):
+        """Number of folds."""
+        return self.folds.shape[0]
+
+    def training_weight(self, fold):
+        """
+        Weights of the training set leaving out fold number `fold`.
+
+        Parameters
+        ----------
+        fold : int
+            Position of the fold in `folds`.
+        """
+        return self.sample_weight * (self._fold_codes != fold)
+
+    def training_design(self, fold):
+        """
+        Design of the training set leaving out fold number `fold`.
+
+        Efron's correction for a tied block divides by its number of
+        events, and the weights of its events are averaged over it. For
+        the training set to count only its own events, each tied block
+        holding out some of the fold's events is reordered (in O(n), with
+        no sort) to put its training events first, followed by the held
+        out ones as blocks of one, with zero weight. The full design is
+        returned as is when no such block exists, e.g. for Breslow ties.
+
+        Parameters
+        ----------
+        fold : int
+            Position of the fold in `folds`.
+
+        Returns
+        -------
+        CoxDesign
+        """
+        design = self.coxdev.design
+        first, last = design.first, design.last
+        held = (self._fold_codes[design.event_order] == fold) & (design.status == 1)
+        if not design.efron or not np.any(held & (last > first)):
+            return design
+
+        n = design.n
+        position = np.arange(n)
+        # training events before each position and in each block
+        trained = np.zeros(n + 1, dtype=np.int64)
+        np.cumsum(~held, out=trained[1:])
+        rank = trained[:-1] - trained[first]
+        n_trained = trained[last + 1] - trained[first]
+        target = np.where(held, first + n_trained + (position - first - rank), first + rank)
+        source = np.empty(n, dtype=np.int64)
+        source[target] = position
+
+        held = held[source]
+        first = first[source]
+        rank = rank[source]
+        n_trained = n_trained[source]
+        new_first = np.where(held, position, first).astype(design.first.dtype)
+        new_last = np.where(held, position, first + n_trained - 1).astype(design.last.dtype)
+        scaling = np.where(held, 0, rank / np.maximum(n_trained, 1))
+        start_map = design.start_map[source] if design.start_map.shape[0] == n else design.start_map
+        event_map = design.event_map[source] if design.event_map.shape[0] == n else design.event_map
+        return replace(design,
+                       event_order=design.event_order[source],
+                       status=design.status[source],
+                       first=new_first,
+                       last=new_last,
+                       scaling=scaling,
+                       event_map=event_map,
+                       start_map=start_map)
+
+    def _training_design(self, fold):
+        # built on a fold's first evaluation and kept for the rest of a
+        # path; folds splitting no tied block share the full design
+        design = self._training_designs.get(fold)
+        if design is None:
+            design = self._training_designs[fold] = self.training_design(fold)
+        return design
+
+    def _loglik_sat(self, sample_weight, buffer, design=None):
+        # leaves the weight cumsum cox_dev reads in buffer, so it must be
+        # built in the order of the design cox_dev is then given
+        if design is None:
+            design = self.coxdev.design
+        return _compute_sat_loglik(design.first,
+                                   design.last,
+                                   sample_weight,
+                                   design.event_order,
+                                   design.status,
+                                   buffer)
+
+    def deviances(self,
+                  linear_predictor,
+                  n_jobs=None):
+        """
+        Full data and training deviances of every fold.
+
+        All evaluations, two per fold and leading index, are spread over
+        a pool of `n_jobs` threads, each with its own workspace and
+        training weights; the compiled routine runs without the GIL.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor of all the observations for each fold, e.g.
+            `X @ beta_k` with `beta_k` fitted to fold k's training set:
+            of shape (n_folds, n), or (..., n_folds, n) for several per
+            fold such as a penalty path.
+        n_jobs : int, optional
+            Number of threads, None for the `ThreadPoolExecutor` default.
+
+        Returns
+        -------
+        CoxCVResult
+        """
+        linear_predictor = _float_input(linear_predictor)
+        n = self.coxdev.design.n
+        if linear_predictor.ndim < 2 or linear_predictor.shape[-2:] != (self.n_folds, n):
+            raise ValueError('linear_predictor must have shape (..., n_folds, n)')
+        shape = linear_predictor.shape[:-1]
+        etas = linear_predictor.reshape((-1, n))
+        full = np.empty(etas.shape[0])
+        training = np.empty(etas.shape[0])
+        weight_dtype = linear_predictor.dtype
+
+        def evaluate(i, train):
+            coxdev = self.coxdev
+            ws = coxdev._workspace
+            if train:
+                fold = i % self.n_folds
+                weight = self.training_weight(fold).astype(weight_dtype, copy=False)
+                design = self._training_design(fold)
+                loglik_sat = self._loglik_sat(weight, ws._forward_cumsum_buffers[0], design)
+                training[i] = coxdev._evaluate(etas[i], weight, loglik_sat, ws,
+                                               design=design)
+            else:
+                weight = self.sample_weight.astype(weight_dtype, copy=False)
+                loglik_sat = self._loglik_sat(weight, ws._forward_cumsum_buffers[0])
+                full[i] = coxdev._evaluate(etas[i], weight, loglik_sat, ws)
+
+        _run_tasks([lambda i=i, train=train: evaluate(i, train)
+                    for i in range(etas.shape[0])
+                    for train in (False, True)], n_jobs)
+        full = full.reshape(shape)
+        training = training.reshape(shape)
+        return CoxCVResult(full_deviance=full,
+                           training_deviance=training,
+                           cv_deviance=full - training)
@@ -0,0 +1,312 @@
+"""
+Fine-Gray subdistribution hazard deviance for competing risks.
+
+Subjects with a competing event stay in the risk sets of later events of
+the cause, weighted by the ratio of the censoring survival at the event
+time to that at their own. Rather than expanding each such subject into
+a weighted row per later event time, the weights are applied inside the
+risk set sums of the compiled code, so an evaluation costs what the Cox
+deviance of the cause does.
+"""
+
+import threading
+from dataclasses import dataclass, InitVar
+from typing import Literal, Optional
+
+import numpy as np
+from joblib import hash as _hash
+from scipy.sparse.linalg import LinearOperator
+
+from .base import (CoxDeviance,
+                   CoxDevianceResult,
+                   Workspace,
+                   _float_input,
+                   _result_into)
+from .coxc import (finegray_dev as _finegray_dev,
+                   finegray_hessian_matvec as _finegray_hessian_matvec,
+                   compute_sat_loglik as _compute_sat_loglik)
+
+
+@dataclass
+class FineGrayDeviance(object):
+    """
+    Fine-Gray deviance of one cause among competing risks.
+
+    Parameters
+    ----------
+    event : np.ndarray
+        Event or censoring times for each observation.
+    status : np.ndarray
+        Status codes: 0 for censored, `cause` for an event of the cause
+        of interest and any other value for a competing event.
+    cause : int, default=1
+        Status code of the cause of interest.
+    tie_breaking : {'efron', 'breslow'}, default='efron'
+        Method for handling tied event times.
+    use_int64 : bool, default=False
+        Use int64 index arrays even when int32 would do.
+    low_memory : bool, default=False
+        Use low memory workspaces, see `CoxDeviance`.
+    result_views : bool, default=False
+        Return gradients, Hessian diagonals and information products as
+        double buffered read-only views, see `CoxDeviance`.
+
+    Attributes
+    ----------
+    coxdev : CoxDeviance
+        The cause specific Cox deviance, competing events censored, whose
+        design the Fine-Gray evaluations share.
+    competing : np.ndarray
+        Whether each observation had a competing event.
+
+    Notes
+    -----
+    The censoring distribution is the Kaplan-Meier estimate from the
+    sample weights of each call, events of either kind preceding
+    censorings at the same time, as in `crprep` and `finegray` of R's
+    mstate and survival packages. Start times (left truncation) are not
+    supported.
+
+    Examples
+    --------
+    >>> import numpy as np
+    >>> from coxdev import FineGrayDeviance
+    >>> event = np.array([3, 6, 8, 4, 6, 4, 3, 2, 2, 5, 3, 4])
+    >>> status = np.array([1, 2, 0, 1, 2, 1, 2, 0, 1, 1, 0, 2])
+    >>> fg = FineGrayDeviance(event=event, status=status)
+    >>> result = fg(np.linspace(-1, 1, 12))
+    >>> I = fg.information(np.linspace(-1, 1, 12))
+    """
+
+    event: InitVar[np.ndarray]
+    status: InitVar[np.ndarray]
+    cause: int = 1
+    tie_breaking: Literal['efron', 'breslow'] = 'efron'
+    use_int64: bool = False
+    low_memory: bool = False
+    result_views: bool = False
+
+    def __post_init__(self,
+                      event,
+                      status):
+
+        status = np.asarray(status)
+        self.competing = (status != 0) & (status != self.cause)
+        self.coxdev = CoxDeviance(event=event,
+                                  status=(status == self.cause).astype(np.int32),
+                                  tie_breaking=self.tie_breaking,
+                                  use_int64=self.use_int64,
+                                  low_memory=self.low_memory)
+        design = self.coxdev.design
+        # in event order, as the kernels read them
+        self._competing = np.ascontiguousarray(self.competing[design.event_order], dtype=np.int32)
+        self._event = self.coxdev._event
+
+        # scratch memory is allocated per thread on first use, apart from
+        # the cause specific model's so neither sees the other's results
+        self._local = threading.local()
+
+    @property
+    def _workspace(self):
+        """The calling thread's workspace, allocated on first use."""
+        if not hasattr(self._local, 'workspace'):
+            self._local.workspace = Workspace(self.coxdev.design.n, self.low_memory, self.result_views)
+        return self._local.workspace
+
+    def __call__(self,
+                 linear_predictor,
+                 sample_weight=None,
+                 workspace=None,
+                 out=None):
+        """
+        Fine-Gray deviance and its derivatives in the linear predictor.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights, also weighting the censoring Kaplan-Meier
+            estimate. If None, uses equal weights.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling thread's
+            workspace.
+        out : tuple of np.ndarray, optional
+            Arrays the gradient and Hessian diagonal are written to, see
+            `CoxDeviance.__call__`.
+
+        Returns
+        -------
+        CoxDevianceResult
+            Deviance, gradient and Hessian diagonal.
+        """
+        linear_predictor = _float_input(linear_predictor)
+
+        ws = workspace if workspace is not None else self._workspace
+        design = self.coxdev.design
+        if ws.n != design.n:
+            raise ValueError('workspace is for a cohort of a different size')
+
+        if sample_weight is None:
+            sample_weight = self.coxdev._ones(linear_predictor.dtype)
+        else:
+            sample_weight = np.asarray(sample_weight)
+
+        cur_hash = _hash([linear_predictor, sample_weight])
+        if ws._result is None or ws._result.__hash_args__ != cur_hash:
+
+            loglik_sat = _compute_sat_loglik(design.first,
+                                             design.last,
+                                             sample_weight,
+                                             design.event_order,
+                                             design.status,
+                                             ws._forward_cumsum_buffers[0])
+
+            eta = ws._eta(linear_predictor.dtype)
+            np.subtract(linear_predictor, linear_predictor.mean(), out=eta)
+            exp_w = ws._exp_w_buffer
+            np.minimum(eta, 30, out=exp_w)
+            np.exp(exp_w, out=exp_w)
+            exp_w *= sample_weight
+
+            deviance = _finegray_dev(eta,
+                                     sample_weight,
+                                     exp_w,
+                                     self._competing,
+                                     self._event,
+                                     design.event_order,
+                                     design.start_order,
+                                     design.status,
+                                     design.first,
+                                     design.last,
+                                     design.scaling,
+                                     loglik_sat,
+                                     ws._T_1_term,
+                                     ws._T_2_term,
+                                     ws._grad_buffer,
+                                     ws._diag_hessian_buffer,
+                                     ws._diag_part_buffer,
+                                     ws._w_avg_buffer,
+                                     ws._event_reorder_buffers,
+                                     ws._risk_sum_buffers,
+                                     ws._forward_cumsum_buffers,
+                                     ws._forward_scratch_buffer,
+                                     ws._reverse_cumsum_buffers,
+                                     design.efron)
+
+            gradient, diag_hessian = (None, None) if out is None else out
+            ws._result = CoxDevianceResult(linear_predictor=linear_predictor,
+                                           sample_weight=sample_weight,
+                                           loglik_sat=loglik_sat,
+                                           deviance=deviance,
+                                           gradient=ws._output('gradient', ws._grad_buffer, gradient),
+                                           diag_hessian=ws._output('diag_hessian', ws._diag_hessian_buffer, diag_hessian),
+                                           __hash_args__=cur_hash)
+
+        elif out is not None:
+            ws._result = _result_into(ws, out)
+
+        return ws._result
+
+    def information(self,
+                    linear_predictor,
+                    sample_weight=None,
+                    workspace=None):
+        """
+        Information matrix (negative Hessian of the log likelihood) as a
+        linear operator.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor values (X @ beta).
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        workspace : Workspace, optional
+            Scratch buffers to use. If None, uses the calling thread's
+            workspace.
+
+        Returns
+        -------
+        FineGrayInformation
+        """
+        ws = workspace if workspace is not None else self._workspace
+        result = self(linear_predictor,
+                      sample_weight,
+                      workspace=ws)
+        return FineGrayInformation(result=result,
+                                   finegray=self,
+                                   workspace=ws)
+
+
+@dataclass
+class FineGrayInformation(LinearOperator):
+    """
+    Linear operator of the Fine-Gray information matrix.
+
+    Parameters
+    ----------
+    finegray : FineGrayDeviance
+        The deviance the information is of.
+    result : CoxDevianceResult
+        Result of the evaluation the information is at.
+    workspace : Workspace, optional
+        Workspace `result` was computed in. If None, uses the calling
+        thread's workspace of `finegray`.
+    """
+
+    finegray: FineGrayDeviance
+    result: CoxDevianceResult
+    workspace: Optional[Workspace] = None
+
+    def __post_init__(self):
+        if self.workspace is None:
+            self.workspace = self.finegray._workspace
+        n = self.finegray.coxdev.design.n
+        self.shape = (n, n)
+        self.dtype = float
+
+    def matvec(self, x, out=None):
+        """Information times `x`, written to `out` if given."""
+        if out is None:
+            return super().matvec(x)
+        return self.workspace._output('matvec', self._hessian_matvec(x), out, negate=True)
+
+    def _matvec(self, arg):
+        return self.workspace._output('matvec', self._hessian_matvec(arg), negate=True)
+
+    def _hessian_matvec(self, arg):
+        result = self.result
+        finegray = self.finegray
+        ws = self.workspace
+        if ws._result is not result:
+            finegray(result.linear_predictor,
+                     result.sample_weight,
+                     workspace=ws)
+
+        design = finegray.coxdev.design
+        _finegray_hessian_matvec(np.asarray(arg).reshape(-1),
+                                 finegray._competing,
+                                 ws._exp_w_buffer,
+                                 ws._diag_part_buffer,
+                                 ws._w_avg_buffer,
+                                 ws._risk_sum_buffers[0],
+                                 ws._T_2_term,
+                                 design.event_order,
+                                 design.start_order,
+                                 design.status,
+                                 design.first,
+                                 design.last,
+                                 design.scaling,
+                                 ws._risk_sum_buffers,
+                                 ws._forward_cumsum_buffers,
+                                 ws._forward_scratch_buffer,
+                                 ws._reverse_cumsum_buffers,
+                                 ws._hess_matvec_buffer,
+                                 design.efron)
+
+        return ws._hess_matvec_buffer
+
+    def _adjoint(self, arg):
+        # it is symmetric
+        return self._matvec(arg)
@@ -0,0 +1,205 @@
+"""
+Cox partial likelihood of many outcomes at one linear predictor.
+
+A phenome wide scan fits thousands of endpoints of the same subjects.
+Each outcome is preprocessed once into a column of shared n x K arrays
+rather than a `CoxDeviance` of its own, and an evaluation forms
+`exp(eta)` once per task for its whole range of outcomes, with one
+workspace per task whatever the number of outcomes.
+"""
+
+from dataclasses import dataclass, InitVar
+from typing import Literal, Optional
+
+import numpy as np
+
+from .base import (_column_blocks,
+                   _float_input,
+                   _run_tasks)
+from .coxc import (preprocess_outcomes as _preprocess_outcomes,
+                   outcome_deviances as _outcome_deviances)
+
+
+@dataclass
+class CoxMultiEndpointResult(object):
+    """
+    Deviances of many outcomes at one linear predictor.
+
+    Attributes
+    ----------
+    deviance : np.ndarray
+        Deviance of each outcome, shape (K,).
+    loglik_sat : np.ndarray
+        Saturated log likelihood of each outcome, shape (K,).
+    n_events : np.ndarray
+        Number of events of each outcome, shape (K,).
+    gradient : np.ndarray, optional
+        Gradient of each outcome's deviance in the linear predictor,
+        shape (n, K); None unless asked for.
+    X_gradient : np.ndarray, optional
+        `X.T @ gradient` for each outcome, the deviance gradient in the
+        coefficients, shape (K, p); None without `X`.
+    """
+
+    deviance: np.ndarray
+    loglik_sat: np.ndarray
+    n_events: np.ndarray
+    gradient: Optional[np.ndarray] = None
+    X_gradient: Optional[np.ndarray] = None
+
+
+@dataclass
+class CoxMultiEndpoint(object):
+    """
+    Cox deviances of K outcomes of the same n subjects.
+
+    Parameters
+    ----------
+    event : np.ndarray
+        Event times, shape (n, K): a column per outcome.
+    status : np.ndarray
+        Event indicators (1 for event, 0 for censored), shape (n, K).
+    start : np.ndarray, optional
+        Start times for left-truncated data, of shape (n,) when all
+        outcomes share them or (n, K).
+    tie_breaking : {'efron', 'breslow'}, default='efron'
+        Method for handling tied event times.
+    use_int64 : bool, default=False
+        Use int64 index arrays even when int32 would do.
+    n_jobs : int, optional
+        Number of threads preprocessing the outcomes, None for the
+        `ThreadPoolExecutor` default.
+
+    Attributes
+    ----------
+    n : int
+        Number of subjects.
+    n_outcomes : int
+        Number of outcomes K.
+    efron : np.ndarray
+        Whether Efron's correction applies to each outcome, i.e. it was
+        asked for and the outcome has tied event times.
+    """
+
+    event: InitVar[np.ndarray]
+    status: InitVar[np.ndarray]
+    start: InitVar[np.ndarray] = None
+    tie_breaking: Literal['efron', 'breslow'] = 'efron'
+    use_int64: bool = False
+    n_jobs: InitVar[Optional[int]] = None
+
+    def __post_init__(self,
+                      event,
+                      status,
+                      start=None,
+                      n_jobs=None):
+
+        event = np.asfortranarray(event, dtype=float)
+        status_arr = np.asarray(status)
+        if event.ndim != 2 or status_arr.shape != event.shape:
+            raise ValueError('event and status must have shape (n, K)')
+        if not set(np.unique(status_arr)).issubset(set([0, 1])):
+            raise ValueError('status must be binary')
+        status = np.asfortranarray(status_arr, dtype=np.int32)
+        n, K = event.shape
+
+        self._have_start_times = start is not None
+        if start is None:
+            start = np.zeros((n, 0), order='F')
+        else:
+            start = np.asarray(start, dtype=float)
+            start = np.asfortranarray(start.reshape((n, 1)) if start.ndim == 1 else start)
+            if start.shape not in [(n, 1), (n, K)]:
+                raise ValueError('start must have shape (n,) or (n, K)')
+
+        index_dtype = np.int64 if self.use_int64 or 2 * n >= np.iinfo(np.int32).max else np.int32
+        K_start = K if self._have_start_times else 0
+        self._arrays = {name: np.empty((n, K if name in ['event_order', 'first', 'last'] else K_start),
+                                       dtype=index_dtype, order='F')
+                        for name in ['event_order', 'start_order', 'first', 'last', 'event_map', 'start_map']}
+        self._arrays['status'] = np.empty((n, K), dtype=np.int32, order='F')
+        self._arrays['scaling'] = np.empty((n, K), order='F')
+        self._efron_flags = np.empty(K, dtype=np.int32)
+        self._design_arrays = [self._arrays[name] for name in ['event_order', 'start_order', 'first', 'last',
+                                                               'event_map', 'start_map', 'status', 'scaling']]
+
+        # disjoint ranges of columns, one per task
+        efron = self.tie_breaking == 'efron'
+        def preprocess(block):
+            _preprocess_outcomes(start, event, status, efron, block.start, block.stop,
+                                 *self._design_arrays, self._efron_flags)
+
+        _run_tasks([lambda block=block: preprocess(block) for block in _column_blocks(K, n_jobs)], n_jobs)
+        self.efron = self._efron_flags.astype(bool)
+        self.n, self.n_outcomes = n, K
+        self.n_events = status.sum(0)
+
+    def __call__(self,
+                 linear_predictor,
+                 sample_weight=None,
+                 X=None,
+                 gradient=False,
+                 n_jobs=None):
+        """
+        Deviances of all the outcomes at one linear predictor.
+
+        The outcomes are split into about one range per thread of a pool
+        of `n_jobs`; each task forms `exp(eta)` once and evaluates its
+        range in one workspace, without the GIL.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor of the n subjects, shared by all outcomes.
+        sample_weight : np.ndarray, optional
+            Sample weights. If None, uses equal weights.
+        X : np.ndarray, optional
+            Design matrix (n, p): the result then has each outcome's
+            deviance gradient in the coefficients, `X.T @ gradient`,
+            without storing the n x K gradients unless `gradient` is set.
+        gradient : bool, default=False
+            Return the gradients in the linear predictor, (n, K).
+        n_jobs : int, optional
+            Number of threads, None for the `ThreadPoolExecutor` default.
+
+        Returns
+        -------
+        CoxMultiEndpointResult
+        """
+        linear_predictor = _float_input(linear_predictor).reshape(-1)
+        dtype = linear_predictor.dtype
+        n, K = self.n, self.n_outcomes
+        if linear_predictor.shape[0] != n:
+            raise ValueError('linear_predictor must have an entry per subject')
+        if sample_weight is None:
+            sample_weight = np.ones(n, dtype)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=dtype).reshape(-1)
+            if sample_weight.shape[0] != n:
+                raise ValueError('sample_weight must have an entry per subject')
+        if X is None:
+            X = np.zeros((n, 0), dtype)
+        else:
+            X = np.asarray(X, dtype=dtype)
+            if X.ndim != 2 or X.shape[0] != n:
+                raise ValueError('X must have a row per subject')
+        p = X.shape[1]
+
+        eta = linear_predictor - linear_predictor.mean()
+        loglik_sat = np.empty(K)
+        deviance = np.empty(K)
+        G = np.empty((n, K) if gradient else (0, 0), order='F')
+        # C ordered (K, p), passed as its transpose (p, K) in column major order
+        XG = np.empty((K, p) if p > 0 else (0, 0))
+
+        def evaluate(block):
+            _outcome_deviances(eta, sample_weight, X, block.start, block.stop,
+                               *self._design_arrays, self._efron_flags,
+                               loglik_sat, deviance, G, XG.T, self._have_start_times)
+
+        _run_tasks([lambda block=block: evaluate(block) for block in _column_blocks(K, n_jobs)], n_jobs)
+        return CoxMultiEndpointResult(deviance=deviance,
+                                      loglik_sat=loglik_sat,
+                                      n_events=self.n_events,
+                                      gradient=G if gradient else None,
+                                      X_gradient=XG if p > 0 else None)
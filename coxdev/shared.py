@@ -0,0 +1,141 @@
+"""
+Arrays in POSIX shared memory, pickled as a handle.
+
+A `SharedArrays` places a set of arrays in one shared memory block. The
+process that made it owns the block; a copy unpickled in another process
+(a joblib or multiprocessing worker) attaches to the block by name and
+reads the arrays in place, so workers neither receive the arrays through
+the pickle nor hold copies of them.
+"""
+
+import os
+import sys
+import weakref
+
+import numpy as np
+from multiprocessing import resource_tracker
+from multiprocessing.shared_memory import SharedMemory
+
+# offsets of the arrays in the block are multiples of this
+_alignment = 64
+
+# blocks made by this process
+_owned = set()
+
+
+def _tracker():
+    """Identity of this process's resource tracker, the pipe to it, which
+    processes forked, spawned or served by a fork server inherit; None
+    while there is none."""
+    fd = resource_tracker._resource_tracker._fd
+    if fd is None:
+        return None
+    try:
+        stat = os.fstat(fd)
+    except OSError:
+        return None
+    return (stat.st_dev, stat.st_ino)
+
+
+def _attach(name, tracker):
+    """Attach to the block `name` without the resource tracker claiming
+    it; `tracker` is that of the process that made the block."""
+    if sys.version_info >= (3, 13):
+        return SharedMemory(name=name, track=False)
+    shm = SharedMemory(name=name)
+    # before 3.13 attaching registers the block too. A tracker of the
+    # worker's own would unlink it when the worker exits, so the worker
+    # unregisters it there; but the owner's tracker, which workers of
+    # multiprocessing share, holds the block once, as the owner's, and
+    # must keep it to unlink it should the owner die without doing so
+    if name not in _owned and _tracker() != tracker:
+        resource_tracker.unregister(shm._name, 'shared_memory')
+    return shm
+
+
+def _close(shm, pid):
+    """Close `shm`, unlinking it if it was made by this process, `pid`
+    (not by a parent it was forked from)."""
+    try:
+        shm.close()
+    except BufferError:
+        # views of the block are still alive; the mapping goes with the process
+        pass
+    if pid == os.getpid():
+        _owned.discard(shm.name)
+        try:
+            shm.unlink()
+        except FileNotFoundError:
+            pass
+
+
+class SharedArrays(object):
+    """
+    Read-only arrays in one POSIX shared memory block.
+
+    Parameters
+    ----------
+    arrays : dict
+        Arrays by name, copied into the block.
+
+    Attributes
+    ----------
+    arrays : dict
+        Read-only views of the block, by name.
+    name : str
+        Name of the block.
+    owner : bool
+        Whether this process made the block (and unlinks it).
+    """
+
+    def __init__(self, arrays):
+
+        layout = []
+        offset = 0
+        for key, values in arrays.items():
+            values = np.ascontiguousarray(values)
+            layout.append((key, values.dtype.str, values.shape, offset))
+            offset += -(-values.nbytes // _alignment) * _alignment
+        shm = SharedMemory(create=True, size=max(offset, 1))
+        _owned.add(shm.name)
+        self._open(shm, layout, owner=True, tracker=_tracker())
+        for key, values in arrays.items():
+            view = self.arrays[key]
+            view.flags.writeable = True
+            view[...] = values
+            view.flags.writeable = False
+
+    def _open(self, shm, layout, owner, tracker):
+        self._shm = shm
+        self._layout = layout
+        # the resource tracker of the owner, which registered the block
+        self._tracker = tracker
+        self.name = shm.name
+        self.owner = owner
+        self.arrays = {}
+        for key, dtype, shape, offset in layout:
+            view = np.ndarray(shape, dtype=np.dtype(dtype), buffer=shm.buf, offset=offset)
+            view.flags.writeable = False
+            self.arrays[key] = view
+        self._finalizer = weakref.finalize(self, _close, shm, os.getpid() if owner else None)
+
+    @property
+    def nbytes(self):
+        """Size of the block."""
+        return self._shm.size
+
+    def release(self):
+        """Close the block and, in the owning process, unlink it. The views
+        in `arrays` must no longer be used."""
+        self.arrays = {}
+        self._finalizer()
+
+    def __reduce__(self):
+        return (_attach_shared, (self.name, self._layout, self._tracker))
+
+
+def _attach_shared(name, layout, tracker=None):
+    """Unpickle a `SharedArrays`: attach to its block."""
+    shared = SharedArrays.__new__(SharedArrays)
+    shared._open(_attach(name, tracker), layout, owner=False, tracker=tracker)
+    return shared
@@ -1,12 +1,35 @@
 import numpy as np
+from concurrent.futures import ThreadPoolExecutor
+from time import perf_counter
 from dataclasses import dataclass, InitVar
 from typing import Optional, Literal
 from scipy.sparse.linalg import LinearOperator
 
+from . import base as _base
 from .base import (CoxDevianceResult,
                    CoxInformation,
-                   CoxDevianceResult)
-from .coxc import c_preprocess, cox_dev as _cox_dev, compute_sat_loglik as _compute_sat_loglik
+                   Workspace,
+                   CoxDevianceResult,
+                   ConcordanceResult,
+                   BaselineHazard,
+                   CoxResiduals,
+                   RobustVariance,
+                   _covariates,
+                   _cluster_codes,
+                   _PhaseStats,
+                   _check_concordance_method,
+                   _row_blocks,
+                   _run_tasks,
+                   _reset_compiled_stats)
+from .coxc import (c_preprocess,
+                   cox_dev as _cox_dev,
+                   compute_sat_loglik as _compute_sat_loglik,
+                   concordance as _concordance,
+                   baseline_hazard as _baseline_hazard,
+                   survival as _survival,
+                   martingale_residuals as _martingale_residuals,
+                   score_residuals as _score_residuals,
+                   cluster_scores as _cluster_scores)
 
 @dataclass
 class StratifiedCoxDeviance:
@@ -16,14 +39,15 @@ class StratifiedCoxDeviance:
     strata: InitVar[Optional[np.ndarray]] = None
     start: InitVar[Optional[np.ndarray]] = None
     tie_breaking: Literal['efron', 'breslow'] = 'efron'
+    low_memory: bool = False
 
     def __post_init__(self, event, status, strata=None, start=None):
-        event = np.asarray(event).astype(float)
+        event = np.asarray(event, dtype=float)
         status = np.asarray(status)
         if not set(np.unique(status)).issubset(set([0,1])):
             raise ValueError('status must be binary')
 
-        status = np.asarray(status).astype(np.int32)        
+        status = np.asarray(status, dtype=np.int32)
         # Validate that status is integer type before casting
         if not np.issubdtype(status.dtype, np.integer):
             raise ValueError(f"status must be integer type, got {status.dtype}")
@@ -54,6 +78,8 @@ class StratifiedCoxDeviance:
         self._status = status
         self._start = start
 
+        self._stats = _PhaseStats(['python_gather', 'python_scatter'])
+
         # Preprocess and allocate buffers for each stratum
 
         self._preproc = []
@@ -81,6 +107,9 @@ class StratifiedCoxDeviance:
         self._diag_part_buffer = []
         self._w_avg_buffer = []
         self._exp_w_buffer = []
+        self._eta_buffer = []
+        self._weight_buffer = []
+        self._workspaces = []
 
         # allocate and preprocess
 
@@ -92,30 +121,35 @@ class StratifiedCoxDeviance:
             self._efron_stratum.append(self._efron and (np.linalg.norm(preproc['scaling']) > 0))
             n_stratum = len(idx)
             self._preproc.append(preproc)
-            self._event_order.append(event_order.astype(np.int32))
-            self._start_order.append(start_order.astype(np.int32))
+            self._event_order.append(np.asarray(event_order))
+            self._start_order.append(np.asarray(start_order))
             self._status_list.append(np.asarray(preproc['status']))
             self._event_list.append(np.asarray(preproc['event']))
             self._start_list.append(np.asarray(preproc['start']))
-            self._first.append(np.asarray(preproc['first']).astype(np.int32))
-            self._last.append(np.asarray(preproc['last']).astype(np.int32))
+            self._first.append(np.asarray(preproc['first']))
+            self._last.append(np.asarray(preproc['last']))
             self._scaling.append(np.asarray(preproc['scaling']))
-            self._event_map.append(np.asarray(preproc['event_map']).astype(np.int32))
-            self._start_map.append(np.asarray(preproc['start_map']).astype(np.int32))
+            self._event_map.append(np.asarray(preproc['event_map']))
+            self._start_map.append(np.asarray(preproc['start_map']))
             self._first_start.append(self._first[-1][self._start_map[-1]])
-            self._T_1_term.append(np.zeros(n_stratum))
-            self._T_2_term.append(np.zeros(n_stratum))
-            self._event_reorder_buffers.append([np.zeros(n_stratum) for _ in range(3)])
-            self._forward_cumsum_buffers.append([np.zeros(n_stratum+1) for _ in range(5)])
-            self._forward_scratch_buffer.append(np.zeros(n_stratum))
-            self._reverse_cumsum_buffers.append([np.zeros(n_stratum+1) for _ in range(4)])
-            self._risk_sum_buffers.append([np.zeros(n_stratum) for _ in range(2)])
-            self._hess_matvec_buffer.append(np.zeros(n_stratum))
-            self._grad_buffer.append(np.zeros(n_stratum))
-            self._diag_hessian_buffer.append(np.zeros(n_stratum))
-            self._diag_part_buffer.append(np.zeros(n_stratum))
-            self._w_avg_buffer.append(np.zeros(n_stratum))
-            self._exp_w_buffer.append(np.zeros(n_stratum))
+            # each stratum's buffers are those of a workspace of its size
+            ws = Workspace(n_stratum, self.low_memory)
+            self._workspaces.append(ws)
+            self._T_1_term.append(ws._T_1_term)
+            self._T_2_term.append(ws._T_2_term)
+            self._event_reorder_buffers.append(ws._event_reorder_buffers)
+            self._forward_cumsum_buffers.append(ws._forward_cumsum_buffers)
+            self._forward_scratch_buffer.append(ws._forward_scratch_buffer)
+            self._reverse_cumsum_buffers.append(ws._reverse_cumsum_buffers)
+            self._risk_sum_buffers.append(ws._risk_sum_buffers)
+            self._hess_matvec_buffer.append(ws._hess_matvec_buffer)
+            self._grad_buffer.append(ws._grad_buffer)
+            self._diag_hessian_buffer.append(ws._diag_hessian_buffer)
+            self._diag_part_buffer.append(ws._diag_part_buffer)
+            self._w_avg_buffer.append(ws._w_avg_buffer)
+            self._exp_w_buffer.append(ws._exp_w_buffer)
+            self._eta_buffer.append(ws._eta_buffer)
+            self._weight_buffer.append(np.zeros(n_stratum))
 
     """
     Stratified Cox Proportional Hazards Model Deviance Calculator.
@@ -135,6 +169,8 @@ class StratifiedCoxDeviance:
         Start times for left-truncated data.
     tie_breaking : {'efron', 'breslow'}, default='efron'
         Tie-breaking method.
+    low_memory : bool, default=False
+        Give each stratum low memory buffers, see `CoxDeviance`.
 
     Examples
     --------
@@ -149,23 +185,45 @@ class StratifiedCoxDeviance:
     >>> print(round(result.deviance, 4))
     14.2741
     """
-    def __call__(self, linear_predictor, sample_weight=None):
-        linear_predictor = np.asarray(linear_predictor)
+    def __call__(self, linear_predictor, sample_weight=None, out=None):
+        """
+        Deviance, gradient and Hessian diagonal, summed over strata.
+
+        `out`, if given, is a pair of arrays of shape (n,) the strata's
+        gradients and Hessian diagonals are scattered into, and that the
+        result then refers to.
+        """
+        linear_predictor = np.asarray(linear_predictor, dtype=float)
         if sample_weight is None:
             sample_weight = np.ones_like(linear_predictor)
         else:
-            sample_weight = np.asarray(sample_weight)
+            sample_weight = np.asarray(sample_weight, dtype=float)
         # Prepare outputs
         deviance = 0.0
         loglik_sat = 0.0
-        grad = np.zeros_like(linear_predictor)
-        diag_hess = np.zeros_like(linear_predictor)
+        if out is None:
+            grad = np.empty_like(linear_predictor)
+            diag_hess = np.empty_like(linear_predictor)
+        else:
+            grad, diag_hess = out
+            if grad.shape != linear_predictor.shape or diag_hess.shape != linear_predictor.shape:
+                raise ValueError('out must be arrays of shape %s' % (linear_predictor.shape,))
+        timed = _base._stats_enabled
         # Loop over strata
         for i, idx in enumerate(self._stratum_indices):
-            eta = linear_predictor[idx]
-            weight = sample_weight[idx]
-            eta = eta - eta.mean()
-            self._exp_w_buffer[i][:] = weight * np.exp(np.clip(eta, -np.inf, 30))
+            if timed:
+                tic = perf_counter()
+            # gather the stratum into its own buffers; indices are in
+            # range so mode='clip' only avoids take's internal copy
+            eta = np.take(linear_predictor, idx, out=self._eta_buffer[i], mode='clip')
+            weight = np.take(sample_weight, idx, out=self._weight_buffer[i], mode='clip')
+            eta -= eta.mean()
+            exp_w = self._exp_w_buffer[i]
+            np.minimum(eta, 30, out=exp_w)
+            np.exp(exp_w, out=exp_w)
+            exp_w *= weight
+            if timed:
+                self._stats.add('python_gather', tic, idx.nbytes + 4 * eta.nbytes + 3 * exp_w.nbytes)
             loglik_sat_i = _compute_sat_loglik(
                 self._first[i], self._last[i], weight, self._event_order[i], self._status_list[i], self._forward_cumsum_buffers[i][0]
             )
@@ -199,8 +257,12 @@ class StratifiedCoxDeviance:
                 self._efron_stratum[i]
             )
             deviance += dev
+            if timed:
+                tic = perf_counter()
             grad[idx] = self._grad_buffer[i]
             diag_hess[idx] = self._diag_hessian_buffer[i]
+            if timed:
+                self._stats.add('python_scatter', tic, 2 * idx.nbytes + 4 * eta.nbytes)
 
         return CoxDevianceResult(
             linear_predictor=linear_predictor,
@@ -217,6 +279,309 @@ class StratifiedCoxDeviance:
         """Return a block-diagonal LinearOperator representing the information matrix."""
         return StratifiedCoxInformation(self, linear_predictor, sample_weight)
 
+    def concordance(self,
+                    linear_predictor,
+                    sample_weight=None,
+                    method='harrell',
+                    tau=None,
+                    n_jobs=None):
+        """
+        Stratified concordance index, see `CoxDeviance.concordance`.
+
+        Pairs are only compared within a stratum and their counts summed
+        over strata. Strata are evaluated in a pool of `n_jobs` threads
+        (None for the `ThreadPoolExecutor` default); the compiled routine
+        runs without the GIL.
+
+        Returns
+        -------
+        ConcordanceResult
+        """
+        ipcw, tau = _check_concordance_method(method, tau)
+        linear_predictor = np.asarray(linear_predictor, dtype=float)
+        if sample_weight is None:
+            sample_weight = np.ones_like(linear_predictor)
+        else:
+            sample_weight = np.asarray(sample_weight, dtype=float)
+
+        def stratum_counts(i):
+            idx = self._stratum_indices[i]
+            return _concordance(linear_predictor[idx],
+                                sample_weight[idx],
+                                self._event_order[i],
+                                self._start_order[i],
+                                self._status_list[i],
+                                self._first[i],
+                                self._last[i],
+                                self._event_map[i],
+                                self._start_map[i],
+                                self._event_list[i],
+                                self._have_start_times,
+                                ipcw,
+                                tau)
+
+        if n_jobs == 1:
+            counts = [stratum_counts(i) for i in range(self._n_strata)]
+        else:
+            with ThreadPoolExecutor(n_jobs) as pool:
+                counts = list(pool.map(stratum_counts, range(self._n_strata)))
+        return ConcordanceResult.from_counts(np.sum(counts, axis=0))
+
+    def baseline_hazard(self, linear_predictor, sample_weight=None):
+        """
+        Baseline cumulative hazard of each stratum at a fitted linear
+        predictor, see `CoxDeviance.baseline_hazard`.
+
+        Returns
+        -------
+        StratifiedBaselineHazard
+        """
+        result = self(linear_predictor, sample_weight)
+        hazards = []
+        for i, idx in enumerate(self._stratum_indices):
+            n_stratum = idx.shape[0]
+            time = np.empty(n_stratum)
+            cumhaz = np.empty(n_stratum)
+            # each stratum's linear predictor was centered by its own mean
+            n_times = _baseline_hazard(self._event_order[i],
+                                       self._status_list[i],
+                                       self._first[i],
+                                       self._last[i],
+                                       self._event_list[i],
+                                       self._risk_sum_buffers[i][0],
+                                       self._w_avg_buffer[i],
+                                       float(result.linear_predictor[idx].mean()),
+                                       time,
+                                       cumhaz)
+            hazards.append(BaselineHazard(time=time[:n_times].copy(),
+                                          cumhaz=cumhaz[:n_times].copy()))
+        return StratifiedBaselineHazard(strata=self._unique_strata,
+                                        hazards=hazards)
+
+    def residuals(self, linear_predictor, sample_weight=None, X=None):
+        """
+        Residuals within each stratum, see `CoxDeviance.residuals`.
+
+        Returns
+        -------
+        CoxResiduals
+        """
+        self(linear_predictor, sample_weight)
+        n = self._event.shape[0]
+        residuals = CoxResiduals(martingale=np.empty(n),
+                                 deviance=np.empty(n))
+        if X is not None:
+            X = _covariates(X)
+            if X.shape[0] != n:
+                raise ValueError('X must have a row per observation')
+            residuals.score = np.empty(X.shape, order='F')
+            residuals.schoenfeld = np.empty(X.shape, order='F')
+        for i, idx in enumerate(self._stratum_indices):
+            n_stratum = idx.shape[0]
+            martingale = np.empty(n_stratum)
+            deviance = np.empty(n_stratum)
+            _martingale_residuals(self._event_order[i],
+                                  self._status_list[i],
+                                  self._T_1_term[i],
+                                  self._event_reorder_buffers[i][0],
+                                  martingale,
+                                  deviance)
+            residuals.martingale[idx] = martingale
+            residuals.deviance[idx] = deviance
+            if X is not None:
+                score = np.empty((n_stratum, X.shape[1]), order='F')
+                schoenfeld = np.empty((n_stratum, X.shape[1]), order='F')
+                _score_residuals(X[idx],
+                                 self._exp_w_buffer[i],
+                                 self._event_order[i],
+                                 self._start_order[i],
+                                 self._status_list[i],
+                                 self._first[i],
+                                 self._last[i],
+                                 self._scaling[i],
+                                 self._event_map[i],
+                                 self._start_map[i],
+                                 self._T_1_term[i],
+                                 self._w_avg_buffer[i],
+                                 self._event_reorder_buffers[i],
+                                 self._risk_sum_buffers[i],
+                                 self._forward_cumsum_buffers[i],
+                                 self._forward_scratch_buffer[i],
+                                 self._reverse_cumsum_buffers[i],
+                                 self._hess_matvec_buffer[i],
+                                 score,
+                                 schoenfeld,
+                                 self._have_start_times,
+                                 self._efron_stratum[i])
+                residuals.score[idx] = score
+                residuals.schoenfeld[idx] = schoenfeld
+        return residuals
+
+    def robust_variance(self,
+                        linear_predictor,
+                        X,
+                        cluster,
+                        sample_weight=None,
+                        n_jobs=None):
+        """
+        Cluster-robust variance, see `CoxDeviance.robust_variance`.
+
+        Clusters may span strata: each stratum's score sums by cluster
+        and information are formed in a pool of `n_jobs` threads (None
+        for the `ThreadPoolExecutor` default) and summed.
+
+        Returns
+        -------
+        RobustVariance
+        """
+        self(linear_predictor, sample_weight)
+        n = self._event.shape[0]
+        X = _covariates(X)
+        if X.shape[0] != n:
+            raise ValueError('X must have a row per observation')
+        codes, n_clusters = _cluster_codes(cluster, n, self._event_order[0].dtype)
+        p = X.shape[1]
+
+        def stratum_scores(i):
+            idx = self._stratum_indices[i]
+            U = np.empty((n_clusters, p), order='F')
+            information = np.empty((p, p), order='F')
+            _cluster_scores(X[idx],
+                            codes[idx],
+                            0,
+                            p,
+                            self._exp_w_buffer[i],
+                            self._event_order[i],
+                            self._start_order[i],
+                            self._status_list[i],
+                            self._first[i],
+                            self._last[i],
+                            self._scaling[i],
+                            self._event_map[i],
+                            self._start_map[i],
+                            self._T_1_term[i],
+                            self._diag_part_buffer[i],
+                            self._w_avg_buffer[i],
+                            self._event_reorder_buffers[i],
+                            self._risk_sum_buffers[i],
+                            self._forward_cumsum_buffers[i],
+                            self._forward_scratch_buffer[i],
+                            self._reverse_cumsum_buffers[i],
+                            self._hess_matvec_buffer[i],
+                            U,
+                            information,
+                            self._have_start_times,
+                            self._efron_stratum[i])
+            return U, information
+
+        if n_jobs == 1:
+            parts = [stratum_scores(i) for i in range(self._n_strata)]
+        else:
+            with ThreadPoolExecutor(n_jobs) as pool:
+                parts = list(pool.map(stratum_scores, range(self._n_strata)))
+        return RobustVariance.from_cluster_scores(sum(U for U, _ in parts),
+                                                  sum(I for _, I in parts))
+
+    def memory_footprint(self):
+        """
+        Bytes held, see `CoxDeviance.memory_footprint`: 'design' sums
+        the strata's preprocessed arrays and 'workspace' their buffers,
+        one set per stratum.
+        """
+        design = sum(values.nbytes
+                     for arrays in [self._event_order, self._start_order, self._status_list,
+                                    self._event_list, self._start_list, self._first, self._last,
+                                    self._scaling, self._event_map, self._start_map]
+                     for values in arrays)
+        workspace = (sum(ws.nbytes for ws in self._workspaces) +
+                     sum(weight.nbytes for weight in self._weight_buffer))
+        return {'design': design,
+                'workspace': workspace,
+                'workspace_doubles': workspace / (8 * max(self._event.shape[0], 1))}
+
+    def stats(self):
+        """Per-phase counters, see `CoxDeviance.stats`; the python phases
+        gather each stratum and scatter its results back."""
+        return self._stats.merged()
+
+    def reset_stats(self):
+        """Zero the counters reported by `stats`."""
+        _reset_compiled_stats()
+        self._stats.reset()
+
+
+@dataclass
+class StratifiedBaselineHazard:
+    """
+    Baseline cumulative hazards of a stratified Cox model.
+
+    Attributes
+    ----------
+    strata : np.ndarray
+        Stratum labels.
+    hazards : list of BaselineHazard
+        The baseline hazard of each of `strata`.
+    """
+
+    strata: np.ndarray
+    hazards: list
+
+    def __getitem__(self, stratum):
+        """The `BaselineHazard` of stratum label `stratum`."""
+        pos = np.searchsorted(self.strata, stratum)
+        if pos >= len(self.strata) or self.strata[pos] != stratum:
+            raise KeyError(stratum)
+        return self.hazards[pos]
+
+    def survival(self, linear_predictor, times, strata, n_jobs=None):
+        """
+        Predicted survival curves, each subject's from the baseline of
+        its stratum; see `BaselineHazard.survival`. Blocks of rows of all
+        strata share one pool of `n_jobs` threads.
+
+        Parameters
+        ----------
+        linear_predictor : np.ndarray
+            Linear predictor of each new subject.
+        times : np.ndarray
+            Query times.
+        strata : np.ndarray
+            Stratum label of each new subject.
+        n_jobs : int, optional
+            Number of threads, None for one per CPU.
+
+        Returns
+        -------
+        np.ndarray
+            Survival probabilities, a row per subject and a column per
+            query time.
+        """
+        linear_predictor = np.asarray(linear_predictor, dtype=float)
+        strata = np.asarray(strata).astype(np.int32)
+        times = np.ascontiguousarray(np.atleast_1d(times), dtype=float)
+        unknown = np.setdiff1d(np.unique(strata), self.strata)
+        if unknown.shape[0] > 0:
+            raise ValueError(f'no baseline hazard for strata {unknown}')
+
+        out = np.empty((linear_predictor.shape[0], times.shape[0]))
+        # gather each stratum's rows, fill its block in parallel, then scatter
+        blocks = []
+        tasks = []
+        for stratum, hazard in zip(self.strata, self.hazards):
+            idx = np.where(strata == stratum)[0]
+            if idx.shape[0] == 0:
+                continue
+            eta = linear_predictor[idx]
+            block = np.empty((idx.shape[0], times.shape[0]))
+            blocks.append((idx, block))
+            tasks.extend([lambda hazard=hazard, eta=eta, block=block, rows=rows:
+                          _survival(hazard.time, hazard.cumhaz, eta[rows], times, block[rows])
+                          for rows in _row_blocks(idx.shape[0], n_jobs)])
+        _run_tasks(tasks, n_jobs)
+        for idx, block in blocks:
+            out[idx] = block
+        return out
+
 
 class StratifiedCoxInformation(LinearOperator):
 
@@ -272,16 +637,28 @@ class StratifiedCoxInformation(LinearOperator):
             blockdev._hess_matvec_buffer = self.strat_cox._hess_matvec_buffer[i]
             blockdev._have_start_times = self.strat_cox._have_start_times
             blockdev._efron = self.strat_cox._efron
-            # Use CoxInformation
-            block_info = CoxInformation(result=result, coxdev=blockdev)
+            blockdev._result = result
+            # Use CoxInformation, the block holds its own buffers
+            block_info = CoxInformation(result=result, coxdev=blockdev, workspace=blockdev)
             self._block_infos.append((idx, block_info))
 
-    def _matvec(self, v):
+    def matvec(self, v, out=None):
+        """Information times `v`, written to `out` if given."""
+        if out is None:
+            return super().matvec(v)
+        if out.shape != (self.n,):
+            raise ValueError('out must have shape %s' % (self.shape[:1],))
+        return self._matvec(v, out)
+
+    def _matvec(self, v, out=None):
         v = np.asarray(v).reshape(-1)
-        result = np.zeros_like(v)
+        if out is None:
+            out = np.empty(self.n)
+        # each block's Hessian product is scattered from its buffer,
+        # and the whole negated once
         for idx, block_info in self._block_infos:
-            result[idx] = block_info @ v[idx]
-        return result
+            out[idx] = block_info._hessian_matvec(v[idx])
+        return np.negative(out, out=out)
 
     def _adjoint(self, v):
         return self._matvec(v)
@@ -77,6 +77,12 @@ def ensure_eigen_available():
 
 # Cox extension
 
+# debug builds can count heap allocations made inside the kernels,
+# see tests/test_allocations.py
+define_macros = []
+if os.environ.get('COXDEV_COUNT_ALLOCATIONS'):
+    define_macros.append(('COXDEV_COUNT_ALLOCATIONS', '1'))
+
 EXTS=[Extension(
     'coxdev.coxc',
     sources=['R_pkg/coxdev/src/coxdev.cpp',
@@ -85,8 +91,24 @@ EXTS=[Extension(
                   eigendir,
                   "R_pkg/coxdev/inst/include"],
     depends=["R_pkg/coxdev/inst/include/coxdev.h",
-             "R_pkg/coxdev/inst/include/coxdev_strata.h"][:1],
+             "R_pkg/coxdev/inst/include/coxdev_core.h",
+             "R_pkg/coxdev/inst/include/coxdev_concordance.h",
+             "R_pkg/coxdev/inst/include/coxdev_survival.h",
+             "R_pkg/coxdev/inst/include/coxdev_residuals.h",
+             "R_pkg/coxdev/inst/include/coxdev_robust.h",
+             "R_pkg/coxdev/inst/include/coxdev_bootstrap.h",
+             "R_pkg/coxdev/inst/include/coxdev_information.h",
+             "R_pkg/coxdev/inst/include/coxdev_stream.h",
+             "R_pkg/coxdev/inst/include/coxdev_screen.h",
+             "R_pkg/coxdev/inst/include/coxdev_multi.h",
+             "R_pkg/coxdev/inst/include/coxdev_horizon.h",
+             "R_pkg/coxdev/inst/include/coxdev_landmark.h",
+             "R_pkg/coxdev/inst/include/coxdev_finegray.h",
+             "R_pkg/coxdev/inst/include/coxdev_exact.h",
+             "R_pkg/coxdev/inst/include/coxdev_sampled.h",
+             "R_pkg/coxdev/inst/include/coxdev_strata.h"][:-1],
     language='c++',
+    define_macros=define_macros,
     extra_compile_args=['-std=c++17', '-DPY_INTERFACE=1'])]
 
 cmdclass = versioneer.get_cmdclass()
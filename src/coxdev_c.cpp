@@ -0,0 +1,760 @@
+// C interface of coxdev_c.h over the header only core.
+
+#include "coxdev_c.h"
+#include "coxdev_core.h"
+#include "coxdev_concordance.h"
+#include "coxdev_survival.h"
+#include "coxdev_residuals.h"
+#include "coxdev_robust.h"
+#include "coxdev_bootstrap.h"
+#include "coxdev_information.h"
+#include "coxdev_stream.h"
+#include "coxdev_screen.h"
+#include "coxdev_multi.h"
+#include "coxdev_horizon.h"
+#include "coxdev_landmark.h"
+#include "coxdev_finegray.h"
+#include "coxdev_exact.h"
+#include "coxdev_sampled.h"
+
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// The index width is picked from n, as in the bindings. A Fine-Gray design
+// is preprocessed with the cause as status and keeps the competing event
+// indicators in event order.
+struct coxdev_design {
+  std::unique_ptr<coxdev::CoxDesignData<int32_t> > narrow;
+  std::unique_ptr<coxdev::CoxDesignData<int64_t> > wide;
+  bool finegray = false;
+  Eigen::VectorXi competing;
+
+  int64_t size() const { return narrow ? narrow->size() : wide->size(); }
+};
+
+struct coxdev_workspace {
+  coxdev_workspace(int64_t n, bool low_memory) : size(n), work(n, low_memory) {}
+  int64_t size;
+  coxdev::CoxWorkspaceData work;
+};
+
+struct coxdev_outcomes {
+  std::unique_ptr<coxdev::CoxOutcomesData<int32_t> > narrow;
+  std::unique_ptr<coxdev::CoxOutcomesData<int64_t> > wide;
+
+  int64_t size() const { return narrow ? narrow->size() : wide->size(); }
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+int fail(const char *message)
+{
+  last_error = message;
+  return COXDEV_ERROR;
+}
+
+// Run f, turning exceptions into COXDEV_ERROR.
+template <typename F>
+int guarded(F f)
+{
+  try {
+    f();
+  } catch (const std::bad_alloc &) {
+    return fail("out of memory");
+  } catch (const std::exception & e) {
+    return fail(e.what());
+  }
+  return COXDEV_OK;
+}
+
+int check_evaluation(const coxdev_design *design,
+		     const coxdev_workspace *workspace)
+{
+  if (design == nullptr || workspace == nullptr) {
+    return fail("design and workspace must not be NULL");
+  }
+  if (design->size() != workspace->size) {
+    return fail("workspace was created for a design of a different size");
+  }
+  return COXDEV_OK;
+}
+
+}
+
+extern "C" {
+
+int coxdev_design_create(int64_t n,
+			 const double *start,
+			 const double *event,
+			 const int *status,
+			 int tie_breaking,
+			 coxdev_design **design)
+{
+  if (design == nullptr) {
+    return fail("design must not be NULL");
+  }
+  *design = nullptr;
+  if (n < 0 || (n > 0 && (event == nullptr || status == nullptr))) {
+    return fail("event and status must hold n values");
+  }
+  if (tie_breaking != COXDEV_EFRON && tie_breaking != COXDEV_BRESLOW) {
+    return fail("tie_breaking must be COXDEV_EFRON or COXDEV_BRESLOW");
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    if (status[i] != 0 && status[i] != 1) {
+      return fail("status must be binary");
+    }
+  }
+  const bool efron = tie_breaking == COXDEV_EFRON;
+  return guarded([&]() {
+      std::unique_ptr<coxdev_design> result(new coxdev_design);
+      if (coxdev::use_int32_index(n)) {
+	result->narrow.reset(new coxdev::CoxDesignData<int32_t>(n, start, event, status, efron));
+      } else {
+	result->wide.reset(new coxdev::CoxDesignData<int64_t>(n, start, event, status, efron));
+      }
+      *design = result.release();
+    });
+}
+
+void coxdev_design_free(coxdev_design *design)
+{
+  delete design;
+}
+
+int64_t coxdev_design_size(const coxdev_design *design)
+{
+  return design->size();
+}
+
+int coxdev_design_append(coxdev_design *design,
+			 int64_t m,
+			 const double *start,
+			 const double *event,
+			 const int *status)
+{
+  if (design == nullptr) {
+    return fail("design must not be NULL");
+  }
+  if (m < 0 || (m > 0 && (event == nullptr || status == nullptr))) {
+    return fail("event and status must hold m values");
+  }
+  if (design->finegray) {
+    return fail("Fine-Gray designs cannot be appended to");
+  }
+  const bool have_start_times = design->narrow ? design->narrow->have_start_times : design->wide->have_start_times;
+  if ((start != nullptr) != have_start_times) {
+    return fail("start must be given exactly when the design has start times");
+  }
+  for (int64_t i = 0; i < m; ++i) {
+    if (status[i] != 0 && status[i] != 1) {
+      return fail("status must be binary");
+    }
+  }
+  return guarded([&]() {
+      // widen the indices once the cohort outgrows int32, as at creation
+      if (design->narrow && !coxdev::use_int32_index(design->size() + m)) {
+	design->wide.reset(new coxdev::CoxDesignData<int64_t>(*design->narrow));
+	design->narrow.reset();
+      }
+      if (design->narrow) {
+	coxdev::append<int32_t>(*design->narrow, m, start, event, status);
+      } else {
+	coxdev::append<int64_t>(*design->wide, m, start, event, status);
+      }
+    });
+}
+
+int coxdev_workspace_create(const coxdev_design *design,
+			    coxdev_workspace **workspace)
+{
+  if (design == nullptr || workspace == nullptr) {
+    return fail("design and workspace must not be NULL");
+  }
+  *workspace = nullptr;
+  return guarded([&]() { *workspace = new coxdev_workspace(design->size(), false); });
+}
+
+int coxdev_workspace_create_low_memory(const coxdev_design *design,
+				       coxdev_workspace **workspace)
+{
+  if (design == nullptr || workspace == nullptr) {
+    return fail("design and workspace must not be NULL");
+  }
+  *workspace = nullptr;
+  return guarded([&]() { *workspace = new coxdev_workspace(design->size(), true); });
+}
+
+void coxdev_workspace_free(coxdev_workspace *workspace)
+{
+  delete workspace;
+}
+
+int64_t coxdev_workspace_nbytes(const coxdev_workspace *workspace)
+{
+  return workspace != nullptr ? static_cast<int64_t>(workspace->work.nbytes()) : 0;
+}
+
+int coxdev_deviance(const coxdev_design *design,
+		    coxdev_workspace *workspace,
+		    const double *eta,
+		    const double *weight,
+		    double *deviance,
+		    double *gradient,
+		    double *diag_hessian)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (eta == nullptr || deviance == nullptr) {
+    return fail("eta and deviance must not be NULL");
+  }
+  return guarded([&]() {
+      *deviance = design->narrow ?
+	coxdev::deviance(*design->narrow, workspace->work, eta, weight, gradient, diag_hessian) :
+	coxdev::deviance(*design->wide, workspace->work, eta, weight, gradient, diag_hessian);
+    });
+}
+
+int coxdev_information_matvec(const coxdev_design *design,
+			      coxdev_workspace *workspace,
+			      const double *arg,
+			      double *out)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (arg == nullptr || out == nullptr) {
+    return fail("arg and out must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::information_matvec(*design->narrow, workspace->work, arg, out);
+      } else {
+	coxdev::information_matvec(*design->wide, workspace->work, arg, out);
+      }
+    });
+}
+
+int coxdev_information_matrix(const coxdev_design *design,
+			      coxdev_workspace *workspace,
+			      const int64_t *rows,
+			      int64_t n_rows,
+			      const int64_t *columns,
+			      int64_t n_columns,
+			      double *out)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if ((rows != nullptr && n_rows < 0) || (columns != nullptr && n_columns < 0)) {
+    return fail("n_rows and n_columns must be non negative");
+  }
+  if (out == nullptr) {
+    return fail("out must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::information_matrix(*design->narrow, workspace->work, rows, n_rows, columns, n_columns, out);
+      } else {
+	coxdev::information_matrix(*design->wide, workspace->work, rows, n_rows, columns, n_columns, out);
+      }
+    });
+}
+
+int coxdev_concordance(const coxdev_design *design,
+		       const double *eta,
+		       const double *weight,
+		       int method,
+		       double tau,
+		       double *concordance,
+		       double *counts)
+{
+  if (design == nullptr || eta == nullptr || concordance == nullptr) {
+    return fail("design, eta and concordance must not be NULL");
+  }
+  if (method != COXDEV_HARRELL && method != COXDEV_UNO) {
+    return fail("method must be COXDEV_HARRELL or COXDEV_UNO");
+  }
+  const bool ipcw = method == COXDEV_UNO;
+  return guarded([&]() {
+      const coxdev::Concordance c = design->narrow ?
+	coxdev::concordance(*design->narrow, eta, weight, ipcw, tau) :
+	coxdev::concordance(*design->wide, eta, weight, ipcw, tau);
+      *concordance = c.index();
+      if (counts != nullptr) {
+	counts[0] = c.concordant;
+	counts[1] = c.discordant;
+	counts[2] = c.tied_risk;
+      }
+    });
+}
+
+int coxdev_baseline_hazard(const coxdev_design *design,
+			   const coxdev_workspace *workspace,
+			   double *time,
+			   double *cumhaz,
+			   int64_t *n_times)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (time == nullptr || cumhaz == nullptr || n_times == nullptr) {
+    return fail("time, cumhaz and n_times must not be NULL");
+  }
+  return guarded([&]() {
+      *n_times = design->narrow ?
+	coxdev::baseline_hazard(*design->narrow, workspace->work, time, cumhaz) :
+	coxdev::baseline_hazard(*design->wide, workspace->work, time, cumhaz);
+    });
+}
+
+int coxdev_survival(const double *time,
+		    const double *cumhaz,
+		    int64_t n_times,
+		    const double *eta,
+		    int64_t n,
+		    const double *query,
+		    int64_t n_query,
+		    double *survival)
+{
+  if (n_times < 0 || n < 0 || n_query < 0) {
+    return fail("lengths must be non-negative");
+  }
+  if ((n_times > 0 && (time == nullptr || cumhaz == nullptr)) ||
+      (n > 0 && eta == nullptr) || (n_query > 0 && query == nullptr) ||
+      (n > 0 && n_query > 0 && survival == nullptr)) {
+    return fail("time, cumhaz, eta, query and survival must not be NULL");
+  }
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrix;
+  return guarded([&]() {
+      coxdev::survival_curves<double>(Eigen::Map<const Eigen::VectorXd>(time, n_times),
+				      Eigen::Map<const Eigen::VectorXd>(cumhaz, n_times),
+				      Eigen::Map<const Eigen::VectorXd>(eta, n),
+				      Eigen::Map<const Eigen::VectorXd>(query, n_query),
+				      Eigen::Map<RowMajorMatrix>(survival, n, n_query));
+    });
+}
+
+int coxdev_residuals(const coxdev_design *design,
+		     const coxdev_workspace *workspace,
+		     double *martingale,
+		     double *deviance)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (martingale == nullptr) {
+    return fail("martingale must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::martingale_residuals(*design->narrow, workspace->work, martingale, deviance);
+      } else {
+	coxdev::martingale_residuals(*design->wide, workspace->work, martingale, deviance);
+      }
+    });
+}
+
+int coxdev_score_residuals(const coxdev_design *design,
+			   coxdev_workspace *workspace,
+			   const double *X,
+			   int64_t p,
+			   double *score,
+			   double *schoenfeld)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (p < 0) {
+    return fail("p must be non-negative");
+  }
+  if (p > 0 && X == nullptr) {
+    return fail("X must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::score_residuals(*design->narrow, workspace->work, X, p, score, schoenfeld);
+      } else {
+	coxdev::score_residuals(*design->wide, workspace->work, X, p, score, schoenfeld);
+      }
+    });
+}
+
+int coxdev_robust_variance(const coxdev_design *design,
+			   coxdev_workspace *workspace,
+			   const double *X,
+			   int64_t p,
+			   const int64_t *cluster,
+			   int64_t n_clusters,
+			   double *meat,
+			   double *covariance)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (p <= 0 || n_clusters <= 0) {
+    return fail("p and n_clusters must be positive");
+  }
+  if (X == nullptr || cluster == nullptr || meat == nullptr || covariance == nullptr) {
+    return fail("X, cluster, meat and covariance must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::robust_variance(*design->narrow, workspace->work, X, p, cluster, n_clusters, meat, covariance);
+      } else {
+	coxdev::robust_variance(*design->wide, workspace->work, X, p, cluster, n_clusters, meat, covariance);
+      }
+    });
+}
+
+int coxdev_score_screen(const coxdev_design *design,
+			coxdev_workspace *workspace,
+			const double *Z,
+			int64_t q,
+			const double *X,
+			int64_t p,
+			double *score,
+			double *variance)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (p < 0 || q < 0) {
+    return fail("p and q must be non negative");
+  }
+  if ((q > 0 && Z == nullptr) || X == nullptr || score == nullptr || variance == nullptr) {
+    return fail("Z (when q > 0), X, score and variance must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::score_screen(*design->narrow, workspace->work, Z, q, X, p, score, variance);
+      } else {
+	coxdev::score_screen(*design->wide, workspace->work, Z, q, X, p, score, variance);
+      }
+    });
+}
+
+int coxdev_bootstrap(const coxdev_design *design,
+		     coxdev_workspace *workspace,
+		     const double *eta,
+		     const double *weight,
+		     int scheme,
+		     uint64_t seed,
+		     int64_t first_replicate,
+		     int64_t n_replicates,
+		     const double *X,
+		     int64_t p,
+		     double *deviance,
+		     double *X_gradient)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (scheme != COXDEV_POISSON && scheme != COXDEV_BAYESIAN) {
+    return fail("scheme must be COXDEV_POISSON or COXDEV_BAYESIAN");
+  }
+  if (first_replicate < 0 || n_replicates < 0 || (X != nullptr && p <= 0)) {
+    return fail("first_replicate and n_replicates must be non negative and p positive");
+  }
+  if (eta == nullptr || deviance == nullptr || (X != nullptr && X_gradient == nullptr)) {
+    return fail("eta, deviance and, with X, X_gradient must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::bootstrap_deviances(*design->narrow, workspace->work, eta, weight, scheme == COXDEV_BAYESIAN,
+				    seed, first_replicate, n_replicates, X, p, deviance, X_gradient);
+      } else {
+	coxdev::bootstrap_deviances(*design->wide, workspace->work, eta, weight, scheme == COXDEV_BAYESIAN,
+				    seed, first_replicate, n_replicates, X, p, deviance, X_gradient);
+      }
+    });
+}
+
+int coxdev_bootstrap_weights(int scheme,
+			     uint64_t seed,
+			     int64_t replicate,
+			     int64_t n,
+			     double *weight)
+{
+  if (scheme != COXDEV_POISSON && scheme != COXDEV_BAYESIAN) {
+    return fail("scheme must be COXDEV_POISSON or COXDEV_BAYESIAN");
+  }
+  if (n < 0 || replicate < 0 || weight == nullptr) {
+    return fail("n and replicate must be non negative and weight not NULL");
+  }
+  coxdev::bootstrap_weights(scheme == COXDEV_BAYESIAN, seed, replicate,
+			    Eigen::Map<Eigen::VectorXd>(weight, n));
+  return COXDEV_OK;
+}
+
+int coxdev_horizon_sweep(const coxdev_design *design,
+			 coxdev_workspace *workspace,
+			 const double *horizon,
+			 int64_t m,
+			 double *loglik_sat,
+			 double *deviance,
+			 double *gradient)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (m < 0 || (m > 0 && (horizon == nullptr || loglik_sat == nullptr || deviance == nullptr))) {
+    return fail("horizon, loglik_sat and deviance must hold m values");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::horizon_sweep(*design->narrow, workspace->work, horizon, m, loglik_sat, deviance, gradient);
+      } else {
+	coxdev::horizon_sweep(*design->wide, workspace->work, horizon, m, loglik_sat, deviance, gradient);
+      }
+    });
+}
+
+int coxdev_landmark_deviances(const coxdev_design *design,
+			      const double *eta,
+			      const double *weight,
+			      const double *landmark,
+			      const double *horizon,
+			      int64_t L,
+			      double *loglik_sat,
+			      double *deviance,
+			      double *gradient)
+{
+  if (design == nullptr) {
+    return fail("design must not be NULL");
+  }
+  if (L < 0 || (L > 0 && (eta == nullptr || landmark == nullptr || horizon == nullptr ||
+			  loglik_sat == nullptr || deviance == nullptr))) {
+    return fail("eta, landmark, horizon, loglik_sat and deviance must hold L values");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::landmark_deviances(*design->narrow, eta, weight, landmark, horizon, L, loglik_sat, deviance, gradient);
+      } else {
+	coxdev::landmark_deviances(*design->wide, eta, weight, landmark, horizon, L, loglik_sat, deviance, gradient);
+      }
+    });
+}
+
+int coxdev_exact_deviance(const coxdev_design *design,
+			  const double *eta,
+			  const double *weight,
+			  double *deviance,
+			  double *gradient,
+			  double *diag_hessian)
+{
+  if (design == nullptr || eta == nullptr || deviance == nullptr) {
+    return fail("design, eta and deviance must not be NULL");
+  }
+  return guarded([&]() {
+      *deviance = design->narrow ?
+	coxdev::exact_deviance(*design->narrow, eta, weight, gradient, diag_hessian) :
+	coxdev::exact_deviance(*design->wide, eta, weight, gradient, diag_hessian);
+    });
+}
+
+int coxdev_sampled_deviance(const coxdev_design *design,
+			    const double *eta,
+			    const double *weight,
+			    int64_t n_controls,
+			    uint64_t seed,
+			    double *deviance,
+			    double *variance,
+			    double *gradient,
+			    double *diag_hessian)
+{
+  if (design == nullptr || eta == nullptr || deviance == nullptr) {
+    return fail("design, eta and deviance must not be NULL");
+  }
+  if (n_controls < 1) {
+    return fail("n_controls must be positive");
+  }
+  return guarded([&]() {
+      *deviance = design->narrow ?
+	coxdev::sampled_deviance(*design->narrow, eta, weight, n_controls, seed, variance, gradient, diag_hessian) :
+	coxdev::sampled_deviance(*design->wide, eta, weight, n_controls, seed, variance, gradient, diag_hessian);
+    });
+}
+
+int coxdev_finegray_create(int64_t n,
+			   const double *event,
+			   const int *status,
+			   int tie_breaking,
+			   coxdev_design **design)
+{
+  if (design == nullptr) {
+    return fail("design must not be NULL");
+  }
+  *design = nullptr;
+  if (n < 0 || (n > 0 && (event == nullptr || status == nullptr))) {
+    return fail("event and status must hold n values");
+  }
+  if (tie_breaking != COXDEV_EFRON && tie_breaking != COXDEV_BRESLOW) {
+    return fail("tie_breaking must be COXDEV_EFRON or COXDEV_BRESLOW");
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    if (status[i] < 0 || status[i] > 2) {
+      return fail("status must be 0, 1 or 2");
+    }
+  }
+  const bool efron = tie_breaking == COXDEV_EFRON;
+  return guarded([&]() {
+      std::vector<int> cause(n);
+      for (int64_t i = 0; i < n; ++i) {
+	cause[i] = status[i] == 1;
+      }
+      std::unique_ptr<coxdev_design> result(new coxdev_design);
+      result->finegray = true;
+      if (coxdev::use_int32_index(n)) {
+	result->narrow.reset(new coxdev::CoxDesignData<int32_t>(n, nullptr, event, cause.data(), efron));
+	result->competing = coxdev::competing_events<int32_t>(result->narrow->design().event_order, status);
+      } else {
+	result->wide.reset(new coxdev::CoxDesignData<int64_t>(n, nullptr, event, cause.data(), efron));
+	result->competing = coxdev::competing_events<int64_t>(result->wide->design().event_order, status);
+      }
+      *design = result.release();
+    });
+}
+
+int coxdev_finegray_deviance(const coxdev_design *design,
+			     coxdev_workspace *workspace,
+			     const double *eta,
+			     const double *weight,
+			     double *deviance,
+			     double *gradient,
+			     double *diag_hessian)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (!design->finegray) {
+    return fail("design was not created by coxdev_finegray_create");
+  }
+  if (eta == nullptr || deviance == nullptr) {
+    return fail("eta and deviance must not be NULL");
+  }
+  return guarded([&]() {
+      *deviance = design->narrow ?
+	coxdev::finegray_deviance(*design->narrow, design->competing, workspace->work, eta, weight, gradient, diag_hessian) :
+	coxdev::finegray_deviance(*design->wide, design->competing, workspace->work, eta, weight, gradient, diag_hessian);
+    });
+}
+
+int coxdev_finegray_information_matvec(const coxdev_design *design,
+				       coxdev_workspace *workspace,
+				       const double *arg,
+				       double *out)
+{
+  if (check_evaluation(design, workspace) != COXDEV_OK) {
+    return COXDEV_ERROR;
+  }
+  if (!design->finegray) {
+    return fail("design was not created by coxdev_finegray_create");
+  }
+  if (arg == nullptr || out == nullptr) {
+    return fail("arg and out must not be NULL");
+  }
+  return guarded([&]() {
+      if (design->narrow) {
+	coxdev::finegray_information_matvec(*design->narrow, design->competing, workspace->work, arg, out);
+      } else {
+	coxdev::finegray_information_matvec(*design->wide, design->competing, workspace->work, arg, out);
+      }
+    });
+}
+
+int coxdev_outcomes_create(int64_t n,
+			   int64_t K,
+			   const double *start,
+			   const double *event,
+			   const int *status,
+			   int tie_breaking,
+			   coxdev_outcomes **outcomes)
+{
+  if (outcomes == nullptr) {
+    return fail("outcomes must not be NULL");
+  }
+  *outcomes = nullptr;
+  if (n < 0 || K < 0 || (n * K > 0 && (event == nullptr || status == nullptr))) {
+    return fail("event and status must hold n x K values");
+  }
+  if (tie_breaking != COXDEV_EFRON && tie_breaking != COXDEV_BRESLOW) {
+    return fail("tie_breaking must be COXDEV_EFRON or COXDEV_BRESLOW");
+  }
+  for (int64_t i = 0; i < n * K; ++i) {
+    if (status[i] != 0 && status[i] != 1) {
+      return fail("status must be binary");
+    }
+  }
+  const bool efron = tie_breaking == COXDEV_EFRON;
+  return guarded([&]() {
+      std::unique_ptr<coxdev_outcomes> result(new coxdev_outcomes);
+      if (coxdev::use_int32_index(n)) {
+	result->narrow.reset(new coxdev::CoxOutcomesData<int32_t>(n, K, start, event, status, efron));
+      } else {
+	result->wide.reset(new coxdev::CoxOutcomesData<int64_t>(n, K, start, event, status, efron));
+      }
+      *outcomes = result.release();
+    });
+}
+
+void coxdev_outcomes_free(coxdev_outcomes *outcomes)
+{
+  delete outcomes;
+}
+
+int coxdev_outcomes_workspace_create(const coxdev_outcomes *outcomes,
+				     coxdev_workspace **workspace)
+{
+  if (outcomes == nullptr || workspace == nullptr) {
+    return fail("outcomes and workspace must not be NULL");
+  }
+  *workspace = nullptr;
+  return guarded([&]() { *workspace = new coxdev_workspace(outcomes->size(), false); });
+}
+
+int coxdev_outcomes_deviance(const coxdev_outcomes *outcomes,
+			     coxdev_workspace *workspace,
+			     const double *eta,
+			     const double *weight,
+			     int64_t first_outcome,
+			     int64_t count,
+			     double *deviance,
+			     double *gradient)
+{
+  if (outcomes == nullptr || workspace == nullptr) {
+    return fail("outcomes and workspace must not be NULL");
+  }
+  if (outcomes->size() != workspace->size) {
+    return fail("workspace was created for outcomes of a different size");
+  }
+  if (eta == nullptr || deviance == nullptr) {
+    return fail("eta and deviance must not be NULL");
+  }
+  return guarded([&]() {
+      if (outcomes->narrow) {
+	coxdev::outcome_deviances(*outcomes->narrow, workspace->work, eta, weight, first_outcome, count,
+				  deviance, gradient);
+      } else {
+	coxdev::outcome_deviances(*outcomes->wide, workspace->work, eta, weight, first_outcome, count,
+				  deviance, gradient);
+      }
+    });
+}
+
+const char *coxdev_last_error(void)
+{
+  return last_error.c_str();
+}
+
+int coxdev_set_stats_enabled(int enabled)
+{
+  return coxdev::set_stats_enabled(enabled != 0) ? 1 : 0;
+}
+
+}
@@ -122,4 +122,16 @@ def simulate_df(tie_types,
         df = pd.concat([df, df_noinfo])
 
     return df
-        
+
+def simulate_arrays(have_start_times,
+                    nrep=5,
+                    size=5,
+                    rng=rng):
+    # start (None without start times), event and status as arrays, with
+    # every type of tie
+    data = simulate_df(all_combos[-1],
+                       nrep=nrep,
+                       size=size,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    return start, np.asarray(data['event']), np.asarray(data['status'])
@@ -0,0 +1,67 @@
+import pytest
+
+import numpy as np
+from coxdev import CoxDeviance, StratifiedCoxDeviance
+from coxdev.coxc import allocation_count
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng)
+
+# build with COXDEV_COUNT_ALLOCATIONS=1 in the environment to run these
+pytestmark = pytest.mark.skipif(allocation_count() < 0,
+                                reason='built without COXDEV_COUNT_ALLOCATIONS')
+
+rng = np.random.default_rng(0)
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('dtype', [np.float64, np.float32])
+def test_no_allocations(tie_breaking,
+                        have_start_times,
+                        dtype):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=20,
+                       size=5,
+                       rng=rng)
+    start = data['start'] if have_start_times else None
+    cox = CoxDeviance(event=data['event'],
+                      start=start,
+                      status=data['status'],
+                      tie_breaking=tie_breaking)
+    n = data.shape[0]
+    weight = rng.uniform(1, 2, size=n).astype(dtype)
+    V = rng.standard_normal((n, 3)).astype(dtype)
+
+    # warm up: workspace allocation happens on first use
+    eta = rng.standard_normal(n).astype(dtype)
+    cox(eta, weight)
+    cox.information(eta, weight) @ V
+
+    before = allocation_count()
+    for _ in range(3):
+        # a new linear predictor each time, so nothing is served from cache
+        eta = rng.standard_normal(n).astype(dtype)
+        cox(eta, weight)
+        cox.information(eta, weight) @ V
+    assert allocation_count() == before
+
+def test_stratified_no_allocations():
+
+    data = simulate_df(all_combos[-1],
+                       nrep=20,
+                       size=5,
+                       rng=rng)
+    n = data.shape[0]
+    strata = rng.choice(3, size=n)
+    cox = StratifiedCoxDeviance(event=data['event'],
+                                start=data['start'],
+                                status=data['status'],
+                                strata=strata)
+    cox(rng.standard_normal(n))
+
+    before = allocation_count()
+    for _ in range(3):
+        cox(rng.standard_normal(n))
+    assert allocation_count() == before
@@ -0,0 +1,109 @@
+import pickle
+
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def _rows(start, rows):
+    return None if start is None else start[rows]
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('calendar', [True, False])
+def test_append(have_start_times,
+                tie_breaking,
+                calendar):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    if calendar:
+        # batches arrive in order of event time, each after the last
+        order = np.argsort(event, kind='stable')
+        event, status = event[order], status[order]
+        start = _rows(start, order)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    v = rng.standard_normal(n)
+
+    full = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    expected = full(eta, weight)
+    expected_info = full.information(eta, weight) @ v
+
+    n0 = n // 4
+    cox = CoxDeviance(event=event[:n0], status=status[:n0], start=_rows(start, slice(0, n0)),
+                      tie_breaking=tie_breaking)
+    cox(eta[:n0], weight[:n0])
+    bounds = [n0, n0, n // 3, n // 2 + 1, n - 2, n]
+    for begin, end in zip(bounds[:-1], bounds[1:]):
+        cox.append(event[begin:end], status[begin:end], start=_rows(start, slice(begin, end)))
+        assert cox.design.n == end
+
+    # the workspace used before the appends is resized for the whole cohort
+    result = cox(eta, weight)
+    assert np.allclose(result.deviance, expected.deviance)
+    assert np.allclose(result.gradient, expected.gradient)
+    assert np.allclose(result.diag_hessian, expected.diag_hessian)
+    assert np.allclose(cox.information(eta, weight) @ v, expected_info)
+    assert cox.design.efron == full.design.efron
+
+    for attr in ['status', 'scaling']:
+        assert np.array_equal(getattr(cox.design, attr), getattr(full.design, attr))
+    assert np.array_equal(cox._event, full._event)
+
+def test_append_checks():
+
+    start, event, status = simulate_arrays(True)
+    cox = CoxDeviance(event=event, status=status, start=start)
+    with pytest.raises(ValueError):
+        cox.append(event[:2], status[:2])
+    with pytest.raises(ValueError):
+        cox.append(event[:2], [0, 2], start=start[:2])
+    with pytest.raises(ValueError):
+        cox.append(event[:2], status[:3], start=start[:2])
+
+    cox = CoxDeviance(event=event, status=status)
+    with pytest.raises(ValueError):
+        cox.append(event[:2], status[:2], start=start[:2])
+
+    # many small batches grow the room geometrically
+    n = event.shape[0]
+    capacities = set()
+    for i in range(50):
+        cox.append(event[i % n:i % n + 1], status[i % n:i % n + 1])
+        capacities.add(cox._arrays['status'].shape[0])
+    assert cox.design.n == n + 50
+    assert len(capacities) <= 2
+
+def test_append_pickle():
+
+    start, event, status = simulate_arrays(True)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    expected = CoxDeviance(event=event, status=status, start=start)(eta, weight)
+
+    n0 = n // 2
+    cox = CoxDeviance(event=event[:n0], status=status[:n0], start=start[:n0])
+    cox.append(event[n0:], status[n0:], start=start[n0:])
+    # the preprocessed arrays describe the whole cohort
+    assert cox._preproc['status'].shape[0] == n
+    assert cox._preproc['status'] is cox.design.status
+    assert np.array_equal(cox._first_start, cox._first[cox._start_map])
+
+    # only the cohort's rows are pickled, not the room kept for appends
+    copy = pickle.loads(pickle.dumps(cox))
+    assert copy._arrays is None
+    assert all(values.shape[0] == n for values in copy._preproc.values())
+    result = copy(eta, weight)
+    assert np.allclose(result.deviance, expected.deviance)
+    assert np.allclose(result.gradient, expected.gradient)
+
+    # and the copy can be appended to in turn
+    copy.append(event[:3], status[:3], start=start[:3])
+    assert copy.design.n == n + 3
+    assert copy._preproc['event'].shape[0] == n + 3
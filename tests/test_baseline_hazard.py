@@ -0,0 +1,152 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, StratifiedCoxDeviance
+
+try:
+    import rpy2.robjects as rpy
+    has_rpy2 = True
+except ImportError:
+    has_rpy2 = False
+
+if has_rpy2:
+    from rpy2.robjects.packages import importr
+    from rpy2.robjects import numpy2ri
+    from rpy2.robjects import default_converter
+
+    np_cv_rules = default_converter + numpy2ri.converter
+    survivalR = importr('survival')
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def baseline_by_risk_sets(start, event, status, eta, weight, tie_breaking):
+    # Breslow / Efron jumps summed over the unique event times
+    times = np.unique(event[status == 1])
+    risk = weight * np.exp(eta)
+    cumhaz = []
+    H = 0
+    for t in times:
+        at_risk = (event >= t) & ((start < t) if start is not None else True)
+        R = risk[at_risk].sum()
+        tied = (status == 1) & (event == t)
+        K = tied.sum()
+        R_tied = risk[tied].sum()
+        w_bar = weight[tied].sum() / K
+        if tie_breaking == 'efron':
+            H += sum(w_bar / (R - k / K * R_tied) for k in range(K))
+        else:
+            H += K * w_bar / R
+        cumhaz.append(H)
+    return times, np.array(cumhaz)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_baseline_hazard(have_start_times,
+                         tie_breaking,
+                         weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    # not centered, to check the baseline is for a linear predictor of 0
+    eta = rng.standard_normal(n) + 1
+    weight = sample_weights(n) if weighted else np.ones(n)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    baseline = cox.baseline_hazard(eta, weight if weighted else None)
+
+    times, cumhaz = baseline_by_risk_sets(start, event, status, eta, weight, tie_breaking)
+    assert np.allclose(baseline.time, times)
+    assert np.allclose(baseline.cumhaz, cumhaz)
+
+    # a step function, 0 before the first event
+    query = np.concatenate([[times[0] - 1], times, (times[1:] + times[:-1]) / 2, [times[-1] + 1]])
+    expected_H = np.array([cumhaz[times <= q][-1] if np.any(times <= q) else 0 for q in query])
+    assert np.allclose(baseline.cumulative_hazard(query), expected_H)
+
+    new_eta = rng.standard_normal(20)
+    for n_jobs in [1, 4]:
+        S = baseline.survival(new_eta, query, n_jobs=n_jobs)
+        assert S.shape == (20, query.shape[0])
+        assert np.allclose(S, np.exp(-np.exp(new_eta)[:, None] * expected_H[None, :]))
+
+def test_survival_blocks():
+
+    start, event, status = simulate_arrays(False)
+    eta = rng.standard_normal(event.shape[0])
+    cox = CoxDeviance(event=event, status=status)
+    baseline = cox.baseline_hazard(eta)
+    # enough rows to be split between threads
+    new_eta = rng.standard_normal(20000)
+    query = np.linspace(event.min(), event.max(), 7)
+    S = baseline.survival(new_eta, query, n_jobs=4)
+    assert np.allclose(S, baseline.survival(new_eta, query, n_jobs=1))
+    assert np.allclose(S, np.exp(-np.exp(new_eta)[:, None] * baseline.cumulative_hazard(query)[None, :]))
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_stratified_baseline_hazard(have_start_times):
+
+    start, event, status = simulate_arrays(have_start_times, nrep=10)
+    n = event.shape[0]
+    strata = rng.choice(3, size=n)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+
+    cox = StratifiedCoxDeviance(event=event, status=status, strata=strata, start=start)
+    baseline = cox.baseline_hazard(eta, weight)
+
+    new_eta = rng.standard_normal(30)
+    new_strata = rng.choice(3, size=30)
+    query = np.quantile(event, [0.1, 0.5, 0.9])
+    S = baseline.survival(new_eta, query, new_strata, n_jobs=2)
+    for s in range(3):
+        keep = strata == s
+        times, cumhaz = baseline_by_risk_sets(None if start is None else start[keep],
+                                              event[keep],
+                                              status[keep],
+                                              eta[keep],
+                                              weight[keep],
+                                              'efron')
+        assert np.allclose(baseline[s].time, times)
+        assert np.allclose(baseline[s].cumhaz, cumhaz)
+        new = new_strata == s
+        assert np.allclose(S[new], baseline[s].survival(new_eta[new], query))
+
+    with pytest.raises(ValueError):
+        baseline.survival(new_eta, query, np.full(30, 5))
+
+@pytest.mark.skipif(not has_rpy2, reason='requires rpy2')
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_baseline_hazard_survival(have_start_times, tie_breaking):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    baseline = cox.baseline_hazard(eta, weight)
+
+    with np_cv_rules.context():
+        rpy.r.assign('event', event)
+        rpy.r.assign('status', status)
+        rpy.r.assign('eta', eta)
+        rpy.r.assign('weight', weight)
+        rpy.r.assign('ties', tie_breaking)
+        if have_start_times:
+            rpy.r.assign('start', start)
+            rpy.r('y = Surv(start, event, status)')
+        else:
+            rpy.r('y = Surv(event, status)')
+        # the coefficient of eta held at 1
+        rpy.r('F = coxph(y ~ eta, weights=weight, ties=ties, init=1, control=coxph.control(iter.max=0))')
+        rpy.r('B = basehaz(F, centered=FALSE)')
+        rpy.r('B = B[B$time %in% unique(event[status == 1]),]')
+        time = rpy.r('B$time')
+        hazard = rpy.r('B$hazard')
+
+    assert np.allclose(baseline.time, time)
+    assert np.allclose(baseline.cumhaz, hazard)
@@ -0,0 +1,56 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, bootstrap_weights
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('scheme', ['poisson', 'bayesian'])
+def test_bootstrap(have_start_times,
+                   tie_breaking,
+                   scheme):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    X = rng.standard_normal((n, 3))
+    n_replicates = 7
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    boot = cox.bootstrap(eta, n_replicates, seed=11, scheme=scheme, sample_weight=weight, X=X, n_jobs=1)
+    assert boot.deviance.shape == (n_replicates,)
+    assert boot.X_gradient.shape == (n_replicates, 3)
+
+    for b in range(n_replicates):
+        replicate_weight = bootstrap_weights(n, b, seed=11, scheme=scheme)
+        assert np.all(replicate_weight >= 0)
+        if scheme == 'poisson':
+            assert np.all(replicate_weight == np.floor(replicate_weight))
+        result = cox(eta, weight * replicate_weight)
+        assert np.allclose(boot.deviance[b], result.deviance)
+        assert np.allclose(boot.X_gradient[b], X.T @ result.gradient)
+
+    # the same bits whatever the tiling
+    for n_jobs in [2, 3]:
+        tiled = cox.bootstrap(eta, n_replicates, seed=11, scheme=scheme, sample_weight=weight, X=X, n_jobs=n_jobs)
+        assert np.array_equal(tiled.deviance, boot.deviance)
+        assert np.array_equal(tiled.X_gradient, boot.X_gradient)
+
+    other = cox.bootstrap(eta, n_replicates, seed=12, scheme=scheme, sample_weight=weight)
+    assert other.X_gradient is None
+    assert not np.allclose(other.deviance, boot.deviance)
+
+def test_bootstrap_weights():
+
+    w = bootstrap_weights(20000, 0, seed=3)
+    assert abs(w.mean() - 1) < 0.05 and abs(w.var() - 1) < 0.05
+    w = bootstrap_weights(20000, 0, seed=3, scheme='bayesian')
+    assert abs(w.mean() - 1) < 0.05 and abs(w.var() - 1) < 0.1
+    assert not np.array_equal(bootstrap_weights(10, 0), bootstrap_weights(10, 1))
+    with pytest.raises(ValueError):
+        bootstrap_weights(10, 0, scheme='jackknife')
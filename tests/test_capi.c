@@ -0,0 +1,1315 @@
+/* Checks of the C interface: the deviance of the CoxDeviance docstring
+   example, the gradient and information matvec against finite
+   differences, the concordance against a direct sum over pairs and the
+   baseline hazard, survival curves and residuals against direct sums
+   over risk sets and the robust variance against the residuals and
+   information products, with and without start times, zero weights
+   against the design of the rows with positive weight, bootstrap
+   replicates against deviances at their weights, the dense information
+   matrix against information products, designs grown by appending rows
+   against designs of all the rows, score screens against the dense
+   information matrix, outcomes evaluated together against their own
+   designs, horizon sweeps against designs censored at each horizon,
+   landmark copies against the stacked copies formed explicitly, the
+   Fine-Gray deviance against the weighted expansion of the competing
+   events, the exact partial likelihood for ties against a sum over the
+   subsets of each risk set and subsampled risk sets against the deviance
+   when every row is drawn and against the spread of their estimates over
+   seeds, and low memory workspaces against full ones. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "coxdev_c.h"
+
+#define N 12
+
+static const double event[N] = {3, 6, 8, 4, 6, 4, 3, 2, 2, 5, 3, 4};
+static const double start[N] = {0, 1, 2, 0, 3, 1, 0, 0, 1, 2, 2, 0};
+static const int status[N] = {1, 1, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1};
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+  if (!ok) {
+    fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+static double deviance_at(const coxdev_design *design,
+			  coxdev_workspace *ws,
+			  const double *eta,
+			  const double *weight,
+			  double *gradient)
+{
+  double dev;
+  check(coxdev_deviance(design, ws, eta, weight, &dev, gradient, NULL) == COXDEV_OK, coxdev_last_error());
+  return dev;
+}
+
+static void check_derivatives(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], arg[N], shifted[N];
+  double grad[N], grad_plus[N], grad_minus[N], info_arg[N];
+  const double h = 1e-5;
+  int i, j;
+
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i);
+    weight[i] = 1.0 + 0.1 * (i % 3);
+    arg[i] = cos(2.0 * i);
+  }
+
+  /* gradient */
+  deviance_at(design, ws, eta, weight, grad);
+  for (j = 0; j < N; ++j) {
+    double plus, minus;
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] + (i == j ? h : 0);
+    plus = deviance_at(design, ws, shifted, weight, NULL);
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] - (i == j ? h : 0);
+    minus = deviance_at(design, ws, shifted, weight, NULL);
+    check(fabs((plus - minus) / (2 * h) - grad[j]) < 1e-6, "gradient");
+  }
+
+  /* the information is half the Hessian of the deviance */
+  for (i = 0; i < N; ++i) shifted[i] = eta[i] + h * arg[i];
+  deviance_at(design, ws, shifted, weight, grad_plus);
+  for (i = 0; i < N; ++i) shifted[i] = eta[i] - h * arg[i];
+  deviance_at(design, ws, shifted, weight, grad_minus);
+
+  deviance_at(design, ws, eta, weight, NULL);
+  check(coxdev_information_matvec(design, ws, arg, info_arg) == COXDEV_OK, coxdev_last_error());
+  for (i = 0; i < N; ++i) {
+    check(fabs((grad_plus[i] - grad_minus[i]) / (4 * h) - info_arg[i]) < 1e-6, "information matvec");
+  }
+
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+/* Zero weights for the rows stopping at 6 or later leave the risk set at 6
+   without weight: the deviance is that of the other rows alone, and the
+   gradient of the zeroed rows 0 rather than 0 / 0. */
+static void check_zero_weights(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *subset;
+  coxdev_workspace *ws, *subset_ws;
+  double eta[N], weight[N], grad[N];
+  double sub_start[N], sub_event[N], sub_eta[N], sub_weight[N];
+  int sub_status[N];
+  int i, m = 0;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i);
+    weight[i] = event[i] < 6 ? 1.0 + 0.1 * (i % 3) : 0.0;
+    if (weight[i] > 0) {
+      sub_start[m] = start_times != NULL ? start_times[i] : 0;
+      sub_event[m] = event[i];
+      sub_status[m] = status[i];
+      sub_eta[m] = eta[i];
+      sub_weight[m] = weight[i];
+      ++m;
+    }
+  }
+
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_design_create(m, start_times != NULL ? sub_start : NULL, sub_event, sub_status,
+			     tie_breaking, &subset) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_workspace_create(subset, &subset_ws) == COXDEV_OK, coxdev_last_error());
+
+  /* the deviance centers eta by its mean, so only differences matter */
+  check(fabs(deviance_at(design, ws, eta, weight, grad) -
+	     deviance_at(subset, subset_ws, sub_eta, sub_weight, NULL)) < 1e-10,
+	"zero weights drop rows");
+  for (i = 0; i < N; ++i) {
+    if (weight[i] == 0) {
+      check(grad[i] == 0, "zero weight gradient");
+    }
+  }
+
+  coxdev_workspace_free(subset_ws);
+  coxdev_design_free(subset);
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+/* at risk at time t: not yet stopped, and started before t */
+static int at_risk(const double *start_times, int j, double t)
+{
+  return event[j] >= t && (start_times == NULL || start_times[j] < t);
+}
+
+/* Kaplan-Meier estimate of the censoring survival just before t */
+static double censoring_survival(const double *start_times, const double *weight, double t)
+{
+  double surv = 1.0;
+  int i, j, seen;
+  for (i = 0; i < N; ++i) {
+    double censored = 0.0, risk = 0.0;
+    if (status[i] != 0 || event[i] >= t) continue;
+    for (seen = 0, j = 0; j < i; ++j) seen |= status[j] == 0 && event[j] == event[i];
+    if (seen) continue;
+    for (j = 0; j < N; ++j) {
+      if (status[j] == 0 && event[j] == event[i]) censored += weight[j];
+      if (at_risk(start_times, j, event[i])) risk += weight[j];
+    }
+    surv *= 1.0 - censored / risk;
+  }
+  return surv;
+}
+
+static void check_concordance(const double *start_times, int method, double tau)
+{
+  coxdev_design *design;
+  double eta[N], weight[N], c, counts[3], expected[3] = {0, 0, 0};
+  int i, j;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = 0.5 * (i % 4); /* tied in eta */
+    weight[i] = 1.0 + 0.1 * (i % 3);
+  }
+  for (i = 0; i < N; ++i) {
+    double omega = weight[i];
+    if (status[i] != 1 || event[i] >= tau) continue;
+    if (method == COXDEV_UNO) {
+      double G = censoring_survival(start_times, weight, event[i]);
+      omega /= G * G;
+    }
+    for (j = 0; j < N; ++j) {
+      if (j == i || !at_risk(start_times, j, event[i])) continue;
+      if (event[j] == event[i] && status[j] == 1) continue; /* tied event times */
+      expected[eta[i] > eta[j] ? 0 : (eta[i] < eta[j] ? 1 : 2)] += omega * weight[j];
+    }
+  }
+
+  check(coxdev_design_create(N, start_times, event, status, COXDEV_EFRON, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_concordance(design, eta, weight, method, tau, &c, counts) == COXDEV_OK, coxdev_last_error());
+  for (i = 0; i < 3; ++i) {
+    check(fabs(counts[i] - expected[i]) < 1e-10, "concordance pair counts");
+  }
+  check(fabs(c - (expected[0] + 0.5 * expected[2]) / (expected[0] + expected[1] + expected[2])) < 1e-12,
+	"concordance");
+  coxdev_design_free(design);
+}
+
+/* Breslow or Efron jump of the baseline hazard at t, for eta on its own scale */
+static double hazard_jump(const double *start_times, const double *eta, const double *weight,
+			  int tie_breaking, double t)
+{
+  double risk = 0.0, tied_risk = 0.0, tied_weight = 0.0, jump = 0.0;
+  int j, k, K = 0;
+  for (j = 0; j < N; ++j) {
+    if (at_risk(start_times, j, t)) risk += weight[j] * exp(eta[j]);
+    if (status[j] == 1 && event[j] == t) {
+      tied_risk += weight[j] * exp(eta[j]);
+      tied_weight += weight[j];
+      ++K;
+    }
+  }
+  for (k = 0; k < K; ++k) {
+    jump += (tied_weight / K) / (risk - (tie_breaking == COXDEV_EFRON ? (double) k / K * tied_risk : 0.0));
+  }
+  return jump;
+}
+
+static void check_baseline_hazard(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], time[N], cumhaz[N], dev, H = 0.0, previous = -INFINITY;
+  const double new_eta[2] = {-0.5, 1.0};
+  const double query[4] = {1.5, 3.0, 4.5, 10.0};
+  double survival[2 * 4], expected[4];
+  int64_t n_times;
+  int i, k;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i) + 2.0; /* not centered */
+    weight[i] = 1.0 + 0.1 * (i % 3);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, weight, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_baseline_hazard(design, ws, time, cumhaz, &n_times) == COXDEV_OK, coxdev_last_error());
+
+  /* the unique event times, increasing */
+  for (i = 0, k = 0; i < N; ++i) {
+    int j, seen = 0;
+    if (status[i] != 1) continue;
+    for (j = 0; j < i; ++j) seen |= status[j] == 1 && event[j] == event[i];
+    k += !seen;
+  }
+  check(n_times == k, "number of unique event times");
+  for (k = 0; k < n_times; ++k) {
+    check(time[k] > previous, "event times increase");
+    previous = time[k];
+    H += hazard_jump(start_times, eta, weight, tie_breaking, time[k]);
+    check(fabs(cumhaz[k] - H) < 1e-10, "baseline cumulative hazard");
+  }
+
+  for (i = 0; i < 4; ++i) {
+    expected[i] = 0.0;
+    for (k = 0; k < n_times; ++k) {
+      if (time[k] <= query[i]) expected[i] = cumhaz[k];
+    }
+  }
+  check(coxdev_survival(time, cumhaz, n_times, new_eta, 2, query, 4, survival) == COXDEV_OK,
+	coxdev_last_error());
+  for (i = 0; i < 2; ++i) {
+    for (k = 0; k < 4; ++k) {
+      check(fabs(survival[4 * i + k] - exp(-expected[k] * exp(new_eta[i]))) < 1e-12, "survival curves");
+    }
+  }
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+/* Martingale, score and Schoenfeld residuals by looping over the event times
+   and the Efron steps k / K of each, for covariate x */
+static void residuals_by_risk_sets(const double *start_times, const double *eta, const double *weight,
+				   const double *x, int tie_breaking,
+				   double *martingale, double *score, double *schoenfeld)
+{
+  double cumhaz[N] = {0}, xbar_hazard[N] = {0}, xbar_death[N] = {0};
+  int i, j, k;
+  for (i = 0; i < N; ++i) {
+    double risk = 0.0, tied_risk = 0.0, S1 = 0.0, tied_S1 = 0.0, tied_weight = 0.0;
+    int K = 0, seen = 0;
+    if (status[i] != 1) continue;
+    for (j = 0; j < i; ++j) seen |= status[j] == 1 && event[j] == event[i];
+    if (seen) continue;
+    for (j = 0; j < N; ++j) {
+      const double r = weight[j] * exp(eta[j]);
+      if (at_risk(start_times, j, event[i])) {
+	risk += r;
+	S1 += r * x[j];
+      }
+      if (status[j] == 1 && event[j] == event[i]) {
+	tied_risk += r;
+	tied_S1 += r * x[j];
+	tied_weight += weight[j];
+	++K;
+      }
+    }
+    for (k = 0; k < K; ++k) {
+      const double f = tie_breaking == COXDEV_EFRON ? (double) k / K : 0.0;
+      const double hazard = (tied_weight / K) / (risk - f * tied_risk);
+      const double xbar = (S1 - f * tied_S1) / (risk - f * tied_risk);
+      for (j = 0; j < N; ++j) {
+	const int tied = status[j] == 1 && event[j] == event[i];
+	const double c = tied ? 1.0 - f : 1.0;
+	if (!at_risk(start_times, j, event[i])) continue;
+	cumhaz[j] += c * hazard;
+	xbar_hazard[j] += c * xbar * hazard;
+	if (tied) xbar_death[j] += xbar / K;
+      }
+    }
+  }
+  for (j = 0; j < N; ++j) {
+    schoenfeld[j] = status[j] ? x[j] - xbar_death[j] : 0.0;
+    martingale[j] = status[j] - exp(eta[j]) * cumhaz[j];
+    score[j] = schoenfeld[j] - exp(eta[j]) * (x[j] * cumhaz[j] - xbar_hazard[j]);
+  }
+}
+
+static void check_residuals(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], X[2 * N], dev, info[N];
+  double martingale[N], deviance[N], score[2 * N], schoenfeld[2 * N];
+  double expected_martingale[N], expected_score[N], expected_schoenfeld[N];
+  int i, j;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i) + 2.0;
+    weight[i] = 1.0 + 0.1 * (i % 3);
+    X[i] = cos(2.0 * i);
+    X[N + i] = (double) (i % 3);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, weight, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_residuals(design, ws, martingale, deviance) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_score_residuals(design, ws, X, 2, score, schoenfeld) == COXDEV_OK, coxdev_last_error());
+  /* the information operator still works afterwards */
+  check(coxdev_information_matvec(design, ws, X, info) == COXDEV_OK, coxdev_last_error());
+
+  for (j = 0; j < 2; ++j) {
+    residuals_by_risk_sets(start_times, eta, weight, X + j * N, tie_breaking,
+			   expected_martingale, expected_score, expected_schoenfeld);
+    for (i = 0; i < N; ++i) {
+      check(fabs(score[j * N + i] - expected_score[i]) < 1e-10, "score residuals");
+      check(fabs(schoenfeld[j * N + i] - expected_schoenfeld[i]) < 1e-10, "Schoenfeld residuals");
+    }
+  }
+  for (i = 0; i < N; ++i) {
+    const double M = expected_martingale[i];
+    const double d = (M > 0 ? 1 : -1) * sqrt(-2 * (M + (status[i] ? log(status[i] - M) : 0)));
+    check(fabs(martingale[i] - M) < 1e-10, "martingale residuals");
+    check(fabs(deviance[i] - d) < 1e-10, "deviance residuals");
+  }
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_robust_variance(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], X[2 * N], dev, info[2 * N];
+  double score[2 * N], U[4 * 2] = {0}, I[4], inv[4], meat[4], covariance[4];
+  double expected_meat[4], M_inv[4], expected_covariance[4], det;
+  int64_t cluster[N];
+  int i, j, k;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = cos(1.0 + i);
+    weight[i] = 1.0 + 0.2 * (i % 2);
+    X[i] = sin(3.0 * i);
+    X[N + i] = (double) (i % 3) - 1.0;
+    cluster[i] = i % 4;
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, weight, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_robust_variance(design, ws, X, 2, cluster, 4, meat, covariance) == COXDEV_OK,
+	coxdev_last_error());
+
+  /* the same from the residuals and information products */
+  check(coxdev_score_residuals(design, ws, X, 2, score, NULL) == COXDEV_OK, coxdev_last_error());
+  for (j = 0; j < 2; ++j) {
+    for (i = 0; i < N; ++i) U[cluster[i] + 4 * j] += weight[i] * score[j * N + i];
+    check(coxdev_information_matvec(design, ws, X + j * N, info + j * N) == COXDEV_OK, coxdev_last_error());
+  }
+  for (j = 0; j < 2; ++j) {
+    for (k = 0; k < 2; ++k) {
+      expected_meat[j + 2 * k] = 0.0;
+      I[j + 2 * k] = 0.0;
+      for (i = 0; i < 4; ++i) expected_meat[j + 2 * k] += U[i + 4 * j] * U[i + 4 * k];
+      for (i = 0; i < N; ++i) I[j + 2 * k] += X[j * N + i] * info[k * N + i];
+    }
+  }
+  det = I[0] * I[3] - I[1] * I[2];
+  inv[0] = I[3] / det; inv[3] = I[0] / det; inv[1] = -I[1] / det; inv[2] = -I[2] / det;
+  for (j = 0; j < 2; ++j) {
+    for (k = 0; k < 2; ++k) {
+      M_inv[j + 2 * k] = expected_meat[j] * inv[2 * k] + expected_meat[j + 2] * inv[1 + 2 * k];
+    }
+  }
+  for (j = 0; j < 2; ++j) {
+    for (k = 0; k < 2; ++k) {
+      expected_covariance[j + 2 * k] = inv[j] * M_inv[2 * k] + inv[j + 2] * M_inv[1 + 2 * k];
+    }
+  }
+  for (i = 0; i < 4; ++i) {
+    check(fabs(meat[i] - expected_meat[i]) < 1e-10, "robust variance meat");
+    check(fabs(covariance[i] - expected_covariance[i]) < 1e-10, "robust covariance");
+  }
+
+  cluster[0] = 4;
+  check(coxdev_robust_variance(design, ws, X, 2, cluster, 4, meat, covariance) == COXDEV_ERROR,
+	"cluster codes out of range are an error");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_information_matrix(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], unit[N], column[N], dense[N * N], block[3 * 3];
+  const int64_t rows[3] = {3, 0, 7}, columns[3] = {5, 5, 11};
+  int i, j;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(0.5 + 2.0 * i);
+    weight[i] = 1.0 + 0.3 * (i % 3);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  deviance_at(design, ws, eta, weight, NULL);
+  check(coxdev_information_matrix(design, ws, NULL, 0, NULL, 0, dense) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_information_matrix(design, ws, rows, 3, columns, 3, block) == COXDEV_OK, coxdev_last_error());
+
+  for (j = 0; j < N; ++j) {
+    for (i = 0; i < N; ++i) unit[i] = (i == j);
+    check(coxdev_information_matvec(design, ws, unit, column) == COXDEV_OK, coxdev_last_error());
+    for (i = 0; i < N; ++i) {
+      check(fabs(dense[i + N * j] - column[i]) < 1e-12, "information matrix");
+    }
+  }
+  for (j = 0; j < 3; ++j) {
+    for (i = 0; i < 3; ++i) {
+      check(block[i + 3 * j] == dense[rows[i] + N * columns[j]], "information matrix block");
+    }
+  }
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_score_screen(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], grad[N], dense[N * N], X[2 * N], Z[N], dev;
+  double score[2], variance[2], unadjusted[2], xIx, xIz, zIz, g;
+  int i, j, l;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = cos(1.0 + 1.5 * i);
+    weight[i] = 1.0 + 0.25 * (i % 4);
+    X[i] = (i * 7) % 3; /* a dosage in 0, 1, 2 */
+    X[N + i] = sin(0.3 * i);
+    Z[i] = cos(0.7 * i);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, weight, &dev, grad, NULL) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_information_matrix(design, ws, NULL, 0, NULL, 0, dense) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_score_screen(design, ws, NULL, 0, X, 2, score, unadjusted) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_score_screen(design, ws, Z, 1, X, 2, score, variance) == COXDEV_OK, coxdev_last_error());
+
+  /* the information quadratic forms, adjusted for Z, from the dense matrix */
+  zIz = 0.0;
+  for (i = 0; i < N; ++i) {
+    for (l = 0; l < N; ++l) zIz += Z[i] * dense[i + N * l] * Z[l];
+  }
+  for (j = 0; j < 2; ++j) {
+    g = xIx = xIz = 0.0;
+    for (i = 0; i < N; ++i) {
+      g -= 0.5 * grad[i] * X[N * j + i];
+      for (l = 0; l < N; ++l) {
+	xIx += X[N * j + i] * dense[i + N * l] * X[N * j + l];
+	xIz += X[N * j + i] * dense[i + N * l] * Z[l];
+      }
+    }
+    check(fabs(score[j] - g) < 1e-12, "score screen score");
+    check(fabs(unadjusted[j] - xIx) < 1e-12, "score screen variance");
+    check(fabs(variance[j] - (xIx - xIz * xIz / zIz)) < 1e-12, "score screen adjusted variance");
+  }
+  check(coxdev_score_screen(design, ws, NULL, 1, X, 2, score, variance) == COXDEV_ERROR, "score screen Z");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_horizon_sweep(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *censored;
+  coxdev_workspace *ws, *censored_ws;
+  /* after the last start time, one at tied event times */
+  const double horizons[4] = {3.5, 4.0, 5.5, INFINITY};
+  const double unsorted[2] = {4.0, 3.5};
+  double eta[N], weight[N], grad[N], event_tau[N], loglik_sat[4], deviance[4], gradients[4 * N], dev;
+  int status_tau[N];
+  int i, j;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = cos(0.5 + 1.3 * i);
+    weight[i] = 1.0 + 0.5 * (i % 3);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  deviance_at(design, ws, eta, weight, NULL);
+  check(coxdev_horizon_sweep(design, ws, horizons, 4, loglik_sat, deviance, gradients) == COXDEV_OK,
+	coxdev_last_error());
+  for (j = 0; j < 4; ++j) {
+    for (i = 0; i < N; ++i) {
+      event_tau[i] = event[i] <= horizons[j] ? event[i] : horizons[j];
+      status_tau[i] = event[i] <= horizons[j] ? status[i] : 0;
+    }
+    check(coxdev_design_create(N, start_times, event_tau, status_tau, tie_breaking, &censored) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_workspace_create(censored, &censored_ws) == COXDEV_OK, coxdev_last_error());
+    dev = deviance_at(censored, censored_ws, eta, weight, grad);
+    check(fabs(deviance[j] - dev) < 1e-10, "horizon deviance");
+    for (i = 0; i < N; ++i) {
+      check(fabs(gradients[N * j + i] - grad[i]) < 1e-10, "horizon gradient");
+    }
+    coxdev_workspace_free(censored_ws);
+    coxdev_design_free(censored);
+  }
+  /* the last horizon follows everyone to the end */
+  check(fabs(deviance[3] - deviance_at(design, ws, eta, weight, NULL)) < 1e-12, "horizon at infinity");
+  check(coxdev_horizon_sweep(design, ws, horizons, 4, loglik_sat, deviance, NULL) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_horizon_sweep(design, ws, unsorted, 2, loglik_sat, deviance, NULL) == COXDEV_ERROR,
+	"unsorted horizons");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_landmarks(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *copy;
+  coxdev_workspace *copy_ws;
+  /* the first splits the tied events at 4 with start times */
+  const double landmarks[3] = {0.5, 2.0, 3.0};
+  const double horizons[3] = {4.0, 5.5, INFINITY};
+  double eta[3 * N], weight[N], loglik_sat[3], deviance[3], gradients[3 * N];
+  double copy_start[N], copy_event[N], copy_eta[N], copy_weight[N], copy_grad[N], dev, total;
+  int copy_status[N], members[N];
+  int i, l, m;
+
+  for (i = 0; i < N; ++i) {
+    weight[i] = 1.0 + 0.5 * (i % 3);
+    for (l = 0; l < 3; ++l) {
+      eta[N * l + i] = cos(0.5 + 1.3 * i + l);
+    }
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_landmark_deviances(design, eta, weight, landmarks, horizons, 3, loglik_sat, deviance, gradients) ==
+	COXDEV_OK, coxdev_last_error());
+  for (l = 0; l < 3; ++l) {
+    /* the stacked copy, formed explicitly */
+    m = 0;
+    for (i = 0; i < N; ++i) {
+      if (event[i] > landmarks[l] && (start_times == NULL || start_times[i] <= landmarks[l])) {
+	members[m] = i;
+	copy_start[m] = landmarks[l];
+	copy_event[m] = event[i] <= horizons[l] ? event[i] : horizons[l];
+	copy_status[m] = event[i] <= horizons[l] ? status[i] : 0;
+	copy_eta[m] = eta[N * l + i];
+	copy_weight[m] = weight[i];
+	++m;
+      }
+    }
+    check(coxdev_design_create(m, copy_start, copy_event, copy_status, tie_breaking, &copy) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_workspace_create(copy, &copy_ws) == COXDEV_OK, coxdev_last_error());
+    dev = deviance_at(copy, copy_ws, copy_eta, copy_weight, copy_grad);
+    check(fabs(deviance[l] - dev) < 1e-10, "landmark deviance");
+    total = 0;
+    for (i = 0; i < m; ++i) {
+      check(fabs(gradients[N * l + members[i]] - copy_grad[i]) < 1e-10, "landmark gradient");
+    }
+    for (i = 0; i < N; ++i) {
+      total += fabs(gradients[N * l + i]);
+    }
+    for (i = 0; i < m; ++i) {
+      total -= fabs(copy_grad[i]);
+    }
+    check(fabs(total) < 1e-10, "landmark gradient off the copy");
+    coxdev_workspace_free(copy_ws);
+    coxdev_design_free(copy);
+  }
+  check(coxdev_landmark_deviances(design, eta, NULL, landmarks, horizons, 3, loglik_sat, deviance, NULL) ==
+	COXDEV_OK, coxdev_last_error());
+  check(coxdev_landmark_deviances(design, eta, NULL, horizons, landmarks, 3, loglik_sat, deviance, NULL) ==
+	COXDEV_ERROR, "horizon before landmark");
+  coxdev_design_free(design);
+}
+
+/* Fine-Gray status codes: 2 for a competing event, tied with events of
+   the cause and with censorings */
+static const int fg_status[N] = {1, 2, 0, 1, 2, 1, 2, 0, 1, 1, 0, 2};
+
+/* Kaplan-Meier estimate of the censoring survival just before t, events
+   of either cause preceding censorings at the same time */
+static double finegray_censoring(const double *weight, double t)
+{
+  double surv = 1.0;
+  int i, j, seen;
+  for (i = 0; i < N; ++i) {
+    double censored = 0.0, risk = 0.0;
+    if (fg_status[i] != 0 || event[i] >= t) continue;
+    for (seen = 0, j = 0; j < i; ++j) seen |= fg_status[j] == 0 && event[j] == event[i];
+    if (seen) continue;
+    for (j = 0; j < N; ++j) {
+      if (fg_status[j] == 0 && event[j] == event[i]) censored += weight[j];
+      if (event[j] > event[i] || (event[j] == event[i] && fg_status[j] == 0)) risk += weight[j];
+    }
+    surv *= 1.0 - censored / risk;
+  }
+  return surv;
+}
+
+static void check_finegray(int tie_breaking)
+{
+  coxdev_design *design, *expanded;
+  coxdev_workspace *ws, *expanded_ws;
+  double eta[N], weight[N], grad[N], diag[N], arg[N], info[N], unit[N], dev;
+  double times[N], x_start[N * N], x_event[N * N], x_eta[N * N], x_weight[N * N];
+  double x_grad[N * N], x_arg[N * N], x_info[N * N], x_dev, prev;
+  int x_status[N * N], owner[N * N];
+  int i, j, k, m, n_times = 0;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(0.3 + 1.7 * i);
+    weight[i] = 1.0 + 0.25 * (i % 4);
+    arg[i] = cos(2.0 * i);
+  }
+  /* the distinct event times of the cause, increasing */
+  for (i = 0; i < N; ++i) {
+    if (fg_status[i] != 1) continue;
+    for (j = 0; j < n_times && times[j] != event[i]; ++j);
+    if (j == n_times) times[n_times++] = event[i];
+  }
+  for (j = 1; j < n_times; ++j) {
+    for (k = j; k > 0 && times[k - 1] > times[k]; --k) {
+      prev = times[k]; times[k] = times[k - 1]; times[k - 1] = prev;
+    }
+  }
+  /* a row per subject, and a row per later event time of the cause for a
+     competing event, weighted by the ratio of censoring survivals */
+  m = 0;
+  for (i = 0; i < N; ++i) {
+    x_start[m] = -1.0; x_event[m] = event[i]; x_status[m] = fg_status[i] == 1;
+    x_weight[m] = weight[i]; owner[m++] = i;
+    if (fg_status[i] != 2) continue;
+    prev = event[i];
+    for (k = 0; k < n_times; ++k) {
+      if (times[k] <= event[i]) continue;
+      x_start[m] = prev; x_event[m] = times[k]; x_status[m] = 0;
+      x_weight[m] = weight[i] * finegray_censoring(weight, times[k]) / finegray_censoring(weight, event[i]);
+      owner[m++] = i;
+      prev = times[k];
+    }
+  }
+  for (j = 0; j < m; ++j) {
+    x_eta[j] = eta[owner[j]];
+    x_arg[j] = arg[owner[j]];
+  }
+
+  check(coxdev_finegray_create(N, event, fg_status, tie_breaking, &design) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_finegray_deviance(design, ws, eta, weight, &dev, grad, diag) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_finegray_information_matvec(design, ws, arg, info) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_design_create(m, x_start, x_event, x_status, tie_breaking, &expanded) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(expanded, &expanded_ws) == COXDEV_OK, coxdev_last_error());
+  x_dev = deviance_at(expanded, expanded_ws, x_eta, x_weight, x_grad);
+  check(coxdev_information_matvec(expanded, expanded_ws, x_arg, x_info) == COXDEV_OK, coxdev_last_error());
+  check(fabs(dev - x_dev) < 1e-10, "Fine-Gray deviance");
+  for (i = 0; i < N; ++i) {
+    double g = 0.0, v = 0.0;
+    for (j = 0; j < m; ++j) {
+      if (owner[j] != i) continue;
+      g += x_grad[j];
+      v += x_info[j];
+    }
+    check(fabs(grad[i] - g) < 1e-10, "Fine-Gray gradient");
+    check(fabs(info[i] - v) < 1e-10, "Fine-Gray information matvec");
+  }
+  /* the diagonal Hessian against information products with unit vectors */
+  for (i = 0; i < N; ++i) {
+    for (j = 0; j < N; ++j) unit[j] = i == j;
+    check(coxdev_finegray_information_matvec(design, ws, unit, info) == COXDEV_OK, coxdev_last_error());
+    check(fabs(diag[i] - 2.0 * info[i]) < 1e-10, "Fine-Gray diagonal Hessian");
+  }
+  /* unit weights */
+  for (j = 0; j < m; ++j) x_weight[j] /= weight[owner[j]];
+  for (i = 0; i < N; ++i) unit[i] = 1.0;
+  for (j = 0; j < m; ++j) {
+    if (x_status[j] == 0 && x_start[j] > -1.0) {
+      i = owner[j];
+      x_weight[j] = finegray_censoring(unit, x_event[j]) / finegray_censoring(unit, event[i]);
+    }
+  }
+  check(coxdev_finegray_deviance(design, ws, eta, NULL, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  x_dev = deviance_at(expanded, expanded_ws, x_eta, x_weight, NULL);
+  check(fabs(dev - x_dev) < 1e-10, "Fine-Gray deviance with unit weights");
+
+  check(coxdev_design_append(design, 1, NULL, event, status) == COXDEV_ERROR, "Fine-Gray designs are not appended to");
+  coxdev_workspace_free(expanded_ws);
+  coxdev_design_free(expanded);
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+
+  check(coxdev_design_create(N, NULL, event, status, tie_breaking, &design) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_finegray_deviance(design, ws, eta, NULL, &dev, NULL, NULL) == COXDEV_ERROR,
+	"Fine-Gray deviance of a Cox design");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+/* the exact partial likelihood deviance by enumerating the subsets of each
+   risk set, weights entering as in coxdev_exact_deviance */
+static double exact_by_subsets(const double *start_times, const double *eta, const double *weight)
+{
+  double sat = 0, loglik = 0, done[N];
+  int i, j, k, n_done = 0;
+
+  for (i = 0; i < N; ++i) {
+    double t = event[i], W = 0, log_w = 0, e_d = 0, w_avg;
+    int d = 0, m = 0, member[N];
+    unsigned subset;
+    if (status[i] != 1 || weight[i] <= 0) continue;
+    for (k = 0; k < n_done && done[k] != t; ++k);
+    if (k < n_done) continue;
+    done[n_done++] = t;
+    for (j = 0; j < N; ++j) {
+      if (status[j] == 1 && event[j] == t && weight[j] > 0) {
+	W += weight[j];
+	log_w += log(weight[j]);
+	loglik += weight[j] * eta[j];
+	++d;
+      }
+      if (weight[j] > 0 && at_risk(start_times, j, t)) member[m++] = j;
+    }
+    w_avg = W / d;
+    sat -= w_avg * log_w;
+    for (subset = 0; subset < (1u << m); ++subset) {
+      double x = 1;
+      int size = 0;
+      for (k = 0; k < m; ++k) {
+	if (subset & (1u << k)) {
+	  x *= weight[member[k]] * exp(eta[member[k]]);
+	  ++size;
+	}
+      }
+      if (size == d) e_d += x;
+    }
+    loglik -= w_avg * log(e_d);
+  }
+  return 2 * (sat - loglik);
+}
+
+/* The exact deviance against the subsets of the risk sets, its gradient and
+   Hessian diagonal against finite differences, Breslow's deviance when no
+   times are tied and zero weights against the design without those rows. */
+static void check_exact(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *untied, *subset;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], shifted[N], grad[N], diag[N], untied_event[N];
+  double sub_start[N], sub_event[N], sub_eta[N], sub_weight[N];
+  double dev, dev0, plus, minus, sub_dev, breslow;
+  int sub_status[N];
+  const double h = 1e-4;
+  int i, j, m = 0;
+
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i);
+    weight[i] = 1.0 + 0.1 * (i % 3);
+  }
+
+  check(coxdev_exact_deviance(design, eta, weight, &dev, grad, diag) == COXDEV_OK, coxdev_last_error());
+  check(fabs(dev - exact_by_subsets(start_times, eta, weight)) < 1e-10, "exact deviance");
+  for (j = 0; j < N; ++j) {
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] + (i == j ? h : 0);
+    check(coxdev_exact_deviance(design, shifted, weight, &plus, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] - (i == j ? h : 0);
+    check(coxdev_exact_deviance(design, shifted, weight, &minus, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+    check(fabs((plus - minus) / (2 * h) - grad[j]) < 1e-6, "exact gradient");
+    check(fabs((plus - 2 * dev + minus) / (h * h) - diag[j]) < 1e-4, "exact Hessian diagonal");
+  }
+
+  /* unit weights */
+  check(coxdev_exact_deviance(design, eta, NULL, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  for (i = 0; i < N; ++i) shifted[i] = 1;
+  check(fabs(dev - exact_by_subsets(start_times, eta, shifted)) < 1e-10, "exact deviance, unit weights");
+
+  /* without ties it is Breslow's partial likelihood */
+  for (i = 0; i < N; ++i) untied_event[i] = event[i] + 0.01 * i;
+  check(coxdev_design_create(N, start_times, untied_event, status, COXDEV_BRESLOW, &untied) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(untied, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_exact_deviance(untied, eta, weight, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  breslow = deviance_at(untied, ws, eta, weight, NULL);
+  check(fabs(dev - breslow) < 1e-10, "exact is Breslow without ties");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(untied);
+
+  /* zero weights drop rows */
+  for (i = 0; i < N; ++i) {
+    if (i % 4 == 1) {
+      weight[i] = 0;
+      continue;
+    }
+    sub_start[m] = start_times != NULL ? start_times[i] : 0;
+    sub_event[m] = event[i];
+    sub_status[m] = status[i];
+    sub_eta[m] = eta[i];
+    sub_weight[m] = weight[i];
+    ++m;
+  }
+  check(coxdev_design_create(m, start_times != NULL ? sub_start : NULL, sub_event, sub_status,
+			     tie_breaking, &subset) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_exact_deviance(design, eta, weight, &dev0, grad, NULL) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_exact_deviance(subset, sub_eta, sub_weight, &sub_dev, NULL, NULL) == COXDEV_OK,
+	coxdev_last_error());
+  check(fabs(dev0 - sub_dev) < 1e-10, "exact zero weights drop rows");
+  for (i = 0; i < N; ++i) {
+    if (weight[i] == 0) {
+      check(grad[i] == 0, "exact zero weight gradient");
+    }
+  }
+  coxdev_design_free(subset);
+
+  coxdev_design_free(design);
+}
+
+/* Risk sets subsampled with at least as many controls as rows give the
+   deviance and its derivatives (the true Hessian diagonal, which Efron's
+   diag_hessian only approximates); with fewer, the approximation's gradient
+   and Hessian diagonal match finite differences at a fixed seed, the
+   draws depend on the seed alone and the variance estimate matches the
+   spread of the deviance over seeds. */
+static void check_sampled(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], shifted[N], grad[N], diag[N], cox_grad[N], cox_diag[N];
+  double dev, cox_dev, variance, again, plus, minus, mean = 0, mean_sq = 0, mean_variance = 0;
+  const double h = 1e-4;
+  const int seeds = 4000;
+  int i, j;
+
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + i);
+    weight[i] = 1.0 + 0.1 * (i % 3);
+  }
+
+  check(coxdev_sampled_deviance(design, eta, weight, N, 1, &dev, &variance, grad, diag) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, weight, &cox_dev, cox_grad, cox_diag) == COXDEV_OK,
+	coxdev_last_error());
+  check(fabs(dev - cox_dev) < 1e-10, "sampled deviance with every row drawn");
+  check(variance == 0, "no sampling variance with every row drawn");
+  for (i = 0; i < N; ++i) {
+    check(fabs(grad[i] - cox_grad[i]) < 1e-10, "sampled gradient with every row drawn");
+    /* Efron's diag_hessian of coxdev_deviance is not quite the diagonal */
+    check(tie_breaking == COXDEV_EFRON || fabs(diag[i] - cox_diag[i]) < 1e-10,
+	  "sampled Hessian diagonal with every row drawn");
+  }
+
+  check(coxdev_sampled_deviance(design, eta, weight, 3, 7, &dev, &variance, grad, diag) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_sampled_deviance(design, eta, weight, 3, 7, &again, NULL, NULL, NULL) == COXDEV_OK,
+	coxdev_last_error());
+  check(again == dev, "sampled deviance depends on the seed alone");
+  check(coxdev_sampled_deviance(design, eta, weight, 3, 8, &again, NULL, NULL, NULL) == COXDEV_OK,
+	coxdev_last_error());
+  check(again != dev, "seeds draw different controls");
+  check(variance > 0, "sampling variance");
+  for (j = 0; j < N; ++j) {
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] + (i == j ? h : 0);
+    check(coxdev_sampled_deviance(design, shifted, weight, 3, 7, &plus, NULL, NULL, NULL) == COXDEV_OK,
+	  coxdev_last_error());
+    for (i = 0; i < N; ++i) shifted[i] = eta[i] - (i == j ? h : 0);
+    check(coxdev_sampled_deviance(design, shifted, weight, 3, 7, &minus, NULL, NULL, NULL) == COXDEV_OK,
+	  coxdev_last_error());
+    check(fabs((plus - minus) / (2 * h) - grad[j]) < 1e-6, "sampled gradient");
+    check(fabs((plus - 2 * dev + minus) / (h * h) - diag[j]) < 1e-4, "sampled Hessian diagonal");
+  }
+
+  for (j = 0; j < seeds; ++j) {
+    check(coxdev_sampled_deviance(design, eta, weight, 3, j, &dev, &variance, NULL, NULL) == COXDEV_OK,
+	  coxdev_last_error());
+    mean += dev / seeds;
+    mean_sq += dev * dev / seeds;
+    mean_variance += variance / seeds;
+  }
+  check(fabs(mean_variance / (mean_sq - mean * mean) - 1) < 0.5, "sampling variance estimate");
+
+  check(coxdev_sampled_deviance(design, eta, weight, 0, 7, &dev, NULL, NULL, NULL) == COXDEV_ERROR,
+	"no controls is an error");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void check_outcomes(const double *start_times, int tie_breaking)
+{
+  coxdev_outcomes *outcomes;
+  coxdev_design *design;
+  coxdev_workspace *ws, *design_ws;
+  double events[3 * N], eta[N], weight[N], grad[N], deviance[3], gradients[3 * N], dev;
+  int statuses[3 * N];
+  int i, k;
+
+  /* the example outcome, one with its times permuted and one without ties */
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(1.0 + 2.0 * i);
+    weight[i] = 1.0 + 0.3 * (i % 2);
+    events[i] = event[i];
+    statuses[i] = status[i];
+    events[N + i] = event[(5 * i) % N] + 0.5;
+    statuses[N + i] = status[(7 * i) % N];
+    events[2 * N + i] = 3.0 + 0.25 * i;
+    statuses[2 * N + i] = i % 3 != 0;
+  }
+  check(coxdev_outcomes_create(N, 3, start_times, events, statuses, tie_breaking, &outcomes) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_outcomes_workspace_create(outcomes, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_outcomes_deviance(outcomes, ws, eta, weight, 0, 3, deviance, gradients) == COXDEV_OK,
+	coxdev_last_error());
+  for (k = 0; k < 3; ++k) {
+    check(coxdev_design_create(N, start_times, events + N * k, statuses + N * k, tie_breaking, &design) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_workspace_create(design, &design_ws) == COXDEV_OK, coxdev_last_error());
+    dev = deviance_at(design, design_ws, eta, weight, grad);
+    check(fabs(deviance[k] - dev) < 1e-12, "outcome deviance");
+    for (i = 0; i < N; ++i) {
+      check(fabs(gradients[N * k + i] - grad[i]) < 1e-12, "outcome gradient");
+    }
+    coxdev_workspace_free(design_ws);
+    coxdev_design_free(design);
+  }
+
+  /* a range of the outcomes, without gradients */
+  check(coxdev_outcomes_deviance(outcomes, ws, eta, NULL, 1, 2, deviance, NULL) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_outcomes_deviance(outcomes, ws, eta, NULL, 2, 2, deviance, NULL) == COXDEV_ERROR,
+	"outcome range");
+  coxdev_workspace_free(ws);
+  coxdev_outcomes_free(outcomes);
+  statuses[0] = 2;
+  check(coxdev_outcomes_create(N, 3, start_times, events, statuses, tie_breaking, &outcomes) == COXDEV_ERROR,
+	"outcome status");
+}
+
+static void check_append(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *appended;
+  coxdev_workspace *ws, *appended_ws;
+  double eta[N], weight[N], grad[N], appended_grad[N], info[N], appended_info[N];
+  double time[N], cumhaz[N], appended_time[N], appended_cumhaz[N], dev;
+  int64_t n_times, appended_n_times;
+  const int64_t sizes[3] = {4, 0, 5};
+  int64_t begin;
+  int i, k;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(3.0 * i);
+    weight[i] = 1.0 + 0.2 * (i % 3);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+
+  /* the first 3 rows have no tied deaths, the rest arrive in batches */
+  check(coxdev_design_create(3, start_times, event, status, tie_breaking, &appended) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(appended, &appended_ws) == COXDEV_OK, coxdev_last_error());
+  begin = 3;
+  for (k = 0; k < 3; ++k) {
+    check(coxdev_design_append(appended, sizes[k], start_times != NULL ? start_times + begin : NULL,
+			       event + begin, status + begin) == COXDEV_OK, coxdev_last_error());
+    begin += sizes[k];
+  }
+  check(coxdev_design_size(appended) == N, "appended size");
+  check(coxdev_deviance(appended, appended_ws, eta, weight, &dev, NULL, NULL) == COXDEV_ERROR,
+	"workspace of the design before appending is an error");
+  coxdev_workspace_free(appended_ws);
+  check(coxdev_workspace_create(appended, &appended_ws) == COXDEV_OK, coxdev_last_error());
+
+  check(fabs(deviance_at(design, ws, eta, weight, grad) -
+	     deviance_at(appended, appended_ws, eta, weight, appended_grad)) < 1e-12, "appended deviance");
+  check(coxdev_information_matvec(design, ws, eta, info) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_information_matvec(appended, appended_ws, eta, appended_info) == COXDEV_OK, coxdev_last_error());
+  for (i = 0; i < N; ++i) {
+    check(fabs(grad[i] - appended_grad[i]) < 1e-12, "appended gradient");
+    check(fabs(info[i] - appended_info[i]) < 1e-12, "appended information");
+  }
+  check(coxdev_baseline_hazard(design, ws, time, cumhaz, &n_times) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_baseline_hazard(appended, appended_ws, appended_time, appended_cumhaz,
+			       &appended_n_times) == COXDEV_OK, coxdev_last_error());
+  check(n_times == appended_n_times, "appended event times");
+  for (i = 0; i < n_times; ++i) {
+    check(time[i] == appended_time[i] && fabs(cumhaz[i] - appended_cumhaz[i]) < 1e-12, "appended baseline hazard");
+  }
+
+  check(coxdev_design_append(appended, 1, start_times != NULL ? NULL : start, event, status) == COXDEV_ERROR,
+	"start times must match the design");
+  coxdev_workspace_free(appended_ws);
+  coxdev_workspace_free(ws);
+  coxdev_design_free(appended);
+  coxdev_design_free(design);
+}
+
+#define B 5
+
+static void check_bootstrap(const double *start_times, int tie_breaking, int scheme)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], weight[N], X[2 * N], replicate_weight[N], grad[N];
+  double dev[B], X_gradient[2 * B], tiled[B], tiled_gradient[2 * B];
+  int i, b;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = cos(2.0 + i);
+    weight[i] = 1.0 + 0.1 * (i % 4);
+    X[i] = sin(2.0 * i);
+    X[N + i] = (double) (i % 2);
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_bootstrap(design, ws, eta, weight, scheme, 2024, 0, B, X, 2, dev, X_gradient) == COXDEV_OK,
+	coxdev_last_error());
+
+  /* replicates split between calls give the same bits */
+  check(coxdev_bootstrap(design, ws, eta, weight, scheme, 2024, 0, 2, X, 2, tiled, tiled_gradient) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_bootstrap(design, ws, eta, weight, scheme, 2024, 2, B - 2, X, 2, tiled + 2,
+			 tiled_gradient + 4) == COXDEV_OK, coxdev_last_error());
+  for (b = 0; b < B; ++b) {
+    check(tiled[b] == dev[b], "bootstrap tiles");
+    check(tiled_gradient[2 * b] == X_gradient[2 * b] && tiled_gradient[2 * b + 1] == X_gradient[2 * b + 1],
+	  "bootstrap tile gradients");
+  }
+
+  for (b = 0; b < B; ++b) {
+    double Xg0 = 0.0, Xg1 = 0.0;
+    check(coxdev_bootstrap_weights(scheme, 2024, b, N, replicate_weight) == COXDEV_OK, coxdev_last_error());
+    for (i = 0; i < N; ++i) {
+      check(replicate_weight[i] >= 0 && (scheme == COXDEV_BAYESIAN || replicate_weight[i] == floor(replicate_weight[i])),
+	    "bootstrap weights");
+      replicate_weight[i] *= weight[i];
+    }
+    check(fabs(deviance_at(design, ws, eta, replicate_weight, grad) - dev[b]) < 1e-12, "bootstrap deviance");
+    for (i = 0; i < N; ++i) {
+      Xg0 += X[i] * grad[i];
+      Xg1 += X[N + i] * grad[i];
+    }
+    check(fabs(Xg0 - X_gradient[2 * b]) < 1e-12 && fabs(Xg1 - X_gradient[2 * b + 1]) < 1e-12,
+	  "bootstrap X' gradient");
+  }
+  check(dev[0] != dev[1], "replicates differ");
+
+  check(coxdev_bootstrap(design, ws, eta, weight, 2, 2024, 0, B, NULL, 0, dev, NULL) == COXDEV_ERROR,
+	"unknown bootstrap scheme is an error");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+}
+
+static void same(const double *a, const double *b, int64_t m, const char *what)
+{
+  int64_t i;
+  for (i = 0; i < m; ++i) {
+    check(a[i] == b[i], what);
+  }
+}
+
+/* Every function reading or writing a workspace, in an order in which each
+   reads what others left, on a full and a low memory workspace. */
+static void check_low_memory(const double *start_times, int tie_breaking)
+{
+  coxdev_design *design, *finegray;
+  coxdev_workspace *ws[2];
+  double eta[N], weight[N], arg[N], X[N * 2], Z[N];
+  double dev[2], grad[2][N], diag[2][N], out[2][N], dense[2][N * N];
+  double martingale[2][N], residual[2][N], score[2][N * 2], schoenfeld[2][N * 2];
+  double meat[2][4], covariance[2][4], screen[2][2], variance[2][2];
+  double horizon[2] = {3.5, 6.0}, sat[2][2], sweep[2][2], sweep_grad[2][N * 2];
+  double time[2][N], cumhaz[2][N], boot[2][3], boot_grad[2][2 * 3];
+  int64_t cluster[N], n_times[2];
+  int i, k;
+
+  for (i = 0; i < N; ++i) {
+    eta[i] = sin(0.5 + 2.0 * i);
+    weight[i] = 1.0 + 0.3 * (i % 3);
+    arg[i] = cos(1.0 + i);
+    X[i] = 0.1 * i - 0.4;
+    X[N + i] = (i % 4) - 1.5;
+    Z[i] = (i % 2) - 0.5;
+    cluster[i] = i % 5;
+  }
+  check(coxdev_design_create(N, start_times, event, status, tie_breaking, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_workspace_create(design, &ws[0]) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_workspace_create_low_memory(design, &ws[1]) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_workspace_nbytes(ws[1]) == 16 * (N + 1) * (int64_t) sizeof(double), "low memory workspace size");
+  check(coxdev_workspace_nbytes(ws[0]) == 24 * (N + 1) * (int64_t) sizeof(double), "workspace size");
+
+  for (k = 0; k < 2; ++k) {
+    check(coxdev_deviance(design, ws[k], eta, weight, &dev[k], grad[k], diag[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_information_matrix(design, ws[k], NULL, 0, NULL, 0, dense[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_information_matvec(design, ws[k], arg, out[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_residuals(design, ws[k], martingale[k], residual[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_score_residuals(design, ws[k], X, 2, score[k], schoenfeld[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_robust_variance(design, ws[k], X, 2, cluster, 5, meat[k], covariance[k]) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_score_screen(design, ws[k], Z, 1, X, 2, screen[k], variance[k]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_horizon_sweep(design, ws[k], horizon, 2, sat[k], sweep[k], sweep_grad[k]) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_baseline_hazard(design, ws[k], time[k], cumhaz[k], &n_times[k]) == COXDEV_OK, coxdev_last_error());
+  }
+  check(dev[0] == dev[1], "low memory deviance");
+  same(grad[0], grad[1], N, "low memory gradient");
+  same(diag[0], diag[1], N, "low memory diagonal Hessian");
+  same(dense[0], dense[1], N * N, "low memory information matrix");
+  same(out[0], out[1], N, "low memory information matvec");
+  same(martingale[0], martingale[1], N, "low memory martingale residuals");
+  same(residual[0], residual[1], N, "low memory deviance residuals");
+  same(score[0], score[1], N * 2, "low memory score residuals");
+  same(schoenfeld[0], schoenfeld[1], N * 2, "low memory schoenfeld residuals");
+  same(meat[0], meat[1], 4, "low memory robust variance meat");
+  same(covariance[0], covariance[1], 4, "low memory robust variance");
+  same(screen[0], screen[1], 2, "low memory score screen");
+  same(variance[0], variance[1], 2, "low memory score screen variance");
+  same(sweep[0], sweep[1], 2, "low memory horizon sweep");
+  same(sweep_grad[0], sweep_grad[1], N * 2, "low memory horizon sweep gradient");
+  check(n_times[0] == n_times[1], "low memory baseline hazard times");
+  same(cumhaz[0], cumhaz[1], n_times[0], "low memory baseline hazard");
+
+  for (k = 0; k < 2; ++k) {
+    check(coxdev_bootstrap(design, ws[k], eta, NULL, COXDEV_POISSON, 7, 0, 3, X, 2, boot[k], boot_grad[k]) == COXDEV_OK,
+	  coxdev_last_error());
+    check(coxdev_information_matvec(design, ws[k], arg, out[k]) == COXDEV_OK, coxdev_last_error());
+  }
+  same(boot[0], boot[1], 3, "low memory bootstrap");
+  same(boot_grad[0], boot_grad[1], 2 * 3, "low memory bootstrap gradient");
+  same(out[0], out[1], N, "low memory information matvec after bootstrap");
+  coxdev_workspace_free(ws[0]);
+  coxdev_workspace_free(ws[1]);
+
+  if (start_times == NULL) {
+    check(coxdev_finegray_create(N, event, fg_status, tie_breaking, &finegray) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_workspace_create(finegray, &ws[0]) == COXDEV_OK, coxdev_last_error());
+    check(coxdev_workspace_create_low_memory(finegray, &ws[1]) == COXDEV_OK, coxdev_last_error());
+    for (k = 0; k < 2; ++k) {
+      check(coxdev_finegray_deviance(finegray, ws[k], eta, weight, &dev[k], grad[k], diag[k]) == COXDEV_OK,
+	    coxdev_last_error());
+      check(coxdev_finegray_information_matvec(finegray, ws[k], arg, out[k]) == COXDEV_OK, coxdev_last_error());
+      check(coxdev_finegray_information_matvec(finegray, ws[k], X, dense[k]) == COXDEV_OK, coxdev_last_error());
+    }
+    check(dev[0] == dev[1], "low memory Fine-Gray deviance");
+    same(grad[0], grad[1], N, "low memory Fine-Gray gradient");
+    same(diag[0], diag[1], N, "low memory Fine-Gray diagonal Hessian");
+    same(out[0], out[1], N, "low memory Fine-Gray information matvec");
+    same(dense[0], dense[1], N, "low memory Fine-Gray information matvec, again");
+    coxdev_workspace_free(ws[0]);
+    coxdev_workspace_free(ws[1]);
+    coxdev_design_free(finegray);
+  }
+  coxdev_design_free(design);
+}
+
+int main(void)
+{
+  coxdev_design *design;
+  coxdev_workspace *ws;
+  double eta[N], dev;
+  const int bad_status[N] = {1, 2, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1};
+  int i;
+
+  for (i = 0; i < N; ++i) eta[i] = -1.0 + 2.0 * i / (N - 1);
+
+  check(coxdev_design_create(N, NULL, event, status, COXDEV_EFRON, &design) == COXDEV_OK,
+	coxdev_last_error());
+  check(coxdev_design_size(design) == N, "design size");
+  check(coxdev_workspace_create(design, &ws) == COXDEV_OK, coxdev_last_error());
+  check(coxdev_deviance(design, ws, eta, NULL, &dev, NULL, NULL) == COXDEV_OK, coxdev_last_error());
+  check(fabs(dev - 20.7998) < 5e-5, "deviance of the docstring example");
+  coxdev_workspace_free(ws);
+  coxdev_design_free(design);
+
+  check_derivatives(NULL, COXDEV_EFRON);
+  check_derivatives(NULL, COXDEV_BRESLOW);
+  check_derivatives(start, COXDEV_EFRON);
+  check_derivatives(start, COXDEV_BRESLOW);
+
+  check_information_matrix(NULL, COXDEV_EFRON);
+  check_information_matrix(NULL, COXDEV_BRESLOW);
+  check_information_matrix(start, COXDEV_EFRON);
+  check_information_matrix(start, COXDEV_BRESLOW);
+
+  check_score_screen(NULL, COXDEV_EFRON);
+  check_score_screen(NULL, COXDEV_BRESLOW);
+  check_score_screen(start, COXDEV_EFRON);
+  check_score_screen(start, COXDEV_BRESLOW);
+
+  check_horizon_sweep(NULL, COXDEV_EFRON);
+  check_horizon_sweep(NULL, COXDEV_BRESLOW);
+  check_horizon_sweep(start, COXDEV_EFRON);
+  check_horizon_sweep(start, COXDEV_BRESLOW);
+
+  check_landmarks(NULL, COXDEV_EFRON);
+  check_landmarks(NULL, COXDEV_BRESLOW);
+  check_landmarks(start, COXDEV_EFRON);
+  check_landmarks(start, COXDEV_BRESLOW);
+
+  check_finegray(COXDEV_EFRON);
+  check_finegray(COXDEV_BRESLOW);
+
+  check_exact(NULL, COXDEV_EFRON);
+  check_exact(start, COXDEV_BRESLOW);
+
+  check_sampled(NULL, COXDEV_EFRON);
+  check_sampled(NULL, COXDEV_BRESLOW);
+  check_sampled(start, COXDEV_EFRON);
+  check_sampled(start, COXDEV_BRESLOW);
+
+  check_outcomes(NULL, COXDEV_EFRON);
+  check_outcomes(NULL, COXDEV_BRESLOW);
+  check_outcomes(start, COXDEV_EFRON);
+  check_outcomes(start, COXDEV_BRESLOW);
+
+  check_zero_weights(NULL, COXDEV_EFRON);
+  check_zero_weights(NULL, COXDEV_BRESLOW);
+  check_zero_weights(start, COXDEV_EFRON);
+  check_zero_weights(start, COXDEV_BRESLOW);
+
+  check_concordance(NULL, COXDEV_HARRELL, INFINITY);
+  check_concordance(start, COXDEV_HARRELL, INFINITY);
+  check_concordance(NULL, COXDEV_UNO, INFINITY);
+  check_concordance(start, COXDEV_UNO, 5.0);
+
+  check_baseline_hazard(NULL, COXDEV_EFRON);
+  check_baseline_hazard(NULL, COXDEV_BRESLOW);
+  check_baseline_hazard(start, COXDEV_EFRON);
+  check_baseline_hazard(start, COXDEV_BRESLOW);
+
+  check_residuals(NULL, COXDEV_EFRON);
+  check_residuals(NULL, COXDEV_BRESLOW);
+  check_residuals(start, COXDEV_EFRON);
+  check_residuals(start, COXDEV_BRESLOW);
+
+  check_robust_variance(NULL, COXDEV_EFRON);
+  check_robust_variance(NULL, COXDEV_BRESLOW);
+  check_robust_variance(start, COXDEV_EFRON);
+  check_robust_variance(start, COXDEV_BRESLOW);
+
+  check_append(NULL, COXDEV_EFRON);
+  check_append(NULL, COXDEV_BRESLOW);
+  check_append(start, COXDEV_EFRON);
+  check_append(start, COXDEV_BRESLOW);
+
+  check_bootstrap(NULL, COXDEV_EFRON, COXDEV_POISSON);
+  check_bootstrap(start, COXDEV_BRESLOW, COXDEV_POISSON);
+  check_bootstrap(NULL, COXDEV_BRESLOW, COXDEV_BAYESIAN);
+  check_bootstrap(start, COXDEV_EFRON, COXDEV_BAYESIAN);
+
+  check_low_memory(NULL, COXDEV_EFRON);
+  check_low_memory(NULL, COXDEV_BRESLOW);
+  check_low_memory(start, COXDEV_EFRON);
+  check_low_memory(start, COXDEV_BRESLOW);
+
+  check(coxdev_design_create(N, NULL, event, bad_status, COXDEV_EFRON, &design) == COXDEV_ERROR,
+	"non binary status is an error");
+  check(design == NULL, "no design on error");
+
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
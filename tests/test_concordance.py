@@ -0,0 +1,154 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, StratifiedCoxDeviance
+
+try:
+    import rpy2.robjects as rpy
+    has_rpy2 = True
+except ImportError:
+    has_rpy2 = False
+
+if has_rpy2:
+    from rpy2.robjects.packages import importr
+    from rpy2.robjects import numpy2ri
+    from rpy2.robjects import default_converter
+
+    np_cv_rules = default_converter + numpy2ri.converter
+    survivalR = importr('survival')
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def _at_risk(start, event, j, t):
+    return event[j] >= t and (start is None or start[j] < t)
+
+def _censoring_survival(start, event, status, weight, t):
+    # Kaplan-Meier estimate of the censoring distribution just before t
+    G = 1
+    for c in np.unique(event[(status == 0) & (event < t)]):
+        censored = weight[(status == 0) & (event == c)].sum()
+        risk = sum(weight[j] for j in range(event.shape[0]) if _at_risk(start, event, j, c))
+        G *= 1 - censored / risk
+    return G
+
+def concordance_by_pairs(start, event, status, eta, weight, method='harrell', tau=np.inf):
+    counts = np.zeros(3) # concordant, discordant, tied_risk
+    n = event.shape[0]
+    for i in range(n):
+        if status[i] != 1 or event[i] >= tau:
+            continue
+        omega = weight[i]
+        if method == 'uno':
+            omega /= _censoring_survival(start, event, status, weight, event[i])**2
+        for j in range(n):
+            if j == i or not _at_risk(start, event, j, event[i]):
+                continue
+            if event[j] == event[i] and status[j] == 1: # tied event times
+                continue
+            if eta[i] > eta[j]:
+                counts[0] += omega * weight[j]
+            elif eta[i] < eta[j]:
+                counts[1] += omega * weight[j]
+            else:
+                counts[2] += omega * weight[j]
+    return counts
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('method', ['harrell', 'uno'])
+@pytest.mark.parametrize('tau', [None, 'median'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_concordance(have_start_times,
+                     method,
+                     tau,
+                     weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    # rounded so there are ties in the linear predictor
+    eta = np.round(rng.standard_normal(n), 1)
+    weight = sample_weights(n) if weighted else np.ones(n)
+    if tau == 'median':
+        tau = np.median(event)
+
+    cox = CoxDeviance(event=event, status=status, start=start)
+    result = cox.concordance(eta, weight if weighted else None, method=method, tau=tau)
+
+    expected = concordance_by_pairs(start, event, status, eta, weight,
+                                    method=method,
+                                    tau=np.inf if tau is None else tau)
+    assert np.allclose([result.concordant, result.discordant, result.tied_risk], expected)
+    assert np.allclose(result.concordance,
+                       (expected[0] + expected[2] / 2) / expected.sum())
+
+def test_concordance_float32():
+
+    start, event, status = simulate_arrays(True)
+    eta = rng.standard_normal(event.shape[0])
+    cox = CoxDeviance(event=event, status=status, start=start)
+    C = cox.concordance(eta).concordance
+    # float32 rounding can only merge close values into ties
+    assert np.fabs(cox.concordance(eta.astype(np.float32)).concordance - C) < 1e-2
+
+def test_concordance_bad_method():
+
+    start, event, status = simulate_arrays(False)
+    cox = CoxDeviance(event=event, status=status)
+    with pytest.raises(ValueError):
+        cox.concordance(np.zeros(event.shape[0]), method='somers')
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('method', ['harrell', 'uno'])
+def test_stratified_concordance(have_start_times,
+                                method):
+
+    start, event, status = simulate_arrays(have_start_times, nrep=10)
+    n = event.shape[0]
+    strata = rng.choice(4, size=n)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+
+    expected = np.zeros(3)
+    for s in np.unique(strata):
+        keep = strata == s
+        expected += concordance_by_pairs(None if start is None else start[keep],
+                                         event[keep],
+                                         status[keep],
+                                         eta[keep],
+                                         weight[keep],
+                                         method=method)
+
+    cox = StratifiedCoxDeviance(event=event, status=status, strata=strata, start=start)
+    for n_jobs in [1, 4]:
+        result = cox.concordance(eta, weight, method=method, n_jobs=n_jobs)
+        assert np.allclose([result.concordant, result.discordant, result.tied_risk], expected)
+
+@pytest.mark.skipif(not has_rpy2, reason='requires rpy2')
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_concordance_survival(have_start_times):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = np.round(rng.standard_normal(n), 1)
+    weight = sample_weights(n)
+
+    cox = CoxDeviance(event=event, status=status, start=start)
+    result = cox.concordance(eta, weight)
+
+    with np_cv_rules.context():
+        rpy.r.assign('event', event)
+        rpy.r.assign('status', status)
+        rpy.r.assign('eta', eta)
+        rpy.r.assign('weight', weight)
+        if have_start_times:
+            rpy.r.assign('start', start)
+            rpy.r('y = Surv(start, event, status)')
+        else:
+            rpy.r('y = Surv(event, status)')
+        rpy.r('C = concordance(y ~ eta, weights=weight, reverse=TRUE)')
+        C = rpy.r('C$concordance')
+        counts = rpy.r('C$count')
+
+    assert np.allclose(result.concordance, C)
+    assert np.allclose([result.concordant, result.discordant, result.tied_risk], counts[:3])
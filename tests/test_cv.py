@@ -0,0 +1,110 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, CoxCV
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def _subset_deviance(start, event, status, weight, eta, keep, tie_breaking):
+    cox = CoxDeviance(event=event[keep],
+                      status=status[keep],
+                      start=None if start is None else start[keep],
+                      tie_breaking=tie_breaking)
+    return cox(eta[keep], weight[keep]).deviance
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_cv(have_start_times,
+            tie_breaking,
+            weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    weight = sample_weights(n) if weighted else np.ones(n)
+    n_folds = 4
+    # tied blocks are split between folds
+    foldid = rng.choice(n_folds, size=n)
+
+    cv = CoxCV(event=event,
+               status=status,
+               foldid=foldid,
+               start=start,
+               sample_weight=weight if weighted else None,
+               tie_breaking=tie_breaking)
+    assert cv.n_folds == n_folds
+
+    # a path of 3 linear predictors per fold
+    eta = rng.standard_normal((3, n_folds, n))
+    for n_jobs in [1, 4]:
+        result = cv.deviances(eta, n_jobs=n_jobs)
+        assert result.cv_deviance.shape == (3, n_folds)
+        for l in range(3):
+            for k in range(n_folds):
+                full = cv.coxdev(eta[l, k], weight).deviance
+                training = _subset_deviance(start, event, status, weight, eta[l, k],
+                                            foldid != cv.folds[k], tie_breaking)
+                assert np.allclose(result.full_deviance[l, k], full)
+                assert np.allclose(result.training_deviance[l, k], training)
+                assert np.allclose(result.cv_deviance[l, k], full - training)
+
+    # one linear predictor per fold
+    assert cv.deviances(eta[0]).cv_deviance.shape == (n_folds,)
+
+    with pytest.raises(ValueError):
+        cv.deviances(eta[..., 1:])
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_cv_leave_one_out(tie_breaking):
+
+    start, event, status = simulate_arrays(False, nrep=2)
+    n = event.shape[0]
+    cv = CoxCV(event=event,
+               status=status,
+               foldid=np.arange(n),
+               tie_breaking=tie_breaking)
+    eta = rng.standard_normal((n, n))
+    result = cv.deviances(eta)
+    for i in range(n):
+        keep = np.arange(n) != i
+        training = _subset_deviance(None, event, status, np.ones(n), eta[i], keep, tie_breaking)
+        assert np.allclose(result.training_deviance[i], training)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_cv_efron_ties(have_start_times):
+
+    # heavy ties: 4 event times, each block split across the folds
+    n = 40
+    event = rng.integers(1, 5, size=n).astype(float)
+    status = (rng.uniform(size=n) < 0.8).astype(int)
+    start = event - rng.uniform(0.5, 3, size=n) if have_start_times else None
+    weight = sample_weights(n)
+    foldid = rng.choice(3, size=n)
+    cv = CoxCV(event=event, status=status, foldid=foldid, start=start,
+               sample_weight=weight)
+    eta = rng.standard_normal((3, n))
+    result = cv.deviances(eta)
+    for k in range(3):
+        keep = foldid != cv.folds[k]
+        training = _subset_deviance(start, event, status, weight, eta[k], keep, 'efron')
+        assert np.allclose(result.training_deviance[k], training)
+        # tied blocks are only rearranged, keeping every row
+        design = cv.training_design(k)
+        assert np.array_equal(np.sort(design.event_order), np.arange(n))
+
+def test_cv_workspace_state():
+
+    # evaluations of the folds do not leave stale results behind
+    start, event, status = simulate_arrays(False)
+    n = event.shape[0]
+    cv = CoxCV(event=event, status=status, foldid=rng.choice(3, size=n))
+    eta = rng.standard_normal(n)
+    before = cv.coxdev(eta)
+    cv.deviances(np.stack([eta] * 3), n_jobs=1)
+    after = cv.coxdev(eta)
+    assert np.allclose(after.deviance, before.deviance)
+    v = rng.standard_normal(n)
+    assert np.allclose(cv.coxdev.information(eta) @ v,
+                       CoxDeviance(event=event, status=status).information(eta) @ v)
@@ -0,0 +1,70 @@
+from itertools import combinations
+
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (rng,
+                      sample_weights)
+
+def exact_by_subsets(eta, weight, event, status, start=None):
+    """Deviance of the exact partial likelihood by summing over the
+    subsets of each risk set."""
+    sat, loglik = 0., 0.
+    keep = weight > 0
+    for t in np.unique(event[(status == 1) & keep]):
+        D = np.nonzero((event == t) & (status == 1) & keep)[0]
+        at_risk = (event >= t) & keep
+        if start is not None:
+            at_risk &= start < t
+        R = np.nonzero(at_risk)[0]
+        w_avg = weight[D].mean()
+        x = weight * np.exp(eta)
+        e_d = sum(np.prod(x[list(S)]) for S in combinations(R, D.shape[0]))
+        sat -= w_avg * np.log(weight[D]).sum()
+        loglik += (weight[D] * eta[D]).sum() - w_avg * np.log(e_d)
+    return 2 * (sat - loglik)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_exact(have_start_times,
+               weighted):
+
+    # few distinct times, so blocks of several ties, and few enough
+    # subjects to enumerate the subsets of the risk sets
+    n = 16
+    event = rng.integers(1, 6, size=n).astype(float)
+    status = rng.choice([0, 1, 1], size=n)
+    start = event - rng.uniform(0.5, 3, size=n) if have_start_times else None
+    weight = sample_weights(n) if weighted else np.ones(n)
+    eta = rng.standard_normal(n) * 0.5
+
+    cox = CoxDeviance(event=event, status=status, start=start)
+    result = cox.exact_deviance(eta, weight if weighted else None, n_jobs=3)
+    f = lambda x: exact_by_subsets(x, weight, event, status, start)
+    assert np.allclose(result.deviance, f(eta))
+
+    h = 1e-4
+    E = np.identity(n) * h
+    grad = np.array([(f(eta + e) - f(eta - e)) / (2 * h) for e in E])
+    diag = np.array([(f(eta + e) - 2 * f(eta) + f(eta - e)) / h**2 for e in E])
+    assert np.allclose(result.gradient, grad, atol=1e-5)
+    assert np.allclose(result.diag_hessian, diag, atol=1e-3)
+
+    # the split into ranges of tie blocks does not change the result
+    serial = cox.exact_deviance(eta, weight if weighted else None, n_jobs=1)
+    assert np.allclose(serial.deviance, result.deviance)
+    assert np.allclose(serial.diag_hessian, result.diag_hessian)
+
+def test_exact_untied():
+
+    n = 40
+    event = rng.exponential(size=n)
+    status = rng.choice([0, 1], size=n)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    cox = CoxDeviance(event=event, status=status, tie_breaking='breslow')
+    exact = cox.exact_deviance(eta, weight)
+    breslow = cox(eta, weight)
+    assert np.allclose(exact.deviance, breslow.deviance)
@@ -0,0 +1,83 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, FineGrayDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+def censoring_survival(event, status, weight, t):
+    """Kaplan-Meier censoring survival just before t, events of either
+    kind preceding censorings at the same time."""
+    G = 1.
+    for c in np.unique(event[(status == 0) & (event < t)]):
+        censored = weight[(status == 0) & (event == c)].sum()
+        at_risk = weight[(event > c) | ((event == c) & (status == 0))].sum()
+        G *= 1 - censored / at_risk
+    return G
+
+def expand(event, status, weight):
+    """The weighted (start, stop] rows of the usual Fine-Gray fit: a row
+    per subject and, for a competing event, a row per later event time
+    of the cause."""
+    times = np.unique(event[status == 1])
+    rows = []
+    for i in range(event.shape[0]):
+        rows.append((-1., event[i], status[i] == 1, weight[i], i))
+        if status[i] == 2:
+            prev = event[i]
+            G_i = censoring_survival(event, status, weight, event[i])
+            for t in times[times > event[i]]:
+                rows.append((prev, t, 0, weight[i] * censoring_survival(event, status, weight, t) / G_i, i))
+                prev = t
+    start, stop, cause, w, owner = [np.array(v) for v in zip(*rows)]
+    return start, stop, cause.astype(int), w, owner.astype(int)
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_finegray(tie_breaking,
+                  weighted):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=3,
+                       size=5,
+                       rng=rng)
+    event = np.asarray(data['event'])
+    n = event.shape[0]
+    # a third of the events become competing events
+    status = np.asarray(data['status']) * rng.choice([1, 1, 2], size=n)
+    weight = sample_weights(n) if weighted else np.ones(n)
+    eta = rng.standard_normal(n) * 0.5
+    arg = rng.standard_normal(n)
+
+    fg = FineGrayDeviance(event=event, status=status, tie_breaking=tie_breaking)
+    result = fg(eta, weight if weighted else None)
+    info = fg.information(eta, weight if weighted else None)
+
+    start, stop, cause, w, owner = expand(event, status, weight)
+    cox = CoxDeviance(event=stop, status=cause, start=start, tie_breaking=tie_breaking)
+    expanded = cox(eta[owner], w)
+    I = cox.information(eta[owner], w)
+
+    assert np.allclose(result.deviance, expanded.deviance)
+    assert np.allclose(result.gradient, np.bincount(owner, expanded.gradient, minlength=n))
+    assert np.allclose(info @ arg, np.bincount(owner, I @ arg[owner], minlength=n))
+    D = np.column_stack([info @ e for e in np.identity(n)])
+    assert np.allclose(result.diag_hessian, 2 * np.diag(D))
+
+def test_finegray_cause():
+
+    event = rng.exponential(size=30)
+    status = rng.choice([0, 1, 2], size=30)
+    eta = rng.standard_normal(30)
+    fg1 = FineGrayDeviance(event=event, status=status)
+    # the same model with the causes' codes swapped
+    fg2 = FineGrayDeviance(event=event, status=np.choose(status, [0, 2, 1]), cause=2)
+    assert np.allclose(fg1(eta).deviance, fg2(eta).deviance)
+    assert np.all(fg1.competing == (status == 2))
+    # without competing events it is the Cox deviance
+    fg0 = FineGrayDeviance(event=event, status=np.minimum(status, 1))
+    cox = CoxDeviance(event=event, status=np.minimum(status, 1))
+    assert np.allclose(fg0(eta).deviance, cox(eta).deviance)
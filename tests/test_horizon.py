@@ -0,0 +1,54 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('gradient', [True, False])
+def test_horizon_sweep(have_start_times,
+                       tie_breaking,
+                       gradient):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    eta = rng.standard_normal(n) * 0.5
+    weight = sample_weights(n)
+
+    horizons = np.concatenate([np.quantile(event, [0.2, 0.5, 0.8]), [np.inf]])
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    sweep = cox.horizon_sweep(eta, horizons, sample_weight=weight, gradient=gradient)
+
+    for j, tau in enumerate(horizons):
+        # administrative censoring at tau
+        censored = CoxDeviance(event=np.minimum(event, tau),
+                               status=status * (event <= tau),
+                               start=start,
+                               tie_breaking=tie_breaking)
+        result = censored(eta, weight)
+        assert np.allclose(sweep.deviance[j], result.deviance)
+        assert np.allclose(sweep.loglik_sat[j], result.loglik_sat)
+        assert sweep.n_events[j] == (status * (event <= tau)).sum()
+        if gradient:
+            assert np.allclose(sweep.gradient[j], result.gradient, atol=1e-5)
+    if not gradient:
+        assert sweep.gradient is None
+
+def test_horizon_sweep_unsorted():
+
+    event = rng.exponential(size=20)
+    status = rng.binomial(1, 0.7, size=20)
+    cox = CoxDeviance(event=event, status=status)
+    with pytest.raises(ValueError):
+        cox.horizon_sweep(np.zeros(20), [2., 1.])
@@ -0,0 +1,70 @@
+import pytest
+
+import numpy as np
+from coxdev import CoxDeviance
+from coxdev.coxc import c_preprocess
+
+from simulate import (simulate_df, 
+                      all_combos,
+                      rng)
+
+rng = np.random.default_rng(0)
+
+def test_index_dtype():
+
+    data = simulate_df(all_combos[-1],
+                       nrep=3,
+                       size=4,
+                       rng=rng)
+    args = (np.asarray(data['start'], float),
+            np.asarray(data['event'], float),
+            np.asarray(data['status'], np.int32))
+
+    preproc32, event_order32, start_order32 = c_preprocess(*args)
+    preproc64, event_order64, start_order64 = c_preprocess(*args, use_int64=True)
+
+    assert event_order32.dtype == np.int32
+    assert event_order64.dtype == np.int64
+    assert np.all(event_order32 == event_order64)
+    assert np.all(start_order32 == start_order64)
+    for key in ['first', 'last', 'event_map', 'start_map']:
+        assert preproc64[key].dtype == np.int64
+        assert np.all(preproc32[key] == preproc64[key])
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_int64_agrees(tie_breaking,
+                      have_start_times,
+                      tol=1e-12):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=3,
+                       size=4,
+                       rng=rng)
+    start = data['start'] if have_start_times else None
+    n = data.shape[0]
+
+    cox32 = CoxDeviance(event=data['event'],
+                        start=start,
+                        status=data['status'],
+                        tie_breaking=tie_breaking)
+    cox64 = CoxDeviance(event=data['event'],
+                        start=start,
+                        status=data['status'],
+                        tie_breaking=tie_breaking,
+                        use_int64=True)
+    assert cox64._first.dtype == np.int64
+
+    eta = rng.standard_normal(n)
+    weight = rng.uniform(1, 2, size=n)
+    V = rng.standard_normal((n, 3))
+
+    C32 = cox32(eta, weight)
+    C64 = cox64(eta, weight)
+    assert np.fabs(C32.deviance - C64.deviance) < tol
+    assert np.allclose(C32.gradient, C64.gradient, atol=tol)
+    assert np.allclose(C32.diag_hessian, C64.diag_hessian, atol=tol)
+
+    I32 = cox32.information(eta, weight)
+    I64 = cox64.information(eta, weight)
+    assert np.allclose(I32 @ V, I64 @ V, atol=tol)
@@ -0,0 +1,33 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_information_matrix(have_start_times,
+                            tie_breaking,
+                            weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    sample_weight = sample_weights(n) if weighted else None
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    I = cox.information(eta, sample_weight) @ np.identity(n)
+
+    for n_jobs in [1, 3]:
+        dense = cox.information_matrix(eta, sample_weight, n_jobs=n_jobs)
+        assert dense.shape == (n, n)
+        assert np.allclose(dense, I)
+
+    rows = rng.choice(n, 7, replace=False)
+    columns = np.array([n - 1, 0, 0, 3])
+    block = cox.information_matrix(eta, sample_weight, rows=rows, columns=columns)
+    assert np.allclose(block, I[np.ix_(rows, columns)])
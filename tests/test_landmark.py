@@ -0,0 +1,60 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('shared', [True, False])
+def test_landmark_deviances(have_start_times,
+                            tie_breaking,
+                            shared):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    weight = sample_weights(n)
+
+    landmarks = np.quantile(event, [0.1, 0.3, 0.5])
+    horizons = landmarks + np.array([np.inf, 2., 1.])
+    L = landmarks.shape[0]
+    eta = rng.standard_normal(n) * 0.5 if shared else rng.standard_normal((n, L)) * 0.5
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    result = cox.landmark_deviances(eta, landmarks, horizons, sample_weight=weight, gradient=True, n_jobs=2)
+
+    for l, (s, h) in enumerate(zip(landmarks, horizons)):
+        # the stacked copy, formed explicitly
+        member = event > s
+        if have_start_times:
+            member &= start <= s
+        copy = CoxDeviance(event=np.minimum(event[member], h),
+                           status=status[member] * (event[member] <= h),
+                           start=np.full(member.sum(), s),
+                           tie_breaking=tie_breaking)
+        eta_l = eta if shared else eta[:, l]
+        copy_result = copy(eta_l[member], weight[member])
+        assert np.allclose(result.deviance[l], copy_result.deviance)
+        assert np.allclose(result.gradient[member, l], copy_result.gradient, atol=1e-5)
+        assert np.all(result.gradient[~member, l] == 0)
+        assert result.n_at_risk[l] == member.sum()
+        assert result.n_events[l] == (status[member] * (event[member] <= h)).sum()
+
+def test_landmark_horizons():
+
+    event = rng.exponential(size=20)
+    status = rng.binomial(1, 0.7, size=20)
+    cox = CoxDeviance(event=event, status=status)
+    with pytest.raises(ValueError):
+        cox.landmark_deviances(np.zeros(20), [0.5, 1.], [0.4, 2.])
+    with pytest.raises(ValueError):
+        cox.landmark_deviances(np.zeros((20, 3)), [0.5, 1.])
@@ -0,0 +1,101 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, FineGrayDeviance, StratifiedCoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_low_memory(have_start_times,
+                    tie_breaking):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    weight = sample_weights(n)
+    eta = rng.standard_normal(n) * 0.5
+    X = rng.standard_normal((n, 3))
+    v = rng.standard_normal(n)
+    cluster = rng.integers(0, 6, size=n)
+
+    full, low = [CoxDeviance(event=event, status=status, start=start,
+                             tie_breaking=tie_breaking, low_memory=low_memory)
+                 for low_memory in [False, True]]
+
+    # each reads what the evaluation before it left in the workspace
+    for cox in [full, low]:
+        cox.results = [cox(eta, weight),
+                       cox.information(eta, weight) @ v,
+                       cox.information_matrix(eta, weight, n_jobs=1),
+                       cox.residuals(eta, weight, X=X),
+                       cox.information(eta, weight) @ X[:, 0],
+                       cox.baseline_hazard(eta, weight),
+                       cox.robust_variance(eta, X, cluster, weight, n_jobs=1),
+                       cox.score_screen(eta, X, weight, n_jobs=1),
+                       cox.horizon_sweep(eta, [3, 5], weight, gradient=True),
+                       cox.bootstrap(eta, 3, seed=2, sample_weight=weight, X=X, n_jobs=1),
+                       cox(eta),
+                       cox.information(eta) @ v]
+
+    def check(a, b):
+        if hasattr(a, '__dict__'):
+            for key in a.__dict__:
+                if not key.startswith('_'):
+                    check(getattr(a, key), getattr(b, key))
+        elif a is not None and not isinstance(a, str):
+            assert np.allclose(a, b, rtol=1e-12, atol=1e-12)
+
+    for a, b in zip(full.results, low.results):
+        check(a, b)
+
+    footprint = low.memory_footprint()
+    assert footprint['design'] == full.memory_footprint()['design']
+    assert footprint['workspace'] * 24 == full.memory_footprint()['workspace'] * 16
+    assert footprint['workspace_doubles'] < 16.5
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_low_memory_finegray(tie_breaking):
+
+    event = rng.integers(1, 8, size=40).astype(float)
+    status = rng.choice([0, 1, 2], size=40)
+    eta = rng.standard_normal(40) * 0.5
+    v = rng.standard_normal(40)
+    full, low = [FineGrayDeviance(event=event, status=status, tie_breaking=tie_breaking,
+                                  low_memory=low_memory)
+                 for low_memory in [False, True]]
+    for fg in [full, low]:
+        fg.results = [fg(eta).deviance, fg(eta).gradient, fg.information(eta) @ v]
+    for a, b in zip(full.results, low.results):
+        assert np.allclose(a, b, rtol=1e-12, atol=1e-12)
+
+def test_low_memory_stratified():
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    strata = rng.integers(0, 3, size=n)
+    eta = rng.standard_normal(n) * 0.5
+    v = rng.standard_normal(n)
+    full, low = [StratifiedCoxDeviance(event=event, status=status, strata=strata,
+                                       low_memory=low_memory)
+                 for low_memory in [False, True]]
+    for cox in [full, low]:
+        result = cox(eta)
+        cox.results = [result.deviance, result.gradient, result.diag_hessian,
+                       cox.information(eta) @ v]
+    for a, b in zip(full.results, low.results):
+        assert np.allclose(a, b, rtol=1e-12, atol=1e-12)
+    assert low.memory_footprint()['workspace'] < full.memory_footprint()['workspace']
@@ -0,0 +1,83 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, CoxMultiEndpoint
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+def _outcomes(K, nrep=5, size=5):
+    # K outcomes of the same subjects: the simulated times permuted
+    data = simulate_df(all_combos[-1],
+                       nrep=nrep,
+                       size=size,
+                       rng=rng)
+    start = np.asarray(data['start'])
+    event, status = np.asarray(data['event']), np.asarray(data['status'])
+    n = event.shape[0]
+    perms = [np.arange(n)] + [rng.permutation(n) for _ in range(K - 1)]
+    return (start,
+            np.column_stack([event[p] for p in perms]),
+            np.column_stack([status[p] for p in perms]),
+            np.column_stack([start[p] for p in perms]))
+
+@pytest.mark.parametrize('start_kind', ['none', 'shared', 'each'])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('dtype', [np.float64, np.float32])
+def test_multi_endpoint(start_kind,
+                        tie_breaking,
+                        dtype):
+
+    K = 7
+    start, event, status, starts = _outcomes(K)
+    # start times must precede the event times of every outcome
+    if start_kind == 'shared':
+        start = np.minimum(start, event.min(1) - 0.5)
+    start_arg = {'none': None, 'shared': start, 'each': starts}[start_kind]
+    n = event.shape[0]
+    eta = rng.standard_normal(n).astype(dtype)
+    weight = sample_weights(n)
+    X = rng.standard_normal((n, 3))
+
+    multi = CoxMultiEndpoint(event=event, status=status, start=start_arg,
+                             tie_breaking=tie_breaking, n_jobs=3)
+    result = multi(eta, sample_weight=weight, X=X, gradient=True, n_jobs=2)
+    assert result.deviance.shape == (K,)
+    assert result.gradient.shape == (n, K)
+    assert result.X_gradient.shape == (K, 3)
+
+    tol = dict(rtol=1e-4, atol=1e-4) if dtype == np.float32 else {}
+    for k in range(K):
+        start_k = {'none': None, 'shared': start, 'each': starts[:, k]}[start_kind]
+        cox = CoxDeviance(event=event[:, k], status=status[:, k], start=start_k,
+                          tie_breaking=tie_breaking)
+        expected = cox(eta, weight)
+        assert np.allclose(result.deviance[k], expected.deviance, **tol)
+        assert np.allclose(result.loglik_sat[k], expected.loglik_sat, **tol)
+        assert np.allclose(result.gradient[:, k], expected.gradient, **tol)
+        assert np.allclose(result.X_gradient[k], X.T @ expected.gradient, **tol)
+        assert multi.efron[k] == cox.design.efron
+        assert result.n_events[k] == status[:, k].sum()
+
+    # one thread, no gradients
+    single = multi(eta, sample_weight=weight, n_jobs=1)
+    assert np.allclose(single.deviance, result.deviance)
+    assert single.gradient is None and single.X_gradient is None
+
+def test_multi_endpoint_checks():
+
+    start, event, status, _ = _outcomes(2)
+    n = event.shape[0]
+    with pytest.raises(ValueError):
+        CoxMultiEndpoint(event=event, status=status[:, :1])
+    with pytest.raises(ValueError):
+        CoxMultiEndpoint(event=event, status=2 * status)
+    with pytest.raises(ValueError):
+        CoxMultiEndpoint(event=event, status=status, start=start[:-1])
+    multi = CoxMultiEndpoint(event=event, status=status)
+    with pytest.raises(ValueError):
+        multi(np.zeros(n + 1))
+    with pytest.raises(ValueError):
+        multi(np.zeros(n), X=np.zeros((n - 1, 2)))
@@ -0,0 +1,155 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, StratifiedCoxDeviance
+
+try:
+    import rpy2.robjects as rpy
+    has_rpy2 = True
+except ImportError:
+    has_rpy2 = False
+
+if has_rpy2:
+    from rpy2.robjects.packages import importr
+    from rpy2.robjects import numpy2ri
+    from rpy2.robjects import default_converter
+
+    np_cv_rules = default_converter + numpy2ri.converter
+    survivalR = importr('survival')
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def residuals_by_risk_sets(start, event, status, eta, weight, X, tie_breaking):
+    # the hazard and mean of X at each (Efron) step of each event time,
+    # charged to everyone at risk
+    n, p = X.shape
+    risk = weight * np.exp(eta)
+    cumhaz = np.zeros(n)
+    xbar_hazard = np.zeros((n, p))
+    xbar_death = np.zeros((n, p))
+    for t in np.unique(event[status == 1]):
+        at_risk = (event >= t) & ((start < t) if start is not None else True)
+        tied = (status == 1) & (event == t)
+        K = tied.sum()
+        w_bar = weight[tied].sum() / K
+        for k in range(K):
+            f = k / K if tie_breaking == 'efron' else 0
+            c = np.where(tied, 1 - f, 1) * at_risk
+            R = (c * risk).sum()
+            xbar = (c * risk) @ X / R
+            cumhaz += c * w_bar / R
+            xbar_hazard += (c * w_bar / R)[:, None] * xbar[None, :]
+            xbar_death[tied] += xbar / K
+    schoenfeld = np.where(status[:, None] == 1, X - xbar_death, 0)
+    martingale = status - np.exp(eta) * cumhaz
+    score = schoenfeld - np.exp(eta)[:, None] * (X * cumhaz[:, None] - xbar_hazard)
+    return martingale, score, schoenfeld
+
+def _deviance(status, martingale):
+    log_term = np.where(status == 1, np.log(np.where(status == 1, status - martingale, 1)), 0)
+    return np.sign(martingale) * np.sqrt(-2 * (martingale + log_term))
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_residuals(have_start_times,
+                   tie_breaking,
+                   weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n) + 1
+    weight = sample_weights(n) if weighted else np.ones(n)
+    X = rng.standard_normal((n, 3))
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    residuals = cox.residuals(eta, weight if weighted else None, X=X)
+
+    martingale, score, schoenfeld = residuals_by_risk_sets(start, event, status, eta, weight, X, tie_breaking)
+    assert np.allclose(residuals.martingale, martingale)
+    assert np.allclose(residuals.deviance, _deviance(status, martingale))
+    assert np.allclose(residuals.score, score)
+    assert np.allclose(residuals.schoenfeld, schoenfeld)
+
+    # a single covariate, in single precision
+    single = cox.residuals(eta, weight if weighted else None, X=X[:, 0].astype(np.float32))
+    assert single.score.shape == (n, 1)
+    assert np.allclose(single.score[:, 0], score[:, 0], atol=1e-4)
+
+    # information products are unaffected by the shared scratch space
+    info = cox.information(eta, weight if weighted else None)
+    v = rng.standard_normal(n)
+    before = info @ v
+    cox.residuals(eta, weight if weighted else None, X=X)
+    assert np.allclose(info @ v, before)
+
+    no_X = cox.residuals(eta, weight if weighted else None)
+    assert no_X.score is None and no_X.schoenfeld is None
+
+    with pytest.raises(ValueError):
+        cox.residuals(eta, X=X[1:])
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_stratified_residuals(have_start_times):
+
+    start, event, status = simulate_arrays(have_start_times, nrep=10)
+    n = event.shape[0]
+    strata = rng.choice(3, size=n)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    X = rng.standard_normal((n, 2))
+
+    cox = StratifiedCoxDeviance(event=event, status=status, strata=strata, start=start)
+    residuals = cox.residuals(eta, weight, X=X)
+    for s in range(3):
+        keep = strata == s
+        martingale, score, schoenfeld = residuals_by_risk_sets(None if start is None else start[keep],
+                                                               event[keep],
+                                                               status[keep],
+                                                               eta[keep],
+                                                               weight[keep],
+                                                               X[keep],
+                                                               'efron')
+        assert np.allclose(residuals.martingale[keep], martingale)
+        assert np.allclose(residuals.score[keep], score)
+        assert np.allclose(residuals.schoenfeld[keep], schoenfeld)
+
+@pytest.mark.skipif(not has_rpy2, reason='requires rpy2')
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_residuals_survival(have_start_times, tie_breaking):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    residuals = cox.residuals(eta, weight, X=eta)
+
+    with np_cv_rules.context():
+        rpy.r.assign('event', event)
+        rpy.r.assign('status', status)
+        rpy.r.assign('eta', eta)
+        rpy.r.assign('weight', weight)
+        rpy.r.assign('ties', tie_breaking)
+        if have_start_times:
+            rpy.r.assign('start', start)
+            rpy.r('y = Surv(start, event, status)')
+        else:
+            rpy.r('y = Surv(event, status)')
+        # the coefficient of eta held at 1
+        rpy.r('F = coxph(y ~ eta, weights=weight, ties=ties, init=1, control=coxph.control(iter.max=0))')
+        martingale = rpy.r('residuals(F, type="martingale")')
+        deviance = rpy.r('residuals(F, type="deviance")')
+        score = rpy.r('residuals(F, type="score")')
+        schoenfeld = rpy.r('residuals(F, type="schoenfeld")')
+
+    assert np.allclose(residuals.martingale, martingale)
+    assert np.allclose(residuals.deviance, deviance)
+    assert np.allclose(residuals.score[:, 0], score)
+    # survival drops the censored rows and orders them by time
+    events = status == 1
+    assert np.allclose(np.sort(residuals.schoenfeld[events, 0]), np.sort(schoenfeld))
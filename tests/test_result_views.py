@@ -0,0 +1,118 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, FineGrayDeviance, StratifiedCoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_result_views(have_start_times,
+                      tie_breaking):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    weight = sample_weights(n)
+    etas = [rng.standard_normal(n) * 0.5 for _ in range(3)]
+    v = rng.standard_normal(n)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    expected = [cox(eta, weight) for eta in etas]
+    products = [cox.information(eta, weight) @ v for eta in etas]
+
+    views = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking,
+                        result_views=True)
+    results = []
+    for eta, result, product in zip(etas, expected, products):
+        results.append(views(eta, weight))
+        assert not results[-1].gradient.flags.writeable
+        assert np.allclose(results[-1].deviance, result.deviance)
+        assert np.allclose(results[-1].gradient, result.gradient)
+        assert np.allclose(results[-1].diag_hessian, result.diag_hessian)
+        # the previous result is intact
+        if len(results) > 1:
+            assert np.allclose(results[-2].gradient, expected[len(results) - 2].gradient)
+        I = views.information(eta, weight)
+        Iv = I @ v
+        assert not Iv.flags.writeable
+        assert np.allclose(Iv, product)
+        assert np.allclose(I @ (2 * v), 2 * product)
+        assert np.allclose(Iv, product)
+
+    # the first result's buffers were reused by the third
+    assert np.shares_memory(results[0].gradient, results[2].gradient)
+
+    # caller's buffers
+    gradient, diag_hessian, Iv = np.empty(n), np.empty(n), np.empty(n)
+    for obj in [cox, views]:
+        result = obj(etas[0], weight, out=(gradient, diag_hessian))
+        assert result.gradient is gradient and result.diag_hessian is diag_hessian
+        assert np.allclose(gradient, expected[0].gradient)
+        assert np.allclose(diag_hessian, expected[0].diag_hessian)
+        assert obj.information(etas[0], weight).matvec(v, out=Iv) is Iv
+        assert np.allclose(Iv, products[0])
+
+    # a cached result copied into other buffers
+    other = np.empty(n), np.empty(n)
+    result = cox(etas[0], weight, out=other)
+    assert result.gradient is other[0]
+    assert np.allclose(other[0], expected[0].gradient)
+    assert np.allclose(cox.information(etas[0], weight) @ v, products[0])
+
+    with pytest.raises(ValueError):
+        cox(etas[1], weight, out=(np.empty(n + 1), np.empty(n + 1)))
+
+def test_result_views_stratified():
+
+    data = simulate_df(all_combos[-1],
+                       nrep=5,
+                       size=5,
+                       rng=rng)
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    strata = rng.integers(0, 3, size=n)
+    eta = rng.standard_normal(n) * 0.5
+    v = rng.standard_normal(n)
+
+    cox = StratifiedCoxDeviance(event=event, status=status, strata=strata)
+    expected = cox(eta)
+    product = cox.information(eta) @ v
+
+    gradient, diag_hessian, Iv = np.empty(n), np.empty(n), np.empty(n)
+    result = cox(eta, out=(gradient, diag_hessian))
+    assert result.gradient is gradient
+    assert np.allclose(gradient, expected.gradient)
+    assert np.allclose(diag_hessian, expected.diag_hessian)
+    assert cox.information(eta).matvec(v, out=Iv) is Iv
+    assert np.allclose(Iv, product)
+
+def test_result_views_finegray():
+
+    event = rng.integers(1, 8, size=40).astype(float)
+    status = rng.choice([0, 1, 2], size=40)
+    eta = rng.standard_normal(40) * 0.5
+    v = rng.standard_normal(40)
+
+    fg = FineGrayDeviance(event=event, status=status)
+    expected = fg(eta)
+    product = fg.information(eta) @ v
+
+    views = FineGrayDeviance(event=event, status=status, result_views=True)
+    result = views(eta)
+    assert not result.gradient.flags.writeable
+    assert np.allclose(result.gradient, expected.gradient)
+    gradient, diag_hessian, Iv = np.empty(40), np.empty(40), np.empty(40)
+    views(eta, out=(gradient, diag_hessian))
+    assert np.allclose(diag_hessian, expected.diag_hessian)
+    assert views.information(eta).matvec(v, out=Iv) is Iv
+    assert np.allclose(Iv, product)
@@ -0,0 +1,124 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance, StratifiedCoxDeviance
+
+try:
+    import rpy2.robjects as rpy
+    has_rpy2 = True
+except ImportError:
+    has_rpy2 = False
+
+if has_rpy2:
+    from rpy2.robjects.packages import importr
+    from rpy2.robjects import numpy2ri
+    from rpy2.robjects import default_converter
+
+    np_cv_rules = default_converter + numpy2ri.converter
+    survivalR = importr('survival')
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+def sandwich_from_residuals(score, weight, cluster, information):
+    labels, codes = np.unique(cluster, return_inverse=True)
+    U = np.zeros((labels.shape[0], score.shape[1]))
+    np.add.at(U, codes, weight[:, None] * score)
+    meat = U.T @ U
+    bread = np.linalg.inv(information)
+    return meat, bread @ meat @ bread
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('weighted', [True, False])
+def test_robust_variance(have_start_times,
+                         tie_breaking,
+                         weighted):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n) if weighted else np.ones(n)
+    X = rng.standard_normal((n, 4))
+    # string labels, several rows each
+    cluster = np.array(['id%d' % i for i in rng.choice(n // 3, size=n)])
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    sample_weight = weight if weighted else None
+    score = cox.residuals(eta, sample_weight, X=X).score
+    information = X.T @ (cox.information(eta, sample_weight) @ X)
+    meat, covariance = sandwich_from_residuals(score, weight, cluster, information)
+
+    for n_jobs in [1, 3]:
+        robust = cox.robust_variance(eta, X, cluster, sample_weight, n_jobs=n_jobs)
+        assert np.allclose(robust.information, information)
+        assert np.allclose(robust.meat, meat)
+        assert np.allclose(robust.covariance, covariance)
+
+    # a cluster per observation
+    robust = cox.robust_variance(eta, X, np.arange(n), sample_weight)
+    D = weight[:, None] * score
+    assert np.allclose(robust.meat, D.T @ D)
+
+    with pytest.raises(ValueError):
+        cox.robust_variance(eta, X, cluster[1:], sample_weight)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_stratified_robust_variance(have_start_times):
+
+    start, event, status = simulate_arrays(have_start_times, nrep=10)
+    n = event.shape[0]
+    strata = rng.choice(3, size=n)
+    eta = rng.standard_normal(n)
+    weight = sample_weights(n)
+    X = rng.standard_normal((n, 3))
+    # clusters spanning strata
+    cluster = rng.choice(n // 4, size=n)
+
+    cox = StratifiedCoxDeviance(event=event, status=status, strata=strata, start=start)
+    score = cox.residuals(eta, weight, X=X).score
+    information = X.T @ (cox.information(eta, weight) @ X)
+    meat, covariance = sandwich_from_residuals(score, weight, cluster, information)
+
+    for n_jobs in [1, 2]:
+        robust = cox.robust_variance(eta, X, cluster, weight, n_jobs=n_jobs)
+        assert np.allclose(robust.information, information)
+        assert np.allclose(robust.meat, meat)
+        assert np.allclose(robust.covariance, covariance)
+
+@pytest.mark.skipif(not has_rpy2, reason='requires rpy2')
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_robust_variance_survival(have_start_times, tie_breaking):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    weight = sample_weights(n)
+    X = rng.standard_normal((n, 2))
+    beta = np.array([0.5, -0.3])
+    cluster = rng.choice(n // 3, size=n)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    robust = cox.robust_variance(X @ beta, X, cluster, weight)
+
+    with np_cv_rules.context():
+        rpy.r.assign('event', event)
+        rpy.r.assign('status', status)
+        rpy.r.assign('X', X)
+        rpy.r.assign('beta', beta)
+        rpy.r.assign('weight', weight)
+        rpy.r.assign('cluster', cluster)
+        rpy.r.assign('ties', tie_breaking)
+        if have_start_times:
+            rpy.r.assign('start', start)
+            rpy.r('y = Surv(start, event, status)')
+        else:
+            rpy.r('y = Surv(event, status)')
+        # the coefficients held at beta
+        rpy.r('F = coxph(y ~ X, weights=weight, ties=ties, cluster=cluster, init=beta, control=coxph.control(iter.max=0))')
+        V = rpy.r('F$var')
+        naive = rpy.r('F$naive.var')
+
+    assert np.allclose(robust.covariance, V)
+    assert np.allclose(np.linalg.inv(robust.information), naive)
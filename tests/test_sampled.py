@@ -0,0 +1,53 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_sampled(have_start_times,
+                 tie_breaking):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=3,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    weight = sample_weights(n)
+    eta = rng.standard_normal(n) * 0.5
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    exact = cox(eta, weight)
+
+    # every row drawn: the deviance itself
+    full = cox.sampled_deviance(eta, n, sample_weight=weight, n_jobs=2)
+    assert np.allclose(full.deviance, exact.deviance)
+    assert np.allclose(full.gradient, exact.gradient)
+    assert full.deviance_variance == 0
+
+    # the draws depend on the seed only, not on the split across threads
+    one = cox.sampled_deviance(eta, 5, sample_weight=weight, seed=3, n_jobs=1)
+    four = cox.sampled_deviance(eta, 5, sample_weight=weight, seed=3, n_jobs=4)
+    assert np.allclose(one.deviance, four.deviance)
+    assert np.allclose(one.gradient, four.gradient)
+    assert np.allclose(one.diag_hessian, four.diag_hessian)
+
+    # the estimates' spread over seeds is about what their variance says
+    sampled = [cox.sampled_deviance(eta, 20, sample_weight=weight, seed=seed) for seed in range(50)]
+    deviance = np.array([s.deviance for s in sampled])
+    variance = np.mean([s.deviance_variance for s in sampled])
+    assert 0.6**2 < deviance.var() / variance < 1.6**2
+
+def test_sampled_controls():
+
+    cox = CoxDeviance(event=rng.exponential(size=10), status=np.ones(10))
+    with pytest.raises(ValueError):
+        cox.sampled_deviance(np.zeros(10), 0)
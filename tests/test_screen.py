@@ -0,0 +1,65 @@
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_arrays,
+                      rng,
+                      sample_weights)
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('dtype', [np.float64, np.float32, np.int8])
+def test_score_screen(have_start_times,
+                      tie_breaking,
+                      dtype):
+
+    start, event, status = simulate_arrays(have_start_times)
+    n = event.shape[0]
+    Z = rng.standard_normal((n, 2))
+    eta = Z @ np.array([0.3, -0.2])
+    weight = sample_weights(n)
+    # dosages in 0, 1, 2 as int8, or continuous columns
+    if dtype == np.int8:
+        X = rng.integers(0, 3, size=(n, 23)).astype(dtype)
+    else:
+        X = rng.standard_normal((n, 23)).astype(dtype)
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    screen = cox.score_screen(eta, X, sample_weight=weight, Z=Z, block_size=5, n_jobs=2)
+    unadjusted = cox.score_screen(eta, X, sample_weight=weight, n_jobs=1)
+
+    result = cox(eta, weight)
+    I = cox.information(eta, weight)
+    Xf = X.astype(float)
+    IX = np.column_stack([I @ Xf[:, j] for j in range(X.shape[1])])
+    IZ = np.column_stack([I @ Z[:, j] for j in range(Z.shape[1])])
+    score = -0.5 * Xf.T @ result.gradient
+    xIx = (Xf * IX).sum(0)
+    adjustment = ((IZ.T @ Xf) * np.linalg.solve(Z.T @ IZ, IZ.T @ Xf)).sum(0)
+
+    assert np.allclose(screen.score, score)
+    assert np.allclose(unadjusted.score, score)
+    assert np.allclose(unadjusted.variance, xIx)
+    assert np.allclose(screen.variance, xIx - adjustment)
+    assert np.allclose(screen.statistic, score / np.sqrt(xIx - adjustment))
+    assert np.all((screen.pvalue >= 0) & (screen.pvalue <= 1))
+
+def test_score_screen_memmap(tmp_path):
+
+    start, event, status = simulate_arrays(False)
+    n = event.shape[0]
+    eta = rng.standard_normal(n)
+    # a file of dosages stored a row per candidate, read transposed in place
+    dosage = np.memmap(tmp_path / 'dosage.bin', dtype=np.int8, mode='w+', shape=(50, n))
+    dosage[:] = rng.integers(0, 3, size=(50, n))
+    dosage.flush()
+    X = np.memmap(tmp_path / 'dosage.bin', dtype=np.int8, mode='r', shape=(50, n)).T
+
+    cox = CoxDeviance(event=event, status=status)
+    screen = cox.score_screen(eta, X, block_size=16)
+    dense = cox.score_screen(eta, np.asarray(X, float))
+    assert np.allclose(screen.score, dense.score)
+    assert np.allclose(screen.variance, dense.variance)
+    with pytest.raises(ValueError):
+        cox.score_screen(eta, X[1:])
@@ -0,0 +1,96 @@
+import multiprocessing
+import os
+import pickle
+import subprocess
+import sys
+from concurrent.futures import ProcessPoolExecutor
+
+import numpy as np
+import pytest
+
+from coxdev import CoxDeviance
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng,
+                      sample_weights)
+
+def _deviance(args):
+    cox, eta, weight = args
+    return cox(eta, weight).deviance
+
+@pytest.mark.parametrize('have_start_times', [True, False])
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_shared(have_start_times,
+                tie_breaking):
+
+    data = simulate_df(all_combos[-1],
+                       nrep=50,
+                       size=5,
+                       rng=rng)
+    start = np.asarray(data['start']) if have_start_times else None
+    event = np.asarray(data['event'])
+    status = np.asarray(data['status'])
+    n = event.shape[0]
+    weight = sample_weights(n)
+    etas = [rng.standard_normal(n) * 0.5 for _ in range(4)]
+
+    cox = CoxDeviance(event=event, status=status, start=start, tie_breaking=tie_breaking)
+    expected = [cox(eta, weight).deviance for eta in etas]
+    private = pickle.dumps(cox)
+
+    assert cox.share_memory() is cox
+    assert not cox._event_order.flags.writeable
+    assert np.allclose(cox(etas[0], weight).deviance, expected[0])
+
+    # the pickle carries the handle, not the arrays
+    shared = pickle.dumps(cox)
+    assert len(shared) < len(private) - 8 * n
+    copy = pickle.loads(shared)
+    assert not copy._shared.owner
+    assert np.allclose(copy(etas[1], weight).deviance, expected[1])
+
+    with ProcessPoolExecutor(2) as pool:
+        deviances = list(pool.map(_deviance, [(cox, eta, weight) for eta in etas]))
+    assert np.allclose(deviances, expected)
+
+    with pytest.raises(ValueError):
+        cox.append(event[:2], status[:2], None if start is None else start[:2])
+
+    del copy
+    cox.release_shared_memory()
+    assert cox._shared is None
+    assert np.allclose(cox(etas[2], weight).deviance, expected[2])
+    assert np.allclose(pickle.loads(pickle.dumps(cox))(etas[3], weight).deviance, expected[3])
+
+# share, attach from a pool of workers started by argv[1], release
+_share_and_release = """
+import multiprocessing, sys
+from concurrent.futures import ProcessPoolExecutor
+from operator import attrgetter
+import numpy as np
+from coxdev import CoxDeviance
+
+rng = np.random.default_rng(0)
+n = 50
+cox = CoxDeviance(event=rng.exponential(size=n), status=rng.choice([0, 1], size=n))
+cox.share_memory()
+context = multiprocessing.get_context(sys.argv[1])
+with ProcessPoolExecutor(2, mp_context=context) as pool:
+    assert list(pool.map(attrgetter('design.n'), [cox] * 4)) == [n] * 4
+cox.release_shared_memory()
+"""
+
+@pytest.mark.parametrize('start_method', ['fork', 'spawn', 'forkserver'])
+def test_shared_tracker(start_method):
+
+    # the workers share the owner's resource tracker, which must still
+    # hold the block when the owner unlinks it
+    if start_method not in multiprocessing.get_all_start_methods():
+        pytest.skip('no %s start method' % start_method)
+    env = dict(os.environ, PYTHONPATH=os.pathsep.join(sys.path))
+    result = subprocess.run([sys.executable, '-c', _share_and_release, start_method],
+                            capture_output=True, text=True, env=env)
+    assert result.returncode == 0, result.stderr
+    assert 'resource_tracker' not in result.stderr, result.stderr
+    assert 'KeyError' not in result.stderr, result.stderr
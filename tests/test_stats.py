@@ -0,0 +1,86 @@
+import pytest
+
+import numpy as np
+from coxdev import CoxDeviance, StratifiedCoxDeviance, set_stats_enabled
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng)
+
+rng = np.random.default_rng(0)
+
+@pytest.fixture
+def enabled():
+    previous = set_stats_enabled(True)
+    yield
+    set_stats_enabled(previous)
+
+def _data(nrep=10):
+    return simulate_df(all_combos[-1],
+                       nrep=nrep,
+                       size=5,
+                       rng=rng)
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+def test_stats(enabled,
+               tie_breaking,
+               ncall=3):
+
+    data = _data()
+    cox = CoxDeviance(event=data['event'],
+                      start=data['start'],
+                      status=data['status'],
+                      tie_breaking=tie_breaking)
+    n = data.shape[0]
+    cox.reset_stats()
+    for _ in range(ncall):
+        eta = rng.standard_normal(n)
+        cox.information(eta) @ rng.standard_normal((n, 2))
+
+    stats = cox.stats()
+    for phase in ['compute_sat_loglik', 'cox_dev', 'reorder', 'forward_cumsums',
+                  'python_hash', 'python_exp_w', 'python_copy']:
+        assert stats[phase]['calls'] >= ncall
+        assert stats[phase]['seconds'] >= 0
+        assert stats[phase]['bytes'] > 0
+    assert stats['hessian_matvec']['calls'] == 2 * ncall
+    # once for the deviance, once per matvec
+    assert stats['sum_over_risk_set']['calls'] == 3 * ncall
+    assert stats['sum_over_events']['calls'] == 2 * ncall
+    assert stats['preprocess']['calls'] == 0
+    assert stats['buffer_remaps'] > 0
+
+    cox.reset_stats()
+    stats = cox.stats()
+    assert all(stats[phase]['calls'] == 0 for phase in stats if phase != 'buffer_remaps')
+    assert stats['buffer_remaps'] == 0
+
+def test_preprocess_counted(enabled):
+    data = _data()
+    CoxDeviance(event=data['event'], status=data['status']).reset_stats()
+    cox = CoxDeviance(event=data['event'], status=data['status'])
+    assert cox.stats()['preprocess']['calls'] == 1
+
+def test_disabled():
+    set_stats_enabled(False)
+    data = _data()
+    cox = CoxDeviance(event=data['event'], status=data['status'])
+    cox.reset_stats()
+    cox.information(rng.standard_normal(data.shape[0])) @ rng.standard_normal(data.shape[0])
+    stats = cox.stats()
+    assert all(stats[phase]['calls'] == 0 for phase in stats if phase != 'buffer_remaps')
+    assert stats['buffer_remaps'] == 0
+
+def test_stratified_stats(enabled):
+    data = _data()
+    n = data.shape[0]
+    cox = StratifiedCoxDeviance(event=data['event'],
+                                start=data['start'],
+                                status=data['status'],
+                                strata=rng.choice(3, size=n))
+    cox.reset_stats()
+    cox(rng.standard_normal(n))
+    stats = cox.stats()
+    assert stats['python_gather']['calls'] == 3
+    assert stats['python_scatter']['calls'] == 3
+    assert stats['cox_dev']['calls'] == 3
@@ -0,0 +1,79 @@
+import pickle
+from concurrent.futures import ThreadPoolExecutor
+
+import pytest
+
+import numpy as np
+from coxdev import CoxDeviance
+from coxdev.base import Workspace
+
+from simulate import (simulate_df,
+                      all_combos,
+                      rng)
+
+rng = np.random.default_rng(0)
+
+def _cox(tie_breaking,
+         have_start_times):
+    data = simulate_df(all_combos[-1],
+                       nrep=50,
+                       size=5,
+                       rng=rng)
+    start = data['start'] if have_start_times else None
+    return CoxDeviance(event=data['event'],
+                       start=start,
+                       status=data['status'],
+                       tie_breaking=tie_breaking)
+
+@pytest.mark.parametrize('tie_breaking', ['efron', 'breslow'])
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_threads_agree(tie_breaking,
+                       have_start_times,
+                       ntask=32):
+
+    cox = _cox(tie_breaking, have_start_times)
+    n = cox.design.n
+    V = rng.standard_normal((n, 3))
+    tasks = [(rng.standard_normal(n) * 0.5,
+              rng.uniform(1, 2, size=n)) for _ in range(ntask)]
+
+    def evaluate(task):
+        eta, weight = task
+        result = cox(eta, weight)
+        I = cox.information(eta, weight)
+        return (result.deviance,
+                result.gradient.copy(),
+                I @ V)
+
+    serial = [evaluate(task) for task in tasks]
+    with ThreadPoolExecutor(8) as pool:
+        threaded = list(pool.map(evaluate, tasks))
+
+    for (D, G, IV), (D_t, G_t, IV_t) in zip(serial, threaded):
+        assert np.allclose(D, D_t)
+        assert np.allclose(G, G_t)
+        assert np.allclose(IV, IV_t)
+
+def test_explicit_workspace():
+
+    cox = _cox('efron', True)
+    n = cox.design.n
+    eta = rng.standard_normal(n) * 0.5
+    V = rng.standard_normal((n, 2))
+
+    ws = Workspace(n)
+    I_ws = cox.information(eta, workspace=ws)
+    # evaluating elsewhere in the thread's workspace leaves ws alone
+    cox(-eta)
+    I = cox.information(eta)
+
+    assert np.allclose(cox(eta, workspace=ws).deviance, cox(eta).deviance)
+    assert np.allclose(I_ws @ V, I @ V)
+
+def test_pickle():
+
+    cox = _cox('efron', True)
+    eta = rng.standard_normal(cox.design.n) * 0.5
+    cox(eta)
+    cox2 = pickle.loads(pickle.dumps(cox))
+    assert np.allclose(cox2(eta).deviance, cox(eta).deviance)
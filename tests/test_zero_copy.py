@@ -0,0 +1,154 @@
+import tracemalloc
+
+import pytest
+import numpy as np
+
+from coxdev import CoxDeviance
+from coxdev.coxc import (cox_dev as _cox_dev,
+                         hessian_matvec as _hessian_matvec,
+                         compute_sat_loglik as _compute_sat_loglik)
+
+rng = np.random.default_rng(0)
+
+n = 20000
+event = rng.exponential(size=n)
+start = event * rng.uniform(size=n)
+status = rng.binomial(1, 0.6, size=n)
+
+# numpy registers its data buffers with tracemalloc, so any array
+# created to convert an argument shows up in the peak; the compiled
+# code's own scratch space is allocated by Eigen and does not
+
+def _kernels(cox, eta, weight, arg):
+
+    ws = cox._workspace
+
+    loglik_sat = _compute_sat_loglik(cox._first,
+                                     cox._last,
+                                     weight,
+                                     cox._event_order,
+                                     cox._status,
+                                     ws._forward_cumsum_buffers[0])
+    deviance = _cox_dev(eta,
+                        weight,
+                        ws._exp_w_buffer,
+                        cox._event_order,
+                        cox._start_order,
+                        cox._status,
+                        cox._first,
+                        cox._last,
+                        cox._scaling,
+                        cox._event_map,
+                        cox._start_map,
+                        loglik_sat,
+                        ws._T_1_term,
+                        ws._T_2_term,
+                        ws._grad_buffer,
+                        ws._diag_hessian_buffer,
+                        ws._diag_part_buffer,
+                        ws._w_avg_buffer,
+                        ws._event_reorder_buffers,
+                        ws._risk_sum_buffers,
+                        ws._forward_cumsum_buffers,
+                        ws._forward_scratch_buffer,
+                        ws._reverse_cumsum_buffers,
+                        cox._have_start_times,
+                        cox._efron)
+    _hessian_matvec(arg,
+                    eta,
+                    weight,
+                    ws._risk_sum_buffers[0],
+                    ws._diag_part_buffer,
+                    ws._w_avg_buffer,
+                    ws._exp_w_buffer,
+                    ws._reverse_cumsum_buffers[0],
+                    ws._reverse_cumsum_buffers[1],
+                    cox._event_order,
+                    cox._start_order,
+                    cox._status,
+                    cox._first,
+                    cox._last,
+                    cox._scaling,
+                    cox._event_map,
+                    cox._start_map,
+                    ws._risk_sum_buffers,
+                    ws._forward_cumsum_buffers,
+                    ws._forward_scratch_buffer,
+                    ws._reverse_cumsum_buffers,
+                    ws._hess_matvec_buffer,
+                    cox._have_start_times,
+                    cox._efron)
+    return deviance
+
+def _peak(cox, eta, weight, arg):
+    tracemalloc.start()
+    try:
+        tracemalloc.reset_peak()
+        base = tracemalloc.get_traced_memory()[0]
+        _kernels(cox, eta, weight, arg)
+        return tracemalloc.get_traced_memory()[1] - base
+    finally:
+        tracemalloc.stop()
+
+def _layouts(dtype):
+    # (eta, weight, arg) in the layouts callers commonly hand us
+    C = rng.standard_normal((n, 3)).astype(dtype)
+    F = np.asfortranarray(C)
+    C[:,1] = F[:,1] = rng.uniform(1, 2, size=n)
+    return {'contiguous': (np.ascontiguousarray(C[:,0]),
+                           np.ascontiguousarray(C[:,1]),
+                           np.ascontiguousarray(C[:,2])),
+            'C_column': (C[:,0], C[:,1], C[:,2]),
+            'F_column': (F[:,0], F[:,1], F[:,2]),
+            'every_other': tuple(np.repeat(C[:,j], 2)[::2] for j in range(3))}
+
+@pytest.mark.parametrize('dtype', [np.float64, np.float32])
+@pytest.mark.parametrize('layout', ['contiguous', 'C_column', 'F_column', 'every_other'])
+@pytest.mark.parametrize('have_start_times', [True, False])
+def test_no_copy(dtype,
+                 layout,
+                 have_start_times):
+
+    cox = CoxDeviance(event=event,
+                      start=start if have_start_times else None,
+                      status=status)
+    eta, weight, arg = _layouts(dtype)[layout]
+    cox._workspace._exp_w_buffer[:] = weight * np.exp(eta)
+
+    # a single converted argument would cost n * itemsize bytes
+    assert _peak(cox, eta, weight, arg) < n * 2
+
+    # results agree with contiguous float64 input
+    D = _kernels(cox, eta, weight, arg)
+    ws = cox._workspace
+    G, H = ws._grad_buffer.copy(), ws._hess_matvec_buffer.copy()
+    D64 = _kernels(cox,
+                   eta.astype(float),
+                   weight.astype(float),
+                   arg.astype(float))
+    G64, H64 = ws._grad_buffer, ws._hess_matvec_buffer
+    tol = 1e-10 if dtype == np.float64 else 1e-4
+    assert np.allclose(D, D64, rtol=tol)
+    assert np.allclose(G, G64, rtol=tol, atol=tol)
+    assert np.allclose(H, H64, rtol=tol, atol=tol)
+
+def test_copy_detected():
+    # integer input has no overload of its own and is converted
+    cox = CoxDeviance(event=event,
+                      status=status)
+    eta, weight, arg = _layouts(np.float64)['contiguous']
+    cox._workspace._exp_w_buffer[:] = weight * np.exp(eta)
+    assert _peak(cox, eta, weight, np.ones(n, np.int64)) >= n * 8
+    
+def test_coxdeviance_strided():
+    X = np.asfortranarray(rng.standard_normal((n, 4)))
+    beta = rng.standard_normal(4) / np.sqrt(n)
+    cox = CoxDeviance(event=event,
+                      start=start,
+                      status=status)
+    eta = X @ beta
+    I = cox.information(eta)
+    C = np.ascontiguousarray(X)
+    assert np.allclose(I @ X, I @ C)
+    assert np.allclose(cox(eta.astype(np.float32)).deviance,
+                       cox(eta).deviance, rtol=1e-5)